@@ -132,6 +132,48 @@ public struct UpdateAccessoryInput: Encodable, Decodable {
     }
 }
 
+// MARK: - Change Feed
+
+/// One characteristic value change, numbered in the order the server saw it
+public struct CharacteristicChange: Encodable, Decodable {
+    public var sequence: UInt64
+    public var home: String
+    public var room: String
+    public var accessory: String
+    public var serviceId: UUID
+    public var characteristicId: UUID
+    public var value: String
+    
+    public init(sequence: UInt64, home: String, room: String, accessory: String, serviceId: UUID, characteristicId: UUID, value: String) {
+        self.sequence = sequence
+        self.home = home
+        self.room = room
+        self.accessory = accessory
+        self.serviceId = serviceId
+        self.characteristicId = characteristicId
+        self.value = value
+    }
+}
+
+/// Response of GET /events
+///
+/// `reset` means the changes the client asked for are no longer buffered (or
+/// `epoch` changed because the server restarted); the client has to reread
+/// the accessories it mirrors and continue from `sequence`.
+public struct ChangeBatch: Encodable, Decodable {
+    public var epoch: String
+    public var sequence: UInt64
+    public var reset: Bool
+    public var changes: [CharacteristicChange]
+    
+    public init(epoch: String, sequence: UInt64, reset: Bool, changes: [CharacteristicChange]) {
+        self.epoch = epoch
+        self.sequence = sequence
+        self.reset = reset
+        self.changes = changes
+    }
+}
+
 enum UnknownFormatError : Error {
     case formatValue(format: String)
 }
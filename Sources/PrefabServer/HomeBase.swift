@@ -34,6 +34,7 @@ public class HomeBase: NSObject, ObservableObject, HMHomeManagerDelegate {
         Logger().log("Manager: \(manager)")
         Logger().log("Homes: \(manager.homes)")
         homes = manager.homes
+        ChangeFeed.shared.observe(homes: manager.homes)
     }
     
     public func getHomes() {
@@ -133,7 +133,7 @@ extension Server {
         let hkService = hkAccessory.services.first(where: { $0.uniqueIdentifier.uuidString == updateAccessoryInput.serviceId })
         guard let hkService else {
             logger.error("Service not found: \(updateAccessoryInput.serviceId, privacy: .public)")
-            throw HBHTTPError(.notFound)
+            throw HBHTTPError(.notFound, message: "Service not found.")
         }
         logger.debug("Found service: \(hkService.name, privacy: .public) type=\(hkService.serviceType, privacy: .public)")
 
@@ -141,7 +141,7 @@ extension Server {
         let hkChar = hkService.characteristics.first(where: { $0.uniqueIdentifier.uuidString == updateAccessoryInput.characteristicId })
         guard let hkChar else {
             logger.error("Characteristic not found: \(updateAccessoryInput.characteristicId, privacy: .public)")
-            throw HBHTTPError(.notFound)
+            throw HBHTTPError(.notFound, message: "Characteristic not found.")
         }
         logger.debug("Found characteristic: \(hkChar.localizedDescription, privacy: .public) type=\(hkChar.characteristicType, privacy: .public) format=\(hkChar.metadata?.format ?? "nil", privacy: .public) properties=\(hkChar.properties.joined(separator: ","), privacy: .public)")
 
@@ -164,6 +164,8 @@ extension Server {
                 logger.error("writeValue completion with error: \(error.localizedDescription, privacy: .public)")
             } else {
                 logger.debug("writeValue completed successfully.")
+                // HomeKit does not call the accessory delegate for our own writes
+                ChangeFeed.shared.record(accessory: hkAccessory, service: hkService, characteristic: hkChar)
             }
             group.leave()
         }
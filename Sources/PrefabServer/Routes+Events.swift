@@ -0,0 +1,115 @@
+//
+//  Routes+Events.swift
+//  PrefabServer
+//
+//  Characteristic change feed (long-poll)
+//
+
+import Foundation
+import HomeKit
+import Hummingbird
+import OSLog
+
+/// Buffers characteristic value changes so clients can long-poll for them
+///
+/// Changes reported by HomeKit (accessory delegate callbacks) and successful
+/// writes through this server are numbered with an increasing sequence. The
+/// last `capacity` changes are kept; a client asking for older ones gets a
+/// reset and rereads its accessories. `epoch` is new on every launch, so a
+/// client also notices a restarted server.
+@available(macCatalyst 14.0, *)
+public final class ChangeFeed: NSObject, HMAccessoryDelegate {
+    public static let shared = ChangeFeed()
+
+    let epoch = UUID().uuidString
+    private let capacity = 1024
+    private let lock = NSLock()
+    private var changes: [CharacteristicChange] = []
+    private var sequence: UInt64 = 0
+
+    /// Become the delegate of every accessory and turn on value notifications
+    func observe(homes: [HMHome]) {
+        for home in homes {
+            for accessory in home.accessories {
+                accessory.delegate = self
+                for service in accessory.services {
+                    for characteristic in service.characteristics
+                        where characteristic.properties.contains(HMCharacteristicPropertySupportsEventNotification) {
+                        characteristic.enableNotification(true) { error in
+                            if let error {
+                                Logger().error("enableNotification failed for \(characteristic.localizedDescription, privacy: .public): \(error.localizedDescription, privacy: .public)")
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    public func accessory(_ accessory: HMAccessory, service: HMService, didUpdateValueFor characteristic: HMCharacteristic) {
+        record(accessory: accessory, service: service, characteristic: characteristic)
+    }
+
+    /// Append a change with the characteristic's current value
+    func record(accessory: HMAccessory, service: HMService, characteristic: HMCharacteristic) {
+        let homeName = HomeBase.shared.homes.first(where: { $0.accessories.contains(accessory) })?.name ?? ""
+        lock.lock()
+        defer { lock.unlock() }
+        sequence += 1
+        changes.append(CharacteristicChange(sequence: sequence, home: homeName, room: accessory.room?.name ?? "", accessory: accessory.name, serviceId: service.uniqueIdentifier, characteristicId: characteristic.uniqueIdentifier, value: "\(characteristic.value ?? "")"))
+        if changes.count > capacity {
+            changes.removeFirst(changes.count - capacity)
+        }
+    }
+
+    /// Changes after `since`, or nil if there are none yet
+    private func batch(since: UInt64?) -> ChangeBatch? {
+        lock.lock()
+        defer { lock.unlock() }
+        guard let since else {
+            return ChangeBatch(epoch: epoch, sequence: sequence, reset: false, changes: [])
+        }
+        let oldest = changes.first?.sequence ?? sequence + 1
+        if since > sequence || since + 1 < oldest {
+            return ChangeBatch(epoch: epoch, sequence: sequence, reset: true, changes: [])
+        }
+        if since == sequence {
+            return nil
+        }
+        return ChangeBatch(epoch: epoch, sequence: sequence, reset: false, changes: changes.filter { $0.sequence > since })
+    }
+
+    /// Wait up to `wait` seconds for changes after `since`
+    func changes(since: UInt64?, wait: TimeInterval) async -> ChangeBatch {
+        let deadline = Date().addingTimeInterval(wait)
+        while true {
+            if let batch = batch(since: since) {
+                return batch
+            }
+            if Date() >= deadline || Task.isCancelled {
+                return ChangeBatch(epoch: epoch, sequence: since ?? 0, reset: false, changes: [])
+            }
+            try? await Task.sleep(nanoseconds: 100_000_000)
+        }
+    }
+}
+
+extension Server {
+    /// GET /events?since=N&wait=S
+    ///
+    /// Without `since` answers at once with the current sequence, which is where
+    /// a client starts after reading its accessories. With `since` returns the
+    /// changes after it, waiting up to `wait` seconds (at most 60) for the first one.
+    func getEvents(_ request: HBRequest) async throws -> String {
+        let since = request.uri.queryParameters.get("since", as: UInt64.self)
+        let wait = min(max(request.uri.queryParameters.get("wait", as: Double.self) ?? 0, 0), 60)
+
+        let batch = await ChangeFeed.shared.changes(since: since, wait: wait)
+
+        let jsonEncoder = JSONEncoder()
+        let jsonData = try jsonEncoder.encode(batch)
+        let json = String(data: jsonData, encoding: String.Encoding.utf8)
+
+        return json!
+    }
+}
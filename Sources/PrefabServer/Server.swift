@@ -89,6 +89,24 @@ struct HomeKitAuthLogger: HBMiddleware {
     }
 }
 
+/// Reports the time spent on each request in a Server-Timing header, so clients
+/// can tell server time from network time. Logs the caller's trace context.
+@available(macCatalyst 14.0, *)
+struct ServerTimingMiddleware: HBMiddleware {
+    func apply(to request: HBRequest, next: HBResponder) -> EventLoopFuture<HBResponse> {
+        let started = DispatchTime.now().uptimeNanoseconds
+        if let traceparent = request.headers.first(name: "traceparent") {
+            request.logger.debug("traceparent \(traceparent)")
+        }
+        return next.respond(to: request).map { response in
+            var response = response
+            let elapsedMs = Double(DispatchTime.now().uptimeNanoseconds - started) / 1_000_000
+            response.headers.replaceOrAdd(name: "Server-Timing", value: String(format: "app;dur=%.3f", elapsedMs))
+            return response
+        }
+    }
+}
+
 @available(macCatalyst 14.0, *)
 class Server  {
     var homeBase: HomeBase
@@ -147,6 +165,7 @@ class Server  {
             let application = HBApplication(configuration: .init(address: .hostname("0.0.0.0", port: 8091)))
             self.app = application
             application.logger.logLevel = .debug
+            application.middleware.add(ServerTimingMiddleware())
             application.middleware.add(HBLogRequestsMiddleware(.debug))
             application.middleware.add(HomeKitAuthLogger())
             application.router.get("homes", use: self.getHomes)
@@ -158,6 +177,8 @@ class Server  {
             application.router.get("accessories/:home/:room", use: self.getAccessories)
             application.router.get("accessories/:home/:room/:accessory", use: self.getAccessory)
             application.router.put("accessories/:home/:room/:accessory", use: self.updateAccessory)
+
+            application.router.get("events", use: self.getEvents)
             
             application.router.get("scenes/:home", use: self.getScenes)
             application.router.get("scenes/:home/:scene", use: self.getScene)
@@ -0,0 +1,379 @@
+/**
+ * @file prefab_bench.cpp
+ * @brief Throughput, latency and allocation benchmarks for the Prefab client
+ *
+ * Runs every PrefabClient method against an in-process mock server with a
+ * generated data set, then a set of serialization microbenchmarks for the
+ * model types. Allocations are counted with a replaced global operator new on
+ * client threads only; the mock server's own allocations are excluded.
+ *
+ * Usage: prefab-bench [--iterations N] [--rooms N] [--accessories N]
+ *                     [--services N] [--characteristics N] [--concurrency N]
+ *                     [--filter SUBSTRING]
+ */
+
+#include <prefab/prefab.h>
+#include <mock_server.h>
+#include "model_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// GCC flags free() in the replaced operator delete once it is inlined next to a new-expression
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+
+    // Allocation accounting. Server threads opt out through onThreadStart.
+    std::atomic<size_t> allocationCount{0};
+    std::atomic<size_t> allocationBytes{0};
+    thread_local bool countAllocations = true;
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    if (countAllocations) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+    using json = nlohmann::json;
+
+    struct Options {
+        int iterations = 2000;
+        int concurrency = 32;
+        std::string filter;
+        prefab::testing::MockHomeLayout layout;
+    };
+
+    struct Result {
+        std::string name;
+        size_t operations = 0;
+        double seconds = 0;
+        double p50Us = 0;
+        double p99Us = 0;
+        double allocationsPerOp = 0;
+        double bytesPerOp = 0;
+    };
+
+    double percentile(std::vector<double>& samples, double fraction) {
+        if (samples.empty()) return 0;
+        size_t index = static_cast<size_t>(fraction * static_cast<double>(samples.size() - 1) + 0.5);
+        std::nth_element(samples.begin(), samples.begin() + static_cast<long>(index), samples.end());
+        return samples[index];
+    }
+
+    void print(const Result& result) {
+        std::printf("%-40s %10.0f %10.1f %10.1f %10.1f %12.0f\n", result.name.c_str(),
+                    result.seconds > 0 ? static_cast<double>(result.operations) / result.seconds : 0.0,
+                    result.p50Us, result.p99Us, result.allocationsPerOp, result.bytesPerOp);
+    }
+
+    class Runner {
+    public:
+        explicit Runner(const Options& options) : options_(options) {}
+
+        bool selected(const std::string& name) const {
+            return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+        }
+
+        // Time each call individually; a few warm-up calls are not measured
+        void measure(const std::string& name, int iterations, const std::function<void()>& op) {
+            if (!selected(name)) return;
+            for (int i = 0; i < std::min(iterations, 10); ++i) op();
+
+            std::vector<double> latencies;
+            latencies.reserve(static_cast<size_t>(iterations));
+            size_t allocations = allocationCount.load();
+            size_t bytes = allocationBytes.load();
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                Clock::time_point begin = Clock::now();
+                op();
+                latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            size_t opAllocations = allocationCount.load() - allocations;
+            size_t opBytes = allocationBytes.load() - bytes;
+
+            Result result;
+            result.name = name;
+            result.operations = static_cast<size_t>(iterations);
+            result.seconds = seconds;
+            result.p50Us = percentile(latencies, 0.50);
+            result.p99Us = percentile(latencies, 0.99);
+            result.allocationsPerOp = static_cast<double>(opAllocations) / iterations;
+            result.bytesPerOp = static_cast<double>(opBytes) / iterations;
+            print(result);
+        }
+
+        /**
+         * @brief Keep @p concurrency asynchronous calls in flight until @p total have finished
+         *
+         * @p start issues one call and must invoke the given completion exactly once.
+         */
+        void measureAsync(const std::string& name, int total, int concurrency,
+                          const std::function<void(std::function<void()>)>& start) {
+            if (!selected(name)) return;
+
+            std::vector<double> latencies(static_cast<size_t>(total));
+            std::atomic<int> next{0};
+            std::atomic<int> finished{0};
+            std::promise<void> allDone;
+
+            std::function<void()> launch = [&]() {
+                int index = next.fetch_add(1);
+                if (index >= total) return;
+                Clock::time_point begin = Clock::now();
+                start([&, index, begin]() {
+                    latencies[static_cast<size_t>(index)] =
+                        std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+                    if (finished.fetch_add(1) + 1 == total) {
+                        allDone.set_value();
+                    } else {
+                        launch();
+                    }
+                });
+            };
+
+            size_t allocations = allocationCount.load();
+            size_t bytes = allocationBytes.load();
+            Clock::time_point startTime = Clock::now();
+            for (int i = 0; i < std::min(concurrency, total); ++i) launch();
+            allDone.get_future().wait();
+            double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+            Result result;
+            result.name = name;
+            result.operations = static_cast<size_t>(total);
+            result.seconds = seconds;
+            result.p50Us = percentile(latencies, 0.50);
+            result.p99Us = percentile(latencies, 0.99);
+            result.allocationsPerOp = static_cast<double>(allocationCount.load() - allocations) / total;
+            result.bytesPerOp = static_cast<double>(allocationBytes.load() - bytes) / total;
+            print(result);
+        }
+
+    private:
+        const Options& options_;
+    };
+
+    template <typename T>
+    T discard(T value) {
+        // Keeps the optimizer from dropping work whose result is unused
+        static volatile size_t sink;
+        sink = sink + sizeof(value);
+        return value;
+    }
+
+    void clientBenchmarks(Runner& runner, const Options& options) {
+        prefab::testing::MockServerOptions serverOptions;
+        serverOptions.layout = options.layout;
+        serverOptions.onThreadStart = []() { countAllocations = false; };
+        prefab::testing::MockPrefabServer server(serverOptions);
+
+        prefab::ClientConfig config(server.baseUrl());
+        config.enableMdnsDiscovery = false;
+        prefab::PrefabClient client(config);
+
+        const std::string home = prefab::testing::MockPrefabServer::homeName(0);
+        const std::string room = prefab::testing::MockPrefabServer::roomName(0);
+        const std::string accessoryName = prefab::testing::MockPrefabServer::accessoryName(0);
+        const prefab::Accessory accessory = client.getAccessory(home, room, accessoryName);
+        const auto scenes = client.getScenes(home);
+        const auto groups = client.getGroups(home);
+
+        prefab::UpdateAccessoryInput update;
+        update.serviceId = accessory.services->at(0).uniqueIdentifier.toString();
+        update.characteristicId = accessory.services->at(0).characteristics.at(1).uniqueIdentifier.toString();
+        update.value = "50";
+
+        const int n = options.iterations;
+        std::printf("\nPrefabClient against mock server (%d rooms x %d accessories x %d services x %d characteristics)\n",
+                    options.layout.roomsPerHome, options.layout.accessoriesPerRoom,
+                    options.layout.servicesPerAccessory, options.layout.characteristicsPerService);
+        std::printf("%-40s %10s %10s %10s %10s %12s\n", "benchmark", "ops/s", "p50 us", "p99 us", "allocs/op", "bytes/op");
+
+        runner.measure("testConnection", n, [&]() { discard(client.testConnection()); });
+        runner.measure("getHomes", n, [&]() { discard(client.getHomes()); });
+        runner.measure("getHome", n, [&]() { discard(client.getHome(home)); });
+        runner.measure("getRooms", n, [&]() { discard(client.getRooms(home)); });
+        runner.measure("getRoom", n, [&]() { discard(client.getRoom(home, room)); });
+        runner.measure("getAccessories", n, [&]() { discard(client.getAccessories(home, room)); });
+        runner.measure("getAccessory", n, [&]() { discard(client.getAccessory(home, room, accessoryName)); });
+        runner.measure("updateAccessory", n, [&]() { discard(client.updateAccessory(home, room, accessoryName, update)); });
+        runner.measure("updateCharacteristicByType", n, [&]() {
+            discard(client.updateCharacteristicByType(home, room, accessoryName, "Brightness", "60"));
+        });
+        if (!scenes.empty()) {
+            runner.measure("getScenes", n, [&]() { discard(client.getScenes(home)); });
+            runner.measure("getScene", n, [&]() { discard(client.getScene(home, scenes[0].uniqueIdentifier)); });
+            runner.measure("executeScene", n, [&]() { discard(client.executeScene(home, scenes[0].uniqueIdentifier)); });
+        }
+        if (!groups.empty()) {
+            prefab::UpdateGroupInput groupUpdate{"00000025-0000-1000-8000-0026BB765291", "1"};
+            runner.measure("getGroups", n, [&]() { discard(client.getGroups(home)); });
+            runner.measure("getGroup", n, [&]() { discard(client.getGroup(home, groups[0].uniqueIdentifier)); });
+            runner.measure("updateGroup", n, [&]() {
+                discard(client.updateGroup(home, groups[0].uniqueIdentifier, groupUpdate));
+            });
+        }
+        runner.measure("getSnapshot", std::max(n / 100, 5), [&]() { discard(client.getSnapshot()); });
+
+        // Startup from a saved snapshot instead of a crawl
+        const std::string snapshotPath = "prefab-bench-" + std::to_string(::getpid()) + ".snapshot";
+        prefab::saveSnapshotFile(client.getSnapshot(), snapshotPath);
+        runner.measure("MappedSnapshot::open", n, [&]() { discard(prefab::MappedSnapshot::open(snapshotPath)); });
+        runner.measure("MappedSnapshot::toSnapshot", std::max(n / 10, 10), [&]() {
+            discard(prefab::MappedSnapshot::open(snapshotPath)->toSnapshot());
+        });
+        std::remove(snapshotPath.c_str());
+
+        const int concurrency = options.concurrency;
+        runner.measureAsync("getAccessoryAsync x" + std::to_string(concurrency), n, concurrency,
+                            [&](std::function<void()> done) {
+                                client.getAccessoryAsync(home, room, accessoryName,
+                                                         [done](prefab::AsyncResult<prefab::Accessory>) { done(); });
+                            });
+        runner.measureAsync("updateAccessoryAsync x" + std::to_string(concurrency), n, concurrency,
+                            [&](std::function<void()> done) {
+                                client.updateAccessoryAsync(home, room, accessoryName, update,
+                                                            [done](prefab::AsyncResult<std::string>) { done(); });
+                            });
+
+        prefab::BatchUpdate batch(client);
+        for (int a = 0; a < options.layout.accessoriesPerRoom; ++a) {
+            batch.addByType(home, room, prefab::testing::MockPrefabServer::accessoryName(a), "Brightness", "30");
+        }
+        runner.measure("BatchUpdate (" + std::to_string(batch.size()) + " writes)", std::max(n / 10, 10),
+                       [&]() { discard(batch.send()); });
+    }
+
+    void serializationBenchmarks(Runner& runner, const Options& options) {
+        prefab::testing::MockServerOptions serverOptions;
+        serverOptions.layout = options.layout;
+        serverOptions.layout.homes = 1;
+        prefab::testing::MockPrefabServer server(serverOptions);
+
+        const std::string home = prefab::testing::MockPrefabServer::homeName(0);
+        const std::string room = prefab::testing::MockPrefabServer::roomName(0);
+        const prefab::Accessory accessory =
+            server.accessory(home, room, prefab::testing::MockPrefabServer::accessoryName(0));
+        const std::string accessoryJson = json(accessory).dump();
+
+        std::vector<prefab::Accessory> listing(static_cast<size_t>(options.layout.accessoriesPerRoom), accessory);
+        for (auto& entry : listing) entry.services.reset();
+        const std::string listingJson = json(listing).dump();
+
+        prefab::SceneDetail scene;
+        scene.home = home;
+        scene.uniqueIdentifier = "3E5B1A2C-0000-4000-8000-000000000001";
+        scene.name = "Evening";
+        for (int i = 0; i < 32; ++i) {
+            scene.actions.push_back(prefab::SceneAction{"Accessory " + std::to_string(i), "Light",
+                                                        "00000025-0000-1000-8000-0026BB765291", "1"});
+        }
+        const std::string sceneJson = json(scene).dump();
+
+        const int n = options.iterations * 5;
+        std::printf("\nModel serialization (accessory %zu bytes, listing %zu bytes, scene %zu bytes)\n",
+                    accessoryJson.size(), listingJson.size(), sceneJson.size());
+        std::printf("%-40s %10s %10s %10s %10s %12s\n", "benchmark", "ops/s", "p50 us", "p99 us", "allocs/op", "bytes/op");
+
+        runner.measure("Accessory to_json + dump", n, [&]() { discard(json(accessory).dump()); });
+        runner.measure("Accessory parse (DOM)", n, [&]() {
+            discard(json::parse(accessoryJson).get<prefab::Accessory>());
+        });
+        runner.measure("Accessory parse (streaming)", n, [&]() {
+            prefab::Accessory parsed;
+            std::string error;
+            discard(prefab::parseAccessoryJson(accessoryJson, parsed, error));
+        });
+        runner.measure("Accessory list parse (DOM)", n, [&]() {
+            discard(json::parse(listingJson).get<std::vector<prefab::Accessory>>());
+        });
+        runner.measure("Accessory list parse (streaming)", n, [&]() {
+            std::vector<prefab::Accessory> parsed;
+            std::string error;
+            discard(prefab::parseAccessoryListJson(listingJson, parsed, error));
+        });
+        prefab::AccessoryArena arena;
+        runner.measure("Accessory list parse (arena)", n, [&]() {
+            arena.clear();
+            std::string error;
+            discard(prefab::parseAccessoryListJson(listingJson, arena.accessories(), error));
+        });
+        runner.measure("SceneDetail to_json + dump", n, [&]() { discard(json(scene).dump()); });
+        runner.measure("SceneDetail parse", n, [&]() { discard(json::parse(sceneJson).get<prefab::SceneDetail>()); });
+        runner.measure("UpdateAccessoryInput dump", n, [&]() {
+            discard(json(prefab::UpdateAccessoryInput{"service", "characteristic", "50"}).dump());
+        });
+    }
+
+    int intArgument(const char* value, const char* name) {
+        char* end = nullptr;
+        long parsed = std::strtol(value, &end, 10);
+        if (!end || *end != '\0' || parsed <= 0) {
+            std::cerr << "Invalid value for " << name << ": " << value << std::endl;
+            std::exit(2);
+        }
+        return static_cast<int>(parsed);
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Usage: " << argv[0] << " [--iterations N] [--rooms N] [--accessories N] [--services N]"
+                      << " [--characteristics N] [--concurrency N] [--filter SUBSTRING]" << std::endl;
+            return 2;
+        }
+        const char* value = argv[++i];
+        if (arg == "--iterations") options.iterations = intArgument(value, "--iterations");
+        else if (arg == "--rooms") options.layout.roomsPerHome = intArgument(value, "--rooms");
+        else if (arg == "--accessories") options.layout.accessoriesPerRoom = intArgument(value, "--accessories");
+        else if (arg == "--services") options.layout.servicesPerAccessory = intArgument(value, "--services");
+        else if (arg == "--characteristics") options.layout.characteristicsPerService = intArgument(value, "--characteristics");
+        else if (arg == "--concurrency") options.concurrency = intArgument(value, "--concurrency");
+        else if (arg == "--filter") options.filter = value;
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    Runner runner(options);
+    try {
+        clientBenchmarks(runner, options);
+        serializationBenchmarks(runner, options);
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
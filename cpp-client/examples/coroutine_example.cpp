@@ -0,0 +1,62 @@
+#include <iostream>
+#include <string>
+#include <prefab/prefab.h>
+#include <prefab/coro.h>
+
+// Count accessories in every room of a home, fetching all rooms concurrently
+prefab::coro::Task<void> listHome(prefab::coro::AsyncClient& client, std::string homeName) {
+    auto rooms = co_await client.getRoomsAsync(homeName);
+
+    std::vector<prefab::coro::Task<std::vector<prefab::Accessory>>> fanOut;
+    for (const auto& room : rooms) {
+        fanOut.push_back(client.getAccessoriesAsync(homeName, room.name));
+    }
+    auto perRoom = co_await prefab::coro::when_all(std::move(fanOut));
+
+    std::cout << "Home: " << homeName << std::endl;
+    for (size_t i = 0; i < rooms.size(); ++i) {
+        std::cout << "  " << rooms[i].name << ": " << perRoom[i].size() << " accessories" << std::endl;
+    }
+}
+
+prefab::coro::Task<void> listAllHomes(prefab::coro::AsyncClient& client) {
+    auto homes = co_await client.getHomesAsync();
+
+    std::vector<prefab::coro::Task<void>> fanOut;
+    for (const auto& home : homes) {
+        fanOut.push_back(listHome(client, home.name));
+    }
+    co_await prefab::coro::when_all(std::move(fanOut));
+}
+
+int main() {
+    try {
+        prefab::PrefabClient client;
+
+        std::cout << "Prefab C++ Client - Coroutine Example" << std::endl;
+        std::cout << "=====================================" << std::endl;
+
+        // Resume coroutines on this thread's run loop rather than the network thread
+        prefab::coro::RunLoop loop;
+        prefab::coro::AsyncClient asyncClient(client, loop.executor());
+
+        int status = 0;
+        prefab::coro::spawn(listAllHomes(asyncClient), [&loop, &status](std::exception_ptr error) {
+            if (error) {
+                try {
+                    std::rethrow_exception(error);
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: " << e.what() << std::endl;
+                }
+                status = 1;
+            }
+            loop.stop();
+        });
+        loop.run();
+
+        return status;
+    } catch (const prefab::PrefabException& e) {
+        std::cerr << "Prefab Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+#include <prefab/prefab.h>
+
+static void printPhase(const char* name, const prefab::CrawlPhaseStats& phase) {
+    std::cout << "  " << name << ": " << phase.requests << " requests";
+    if (phase.failures > 0) {
+        std::cout << " (" << phase.failures << " failed)";
+    }
+    std::cout << ", wall " << phase.wallTime.count() / 1000.0 << " ms"
+              << ", avg " << phase.averageLatency().count() / 1000.0 << " ms"
+              << ", max " << phase.maxLatency.count() / 1000.0 << " ms" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        prefab::PrefabClient client;
+
+        std::cout << "Prefab C++ Client - Snapshot Example" << std::endl;
+        std::cout << "====================================" << std::endl;
+
+        prefab::SnapshotOptions options;
+        if (argc >= 2) {
+            options.maxParallelRequests = std::stoi(argv[1]);
+        }
+
+        prefab::HomeSnapshot snapshot = client.getSnapshot(options);
+
+        for (const auto& home : snapshot.homes) {
+            std::cout << "Home: " << home.home.name << std::endl;
+            for (const auto& room : home.rooms) {
+                std::cout << "  Room: " << room.room.name << std::endl;
+                for (const auto& accessory : room.accessories) {
+                    size_t services = accessory.services.has_value() ? accessory.services->size() : 0;
+                    std::cout << "    " << accessory.name << " (" << services << " services)" << std::endl;
+                }
+            }
+        }
+
+        const prefab::CrawlStats& stats = snapshot.stats;
+        std::cout << std::endl;
+        std::cout << "Crawled " << snapshot.roomCount() << " rooms and " << snapshot.accessoryCount()
+                  << " accessories in " << stats.totalTime.count() / 1000.0 << " ms"
+                  << " (peak " << stats.peakInFlight << " in flight)" << std::endl;
+        printPhase("homes", stats.homes);
+        printPhase("rooms", stats.rooms);
+        printPhase("accessory lists", stats.accessories);
+        printPhase("accessory details", stats.details);
+
+        for (const auto& error : stats.errors) {
+            std::cout << "  error: " << error << std::endl;
+        }
+
+    } catch (const prefab::PrefabException& e) {
+        std::cerr << "Prefab Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
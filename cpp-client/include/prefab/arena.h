@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <vector>
+#include "models.h"
+
+namespace prefab {
+
+    /**
+     * @brief Arena-allocated variants of the accessory models
+     *
+     * Same fields as prefab::CharacteristicMetadata, Characteristic, Service and
+     * Accessory, but every string and vector takes its memory from a
+     * std::pmr::memory_resource. Filled by the AccessoryArena overloads of
+     * PrefabClient::getAccessories / getAccessory, so a whole response lives in
+     * one arena and is freed in one step.
+     *
+     * The allocator-extended constructors follow the usual pmr rules: a plain
+     * copy uses the default resource, a copy with an allocator uses that one.
+     * Assign only between objects in the same arena.
+     */
+    namespace pmr {
+
+        using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+        struct CharacteristicMetadata {
+            using allocator_type = pmr::allocator_type;
+
+            std::optional<std::pmr::string> manufacturerDescription;
+            std::optional<std::pmr::vector<std::pmr::string>> validValues;
+            std::optional<std::pmr::string> minimumValue;
+            std::optional<std::pmr::string> maximumValue;
+            std::optional<std::pmr::string> stepValue;
+            std::optional<std::pmr::string> maxLength;
+            std::optional<std::pmr::string> format;
+            std::optional<std::pmr::string> units;
+
+            // Decoded from the fields above when the metadata is parsed
+            ValueConstraints constraints;
+
+            explicit CharacteristicMetadata(const allocator_type& alloc = {}) : alloc_(alloc) {}
+            CharacteristicMetadata(const CharacteristicMetadata& other, const allocator_type& alloc);
+            CharacteristicMetadata(CharacteristicMetadata&& other, const allocator_type& alloc);
+            CharacteristicMetadata(const CharacteristicMetadata&) = default;
+            CharacteristicMetadata(CharacteristicMetadata&&) = default;
+            CharacteristicMetadata& operator=(const CharacteristicMetadata& other);  // Keeps this object's allocator
+            CharacteristicMetadata& operator=(CharacteristicMetadata&& other);
+
+            allocator_type get_allocator() const { return alloc_; }
+
+        private:
+            allocator_type alloc_;
+        };
+
+        struct Characteristic {
+            using allocator_type = pmr::allocator_type;
+
+            Uuid uniqueIdentifier;
+            std::pmr::string description;
+            std::pmr::vector<std::pmr::string> properties;
+            InternedString typeName;
+            Uuid type;
+            CharacteristicMetadata metadata;
+            std::pmr::string value;
+            CharacteristicValue typedValue;  ///< Holds a heap copy only for string values past the SSO size
+
+            explicit Characteristic(const allocator_type& alloc = {})
+                : description(alloc), properties(alloc), metadata(alloc), value(alloc) {}
+            Characteristic(const Characteristic& other, const allocator_type& alloc);
+            Characteristic(Characteristic&& other, const allocator_type& alloc);
+            Characteristic(const Characteristic&) = default;
+            Characteristic(Characteristic&&) = default;
+            Characteristic& operator=(const Characteristic&) = default;
+            Characteristic& operator=(Characteristic&&) = default;
+
+            allocator_type get_allocator() const { return description.get_allocator(); }
+        };
+
+        struct Service {
+            using allocator_type = pmr::allocator_type;
+
+            Uuid uniqueIdentifier;
+            std::pmr::string name;
+            InternedString typeName;
+            Uuid type;
+            bool isPrimary = false;
+            bool isUserInteractive = false;
+            std::optional<std::pmr::string> associatedType;
+            std::pmr::vector<Characteristic> characteristics;
+
+            explicit Service(const allocator_type& alloc = {}) : name(alloc), characteristics(alloc) {}
+            Service(const Service& other, const allocator_type& alloc);
+            Service(Service&& other, const allocator_type& alloc);
+            Service(const Service&) = default;
+            Service(Service&&) = default;
+            Service& operator=(const Service&) = default;
+            Service& operator=(Service&&) = default;
+
+            allocator_type get_allocator() const { return name.get_allocator(); }
+        };
+
+        struct Accessory {
+            using allocator_type = pmr::allocator_type;
+
+            std::pmr::string home;
+            std::pmr::string room;
+            std::pmr::string name;
+
+            // Optional detailed properties
+            std::optional<std::pmr::string> category;
+            std::optional<bool> isReachable;
+            std::optional<bool> supportsIdentify;
+            std::optional<bool> isBridged;
+            std::optional<std::pmr::vector<Service>> services;
+            std::optional<std::pmr::string> firmwareVersion;
+            std::optional<std::pmr::string> manufacturer;
+            std::optional<std::pmr::string> model;
+
+            explicit Accessory(const allocator_type& alloc = {}) : home(alloc), room(alloc), name(alloc) {}
+            Accessory(const Accessory& other, const allocator_type& alloc);
+            Accessory(Accessory&& other, const allocator_type& alloc);
+            Accessory(const Accessory&) = default;
+            Accessory(Accessory&&) = default;
+            Accessory& operator=(const Accessory&) = default;
+            Accessory& operator=(Accessory&&) = default;
+
+            allocator_type get_allocator() const { return home.get_allocator(); }
+        };
+
+    } // namespace pmr
+
+    /**
+     * @brief Copy an arena accessory into the regular, heap-allocated model
+     */
+    Accessory toAccessory(const pmr::Accessory& accessory);
+
+    /**
+     * @brief Owns a monotonic arena and the accessories parsed into it
+     *
+     * All strings and vectors of the accessories share one
+     * std::pmr::monotonic_buffer_resource: allocation is a pointer bump and
+     * clear() frees everything at once. The arena keeps a buffer as large as
+     * the most it has held, so refilling it with a response of similar size
+     * does not touch the heap at all.
+     *
+     * Not thread-safe; use one arena per thread.
+     *
+     * @code
+     * prefab::AccessoryArena arena;
+     * for (;;) {
+     *     arena.clear();
+     *     client.getAccessories("My Home", "Living Room", arena);
+     *     for (const auto& accessory : arena.accessories()) { ... }
+     * }
+     * @endcode
+     */
+    class AccessoryArena {
+    public:
+        explicit AccessoryArena(size_t initialBytes = 64 * 1024);
+
+        AccessoryArena(const AccessoryArena&) = delete;
+        AccessoryArena& operator=(const AccessoryArena&) = delete;
+
+        std::pmr::vector<pmr::Accessory>& accessories() { return accessories_; }
+        const std::pmr::vector<pmr::Accessory>& accessories() const { return accessories_; }
+
+        pmr::allocator_type allocator() { return pmr::allocator_type(&counter_); }
+        std::pmr::memory_resource* resource() { return &counter_; }
+
+        /**
+         * @brief Destroy every accessory and release the arena in one step
+         */
+        void clear();
+
+        size_t bytesUsed() const { return counter_.bytes; }  ///< Handed out since the last clear()
+        size_t capacity() const { return bufferSize_; }      ///< Size of the retained buffer
+        size_t overflowBytes() const { return upstream_.bytes; } ///< Heap blocks taken beyond the buffer since the last clear()
+
+    private:
+        // Counts the bytes that pass through to another resource
+        class CountingResource : public std::pmr::memory_resource {
+        public:
+            explicit CountingResource(std::pmr::memory_resource* next) : next_(next) {}
+            void setNext(std::pmr::memory_resource* next) { next_ = next; }
+
+            size_t bytes = 0;
+
+        private:
+            void* do_allocate(size_t size, size_t alignment) override;
+            void do_deallocate(void* p, size_t size, size_t alignment) override;
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+            std::pmr::memory_resource* next_;
+        };
+
+        void reset(size_t bufferSize);
+
+        std::unique_ptr<std::byte[]> buffer_;
+        size_t bufferSize_ = 0;
+        CountingResource upstream_{std::pmr::new_delete_resource()};
+        std::optional<std::pmr::monotonic_buffer_resource> arena_;
+        CountingResource counter_{nullptr};
+        std::pmr::vector<pmr::Accessory> accessories_;  // Declared last so it is destroyed before the arena
+    };
+
+} // namespace prefab
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <string>
+#include <vector>
+#include "client.h"
+
+namespace prefab {
+
+    /**
+     * @brief Outcome of one write in a batch
+     */
+    struct BatchItemResult {
+        std::string homeName;
+        std::string roomName;
+        std::string accessoryName;
+        std::string characteristic;     ///< characteristicId, or the type for items added with addByType()
+
+        bool success = false;
+        int httpCode = 0;               ///< HTTP status of a failed request (0 for transport or local errors)
+        std::string response;           ///< Server response on success
+        std::string error;              ///< Error message on failure
+        std::chrono::microseconds latency{0};
+    };
+
+    /**
+     * @brief Outcome of a whole batch; items are in the order they were added
+     */
+    struct BatchResult {
+        std::vector<BatchItemResult> items;
+        std::chrono::microseconds totalTime{0};
+        size_t peakInFlight = 0;        ///< Most writes that were in flight at the same time
+
+        size_t succeeded() const;
+        size_t failed() const { return items.size() - succeeded(); }
+        bool allSucceeded() const { return succeeded() == items.size(); }
+    };
+
+    /**
+     * @brief Builder that sends many characteristic writes concurrently
+     *
+     * Writes are collected with add() / addByType() and then issued together
+     * through the client's asynchronous API, so a change touching many
+     * accessories takes roughly one round trip instead of one per write.
+     * Individual failures do not stop the batch; inspect the per-item results.
+     *
+     * The builder keeps a reference to the client, which must outlive any
+     * batch in flight. A builder can be sent more than once.
+     *
+     * @code
+     * prefab::BatchUpdate batch(client);
+     * batch.addByType("My Home", "Living Room", "Lamp", "Brightness", "40")
+     *      .addByType("My Home", "Living Room", "Lamp", "On", "1");
+     * prefab::BatchResult result = batch.send();
+     * @endcode
+     */
+    class BatchUpdate {
+    public:
+        explicit BatchUpdate(PrefabClient& client);
+
+        /**
+         * @brief Queue a write with known service and characteristic IDs
+         */
+        BatchUpdate& add(const std::string& homeName, const std::string& roomName,
+                         const std::string& accessoryName, const UpdateAccessoryInput& update);
+
+        /**
+         * @brief Queue a write resolved by characteristic type (UUID or typeName)
+         *
+         * Resolution goes through the same ID index as
+         * PrefabClient::updateCharacteristicByType().
+         */
+        BatchUpdate& addByType(const std::string& homeName, const std::string& roomName,
+                               const std::string& accessoryName, const std::string& characteristicType,
+                               const std::string& value);
+
+        /**
+         * @brief Upper bound on writes in flight at once (default 16)
+         */
+        BatchUpdate& maxParallelRequests(int maxParallel);
+
+        size_t size() const { return items_.size(); }
+        bool empty() const { return items_.empty(); }
+        void clear() { items_.clear(); }
+
+        /**
+         * @brief Send every queued write and wait for all of them to finish
+         */
+        BatchResult send();
+
+        /**
+         * @brief Send every queued write; the callback runs once all have finished
+         *
+         * The callback runs on the client's network thread (or on the calling
+         * thread for an empty batch). The result is always a success; per-item
+         * failures are reported in BatchResult::items.
+         */
+        void sendAsync(AsyncCallback<BatchResult> callback);
+        std::future<BatchResult> sendAsync();
+
+    private:
+        class Run;
+
+        struct Item {
+            std::string homeName;
+            std::string roomName;
+            std::string accessoryName;
+            UpdateAccessoryInput update;
+            std::string characteristicType;  // Set for addByType(); resolved when sent
+        };
+
+        PrefabClient& client_;
+        std::vector<Item> items_;
+        size_t maxParallel_ = 16;
+    };
+
+} // namespace prefab
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include "client.h"
+
+namespace prefab {
+
+    /**
+     * @brief Options for ChangeFeed
+     */
+    struct ChangeFeedOptions {
+        int waitSeconds = 25;          ///< How long each long poll may stay open on the server
+        int retryDelayMs = 500;        ///< First delay before reconnecting after an error
+        int maxRetryDelayMs = 30000;   ///< The delay doubles after every failed attempt up to this
+
+        ChangeFeedOptions() = default;
+    };
+
+    /**
+     * @brief Local mirror of accessory state kept current from the server's change feed
+     *
+     * Watched accessories are read once, then kept up to date by long-polling
+     * GET /events, so reads come from memory instead of a request each. After a
+     * connection error, a server restart or a gap in the feed the mirror is
+     * reread ("resync"); values that changed meanwhile are reported to the
+     * subscribers like any other change.
+     *
+     * Subscribers see every change the server reports, including changes to
+     * accessories that are not watched. They run on the client's network
+     * thread and must not block.
+     *
+     * The feed keeps a reference to the client, which must outlive it.
+     *
+     * @code
+     * prefab::ChangeFeed feed(client);
+     * feed.watch("My Home", "Living Room", "Lamp");
+     * feed.subscribe([](const prefab::CharacteristicChange& change) { ... });
+     * feed.start();
+     * std::optional<std::string> brightness = feed.value("My Home", "Living Room", "Lamp", "Brightness");
+     * @endcode
+     */
+    class ChangeFeed {
+    public:
+        using Callback = std::function<void(const CharacteristicChange& change)>;
+
+        explicit ChangeFeed(PrefabClient& client, const ChangeFeedOptions& options = ChangeFeedOptions());
+        ~ChangeFeed();
+
+        ChangeFeed(const ChangeFeed&) = delete;
+        ChangeFeed& operator=(const ChangeFeed&) = delete;
+
+        /**
+         * @brief Mirror an accessory; if the feed is running it is read right away
+         *
+         * A failed read is repeated with the feed's retry backoff until it
+         * succeeds or the accessory turns out not to exist.
+         */
+        void watch(const std::string& homeName, const std::string& roomName, const std::string& accessoryName);
+
+        /**
+         * @brief Register a change callback; returns an id for unsubscribe()
+         */
+        size_t subscribe(Callback callback);
+        void unsubscribe(size_t id);
+
+        /**
+         * @brief Read the watched accessories and start following the feed
+         */
+        void start();
+
+        /**
+         * @brief Stop following the feed; a poll in flight is ignored when it returns
+         */
+        void stop();
+
+        /**
+         * @brief Mirrored value of a characteristic, matched by type UUID or typeName
+         * @return std::nullopt if the accessory is not mirrored (yet) or has no such characteristic
+         */
+        std::optional<std::string> value(const std::string& homeName, const std::string& roomName,
+                                         const std::string& accessoryName, const std::string& characteristicType) const;
+
+        /**
+         * @brief Copy of a mirrored accessory
+         */
+        std::optional<Accessory> accessory(const std::string& homeName, const std::string& roomName,
+                                           const std::string& accessoryName) const;
+
+        bool synchronized() const;   ///< True between a completed resync and the next error
+        uint64_t sequence() const;   ///< Sequence of the last change applied
+        size_t resyncCount() const;  ///< Completed resyncs, including the first read
+
+    private:
+        class Session;
+
+        std::shared_ptr<Session> session_;
+    };
+
+} // namespace prefab
@@ -1,11 +1,21 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <memory>
 #include <optional>
 #include <functional>
+#include <future>
+#include <exception>
 #include "models.h"
+#include "arena.h"
+#include "snapshot.h"
+#include "snapshot_file.h"
+#include "discovery.h"
+#include "metrics.h"
+#include "tracing.h"
 
 namespace prefab {
 
@@ -28,6 +38,192 @@ namespace prefab {
         int getHttpCode() const { return httpCode_; }
     };
 
+    /**
+     * @brief Outcome of an asynchronous request: either a value or the error that occurred
+     */
+    template <typename T>
+    class AsyncResult {
+    private:
+        std::optional<T> value_;
+        std::exception_ptr error_;
+
+    public:
+        static AsyncResult success(T value) {
+            AsyncResult result;
+            result.value_ = std::move(value);
+            return result;
+        }
+
+        static AsyncResult failure(std::exception_ptr error) {
+            AsyncResult result;
+            result.error_ = error;
+            return result;
+        }
+
+        bool ok() const { return !error_; }
+
+        /**
+         * @brief Access the value, rethrowing the stored error (usually a PrefabException) on failure
+         */
+        T& value() {
+            if (error_) std::rethrow_exception(error_);
+            return *value_;
+        }
+
+        const T& value() const {
+            if (error_) std::rethrow_exception(error_);
+            return *value_;
+        }
+
+        std::exception_ptr error() const { return error_; }
+    };
+
+    /**
+     * @brief Completion callback for asynchronous requests
+     *
+     * Callbacks run on the client's network thread and must not block; hand
+     * long-running work off to another thread. Requests answered from the
+     * response cache, or that cannot be started at all, complete immediately on
+     * the calling thread.
+     */
+    template <typename T>
+    using AsyncCallback = std::function<void(AsyncResult<T>)>;
+
+    /**
+     * @brief Settings for the client-side read-through response cache
+     *
+     * Disabled by default. TTLs are per resource type in milliseconds; a TTL of
+     * 0 disables caching for that type. Accessory details carry live
+     * characteristic values, so their default TTL is short.
+     */
+    struct CacheConfig {
+        bool enabled = false;
+        size_t maxBytes = 4 * 1024 * 1024;  ///< Memory budget; least recently used entries are evicted first
+        int homesTtlMs = 300000;            ///< getHomes/getHome
+        int roomsTtlMs = 300000;            ///< getRooms/getRoom
+        int accessoriesTtlMs = 60000;       ///< getAccessories (room listings)
+        int accessoryTtlMs = 1000;          ///< getAccessory (services and current values)
+        int scenesTtlMs = 300000;           ///< getScenes/getScene
+        int groupsTtlMs = 300000;           ///< getGroups/getGroup
+    };
+
+    /**
+     * @brief Counters describing response cache effectiveness
+     */
+    struct CacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;  ///< Entries dropped to stay within CacheConfig::maxBytes
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    /**
+     * @brief Settings for coalescing rapid writes to the same characteristic
+     *
+     * Disabled by default. When enabled, writes through updateAccessory (and
+     * everything built on it) keep only the latest value per characteristic,
+     * with at most one request in flight per characteristic. Callers whose
+     * value was dropped get the result of the write that replaced it.
+     */
+    struct WriteCoalescingConfig {
+        bool enabled = false;
+        int holdWindowMs = 50;  ///< How long the first write of a burst waits for newer values (0 sends at once)
+    };
+
+    /**
+     * @brief How a request picks among healthy endpoints
+     */
+    enum class EndpointSelection {
+        EwmaLatency,       ///< Lowest smoothed latency, scaled by requests in flight
+        LeastOutstanding   ///< Fewest requests in flight; latency breaks ties
+    };
+
+    /**
+     * @brief Settings for spreading requests over several Prefab servers
+     *
+     * Several servers can bridge the same homes (e.g. one per Mac). Load
+     * balancing is active when endpoints is non-empty or useDiscoveredServers
+     * is set; otherwise the client talks to its one base URL as before.
+     */
+    struct LoadBalancingConfig {
+        std::vector<std::string> endpoints;   ///< Base URLs of servers for the same homes
+        bool useDiscoveredServers = false;    ///< Also use every server the mDNS browser finds
+        EndpointSelection selection = EndpointSelection::EwmaLatency;
+        int maxAttempts = 3;                  ///< Tries per request, each on a different endpoint
+        int healthCheckIntervalMs = 2000;     ///< How often endpoints marked down are probed
+        double latencyWeight = 0.3;           ///< Weight of the newest sample in the latency average
+    };
+
+    /**
+     * @brief State of one load-balanced endpoint
+     */
+    struct EndpointStatus {
+        std::string url;
+        bool healthy = true;
+        size_t outstanding = 0;                   ///< Requests in flight
+        std::chrono::microseconds latency{0};     ///< Smoothed latency; 0 until the first response
+        size_t requests = 0;
+        size_t failures = 0;                      ///< Transport errors, timeouts and 502/503/504 answers
+    };
+
+    /**
+     * @brief Settings for hedged reads
+     *
+     * Disabled by default. When enabled, a GET that has not been answered
+     * within the chosen percentile of recent GET latencies is sent a second
+     * time (to another endpoint when load balancing is on). The first answer
+     * wins and the other transfer is cancelled. Writes and long polls are
+     * never hedged.
+     */
+    struct HedgingConfig {
+        bool enabled = false;
+        double percentile = 95;     ///< Hedge after this percentile of recent GET latencies
+        int initialDelayMs = 100;   ///< Hedge delay until minSamples latencies are known
+        int minDelayMs = 5;         ///< Lower bound for the computed delay
+        int maxDelayMs = 2000;      ///< Upper bound for the computed delay
+        size_t minSamples = 20;
+        size_t window = 256;        ///< Recent latencies the percentile is taken over
+    };
+
+    /**
+     * @brief Counters describing hedged reads
+     */
+    struct HedgingStats {
+        size_t hedged = 0;                   ///< GETs that were sent a second time
+        size_t hedgeWins = 0;                ///< Of those, answered first by the second attempt
+        std::chrono::milliseconds delay{0};  ///< Delay the next hedge would use
+    };
+
+    /**
+     * @brief Queue a request waits in when scheduling is enabled; earlier classes always go first
+     *
+     * Without a RequestPriorityScope, writes (updateAccessory, executeScene,
+     * updateGroup) are Interactive and reads are Normal. Poller and ChangeFeed
+     * reads are Background.
+     */
+    enum class RequestPriority { Interactive, Normal, Background };
+
+    /**
+     * @brief Client-side rate limits for outgoing requests
+     *
+     * Each server, and each accessory on it, gets a token bucket: a request is
+     * sent only when both buckets hold a token, and waits in the queue of its
+     * RequestPriority until then. Bridges behind the server are spared bursts,
+     * and a queued interactive write overtakes queued background reads.
+     * Every attempt takes its own tokens, failovers and hedges included, from
+     * the buckets of the endpoint it goes to. A request whose deadline passes
+     * while it waits fails with "Deadline exceeded".
+     */
+    struct SchedulingConfig {
+        bool enabled = false;
+        double serverRate = 20;     ///< Requests per second to each server (0: unlimited)
+        int serverBurst = 10;       ///< Requests a server takes at once after a quiet spell
+        double accessoryRate = 5;   ///< Requests per second to each accessory (0: unlimited)
+        int accessoryBurst = 2;     ///< Requests an accessory takes at once after a quiet spell
+        size_t maxQueued = 1000;    ///< Per priority class; requests beyond it fail at once
+    };
+
     /**
      * @brief Configuration for the Prefab client
      */
@@ -35,36 +231,231 @@ namespace prefab {
         std::string baseUrl = "http://localhost:8080";
         std::string serviceName = "_prefab._tcp.";
         int timeoutSeconds = 30;
+        int timeoutMs = 0;                      ///< Per-request timeout in milliseconds; overrides timeoutSeconds if > 0
         bool enableMdnsDiscovery = true;
+        int discoveryTimeoutMs = 5000;          ///< Longest wait for a first mDNS result
+        bool lazyDiscovery = false;             ///< Return from the constructor at once; the first request waits instead
+        std::string discoveryCachePath;         ///< File remembering the discovered server between runs (empty: none)
+
+        // Connection reuse
+        int maxPooledConnections = 8;           ///< Idle curl handles kept for reuse
+        int connectionIdleTimeoutSeconds = 60;  ///< Idle handles/connections older than this are dropped
+        bool enableKeepAlive = true;            ///< Keep connections open between requests
+
+        CacheConfig cache;                      ///< Read-through cache for GET requests (off by default)
+        WriteCoalescingConfig coalescing;       ///< Latest-value-wins characteristic writes (off by default)
+        LoadBalancingConfig loadBalancing;      ///< Several servers with failover (off by default)
+        HedgingConfig hedging;                  ///< Second attempt for slow GETs (off by default)
+        bool enableMetrics = true;              ///< Keep per-route request metrics (see getMetrics)
+        TracingConfig tracing;                  ///< Request spans with trace context propagation (off by default)
+        SchedulingConfig scheduling;            ///< Rate limits and priority queues (off by default)
 
         ClientConfig() = default;
         ClientConfig(const std::string& url) : baseUrl(url) {}
     };
 
+    /**
+     * @brief Deadline for every request started on this thread while in scope
+     *
+     * Requests (synchronous or asynchronous) started while a RequestDeadline
+     * is alive must finish by its deadline: each attempt, failover and hedge
+     * gets only the time that is left, and a request started after the
+     * deadline fails at once with "Deadline exceeded". Nested deadlines never
+     * extend an outer one.
+     *
+     * @code
+     * {
+     *     prefab::RequestDeadline deadline(std::chrono::milliseconds(250));
+     *     auto homes = client.getHomes();
+     * }
+     * @endcode
+     */
+    class RequestDeadline {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit RequestDeadline(std::chrono::milliseconds timeout);
+        explicit RequestDeadline(Clock::time_point deadline);
+        ~RequestDeadline();
+
+        RequestDeadline(const RequestDeadline&) = delete;
+        RequestDeadline& operator=(const RequestDeadline&) = delete;
+
+        /**
+         * @brief The deadline in force on this thread, if any
+         */
+        static std::optional<Clock::time_point> current();
+
+    private:
+        std::optional<Clock::time_point> previous_;
+    };
+
+    /**
+     * @brief Priority for every request started on this thread while in scope
+     *
+     * Only matters with ClientConfig::scheduling enabled. The innermost scope
+     * wins.
+     *
+     * @code
+     * {
+     *     prefab::RequestPriorityScope background(prefab::RequestPriority::Background);
+     *     auto snapshot = client.getSnapshot();
+     * }
+     * @endcode
+     */
+    class RequestPriorityScope {
+    public:
+        explicit RequestPriorityScope(RequestPriority priority);
+        ~RequestPriorityScope();
+
+        RequestPriorityScope(const RequestPriorityScope&) = delete;
+        RequestPriorityScope& operator=(const RequestPriorityScope&) = delete;
+
+        /**
+         * @brief The priority set on this thread, if any
+         */
+        static std::optional<RequestPriority> current();
+
+    private:
+        std::optional<RequestPriority> previous_;
+    };
+
     /**
      * @brief Callback function type for mDNS service discovery
      */
     using ServiceDiscoveryCallback = std::function<void(const std::string& hostname, int port)>;
 
+    class ConnectionPool;
+    class Reactor;
+    class ResponseCache;
+    class CharacteristicIndex;
+    class WriteCoalescer;
+    class BaseUrlDiscovery;
+    class EndpointSet;
+    class HedgePolicy;
+    class MetricsRegistry;
+    class Tracer;
+    class RequestScheduler;
+    template <typename T> class PublishedPtr;
+
     /**
      * @brief C++ client for the Prefab HomeKit HTTP API
      * 
      * This client provides access to HomeKit data through the Prefab server's REST API.
      * It can automatically discover Prefab servers on the network using mDNS/Bonjour
      * or connect to a specific server URL.
+     *
+     * Requests are issued on pooled curl handles that share one keep-alive
+     * connection cache, so repeated calls avoid a new TCP handshake each time.
+     *
+     * Every request method has an asynchronous counterpart (suffix Async) that
+     * either takes an AsyncCallback or returns a std::future. Asynchronous
+     * requests are multiplexed on a single curl multi reactor thread owned by the
+     * client, so many requests can be in flight without blocking the caller.
+     *
+     * With ClientConfig::cache enabled, GET responses are served from a TTL/LRU
+     * cache. Writes through updateAccessory, updateGroup and executeScene drop
+     * the cached entries they can affect.
+     *
+     * With ClientConfig::coalescing enabled, rapid writes to one characteristic
+     * are collapsed so that only the latest value is sent.
+     *
+     * updateCharacteristicByType resolves characteristic types to service and
+     * characteristic IDs through an index learned from accessory details, so
+     * repeated writes skip the lookup round trip. A stale ID rejected by the
+     * server is re-resolved and the write retried once.
+     *
+     * With ClientConfig::tracing enabled, each request is a span with a child
+     * per attempt, and updateCharacteristicByType is a span around the requests
+     * it makes. Wrap your own operations in a TraceSpan to group requests.
+     *
+     * Thread safety: one client may be shared by any number of threads. Every
+     * method can be called concurrently, including setBaseUrl, which affects
+     * requests started after it returns (requests in flight finish against the
+     * old server). The exceptions are the AccessoryArena overloads, which
+     * write into the caller's arena: give each thread its own arena.
+     * RequestDeadline and TraceSpan apply to the thread that creates them.
+     * Callbacks of asynchronous requests run on the client's network thread.
+     * libcurl is initialized once per process by the first client and is not
+     * torn down by the destructor, so clients may be created and destroyed on
+     * any thread.
      */
     class PrefabClient {
     private:
-        ClientConfig config_;
-        std::string discoveredBaseUrl_;
-        
-        // Internal HTTP methods
-        std::string makeHttpRequest(const std::string& method, const std::string& path, 
-                                  const std::string& body = "") const;
+        const ClientConfig config_;
+        std::unique_ptr<ConnectionPool> pool_;
+        std::unique_ptr<Reactor> reactor_;
+        std::unique_ptr<ResponseCache> cache_;
+        std::unique_ptr<CharacteristicIndex> characteristics_;
+        std::shared_ptr<WriteCoalescer> coalescer_;
+        // Where requests go; immutable once published. setBaseUrl publishes a new one, and
+        // requests read it through a per-thread cache without taking a lock
+        struct Upstream;
+        std::unique_ptr<PublishedPtr<const Upstream>> upstream_;
+        std::shared_ptr<const Upstream> upstream() const;
+        std::unique_ptr<HedgePolicy> hedge_;           // Set when hedging is enabled
+        std::unique_ptr<MetricsRegistry> metrics_;     // Set when metrics are enabled
+        std::shared_ptr<Tracer> tracer_;               // Set when tracing is enabled
+        std::shared_ptr<RequestScheduler> scheduler_;  // Set when scheduling is enabled
+        // Snapshot files being written off the network thread; the destructor waits for them
+        struct BackgroundSaves;
+        std::unique_ptr<BackgroundSaves> saves_;
+        void saveInBackground(std::function<void()> task) const;
+
+        // Internal HTTP methods; a timeout of 0 uses the configured timeout. With load
+        // balancing they pick an endpoint per attempt and fail over to another one. Both
+        // honour the calling thread's RequestDeadline, and with scheduling every attempt
+        // waits for admission to the endpoint it goes to
+        std::string makeHttpRequest(const std::string& method, const std::string& path,
+                                  const std::string& body = "", long timeoutMs = 0) const;
+        void requestAsync(const std::string& method, const std::string& path, const std::string& body,
+                          std::function<void(std::string&&, std::exception_ptr)> done,
+                          long timeoutMs = 0) const;
+        // Block until the scheduler lets an attempt to server through; throws if it never will
+        void awaitAdmission(RequestPriority priority, const std::string& server, const std::string& path) const;
+
+        // One HTTP exchange with a full URL, without failover
+        struct TransferOutcome;
+        struct AsyncAttempt;
+        struct HedgeRace;
+        // (traceparent: header value to send, if any)
+        TransferOutcome performTransfer(const std::string& method, const std::string& url, const std::string& body,
+                                        long timeoutMs, const std::string& traceparent = "") const;
+        void transferAsync(const std::string& method, const std::string& url, const std::string& body,
+                           long timeoutMs, std::function<void(TransferOutcome&&)> done,
+                           std::shared_ptr<const std::atomic<bool>> cancelled = nullptr,
+                           const std::string& traceparent = "") const;
+        // Waits for the scheduler (if any) to admit the attempt, then sends it with sendAttempt
+        void attemptAsync(std::shared_ptr<AsyncAttempt> attempt) const;
+        void sendAttempt(std::shared_ptr<AsyncAttempt> attempt) const;
+        void recordAttempt(const std::string& method, const std::string& path, size_t bytesSent,
+                           const TransferOutcome& outcome) const;
+        void hedgeAsync(std::shared_ptr<HedgeRace> race) const;
+        // Milliseconds an attempt may take: the request's timeout, cut to what is left of its deadline
+        // (clipped: set to whether the deadline cut it)
+        long attemptTimeoutMs(long timeoutMs, const std::optional<RequestDeadline::Clock::time_point>& deadline,
+                              bool* clipped = nullptr) const;
+
+        // GET through the response cache (if enabled) with the given TTL
+        std::string cachedGet(const std::string& path, int ttlMs) const;
+        void cachedGetAsync(const std::string& path, int ttlMs,
+                            std::function<void(std::string&&, std::exception_ptr)> done) const;
+        void invalidateAccessoryState(const std::string& homeName, const std::string& roomName,
+                                      const std::string& accessoryName);
+        void invalidateHomeState(const std::string& homeName);
+        // PUT an accessory update, bypassing write coalescing
+        void sendAccessoryUpdateAsync(const std::string& homeName, const std::string& roomName,
+                                      const std::string& accessoryName, const UpdateAccessoryInput& update,
+                                      AsyncCallback<std::string> callback);
+        // Look up the accessory, then write the characteristic; fallback path of updateCharacteristicByTypeAsync
+        void resolveAndUpdateAsync(const std::string& homeName, const std::string& roomName,
+                                   const std::string& accessoryName, const std::string& characteristicType,
+                                   const std::string& value, AsyncCallback<std::string> callback);
         std::string urlEncode(const std::string& value) const;
-        
-        // mDNS discovery implementation
-        bool discoverService();
+
+        friend class ChangeFeed;  // Uses the reactor for retry timers and drops cached accessory state
+        friend class Poller;      // Same, for its timer wheel and uncached reads
+        friend class TraceSpan;   // Opens its span on this client's tracer
 
     public:
         /**
@@ -81,13 +472,22 @@ namespace prefab {
 
         /**
          * @brief Discover Prefab servers on the network using mDNS
+         *
+         * Reads the process-wide ServiceBrowser registry, waiting up to
+         * timeoutMs only while it is still empty, and reports every known
+         * server.
          * 
-         * @param callback Function called when a service is discovered
-         * @param timeoutMs Discovery timeout in milliseconds
+         * @param callback Function called for each discovered service
+         * @param timeoutMs How long to wait for a first server if none is known yet
          * @return true if at least one service was discovered
          */
         bool discoverServices(ServiceDiscoveryCallback callback, int timeoutMs = 5000);
 
+        /**
+         * @brief Servers currently known to the background browser, without waiting
+         */
+        std::vector<DiscoveredServer> discoveredServers() const;
+
         /**
          * @brief Set the base URL for the Prefab server
          * 
@@ -102,6 +502,50 @@ namespace prefab {
          */
         std::string getBaseUrl() const;
 
+        /**
+         * @brief Drop every cached response
+         */
+        void invalidateCache();
+
+        /**
+         * @brief Drop every cached response belonging to one home
+         *
+         * @param homeName Name of the home
+         */
+        void invalidateCache(const std::string& homeName);
+
+        /**
+         * @brief Get response cache counters (all zero when the cache is disabled)
+         */
+        CacheStats getCacheStats() const;
+
+        /**
+         * @brief Health and latency of each load-balanced endpoint (empty without load balancing)
+         */
+        std::vector<EndpointStatus> getEndpointStatus() const;
+
+        /**
+         * @brief Get hedged read counters (all zero when hedging is disabled)
+         */
+        HedgingStats getHedgingStats() const;
+
+        /**
+         * @brief Per-route request counts, errors, bytes and latency histograms
+         *
+         * Routes are empty when ClientConfig::enableMetrics is off; queues are
+         * filled when ClientConfig::scheduling is on. Pass the result to
+         * formatPrometheus() for a scrape endpoint.
+         */
+        MetricsSnapshot getMetrics() const;
+
+        /**
+         * @brief Hand every span finished so far to the exporter and wait for it
+         *
+         * Spans are otherwise exported every TracingConfig::exportIntervalMs,
+         * and on destruction of the client. Does nothing when tracing is off.
+         */
+        void flushTraces() const;
+
         /**
          * @brief Test connectivity to the Prefab server
          * 
@@ -165,6 +609,22 @@ namespace prefab {
                              const std::string& roomName, 
                              const std::string& accessoryName);
 
+        /**
+         * @brief getAccessories() parsed into an arena
+         *
+         * Appends the room's accessories to arena.accessories(); every string
+         * and vector of the result is allocated from the arena. Call
+         * arena.clear() to drop earlier results in one step.
+         */
+        void getAccessories(const std::string& homeName, const std::string& roomName, AccessoryArena& arena);
+
+        /**
+         * @brief getAccessory() parsed into an arena
+         * @return The accessory appended to arena.accessories()
+         */
+        const pmr::Accessory& getAccessory(const std::string& homeName, const std::string& roomName,
+                                           const std::string& accessoryName, AccessoryArena& arena);
+
         /**
          * @brief Update an accessory's characteristic value
          * 
@@ -185,11 +645,15 @@ namespace prefab {
          * This is a convenience method that finds a characteristic by its type UUID
          * and updates its value without needing to know the exact characteristic UUID.
          * 
+         * The value is checked against the characteristic's format, range, step
+         * and valid values from its metadata, and rejected with a
+         * PrefabException before anything is sent if it does not fit.
+         *
          * @param homeName Name of the home
          * @param roomName Name of the room
          * @param accessoryName Name of the accessory
          * @param characteristicType The HomeKit characteristic type UUID
-         * @param value The new value to set
+         * @param value The new value to set, as text or as a typed value
          * @return std::string Response from the server
          */
         std::string updateCharacteristicByType(const std::string& homeName,
@@ -197,6 +661,11 @@ namespace prefab {
                                              const std::string& accessoryName,
                                              const std::string& characteristicType,
                                              const std::string& value);
+        std::string updateCharacteristicByType(const std::string& homeName,
+                                             const std::string& roomName,
+                                             const std::string& accessoryName,
+                                             const std::string& characteristicType,
+                                             const CharacteristicValue& value);
 
         // Scene API methods
 
@@ -256,6 +725,200 @@ namespace prefab {
         std::string updateGroup(const std::string& homeName,
                                const std::string& groupId,
                                const UpdateGroupInput& update);
+
+        // Change feed
+
+        /**
+         * @brief Long-poll the server for characteristic value changes
+         *
+         * Without since, returns at once with the server's current sequence and
+         * no changes. With since, returns the changes after it, or waits up to
+         * waitSeconds for the first one. A batch with reset set means the
+         * changes after since are lost; see ChangeFeed for a client that
+         * handles this.
+         *
+         * @param since Sequence of the last change already seen
+         * @param waitSeconds How long the server may hold the request open
+         * @return ChangeBatch Changes after since and the sequence to continue from
+         */
+        ChangeBatch getChanges(std::optional<uint64_t> since = std::nullopt, int waitSeconds = 0);
+
+        // Whole-home snapshot
+
+        /**
+         * @brief Crawl every home, room and accessory into one in-memory tree
+         *
+         * Rooms, accessory lists and accessory details are fetched concurrently
+         * with at most SnapshotOptions::maxParallelRequests requests in flight.
+         * Failures below the home list are recorded in HomeSnapshot::stats.errors
+         * instead of aborting the crawl.
+         *
+         * @param options Crawl options
+         * @return HomeSnapshot The crawled tree including per-phase timing
+         * @throws PrefabException if the list of homes cannot be fetched
+         */
+        HomeSnapshot getSnapshot(const SnapshotOptions& options = SnapshotOptions());
+
+        /**
+         * @brief Asynchronous getSnapshot()
+         */
+        void getSnapshotAsync(const SnapshotOptions& options, AsyncCallback<HomeSnapshot> callback);
+
+        /**
+         * @brief Serve a saved snapshot immediately and refresh it in the background
+         *
+         * Maps the snapshot file at path, if there is a valid one, and teaches
+         * the characteristic ID index from it, so updateCharacteristicByType
+         * works without a lookup request. Then starts getSnapshotAsync(); a
+         * crawl without errors is saved over path, on a thread of its own so
+         * the disk does not hold up the network thread, before refreshed is
+         * invoked on that thread. A failure to save is reported in
+         * HomeSnapshot::stats.errors. The client waits for a save in progress
+         * when it is destroyed.
+         *
+         * @param path Snapshot file written by saveSnapshotFile()
+         * @param options Options for the background crawl
+         * @param refreshed Invoked with the fresh snapshot after the save, or on the network thread if
+         *                  the crawl failed; may be empty
+         * @return The saved snapshot, or nullptr if path is missing, damaged or of another format version
+         */
+        std::shared_ptr<const MappedSnapshot> loadSnapshot(const std::string& path,
+                                                           const SnapshotOptions& options = SnapshotOptions(),
+                                                           AsyncCallback<HomeSnapshot> refreshed = nullptr);
+
+        // Asynchronous API
+        //
+        // Each overload taking an AsyncCallback returns immediately and invokes the
+        // callback on the network thread when the request completes. The overloads
+        // without a callback return a std::future whose get() rethrows request errors.
+
+        /**
+         * @brief Asynchronous testConnection(); the result is true if the server is reachable
+         */
+        void testConnectionAsync(AsyncCallback<bool> callback);
+        std::future<bool> testConnectionAsync();
+
+        /**
+         * @brief Asynchronous getHomes()
+         */
+        void getHomesAsync(AsyncCallback<std::vector<Home>> callback);
+        std::future<std::vector<Home>> getHomesAsync();
+
+        /**
+         * @brief Asynchronous getHome()
+         */
+        void getHomeAsync(const std::string& homeName, AsyncCallback<Home> callback);
+        std::future<Home> getHomeAsync(const std::string& homeName);
+
+        /**
+         * @brief Asynchronous getRooms()
+         */
+        void getRoomsAsync(const std::string& homeName, AsyncCallback<std::vector<Room>> callback);
+        std::future<std::vector<Room>> getRoomsAsync(const std::string& homeName);
+
+        /**
+         * @brief Asynchronous getRoom()
+         */
+        void getRoomAsync(const std::string& homeName, const std::string& roomName,
+                          AsyncCallback<Room> callback);
+        std::future<Room> getRoomAsync(const std::string& homeName, const std::string& roomName);
+
+        /**
+         * @brief Asynchronous getAccessories()
+         */
+        void getAccessoriesAsync(const std::string& homeName, const std::string& roomName,
+                                 AsyncCallback<std::vector<Accessory>> callback);
+        std::future<std::vector<Accessory>> getAccessoriesAsync(const std::string& homeName,
+                                                                const std::string& roomName);
+
+        /**
+         * @brief Asynchronous getAccessory()
+         */
+        void getAccessoryAsync(const std::string& homeName, const std::string& roomName,
+                               const std::string& accessoryName, AsyncCallback<Accessory> callback);
+        std::future<Accessory> getAccessoryAsync(const std::string& homeName, const std::string& roomName,
+                                                 const std::string& accessoryName);
+
+        /**
+         * @brief Asynchronous updateAccessory()
+         */
+        void updateAccessoryAsync(const std::string& homeName, const std::string& roomName,
+                                  const std::string& accessoryName, const UpdateAccessoryInput& update,
+                                  AsyncCallback<std::string> callback);
+        std::future<std::string> updateAccessoryAsync(const std::string& homeName, const std::string& roomName,
+                                                      const std::string& accessoryName,
+                                                      const UpdateAccessoryInput& update);
+
+        /**
+         * @brief Asynchronous updateCharacteristicByType()
+         */
+        void updateCharacteristicByTypeAsync(const std::string& homeName, const std::string& roomName,
+                                             const std::string& accessoryName,
+                                             const std::string& characteristicType,
+                                             const std::string& value,
+                                             AsyncCallback<std::string> callback);
+        std::future<std::string> updateCharacteristicByTypeAsync(const std::string& homeName,
+                                                                 const std::string& roomName,
+                                                                 const std::string& accessoryName,
+                                                                 const std::string& characteristicType,
+                                                                 const std::string& value);
+        void updateCharacteristicByTypeAsync(const std::string& homeName, const std::string& roomName,
+                                             const std::string& accessoryName,
+                                             const std::string& characteristicType,
+                                             const CharacteristicValue& value,
+                                             AsyncCallback<std::string> callback);
+        std::future<std::string> updateCharacteristicByTypeAsync(const std::string& homeName,
+                                                                 const std::string& roomName,
+                                                                 const std::string& accessoryName,
+                                                                 const std::string& characteristicType,
+                                                                 const CharacteristicValue& value);
+
+        /**
+         * @brief Asynchronous getScenes()
+         */
+        void getScenesAsync(const std::string& homeName, AsyncCallback<std::vector<HomeKitScene>> callback);
+        std::future<std::vector<HomeKitScene>> getScenesAsync(const std::string& homeName);
+
+        /**
+         * @brief Asynchronous getScene()
+         */
+        void getSceneAsync(const std::string& homeName, const std::string& sceneId,
+                           AsyncCallback<SceneDetail> callback);
+        std::future<SceneDetail> getSceneAsync(const std::string& homeName, const std::string& sceneId);
+
+        /**
+         * @brief Asynchronous executeScene()
+         */
+        void executeSceneAsync(const std::string& homeName, const std::string& sceneId,
+                               AsyncCallback<std::string> callback);
+        std::future<std::string> executeSceneAsync(const std::string& homeName, const std::string& sceneId);
+
+        /**
+         * @brief Asynchronous getGroups()
+         */
+        void getGroupsAsync(const std::string& homeName, AsyncCallback<std::vector<AccessoryGroup>> callback);
+        std::future<std::vector<AccessoryGroup>> getGroupsAsync(const std::string& homeName);
+
+        /**
+         * @brief Asynchronous getGroup()
+         */
+        void getGroupAsync(const std::string& homeName, const std::string& groupId,
+                           AsyncCallback<AccessoryGroupDetail> callback);
+        std::future<AccessoryGroupDetail> getGroupAsync(const std::string& homeName, const std::string& groupId);
+
+        /**
+         * @brief Asynchronous updateGroup()
+         */
+        void updateGroupAsync(const std::string& homeName, const std::string& groupId,
+                              const UpdateGroupInput& update, AsyncCallback<std::string> callback);
+        std::future<std::string> updateGroupAsync(const std::string& homeName, const std::string& groupId,
+                                                  const UpdateGroupInput& update);
+
+        /**
+         * @brief Asynchronous getChanges()
+         */
+        void getChangesAsync(std::optional<uint64_t> since, int waitSeconds, AsyncCallback<ChangeBatch> callback);
+        std::future<ChangeBatch> getChangesAsync(std::optional<uint64_t> since, int waitSeconds);
     };
 
 } // namespace prefab
\ No newline at end of file
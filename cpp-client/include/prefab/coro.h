@@ -0,0 +1,576 @@
+#pragma once
+
+/**
+ * @file coro.h
+ * @brief C++20 coroutine front-end for the Prefab client
+ *
+ * Wraps the callback-based asynchronous API of PrefabClient in awaitable
+ * tasks, so automation rules can be written as straight-line code:
+ *
+ * @code
+ * prefab::coro::Task<void> dimAll(prefab::coro::AsyncClient& client, std::string home) {
+ *     auto rooms = co_await client.getRoomsAsync(home);
+ *     std::vector<prefab::coro::Task<std::vector<prefab::Accessory>>> fanOut;
+ *     for (const auto& room : rooms) {
+ *         fanOut.push_back(client.getAccessoriesAsync(home, room.name));
+ *     }
+ *     auto perRoom = co_await prefab::coro::when_all(std::move(fanOut));
+ *     ...
+ * }
+ * @endcode
+ *
+ * This header requires C++20 and is provided by the optional
+ * prefab::prefab-client-coro CMake target.
+ */
+
+#if __cplusplus < 202002L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#error "prefab/coro.h requires C++20; link against prefab::prefab-client-coro"
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "client.h"
+
+namespace prefab::coro {
+
+    /**
+     * @brief Runs a coroutine continuation
+     *
+     * Network completions are delivered on the client's reactor thread; the
+     * executor decides where the awaiting coroutine resumes.
+     */
+    using Executor = std::function<void(std::function<void()>)>;
+
+    /**
+     * @brief Executor that resumes coroutines directly on the network thread
+     *
+     * Cheapest option, but code after a co_await must then not block.
+     */
+    inline Executor inlineExecutor() {
+        return [](std::function<void()> work) { work(); };
+    }
+
+    /**
+     * @brief Minimal single-threaded event loop usable as an Executor
+     *
+     * Continuations posted to the loop run on whichever thread calls run().
+     */
+    class RunLoop {
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<std::function<void()>> queue_;
+        bool stopped_ = false;
+
+    public:
+        void post(std::function<void()> work) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                queue_.push_back(std::move(work));
+            }
+            cv_.notify_one();
+        }
+
+        /**
+         * @brief Process posted work until stop() is called
+         */
+        void run() {
+            while (true) {
+                std::function<void()> work;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cv_.wait(lock, [this] { return stopped_ || !queue_.empty(); });
+                    if (queue_.empty()) return;
+                    work = std::move(queue_.front());
+                    queue_.pop_front();
+                }
+                work();
+            }
+        }
+
+        /**
+         * @brief Make run() return once the queue is drained
+         */
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopped_ = true;
+            }
+            cv_.notify_all();
+        }
+
+        Executor executor() {
+            return [this](std::function<void()> work) { post(std::move(work)); };
+        }
+    };
+
+    template <typename T>
+    class Task;
+
+    namespace detail {
+
+        struct PromiseBase {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct FinalAwaiter {
+                bool await_ready() noexcept { return false; }
+
+                template <typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                    auto continuation = handle.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            FinalAwaiter final_suspend() noexcept { return {}; }
+
+            void unhandled_exception() { error = std::current_exception(); }
+        };
+
+        template <typename T>
+        struct Promise : PromiseBase {
+            std::optional<T> value;
+
+            Task<T> get_return_object();
+
+            void return_value(T result) { value = std::move(result); }
+
+            T take() {
+                if (error) std::rethrow_exception(error);
+                return std::move(*value);
+            }
+        };
+
+        template <>
+        struct Promise<void> : PromiseBase {
+            Task<void> get_return_object();
+
+            void return_void() {}
+
+            void take() {
+                if (error) std::rethrow_exception(error);
+            }
+        };
+
+        /**
+         * @brief Eagerly started, self-destroying coroutine used to drive tasks
+         */
+        struct Detached {
+            struct promise_type {
+                Detached get_return_object() { return {}; }
+                std::suspend_never initial_suspend() noexcept { return {}; }
+                std::suspend_never final_suspend() noexcept { return {}; }
+                void return_void() {}
+                void unhandled_exception() { std::terminate(); }
+            };
+        };
+
+        /**
+         * @brief Awaits one callback-style PrefabClient call
+         *
+         * The call may complete before await_suspend returns (for example when a
+         * request cannot be started); the shared state records which side
+         * finished first so the coroutine is resumed exactly once.
+         */
+        template <typename T>
+        class CallbackAwaiter {
+        private:
+            enum : int { Pending, Suspended, Completed };
+
+            struct State {
+                std::atomic<int> phase{Pending};
+                AsyncResult<T> result;
+            };
+
+            Executor executor_;
+            std::function<void(AsyncCallback<T>)> start_;
+            std::shared_ptr<State> state_ = std::make_shared<State>();
+
+        public:
+            CallbackAwaiter(Executor executor, std::function<void(AsyncCallback<T>)> start)
+                : executor_(std::move(executor)), start_(std::move(start)) {}
+
+            bool await_ready() const noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                auto state = state_;
+                Executor executor = executor_;
+                start_([state, executor, handle](AsyncResult<T> result) {
+                    state->result = std::move(result);
+                    if (state->phase.exchange(Completed) == Suspended) {
+                        executor([handle] { handle.resume(); });
+                    }
+                });
+                // If the callback already ran, continue without suspending
+                return state->phase.exchange(Suspended) != Completed;
+            }
+
+            T await_resume() { return std::move(state_->result.value()); }
+        };
+
+    } // namespace detail
+
+    /**
+     * @brief Lazily started coroutine producing a T
+     *
+     * The body runs when the task is first awaited (or passed to when_all,
+     * spawn or sync_wait). Exceptions thrown inside the task are rethrown to
+     * the awaiter.
+     */
+    template <typename T>
+    class [[nodiscard]] Task {
+    public:
+        using promise_type = detail::Promise<T>;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        Task() = default;
+        explicit Task(handle_type handle) : handle_(handle) {}
+        Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                if (handle_) handle_.destroy();
+                handle_ = std::exchange(other.handle_, nullptr);
+            }
+            return *this;
+        }
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+        ~Task() {
+            if (handle_) handle_.destroy();
+        }
+
+        bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+            handle_.promise().continuation = continuation;
+            return handle_;
+        }
+
+        T await_resume() { return handle_.promise().take(); }
+
+    private:
+        handle_type handle_;
+    };
+
+    namespace detail {
+
+        template <typename T>
+        Task<T> Promise<T>::get_return_object() {
+            return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+        }
+
+        inline Task<void> Promise<void>::get_return_object() {
+            return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+        }
+
+        /**
+         * @brief Shared completion state of a when_all fan-out
+         */
+        struct WhenAllLatch {
+            std::atomic<size_t> remaining;
+            std::coroutine_handle<> parent;
+            std::mutex mutex;
+            std::exception_ptr error;
+
+            explicit WhenAllLatch(size_t count) : remaining(count + 1) {}
+
+            void fail(std::exception_ptr e) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = e;
+            }
+
+            void arrive() {
+                if (remaining.fetch_sub(1) == 1) parent.resume();
+            }
+        };
+
+        template <typename T>
+        Detached driveInto(Task<T> task, std::shared_ptr<WhenAllLatch> latch, std::optional<T>* slot) {
+            try {
+                slot->emplace(co_await task);
+            } catch (...) {
+                latch->fail(std::current_exception());
+            }
+            latch->arrive();
+        }
+
+        inline Detached driveVoid(Task<void> task, std::shared_ptr<WhenAllLatch> latch) {
+            try {
+                co_await task;
+            } catch (...) {
+                latch->fail(std::current_exception());
+            }
+            latch->arrive();
+        }
+
+        template <typename Launch>
+        struct WhenAllAwaiter {
+            std::shared_ptr<WhenAllLatch> latch;
+            Launch launch;
+
+            bool await_ready() const noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<> parent) {
+                latch->parent = parent;
+                launch();
+                // Drop the launcher's own count; suspend only if children are still running
+                return latch->remaining.fetch_sub(1) != 1;
+            }
+
+            void await_resume() {
+                if (latch->error) std::rethrow_exception(latch->error);
+            }
+        };
+
+    } // namespace detail
+
+    /**
+     * @brief Run all tasks concurrently and collect their results in order
+     *
+     * If any task fails, the first error is rethrown once all tasks finished.
+     */
+    template <typename T>
+    Task<std::vector<T>> when_all(std::vector<Task<T>> tasks) {
+        std::vector<std::optional<T>> slots(tasks.size());
+        auto latch = std::make_shared<detail::WhenAllLatch>(tasks.size());
+
+        auto launch = [&tasks, &slots, latch] {
+            for (size_t i = 0; i < tasks.size(); ++i) {
+                detail::driveInto(std::move(tasks[i]), latch, &slots[i]);
+            }
+        };
+        co_await detail::WhenAllAwaiter<decltype(launch)>{latch, launch};
+
+        std::vector<T> results;
+        results.reserve(slots.size());
+        for (auto& slot : slots) {
+            results.push_back(std::move(*slot));
+        }
+        co_return results;
+    }
+
+    /**
+     * @brief Run all void tasks concurrently and wait for every one of them
+     */
+    inline Task<void> when_all(std::vector<Task<void>> tasks) {
+        auto latch = std::make_shared<detail::WhenAllLatch>(tasks.size());
+
+        auto launch = [&tasks, latch] {
+            for (auto& task : tasks) {
+                detail::driveVoid(std::move(task), latch);
+            }
+        };
+        co_await detail::WhenAllAwaiter<decltype(launch)>{latch, launch};
+    }
+
+    /**
+     * @brief Start a task without waiting for it
+     *
+     * @param onDone Optional callback receiving the task's error (null on success)
+     */
+    inline void spawn(Task<void> task, std::function<void(std::exception_ptr)> onDone = nullptr) {
+        [](Task<void> task, std::function<void(std::exception_ptr)> onDone) -> detail::Detached {
+            std::exception_ptr error;
+            try {
+                co_await task;
+            } catch (...) {
+                error = std::current_exception();
+            }
+            if (onDone) onDone(error);
+        }(std::move(task), std::move(onDone));
+    }
+
+    /**
+     * @brief Block the calling thread until the task finishes and return its result
+     *
+     * Intended for main() and tests; never call it from a coroutine or from the
+     * thread that resumes the task.
+     */
+    template <typename T>
+    T sync_wait(Task<T> task) {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool done = false;
+        std::optional<T> value;
+        std::exception_ptr error;
+
+        [](Task<T> task, std::mutex& mutex, std::condition_variable& cv, bool& done,
+           std::optional<T>& value, std::exception_ptr& error) -> detail::Detached {
+            try {
+                value.emplace(co_await task);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            cv.notify_one();
+        }(std::move(task), mutex, cv, done, value, error);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&done] { return done; });
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+
+    inline void sync_wait(Task<void> task) {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool done = false;
+        std::exception_ptr error;
+
+        [](Task<void> task, std::mutex& mutex, std::condition_variable& cv, bool& done,
+           std::exception_ptr& error) -> detail::Detached {
+            try {
+                co_await task;
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            cv.notify_one();
+        }(std::move(task), mutex, cv, done, error);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&done] { return done; });
+        if (error) std::rethrow_exception(error);
+    }
+
+    /**
+     * @brief Awaitable view of a PrefabClient
+     *
+     * Each method issues the corresponding asynchronous PrefabClient request,
+     * suspends the calling coroutine while the request is in flight and resumes
+     * it through the configured executor. The wrapped client must outlive every
+     * task created from this object.
+     */
+    class AsyncClient {
+    private:
+        PrefabClient& client_;
+        Executor executor_;
+
+        template <typename T>
+        detail::CallbackAwaiter<T> call(std::function<void(AsyncCallback<T>)> start) {
+            return detail::CallbackAwaiter<T>(executor_, std::move(start));
+        }
+
+    public:
+        /**
+         * @param client Underlying client that performs the requests
+         * @param executor Where coroutines resume after network I/O (default: network thread)
+         */
+        explicit AsyncClient(PrefabClient& client, Executor executor = inlineExecutor())
+            : client_(client), executor_(std::move(executor)) {}
+
+        PrefabClient& client() { return client_; }
+
+        Task<bool> testConnectionAsync() {
+            co_return co_await call<bool>([this](AsyncCallback<bool> cb) {
+                client_.testConnectionAsync(std::move(cb));
+            });
+        }
+
+        Task<std::vector<Home>> getHomesAsync() {
+            co_return co_await call<std::vector<Home>>([this](AsyncCallback<std::vector<Home>> cb) {
+                client_.getHomesAsync(std::move(cb));
+            });
+        }
+
+        Task<Home> getHomeAsync(std::string homeName) {
+            co_return co_await call<Home>([&](AsyncCallback<Home> cb) {
+                client_.getHomeAsync(homeName, std::move(cb));
+            });
+        }
+
+        Task<std::vector<Room>> getRoomsAsync(std::string homeName) {
+            co_return co_await call<std::vector<Room>>([&](AsyncCallback<std::vector<Room>> cb) {
+                client_.getRoomsAsync(homeName, std::move(cb));
+            });
+        }
+
+        Task<Room> getRoomAsync(std::string homeName, std::string roomName) {
+            co_return co_await call<Room>([&](AsyncCallback<Room> cb) {
+                client_.getRoomAsync(homeName, roomName, std::move(cb));
+            });
+        }
+
+        Task<std::vector<Accessory>> getAccessoriesAsync(std::string homeName, std::string roomName) {
+            co_return co_await call<std::vector<Accessory>>([&](AsyncCallback<std::vector<Accessory>> cb) {
+                client_.getAccessoriesAsync(homeName, roomName, std::move(cb));
+            });
+        }
+
+        Task<Accessory> getAccessoryAsync(std::string homeName, std::string roomName, std::string accessoryName) {
+            co_return co_await call<Accessory>([&](AsyncCallback<Accessory> cb) {
+                client_.getAccessoryAsync(homeName, roomName, accessoryName, std::move(cb));
+            });
+        }
+
+        Task<std::string> updateAccessoryAsync(std::string homeName, std::string roomName,
+                                               std::string accessoryName, UpdateAccessoryInput update) {
+            co_return co_await call<std::string>([&](AsyncCallback<std::string> cb) {
+                client_.updateAccessoryAsync(homeName, roomName, accessoryName, update, std::move(cb));
+            });
+        }
+
+        Task<std::string> updateCharacteristicByTypeAsync(std::string homeName, std::string roomName,
+                                                          std::string accessoryName,
+                                                          std::string characteristicType, std::string value) {
+            co_return co_await call<std::string>([&](AsyncCallback<std::string> cb) {
+                client_.updateCharacteristicByTypeAsync(homeName, roomName, accessoryName,
+                                                        characteristicType, value, std::move(cb));
+            });
+        }
+
+        Task<std::vector<HomeKitScene>> getScenesAsync(std::string homeName) {
+            co_return co_await call<std::vector<HomeKitScene>>([&](AsyncCallback<std::vector<HomeKitScene>> cb) {
+                client_.getScenesAsync(homeName, std::move(cb));
+            });
+        }
+
+        Task<SceneDetail> getSceneAsync(std::string homeName, std::string sceneId) {
+            co_return co_await call<SceneDetail>([&](AsyncCallback<SceneDetail> cb) {
+                client_.getSceneAsync(homeName, sceneId, std::move(cb));
+            });
+        }
+
+        Task<std::string> executeSceneAsync(std::string homeName, std::string sceneId) {
+            co_return co_await call<std::string>([&](AsyncCallback<std::string> cb) {
+                client_.executeSceneAsync(homeName, sceneId, std::move(cb));
+            });
+        }
+
+        Task<std::vector<AccessoryGroup>> getGroupsAsync(std::string homeName) {
+            co_return co_await call<std::vector<AccessoryGroup>>([&](AsyncCallback<std::vector<AccessoryGroup>> cb) {
+                client_.getGroupsAsync(homeName, std::move(cb));
+            });
+        }
+
+        Task<AccessoryGroupDetail> getGroupAsync(std::string homeName, std::string groupId) {
+            co_return co_await call<AccessoryGroupDetail>([&](AsyncCallback<AccessoryGroupDetail> cb) {
+                client_.getGroupAsync(homeName, groupId, std::move(cb));
+            });
+        }
+
+        Task<std::string> updateGroupAsync(std::string homeName, std::string groupId, UpdateGroupInput update) {
+            co_return co_await call<std::string>([&](AsyncCallback<std::string> cb) {
+                client_.updateGroupAsync(homeName, groupId, update, std::move(cb));
+            });
+        }
+    };
+
+} // namespace prefab::coro
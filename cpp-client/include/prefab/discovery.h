@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace prefab {
+
+    /**
+     * @brief A resolved Prefab server instance
+     */
+    struct DiscoveredServer {
+        std::string name;       ///< Service instance name
+        std::string hostName;   ///< e.g. "living-room-mac.local"
+        std::string address;    ///< Numeric IPv4 or IPv6 address
+        int port = 0;
+        int interfaceIndex = 0;
+        bool ipv6 = false;
+        std::map<std::string, std::string> txt;
+        std::chrono::steady_clock::time_point resolvedAt;
+
+        /**
+         * @brief Base URL for ClientConfig / PrefabClient::setBaseUrl
+         */
+        std::string url() const;
+    };
+
+    enum class DiscoveryEvent {
+        Added,    ///< A new instance was resolved
+        Updated,  ///< A known instance resolved to a different address, port or TXT record
+        Removed   ///< The instance left the network (or the browser lost the Avahi daemon)
+    };
+
+    /**
+     * @brief Long-lived mDNS browser keeping a registry of Prefab servers
+     *
+     * A background Avahi thread browses the service type and keeps a resolver
+     * open per instance, so the registry follows instances as they appear,
+     * change address and leave. Lookups read the registry without any network
+     * traffic. If the Avahi daemon restarts the registry is emptied and
+     * browsing resumes once it is back.
+     *
+     * shared() returns one browser per service type for the whole process;
+     * every PrefabClient with mDNS discovery enabled uses it.
+     *
+     * Listeners run on the Avahi thread and must not block.
+     */
+    class ServiceBrowser {
+    public:
+        using Listener = std::function<void(DiscoveryEvent event, const DiscoveredServer& server)>;
+
+        explicit ServiceBrowser(const std::string& serviceType = "_prefab._tcp");
+        ~ServiceBrowser();
+
+        ServiceBrowser(const ServiceBrowser&) = delete;
+        ServiceBrowser& operator=(const ServiceBrowser&) = delete;
+
+        /**
+         * @brief The process-wide browser for a service type, started on first use
+         */
+        static std::shared_ptr<ServiceBrowser> shared(const std::string& serviceType = "_prefab._tcp");
+
+        /**
+         * @brief Start the background browser; does nothing if it is running
+         * @return false if Avahi could not be set up
+         */
+        bool start();
+        void stop();
+        bool running() const;
+
+        /**
+         * @brief All resolved instances, oldest first
+         */
+        std::vector<DiscoveredServer> servers() const;
+
+        /**
+         * @brief The instance a client should use: the oldest IPv4 one, else the oldest
+         *
+         * Link-local IPv6 addresses are not usable without their zone, so IPv4 wins.
+         */
+        std::optional<DiscoveredServer> preferred() const;
+
+        /**
+         * @brief Wait until at least one instance is resolved
+         * @return preferred(), or std::nullopt after the timeout
+         */
+        std::optional<DiscoveredServer> waitForServer(std::chrono::milliseconds timeout) const;
+
+        /**
+         * @brief Register a listener for registry changes; returns an id for unsubscribe()
+         */
+        size_t subscribe(Listener listener);
+        void unsubscribe(size_t id);
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> impl_;
+    };
+
+} // namespace prefab
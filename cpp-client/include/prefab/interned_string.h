@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+
+namespace prefab {
+
+    /**
+     * @brief A string stored once in a process-wide table
+     *
+     * Meant for the small, highly repetitive set of HomeKit type names
+     * ("Brightness", "Lightbulb", ...). Every distinct text is stored once and
+     * never freed; an InternedString is a pointer to it, so copies are free and
+     * comparison and hashing are pointer operations.
+     *
+     * Interning is thread-safe. Do not intern unbounded data such as names
+     * chosen by users.
+     */
+    class InternedString {
+    public:
+        InternedString();  ///< The empty string
+        explicit InternedString(std::string_view text);
+
+        /**
+         * @brief The interned copy of text, if it was ever interned; never adds to the table
+         */
+        static std::optional<InternedString> find(std::string_view text);
+
+        const std::string& str() const { return *text_; }
+        const char* c_str() const { return text_->c_str(); }
+        size_t size() const { return text_->size(); }
+        bool empty() const { return text_->empty(); }
+
+        bool operator==(const InternedString& other) const { return text_ == other.text_; }
+        bool operator!=(const InternedString& other) const { return text_ != other.text_; }
+        bool operator<(const InternedString& other) const { return *text_ < *other.text_; }
+
+    private:
+        explicit InternedString(const std::string* text) : text_(text) {}
+
+        const std::string* text_;
+    };
+
+    inline bool operator==(const InternedString& interned, std::string_view text) { return interned.str() == text; }
+    inline bool operator==(std::string_view text, const InternedString& interned) { return interned.str() == text; }
+    inline bool operator!=(const InternedString& interned, std::string_view text) { return interned.str() != text; }
+    inline bool operator!=(std::string_view text, const InternedString& interned) { return interned.str() != text; }
+
+    inline std::ostream& operator<<(std::ostream& out, const InternedString& interned) {
+        return out << interned.str();
+    }
+
+    void to_json(nlohmann::json& j, const InternedString& interned);
+    void from_json(const nlohmann::json& j, InternedString& interned);
+
+} // namespace prefab
+
+namespace std {
+    template <>
+    struct hash<prefab::InternedString> {
+        size_t operator()(const prefab::InternedString& interned) const noexcept {
+            return std::hash<const void*>()(&interned.str());
+        }
+    };
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace prefab {
+
+    /**
+     * @brief Severity of a log record, lowest first
+     */
+    enum class LogLevel { Trace = 0, Debug, Info, Warn, Error, Off };
+
+    const char* toString(LogLevel level);
+
+    using LogFields = std::vector<std::pair<std::string, std::string>>;
+
+    /**
+     * @brief One log statement: a short message plus key/value fields
+     */
+    struct LogRecord {
+        LogLevel level = LogLevel::Info;
+        std::chrono::system_clock::time_point time;
+        const char* component = "";  ///< Static string naming the emitting part, e.g. "client"
+        std::string message;
+        LogFields fields;
+    };
+
+    /**
+     * @brief Destination for log records
+     *
+     * write() may be called from any thread, including the client's network
+     * thread, so it must be thread-safe and should not block for long; wrap
+     * slow sinks in an AsyncLogSink.
+     */
+    class LogSink {
+    public:
+        virtual ~LogSink() = default;
+        virtual void write(const LogRecord& record) = 0;
+        virtual void flush() {}
+    };
+
+    /**
+     * @brief Writes one line per record to a stream (std::cerr by default)
+     *
+     * Format: 2026-01-02T03:04:05.678Z DEBUG client: message key="value" ...
+     */
+    class StreamLogSink : public LogSink {
+    public:
+        explicit StreamLogSink(std::ostream& out);
+        StreamLogSink();
+
+        void write(const LogRecord& record) override;
+        void flush() override;
+
+    private:
+        std::ostream& out_;
+        std::mutex mutex_;
+    };
+
+    /**
+     * @brief Hands records to another sink on a background thread
+     *
+     * write() puts the record into a bounded lock-free ring and returns; it
+     * never waits for the target sink or for other writers. When the ring is
+     * full the record is dropped and counted instead. flush() waits until
+     * everything accepted so far has reached the target.
+     */
+    class AsyncLogSink : public LogSink {
+    public:
+        explicit AsyncLogSink(std::shared_ptr<LogSink> target, size_t capacity = 4096);
+        ~AsyncLogSink() override;
+
+        AsyncLogSink(const AsyncLogSink&) = delete;
+        AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+        void write(const LogRecord& record) override;
+        void flush() override;
+
+        /**
+         * @brief Records dropped because the ring was full
+         */
+        uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        struct Slot {
+            std::atomic<size_t> sequence{0};
+            LogRecord record;
+        };
+
+        bool pop(LogRecord& record);
+        void run();
+
+        const std::shared_ptr<LogSink> target_;
+        const size_t mask_;
+        std::unique_ptr<Slot[]> slots_;
+        std::atomic<size_t> enqueue_{0};
+        size_t dequeue_ = 0;  // Only the background thread reads from the ring
+        std::atomic<uint64_t> accepted_{0};
+        std::atomic<uint64_t> delivered_{0};
+        std::atomic<uint64_t> dropped_{0};
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable drained_;
+        bool stopping_ = false;
+        std::thread thread_;
+    };
+
+    /**
+     * @brief Process-wide log configuration used by every client
+     *
+     * Records below the runtime level (Warn by default) are discarded before
+     * their message is even built. Statements below the compile-time level
+     * (CMake option PREFAB_LOG_LEVEL) are not compiled in at all. The default
+     * sink is an AsyncLogSink in front of a StreamLogSink on std::cerr.
+     */
+    class Logger {
+    public:
+        static void setLevel(LogLevel level);
+        static LogLevel level();
+
+        /**
+         * @brief Replace the sink; null discards every record
+         */
+        static void setSink(std::shared_ptr<LogSink> sink);
+        /**
+         * @brief The current sink; takes a brief lock, so records below the level never call it
+         */
+        static std::shared_ptr<LogSink> sink();
+
+        static bool enabled(LogLevel level) {
+            return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+        }
+
+        static void write(LogLevel level, const char* component, std::string message, LogFields fields = {});
+
+    private:
+        static std::atomic<int> level_;
+    };
+
+} // namespace prefab
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace prefab {
+
+    /**
+     * @brief Copy of a latency histogram
+     *
+     * Buckets are log-linear, as in HdrHistogram: values below 8 us have one
+     * bucket each, and every power of two above that is split into 8 buckets.
+     * Any value is therefore known to within 12.5%, from 1 us up to about
+     * nine hours, with a fixed 272 counters.
+     */
+    struct HistogramSnapshot {
+        static constexpr size_t kBuckets = 272;
+
+        uint64_t count = 0;
+        std::chrono::microseconds sum{0};
+        std::chrono::microseconds max{0};
+        std::vector<uint64_t> buckets;  ///< kBuckets counts (empty while count is 0)
+
+        /**
+         * @brief Largest value that lands in the bucket
+         */
+        static std::chrono::microseconds bucketUpperBound(size_t index);
+
+        /**
+         * @brief Index of the bucket a value lands in
+         */
+        static size_t bucketFor(std::chrono::microseconds value);
+
+        /**
+         * @brief Value at the percentile (0-100), rounded up to its bucket's bound
+         */
+        std::chrono::microseconds percentile(double percentile) const;
+
+        /**
+         * @brief Number of values no larger than bound, to bucket resolution
+         */
+        uint64_t countAtOrBelow(std::chrono::microseconds bound) const;
+    };
+
+    /**
+     * @brief Counters and latencies of one method and route
+     *
+     * Every attempt counts, so failovers and hedged reads add requests of their
+     * own. Phase timings come from curl: dns is the name lookup, connect the
+     * TCP connect after it (both near 0 on a reused connection) and transfer
+     * everything from the connection being ready to the last byte.
+     */
+    struct RouteMetrics {
+        std::string method;
+        std::string route;                      ///< Path with names replaced, e.g. /rooms/:home/:room
+        uint64_t requests = 0;
+        uint64_t errors = 0;                    ///< Transport errors, timeouts and HTTP status >= 400
+        std::map<int, uint64_t> errorsByCode;   ///< By HTTP status; 0 for transport errors and timeouts
+        uint64_t bytesSent = 0;                 ///< Request bodies
+        uint64_t bytesReceived = 0;             ///< Response bodies
+        HistogramSnapshot latency;              ///< Whole exchange
+        HistogramSnapshot dns;
+        HistogramSnapshot connect;
+        HistogramSnapshot transfer;
+    };
+
+    /**
+     * @brief One priority class of the request scheduler
+     */
+    struct QueueMetrics {
+        std::string priority;    ///< "interactive", "normal" or "background"
+        uint64_t depth = 0;      ///< Requests waiting now
+        uint64_t admitted = 0;   ///< Attempts sent so far, failovers and hedges included
+        uint64_t rejected = 0;   ///< Queue full, deadline passed while waiting, or client shut down
+        HistogramSnapshot wait;  ///< Time from queueing an attempt to sending it
+    };
+
+    /**
+     * @brief Metrics of one client, one entry per method and route seen
+     */
+    struct MetricsSnapshot {
+        std::vector<RouteMetrics> routes;  ///< Sorted by route, then method
+        std::vector<QueueMetrics> queues;  ///< By priority, highest first; empty without scheduling
+    };
+
+    /**
+     * @brief Render a snapshot in the Prometheus text exposition format
+     *
+     * Produces <prefix>_requests_total, <prefix>_errors_total (labelled by
+     * code), <prefix>_sent_bytes_total, <prefix>_received_bytes_total and the
+     * histogram <prefix>_request_duration_seconds labelled by phase (total,
+     * dns, connect, transfer), all labelled by method and route. Scheduler
+     * queues add <prefix>_queue_depth, <prefix>_queue_admitted_total,
+     * <prefix>_queue_rejected_total and the histogram
+     * <prefix>_queue_wait_seconds, labelled by priority.
+     */
+    std::string formatPrometheus(const MetricsSnapshot& snapshot, const std::string& prefix = "prefab_client");
+
+} // namespace prefab
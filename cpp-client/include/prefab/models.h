@@ -4,6 +4,9 @@
 #include <vector>
 #include <optional>
 #include <nlohmann/json.hpp>
+#include "interned_string.h"
+#include "uuid.h"
+#include "value.h"
 
 namespace prefab {
 
@@ -40,6 +43,9 @@ namespace prefab {
         std::optional<std::string> format;
         std::optional<std::string> units;
 
+        // Decoded from the fields above when the metadata is parsed; not serialized
+        ValueConstraints constraints;
+
         // Custom JSON serialization for optional fields
         friend void to_json(nlohmann::json& j, const CharacteristicMetadata& m) {
             j = nlohmann::json{};
@@ -78,33 +84,66 @@ namespace prefab {
             if (j.contains("units") && !j["units"].is_null()) {
                 m.units = j["units"].get<std::string>();
             }
+            m.constraints = ValueConstraints::fromMetadata(m);
         }
     };
 
     /**
      * @brief Represents a HomeKit Characteristic
+     *
+     * Identifiers and the type are stored as binary UUIDs and the type name is
+     * interned, so the many characteristics of a large home share that data.
      */
     struct Characteristic {
-        std::string uniqueIdentifier;
+        Uuid uniqueIdentifier;
         std::string description;
         std::vector<std::string> properties;
-        std::string typeName;
-        std::string type;
+        InternedString typeName;
+        Uuid type;
         CharacteristicMetadata metadata;
-        std::string value;
+        std::string value;                ///< Value as sent by the server
+        CharacteristicValue typedValue;   ///< value decoded with metadata.format; not serialized
+
+        /**
+         * @brief Set both value and typedValue
+         */
+        void setValue(const CharacteristicValue& newValue) {
+            typedValue = newValue;
+            value = newValue.toString();
+        }
+
+        friend void to_json(nlohmann::json& j, const Characteristic& c) {
+            j = nlohmann::json{
+                {"uniqueIdentifier", c.uniqueIdentifier},
+                {"description", c.description},
+                {"properties", c.properties},
+                {"typeName", c.typeName},
+                {"type", c.type},
+                {"metadata", c.metadata},
+                {"value", c.value}
+            };
+        }
 
-        NLOHMANN_DEFINE_TYPE_INTRUSIVE(Characteristic,
-            uniqueIdentifier, description, properties, typeName, type, metadata, value)
+        friend void from_json(const nlohmann::json& j, Characteristic& c) {
+            j.at("uniqueIdentifier").get_to(c.uniqueIdentifier);
+            j.at("description").get_to(c.description);
+            j.at("properties").get_to(c.properties);
+            j.at("typeName").get_to(c.typeName);
+            j.at("type").get_to(c.type);
+            j.at("metadata").get_to(c.metadata);
+            j.at("value").get_to(c.value);
+            c.typedValue = c.metadata.constraints.decode(c.value);
+        }
     };
 
     /**
      * @brief Represents a HomeKit Service
      */
     struct Service {
-        std::string uniqueIdentifier;
+        Uuid uniqueIdentifier;
         std::string name;
-        std::string typeName;
-        std::string type;
+        InternedString typeName;
+        Uuid type;
         bool isPrimary;
         bool isUserInteractive;
         std::optional<std::string> associatedType;
@@ -217,6 +256,8 @@ namespace prefab {
         std::string characteristicId;
         std::string value;
 
+        void setValue(const CharacteristicValue& newValue) { value = newValue.toString(); }
+
         NLOHMANN_DEFINE_TYPE_INTRUSIVE(UpdateAccessoryInput,
             serviceId, characteristicId, value)
     };
@@ -317,4 +358,39 @@ namespace prefab {
         NLOHMANN_DEFINE_TYPE_INTRUSIVE(UpdateGroupInput, characteristicType, value)
     };
 
+    // ========================================================================
+    // Change Feed
+    // ========================================================================
+
+    /**
+     * @brief One characteristic value change, numbered in the order the server saw it
+     */
+    struct CharacteristicChange {
+        uint64_t sequence = 0;
+        std::string home;
+        std::string room;
+        std::string accessory;
+        Uuid serviceId;
+        Uuid characteristicId;
+        std::string value;
+
+        NLOHMANN_DEFINE_TYPE_INTRUSIVE(CharacteristicChange,
+            sequence, home, room, accessory, serviceId, characteristicId, value)
+    };
+
+    /**
+     * @brief Response of GET /events
+     *
+     * reset means the requested changes are no longer buffered on the server
+     * (or epoch changed because it restarted); mirrored state has to be reread.
+     */
+    struct ChangeBatch {
+        std::string epoch;
+        uint64_t sequence = 0;
+        bool reset = false;
+        std::vector<CharacteristicChange> changes;
+
+        NLOHMANN_DEFINE_TYPE_INTRUSIVE(ChangeBatch, epoch, sequence, reset, changes)
+    };
+
 } // namespace prefab
\ No newline at end of file
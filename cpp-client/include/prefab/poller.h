@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include "client.h"
+
+namespace prefab {
+
+    /**
+     * @brief Options for Poller
+     */
+    struct PollerOptions {
+        int initialIntervalMs = 5000;     ///< Interval of a newly added characteristic
+        int minIntervalMs = 1000;         ///< Halved on every change, down to this
+        int maxIntervalMs = 60000;        ///< Grows by a quarter on every unchanged read, up to this
+        double maxRequestsPerSecond = 10; ///< Global cap on reads; reads over it wait for the next tick. 0: unlimited
+        int tickMs = 100;                 ///< Timer wheel resolution
+        size_t wheelSlots = 512;          ///< Timer wheel size; longer intervals take several turns
+
+        PollerOptions() = default;
+    };
+
+    /**
+     * @brief Counters since the poller was created
+     */
+    struct PollerStats {
+        size_t reads = 0;     ///< Accessory reads issued
+        size_t changes = 0;   ///< Callbacks fired
+        size_t errors = 0;    ///< Failed reads
+        size_t deferred = 0;  ///< Reads pushed to a later tick by the rate cap
+    };
+
+    /**
+     * @brief Polls characteristics at intervals that follow how often they change
+     *
+     * Every added characteristic has its own interval: it is halved when a
+     * read finds a new value and grows slowly while the value stays the same,
+     * within [minIntervalMs, maxIntervalMs]. Due reads are kept on a hashed
+     * timer wheel driven by the client's network thread. First reads are
+     * spread randomly over the initial interval and later ones are jittered,
+     * so characteristics added together do not stay in step.
+     *
+     * Characteristics of the same accessory that are due in the same tick
+     * share one read, and every read refreshes all characteristics of its
+     * accessory. A token bucket caps the total read rate; reads over the cap
+     * move to the next tick. A cap of zero or less turns it off.
+     *
+     * The first read of a characteristic sets its baseline. After that the
+     * callback runs only when the value changes, on the client's network
+     * thread, and must not block.
+     *
+     * The poller keeps a reference to the client, which must outlive it.
+     *
+     * @code
+     * prefab::Poller poller(client);
+     * poller.add("My Home", "Hall", "Front Door", "Contact Sensor State", [](const std::string& value) { ... });
+     * poller.start();
+     * @endcode
+     */
+    class Poller {
+    public:
+        using Callback = std::function<void(const std::string& value)>;
+
+        explicit Poller(PrefabClient& client, const PollerOptions& options = PollerOptions());
+        ~Poller();
+
+        Poller(const Poller&) = delete;
+        Poller& operator=(const Poller&) = delete;
+
+        /**
+         * @brief Poll a characteristic, matched by type UUID or typeName
+         * @return An id for remove(), value() and interval()
+         */
+        size_t add(const std::string& homeName, const std::string& roomName, const std::string& accessoryName,
+                   const std::string& characteristicType, Callback callback);
+        void remove(size_t id);
+
+        void start();
+
+        /**
+         * @brief Stop polling; reads in flight are ignored when they return
+         */
+        void stop();
+
+        std::optional<std::string> value(size_t id) const;                ///< Last value read
+        std::optional<std::chrono::milliseconds> interval(size_t id) const;  ///< Current interval
+        PollerStats stats() const;
+
+    private:
+        class Session;
+
+        std::shared_ptr<Session> session_;
+    };
+
+} // namespace prefab
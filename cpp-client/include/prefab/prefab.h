@@ -12,7 +12,17 @@
  */
 
 #include "models.h"
+#include "arena.h"
+#include "snapshot.h"
+#include "snapshot_file.h"
+#include "discovery.h"
+#include "metrics.h"
+#include "log.h"
+#include "tracing.h"
 #include "client.h"
+#include "batch.h"
+#include "change_feed.h"
+#include "poller.h"
 
 /**
  * @brief Prefab C++ client library for HomeKit data access
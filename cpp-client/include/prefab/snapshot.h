@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "models.h"
+
+namespace prefab {
+
+    /**
+     * @brief Options for crawling a whole-home snapshot
+     */
+    struct SnapshotOptions {
+        int maxParallelRequests = 8;  ///< Upper bound on requests in flight during the crawl
+        bool includeDetails = true;   ///< Fetch services/characteristics for every accessory
+
+        SnapshotOptions() = default;
+    };
+
+    /**
+     * @brief Timing and request counts for one level of the crawl
+     */
+    struct CrawlPhaseStats {
+        size_t requests = 0;
+        size_t failures = 0;
+        std::chrono::microseconds wallTime{0};     ///< First request start to last response in this phase
+        std::chrono::microseconds totalLatency{0}; ///< Sum of individual request latencies
+        std::chrono::microseconds maxLatency{0};   ///< Slowest single request
+
+        std::chrono::microseconds averageLatency() const {
+            return requests ? totalLatency / static_cast<long>(requests) : std::chrono::microseconds(0);
+        }
+    };
+
+    /**
+     * @brief Where the time went while crawling a snapshot
+     */
+    struct CrawlStats {
+        std::chrono::microseconds totalTime{0};
+        CrawlPhaseStats homes;
+        CrawlPhaseStats rooms;
+        CrawlPhaseStats accessories;  ///< Accessory lists per room
+        CrawlPhaseStats details;      ///< Detailed accessory fetches
+        size_t peakInFlight = 0;
+        std::vector<std::string> errors; ///< One entry per failed request; the crawl continues past failures
+    };
+
+    /**
+     * @brief In-memory tree of homes, rooms and accessories
+     *
+     * Accessories carry their services and characteristics when the snapshot
+     * was crawled with SnapshotOptions::includeDetails. If a detail request
+     * fails, the basic accessory entry from the room listing is kept.
+     */
+    struct HomeSnapshot {
+        struct RoomNode {
+            Room room;
+            std::vector<Accessory> accessories;
+        };
+
+        struct HomeNode {
+            Home home;
+            std::vector<RoomNode> rooms;
+        };
+
+        std::vector<HomeNode> homes;
+        CrawlStats stats;
+
+        size_t roomCount() const;
+        size_t accessoryCount() const;
+
+        /**
+         * @brief Look up an accessory by its path, or nullptr if absent
+         */
+        const Accessory* findAccessory(const std::string& homeName,
+                                       const std::string& roomName,
+                                       const std::string& accessoryName) const;
+    };
+
+} // namespace prefab
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "models.h"
+#include "snapshot.h"
+
+namespace prefab {
+
+    namespace snapshot_format {
+        struct Header;
+        struct HomeRecord;
+        struct RoomRecord;
+        struct AccessoryRecord;
+        struct ServiceRecord;
+        struct CharacteristicRecord;
+        struct StringRef;
+    }
+
+    /**
+     * @brief Write a snapshot to disk in the binary snapshot format
+     *
+     * The file holds fixed-size records and one deduplicated string table, so
+     * MappedSnapshot can use it in place. It is written to a temporary file
+     * and renamed over path, so readers never see a partial file. Crawl
+     * statistics are not stored.
+     *
+     * @throws PrefabException if the file cannot be written
+     */
+    void saveSnapshotFile(const HomeSnapshot& snapshot, const std::string& path);
+
+    /**
+     * @brief A snapshot file mapped into memory
+     *
+     * open() checks the header, the checksum and every index in the file
+     * once; after that the views below read straight from the mapping
+     * without copying or parsing. Strings are returned as std::string_view
+     * into the mapping, so views and strings stay valid as long as the
+     * MappedSnapshot does.
+     *
+     * Files written by a different format version are rejected rather than
+     * converted; the caller crawls again and saves a new one.
+     */
+    class MappedSnapshot {
+    public:
+        static constexpr uint32_t kFormatVersion = 1;
+
+        class CharacteristicView {
+        public:
+            Uuid uniqueIdentifier() const;
+            Uuid type() const;
+            std::string_view description() const;
+            std::string_view typeName() const;
+            std::string_view value() const;
+            std::optional<std::string_view> format() const;
+            std::optional<std::string_view> units() const;
+            size_t propertyCount() const;
+            std::string_view property(size_t index) const;
+
+            Characteristic toCharacteristic() const;  ///< Copy into the regular model, decoding the typed value
+
+        private:
+            friend class MappedSnapshot;
+            CharacteristicView(const MappedSnapshot* snapshot, const snapshot_format::CharacteristicRecord* record)
+                : snapshot_(snapshot), record_(record) {}
+
+            const MappedSnapshot* snapshot_;
+            const snapshot_format::CharacteristicRecord* record_;
+        };
+
+        class ServiceView {
+        public:
+            Uuid uniqueIdentifier() const;
+            Uuid type() const;
+            std::string_view name() const;
+            std::string_view typeName() const;
+            bool isPrimary() const;
+            bool isUserInteractive() const;
+            std::optional<std::string_view> associatedType() const;
+            size_t characteristicCount() const;
+            CharacteristicView characteristic(size_t index) const;
+
+        private:
+            friend class MappedSnapshot;
+            ServiceView(const MappedSnapshot* snapshot, const snapshot_format::ServiceRecord* record)
+                : snapshot_(snapshot), record_(record) {}
+
+            const MappedSnapshot* snapshot_;
+            const snapshot_format::ServiceRecord* record_;
+        };
+
+        class AccessoryView {
+        public:
+            std::string_view home() const;
+            std::string_view room() const;
+            std::string_view name() const;
+            std::optional<std::string_view> category() const;
+            std::optional<bool> isReachable() const;
+            std::optional<bool> supportsIdentify() const;
+            std::optional<bool> isBridged() const;
+            std::optional<std::string_view> firmwareVersion() const;
+            std::optional<std::string_view> manufacturer() const;
+            std::optional<std::string_view> model() const;
+            bool hasServices() const;  ///< False when the accessory was saved without details
+            size_t serviceCount() const;
+            ServiceView service(size_t index) const;
+
+            Accessory toAccessory() const;  ///< Copy into the regular model
+
+        private:
+            friend class MappedSnapshot;
+            AccessoryView(const MappedSnapshot* snapshot, const snapshot_format::AccessoryRecord* record)
+                : snapshot_(snapshot), record_(record) {}
+
+            const MappedSnapshot* snapshot_;
+            const snapshot_format::AccessoryRecord* record_;
+        };
+
+        class RoomView {
+        public:
+            std::string_view home() const;
+            std::string_view name() const;
+            size_t accessoryCount() const;
+            AccessoryView accessory(size_t index) const;
+
+        private:
+            friend class MappedSnapshot;
+            RoomView(const MappedSnapshot* snapshot, const snapshot_format::RoomRecord* record)
+                : snapshot_(snapshot), record_(record) {}
+
+            const MappedSnapshot* snapshot_;
+            const snapshot_format::RoomRecord* record_;
+        };
+
+        class HomeView {
+        public:
+            std::string_view name() const;
+            size_t roomCount() const;
+            RoomView room(size_t index) const;
+
+        private:
+            friend class MappedSnapshot;
+            HomeView(const MappedSnapshot* snapshot, const snapshot_format::HomeRecord* record)
+                : snapshot_(snapshot), record_(record) {}
+
+            const MappedSnapshot* snapshot_;
+            const snapshot_format::HomeRecord* record_;
+        };
+
+        /**
+         * @brief Map and validate a snapshot file
+         * @throws PrefabException if the file is missing, truncated, corrupt or of another format version
+         */
+        static std::shared_ptr<const MappedSnapshot> open(const std::string& path);
+
+        ~MappedSnapshot();
+        MappedSnapshot(const MappedSnapshot&) = delete;
+        MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+        std::chrono::system_clock::time_point savedAt() const;
+        size_t sizeBytes() const { return size_; }
+
+        size_t homeCount() const;
+        HomeView home(size_t index) const;
+        size_t roomCount() const;
+        size_t accessoryCount() const;
+
+        /**
+         * @brief Look up an accessory by its path without allocating
+         */
+        std::optional<AccessoryView> findAccessory(std::string_view homeName,
+                                                   std::string_view roomName,
+                                                   std::string_view accessoryName) const;
+
+        /**
+         * @brief Copy the whole file into an in-memory HomeSnapshot
+         */
+        HomeSnapshot toSnapshot() const;
+
+    private:
+        MappedSnapshot(const std::byte* data, size_t size);
+        void validate(const std::string& path);
+
+        std::string_view string(const snapshot_format::StringRef& ref) const;
+        std::optional<std::string_view> optionalString(const snapshot_format::StringRef& ref) const;
+
+        const std::byte* data_;
+        size_t size_;
+        const snapshot_format::Header* header_;
+        const snapshot_format::HomeRecord* homes_;
+        const snapshot_format::RoomRecord* rooms_;
+        const snapshot_format::AccessoryRecord* accessories_;
+        const snapshot_format::ServiceRecord* services_;
+        const snapshot_format::CharacteristicRecord* characteristics_;
+        const snapshot_format::StringRef* lists_;  // Characteristic properties and valid values
+        const char* strings_;
+    };
+
+} // namespace prefab
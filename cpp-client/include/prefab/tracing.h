@@ -0,0 +1,172 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace prefab {
+
+    class PrefabClient;
+    class ActiveSpan;
+
+    /**
+     * @brief Identity of a span, as carried by a W3C traceparent header
+     */
+    struct SpanContext {
+        std::string traceId;  ///< 32 lowercase hex digits
+        std::string spanId;   ///< 16 lowercase hex digits
+        bool sampled = true;
+
+        /**
+         * @brief "00-<traceId>-<spanId>-<flags>"
+         */
+        std::string traceparent() const;
+
+        /**
+         * @brief Parse a traceparent header value; std::nullopt if it is malformed
+         */
+        static std::optional<SpanContext> parse(const std::string& traceparent);
+    };
+
+    enum class SpanKind { Internal, Client };
+
+    /**
+     * @brief A finished span, ready for export
+     */
+    struct SpanRecord {
+        std::string traceId;
+        std::string spanId;
+        std::string parentSpanId;  ///< Empty for a root span
+        std::string name;
+        SpanKind kind = SpanKind::Internal;
+        std::chrono::system_clock::time_point start;
+        std::chrono::system_clock::time_point end;
+        bool error = false;
+        std::string statusMessage;
+        std::vector<std::pair<std::string, std::string>> attributes;
+    };
+
+    /**
+     * @brief Destination for finished spans
+     *
+     * The client batches spans and calls exportSpans() from a background
+     * thread of its own, so exporters may block (write files, send requests).
+     */
+    class SpanExporter {
+    public:
+        virtual ~SpanExporter() = default;
+        virtual void exportSpans(const std::vector<SpanRecord>& spans) = 0;
+        virtual void flush() {}
+    };
+
+    /**
+     * @brief Encode spans as an OTLP/JSON ExportTraceServiceRequest
+     */
+    std::string toOtlpJson(const std::vector<SpanRecord>& spans, const std::string& serviceName = "prefab-client");
+
+    /**
+     * @brief Appends each batch to a file as one line of OTLP/JSON
+     *
+     * The file can be replayed into a collector later, or read with jq.
+     */
+    class FileSpanExporter : public SpanExporter {
+    public:
+        explicit FileSpanExporter(std::string path, std::string serviceName = "prefab-client");
+        ~FileSpanExporter() override;
+
+        void exportSpans(const std::vector<SpanRecord>& spans) override;
+        void flush() override;
+
+    private:
+        const std::string serviceName_;
+        std::mutex mutex_;
+        std::FILE* file_ = nullptr;
+    };
+
+    /**
+     * @brief Sends each batch to an OpenTelemetry collector over OTLP/HTTP with JSON encoding
+     *
+     * @param url Traces endpoint, e.g. "http://localhost:4318/v1/traces"
+     */
+    class OtlpHttpSpanExporter : public SpanExporter {
+    public:
+        explicit OtlpHttpSpanExporter(std::string url, std::string serviceName = "prefab-client");
+
+        void exportSpans(const std::vector<SpanRecord>& spans) override;
+
+    private:
+        const std::string url_;
+        const std::string serviceName_;
+    };
+
+    /**
+     * @brief Settings for request tracing
+     *
+     * Disabled by default. When enabled, every request becomes a client span
+     * with one child span per attempt (failovers and hedges included) that
+     * carries the curl phase timings and the server's own time from its
+     * Server-Timing header. Each attempt sends a W3C traceparent header so
+     * server-side spans can join the trace.
+     */
+    struct TracingConfig {
+        bool enabled = false;
+        std::shared_ptr<SpanExporter> exporter;  ///< Where finished spans go (none: only propagate)
+        double sampleRatio = 1.0;                ///< Share of new traces that are exported
+        bool propagate = true;                   ///< Send traceparent headers
+        int exportIntervalMs = 1000;             ///< Longest time a finished span waits for export
+        size_t maxQueuedSpans = 8192;            ///< Spans beyond this are dropped until the next export
+    };
+
+    /**
+     * @brief Span around a composite operation of the caller
+     *
+     * Requests started on this thread while the span is alive, and spans
+     * opened inside it, become its children. Does nothing when the client's
+     * tracing is disabled.
+     *
+     * @code
+     * {
+     *     prefab::TraceSpan span(client, "evening scene");
+     *     client.updateCharacteristicByType(home, room, "Lamp", "On", "1");
+     *     client.updateCharacteristicByType(home, room, "Blinds", "Target Position", "0");
+     * }
+     * @endcode
+     */
+    class TraceSpan {
+    public:
+        TraceSpan(const PrefabClient& client, std::string name);
+
+        /**
+         * @brief Continue a trace started elsewhere, e.g. by an incoming request
+         */
+        TraceSpan(const PrefabClient& client, std::string name, const std::string& traceparent);
+        ~TraceSpan();
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+        void setAttribute(const std::string& key, const std::string& value);
+        void setError(const std::string& message);
+
+        /**
+         * @brief This span's identity; std::nullopt when tracing is disabled
+         */
+        std::optional<SpanContext> context() const;
+
+        /**
+         * @brief The innermost span open on this thread, if any
+         */
+        static std::optional<SpanContext> current();
+
+    private:
+        std::shared_ptr<ActiveSpan> span_;
+        std::optional<SpanContext> previous_;
+        std::string error_;
+    };
+
+} // namespace prefab
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+
+namespace prefab {
+
+    /**
+     * @brief A UUID held as 16 bytes instead of its 36-character text
+     *
+     * Used for service and characteristic identifiers and HomeKit type UUIDs.
+     * Comparison and hashing work on two 64-bit words. Text is accepted in
+     * either case and formatted in upper case, the way Foundation prints
+     * UUIDs, so IDs round-trip unchanged through the server.
+     */
+    class Uuid {
+    public:
+        Uuid() = default;  ///< The nil UUID
+        Uuid(uint64_t high, uint64_t low) : high_(high), low_(low) {}
+
+        /**
+         * @brief Parse the canonical 8-4-4-4-12 hex form
+         * @return std::nullopt if the text is not a UUID
+         */
+        static std::optional<Uuid> parse(std::string_view text);
+
+        std::string toString() const;
+        std::array<uint8_t, 16> bytes() const;
+        bool isNil() const { return high_ == 0 && low_ == 0; }
+
+        uint64_t high() const { return high_; }
+        uint64_t low() const { return low_; }
+
+        bool operator==(const Uuid& other) const { return high_ == other.high_ && low_ == other.low_; }
+        bool operator!=(const Uuid& other) const { return !(*this == other); }
+        bool operator<(const Uuid& other) const {
+            return high_ != other.high_ ? high_ < other.high_ : low_ < other.low_;
+        }
+
+    private:
+        uint64_t high_ = 0;
+        uint64_t low_ = 0;
+    };
+
+    // Comparison with text parses the text; anything that is not a UUID compares unequal
+    bool operator==(const Uuid& uuid, std::string_view text);
+    inline bool operator==(std::string_view text, const Uuid& uuid) { return uuid == text; }
+    inline bool operator!=(const Uuid& uuid, std::string_view text) { return !(uuid == text); }
+    inline bool operator!=(std::string_view text, const Uuid& uuid) { return !(uuid == text); }
+
+    std::ostream& operator<<(std::ostream& out, const Uuid& uuid);
+
+    void to_json(nlohmann::json& j, const Uuid& uuid);
+    void from_json(const nlohmann::json& j, Uuid& uuid);  // Throws nlohmann::json::exception for non-UUID text
+
+} // namespace prefab
+
+namespace std {
+    template <>
+    struct hash<prefab::Uuid> {
+        size_t operator()(const prefab::Uuid& uuid) const noexcept {
+            return static_cast<size_t>(uuid.high() ^ (uuid.low() * 0x9E3779B97F4A7C15ULL));
+        }
+    };
+}
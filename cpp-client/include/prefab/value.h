@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace prefab {
+
+    struct CharacteristicMetadata;
+    namespace pmr {
+        struct CharacteristicMetadata;
+    }
+
+    /**
+     * @brief Value format of a characteristic, decoded from CharacteristicMetadata::format
+     *
+     * The server reports the HMCharacteristicMetadataFormat strings: "bool",
+     * "uint8", "uint16", "uint32", "uint64", "int", "float", "string",
+     * "tlv8" and "data". Anything else decodes to Unknown.
+     */
+    enum class ValueFormat : uint8_t {
+        Unknown,
+        Bool,
+        UInt8,
+        UInt16,
+        UInt32,
+        UInt64,
+        Int,
+        Float,
+        String,
+        TLV8,
+        Data
+    };
+
+    ValueFormat parseValueFormat(std::string_view format);
+    const char* valueFormatName(ValueFormat format);
+
+    /**
+     * @brief A characteristic value decoded once according to its format
+     *
+     * The Prefab API transfers every value as a string. CharacteristicValue
+     * holds the decoded form so consumers do not re-parse numbers and booleans
+     * on every read. All integer formats are held as Int, tlv8 and data as
+     * Data (in the server's textual encoding).
+     *
+     * The as*() getters convert between the numeric types and return
+     * false / 0 / an empty string where no conversion makes sense.
+     */
+    class CharacteristicValue {
+    public:
+        enum class Type : uint8_t { Empty, Bool, Int, Float, String, Data };
+
+        CharacteristicValue() = default;
+
+        static CharacteristicValue fromBool(bool value);
+        static CharacteristicValue fromInt(int64_t value);
+        static CharacteristicValue fromFloat(double value);
+        static CharacteristicValue fromString(std::string value);
+        static CharacteristicValue fromData(std::string value);
+
+        /**
+         * @brief Decode the server's text for a value of the given format
+         * @return std::nullopt if the text is not a valid value of that format
+         *
+         * For numeric and bool formats empty text decodes to an Empty value
+         * (the server sends "" when a characteristic has no value yet).
+         * Unknown formats decode as String.
+         */
+        static std::optional<CharacteristicValue> parse(std::string_view text, ValueFormat format);
+
+        Type type() const { return type_; }
+        bool isEmpty() const { return type_ == Type::Empty; }
+        bool isBool() const { return type_ == Type::Bool; }
+        bool isInt() const { return type_ == Type::Int; }
+        bool isFloat() const { return type_ == Type::Float; }
+        bool isNumber() const { return type_ == Type::Bool || type_ == Type::Int || type_ == Type::Float; }
+        bool isString() const { return type_ == Type::String; }
+        bool isData() const { return type_ == Type::Data; }
+
+        bool asBool() const;
+        int64_t asInt() const;
+        double asFloat() const;
+        const std::string& asString() const { return text_; }  ///< String and Data only
+
+        void setBool(bool value) { *this = fromBool(value); }
+        void setInt(int64_t value) { *this = fromInt(value); }
+        void setFloat(double value) { *this = fromFloat(value); }
+        void setString(std::string value) { *this = fromString(std::move(value)); }
+        void setData(std::string value) { *this = fromData(std::move(value)); }
+
+        /**
+         * @brief Text the server expects for this value in UpdateAccessoryInput::value
+         */
+        std::string toString() const;
+
+        bool operator==(const CharacteristicValue& other) const;
+        bool operator!=(const CharacteristicValue& other) const { return !(*this == other); }
+
+    private:
+        Type type_ = Type::Empty;
+        union {
+            bool boolean_;
+            int64_t integer_;
+            double real_ = 0;
+        };
+        std::string text_;
+    };
+
+    /**
+     * @brief Format, range and step of a characteristic, decoded from its metadata
+     *
+     * Used to reject writes locally before they are sent to the server.
+     */
+    struct ValueConstraints {
+        ValueFormat format = ValueFormat::Unknown;
+        std::optional<double> minimum;
+        std::optional<double> maximum;
+        std::optional<double> step;
+        std::optional<size_t> maxLength;
+        std::vector<double> validValues;
+
+        static ValueConstraints fromMetadata(const CharacteristicMetadata& metadata);
+        static ValueConstraints fromMetadata(const pmr::CharacteristicMetadata& metadata);
+
+        /**
+         * @brief Decode a value reported by the server
+         *
+         * Never fails: text that does not match the format is kept as a String.
+         */
+        CharacteristicValue decode(std::string_view text) const;
+
+        /**
+         * @brief Check a value against the format, range, step and valid values
+         * @param error Set to a description of the problem when the value is rejected
+         */
+        bool check(const CharacteristicValue& value, std::string& error) const;
+
+        /**
+         * @brief Parse text in the characteristic's format, then check() it
+         */
+        bool check(std::string_view text, std::string& error) const;
+    };
+
+} // namespace prefab
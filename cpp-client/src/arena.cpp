@@ -0,0 +1,236 @@
+#include "prefab/arena.h"
+
+namespace prefab {
+
+    namespace {
+
+        // Copy or move an optional member into the given allocator
+        template <typename T, typename Optional>
+        std::optional<T> rebind(Optional&& value, const pmr::allocator_type& alloc) {
+            if (!value) return std::nullopt;
+            return std::optional<T>(std::in_place, *std::forward<Optional>(value), alloc);
+        }
+
+        std::string toStd(const std::pmr::string& value) {
+            return std::string(value.data(), value.size());
+        }
+
+        std::optional<std::string> toStd(const std::optional<std::pmr::string>& value) {
+            if (!value) return std::nullopt;
+            return toStd(*value);
+        }
+
+    } // namespace
+
+    namespace pmr {
+
+        CharacteristicMetadata::CharacteristicMetadata(const CharacteristicMetadata& other, const allocator_type& alloc)
+            : manufacturerDescription(rebind<std::pmr::string>(other.manufacturerDescription, alloc)),
+              validValues(rebind<std::pmr::vector<std::pmr::string>>(other.validValues, alloc)),
+              minimumValue(rebind<std::pmr::string>(other.minimumValue, alloc)),
+              maximumValue(rebind<std::pmr::string>(other.maximumValue, alloc)),
+              stepValue(rebind<std::pmr::string>(other.stepValue, alloc)),
+              maxLength(rebind<std::pmr::string>(other.maxLength, alloc)),
+              format(rebind<std::pmr::string>(other.format, alloc)),
+              units(rebind<std::pmr::string>(other.units, alloc)),
+              constraints(other.constraints),
+              alloc_(alloc) {}
+
+        CharacteristicMetadata::CharacteristicMetadata(CharacteristicMetadata&& other, const allocator_type& alloc)
+            : manufacturerDescription(rebind<std::pmr::string>(std::move(other.manufacturerDescription), alloc)),
+              validValues(rebind<std::pmr::vector<std::pmr::string>>(std::move(other.validValues), alloc)),
+              minimumValue(rebind<std::pmr::string>(std::move(other.minimumValue), alloc)),
+              maximumValue(rebind<std::pmr::string>(std::move(other.maximumValue), alloc)),
+              stepValue(rebind<std::pmr::string>(std::move(other.stepValue), alloc)),
+              maxLength(rebind<std::pmr::string>(std::move(other.maxLength), alloc)),
+              format(rebind<std::pmr::string>(std::move(other.format), alloc)),
+              units(rebind<std::pmr::string>(std::move(other.units), alloc)),
+              constraints(std::move(other.constraints)),
+              alloc_(alloc) {}
+
+        CharacteristicMetadata& CharacteristicMetadata::operator=(const CharacteristicMetadata& other) {
+            if (this == &other) return *this;
+            return *this = CharacteristicMetadata(other, alloc_);
+        }
+
+        CharacteristicMetadata& CharacteristicMetadata::operator=(CharacteristicMetadata&& other) {
+            manufacturerDescription = std::move(other.manufacturerDescription);
+            validValues = std::move(other.validValues);
+            minimumValue = std::move(other.minimumValue);
+            maximumValue = std::move(other.maximumValue);
+            stepValue = std::move(other.stepValue);
+            maxLength = std::move(other.maxLength);
+            format = std::move(other.format);
+            units = std::move(other.units);
+            constraints = std::move(other.constraints);
+            return *this;
+        }
+
+        Characteristic::Characteristic(const Characteristic& other, const allocator_type& alloc)
+            : uniqueIdentifier(other.uniqueIdentifier),
+              description(other.description, alloc),
+              properties(other.properties, alloc),
+              typeName(other.typeName),
+              type(other.type),
+              metadata(other.metadata, alloc),
+              value(other.value, alloc),
+              typedValue(other.typedValue) {}
+
+        Characteristic::Characteristic(Characteristic&& other, const allocator_type& alloc)
+            : uniqueIdentifier(other.uniqueIdentifier),
+              description(std::move(other.description), alloc),
+              properties(std::move(other.properties), alloc),
+              typeName(other.typeName),
+              type(other.type),
+              metadata(std::move(other.metadata), alloc),
+              value(std::move(other.value), alloc),
+              typedValue(std::move(other.typedValue)) {}
+
+        Service::Service(const Service& other, const allocator_type& alloc)
+            : uniqueIdentifier(other.uniqueIdentifier),
+              name(other.name, alloc),
+              typeName(other.typeName),
+              type(other.type),
+              isPrimary(other.isPrimary),
+              isUserInteractive(other.isUserInteractive),
+              associatedType(rebind<std::pmr::string>(other.associatedType, alloc)),
+              characteristics(other.characteristics, alloc) {}
+
+        Service::Service(Service&& other, const allocator_type& alloc)
+            : uniqueIdentifier(other.uniqueIdentifier),
+              name(std::move(other.name), alloc),
+              typeName(other.typeName),
+              type(other.type),
+              isPrimary(other.isPrimary),
+              isUserInteractive(other.isUserInteractive),
+              associatedType(rebind<std::pmr::string>(std::move(other.associatedType), alloc)),
+              characteristics(std::move(other.characteristics), alloc) {}
+
+        Accessory::Accessory(const Accessory& other, const allocator_type& alloc)
+            : home(other.home, alloc),
+              room(other.room, alloc),
+              name(other.name, alloc),
+              category(rebind<std::pmr::string>(other.category, alloc)),
+              isReachable(other.isReachable),
+              supportsIdentify(other.supportsIdentify),
+              isBridged(other.isBridged),
+              services(rebind<std::pmr::vector<Service>>(other.services, alloc)),
+              firmwareVersion(rebind<std::pmr::string>(other.firmwareVersion, alloc)),
+              manufacturer(rebind<std::pmr::string>(other.manufacturer, alloc)),
+              model(rebind<std::pmr::string>(other.model, alloc)) {}
+
+        Accessory::Accessory(Accessory&& other, const allocator_type& alloc)
+            : home(std::move(other.home), alloc),
+              room(std::move(other.room), alloc),
+              name(std::move(other.name), alloc),
+              category(rebind<std::pmr::string>(std::move(other.category), alloc)),
+              isReachable(other.isReachable),
+              supportsIdentify(other.supportsIdentify),
+              isBridged(other.isBridged),
+              services(rebind<std::pmr::vector<Service>>(std::move(other.services), alloc)),
+              firmwareVersion(rebind<std::pmr::string>(std::move(other.firmwareVersion), alloc)),
+              manufacturer(rebind<std::pmr::string>(std::move(other.manufacturer), alloc)),
+              model(rebind<std::pmr::string>(std::move(other.model), alloc)) {}
+
+    } // namespace pmr
+
+    Accessory toAccessory(const pmr::Accessory& source) {
+        Accessory accessory;
+        accessory.home = toStd(source.home);
+        accessory.room = toStd(source.room);
+        accessory.name = toStd(source.name);
+        accessory.category = toStd(source.category);
+        accessory.isReachable = source.isReachable;
+        accessory.supportsIdentify = source.supportsIdentify;
+        accessory.isBridged = source.isBridged;
+        accessory.firmwareVersion = toStd(source.firmwareVersion);
+        accessory.manufacturer = toStd(source.manufacturer);
+        accessory.model = toStd(source.model);
+        if (!source.services) return accessory;
+
+        auto& services = accessory.services.emplace();
+        services.reserve(source.services->size());
+        for (const auto& sourceService : *source.services) {
+            Service& service = services.emplace_back();
+            service.uniqueIdentifier = sourceService.uniqueIdentifier;
+            service.name = toStd(sourceService.name);
+            service.typeName = sourceService.typeName;
+            service.type = sourceService.type;
+            service.isPrimary = sourceService.isPrimary;
+            service.isUserInteractive = sourceService.isUserInteractive;
+            service.associatedType = toStd(sourceService.associatedType);
+            service.characteristics.reserve(sourceService.characteristics.size());
+
+            for (const auto& sourceCharacteristic : sourceService.characteristics) {
+                Characteristic& characteristic = service.characteristics.emplace_back();
+                characteristic.uniqueIdentifier = sourceCharacteristic.uniqueIdentifier;
+                characteristic.description = toStd(sourceCharacteristic.description);
+                for (const auto& property : sourceCharacteristic.properties) {
+                    characteristic.properties.push_back(toStd(property));
+                }
+                characteristic.typeName = sourceCharacteristic.typeName;
+                characteristic.type = sourceCharacteristic.type;
+                characteristic.value = toStd(sourceCharacteristic.value);
+                characteristic.typedValue = sourceCharacteristic.typedValue;
+
+                const pmr::CharacteristicMetadata& sourceMetadata = sourceCharacteristic.metadata;
+                CharacteristicMetadata& metadata = characteristic.metadata;
+                metadata.manufacturerDescription = toStd(sourceMetadata.manufacturerDescription);
+                if (sourceMetadata.validValues) {
+                    auto& validValues = metadata.validValues.emplace();
+                    for (const auto& value : *sourceMetadata.validValues) validValues.push_back(toStd(value));
+                }
+                metadata.minimumValue = toStd(sourceMetadata.minimumValue);
+                metadata.maximumValue = toStd(sourceMetadata.maximumValue);
+                metadata.stepValue = toStd(sourceMetadata.stepValue);
+                metadata.maxLength = toStd(sourceMetadata.maxLength);
+                metadata.format = toStd(sourceMetadata.format);
+                metadata.units = toStd(sourceMetadata.units);
+                metadata.constraints = sourceMetadata.constraints;
+            }
+        }
+        return accessory;
+    }
+
+    void* AccessoryArena::CountingResource::do_allocate(size_t size, size_t alignment) {
+        void* p = next_->allocate(size, alignment);
+        bytes += size;
+        return p;
+    }
+
+    void AccessoryArena::CountingResource::do_deallocate(void* p, size_t size, size_t alignment) {
+        next_->deallocate(p, size, alignment);
+    }
+
+    bool AccessoryArena::CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+        return this == &other;
+    }
+
+    AccessoryArena::AccessoryArena(size_t initialBytes) : accessories_(pmr::allocator_type(&counter_)) {
+        reset(initialBytes);
+    }
+
+    void AccessoryArena::clear() {
+        // Swapping with an empty vector also returns the element storage, which lives in the arena
+        std::pmr::vector<pmr::Accessory>(allocator()).swap(accessories_);
+        // Grow the retained buffer by whatever spilled to the heap this round
+        reset(bufferSize_ + upstream_.bytes);
+    }
+
+    void AccessoryArena::reset(size_t bufferSize) {
+        arena_.reset();
+        if (bufferSize != bufferSize_ || !buffer_) {
+            buffer_.reset(bufferSize ? new std::byte[bufferSize] : nullptr);
+            bufferSize_ = bufferSize;
+        }
+        if (buffer_) {
+            arena_.emplace(buffer_.get(), bufferSize_, &upstream_);
+        } else {
+            arena_.emplace(&upstream_);
+        }
+        counter_.setNext(&*arena_);
+        counter_.bytes = 0;
+        upstream_.bytes = 0;
+    }
+
+} // namespace prefab
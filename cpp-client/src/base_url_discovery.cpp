@@ -0,0 +1,84 @@
+#include "base_url_discovery.h"
+#include <cstdio>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace prefab {
+
+    BaseUrlDiscovery::BaseUrlDiscovery(std::shared_ptr<ServiceBrowser> browser, std::chrono::milliseconds timeout,
+                                       std::string cachePath)
+        : browser_(std::move(browser)), timeout_(timeout), cachePath_(std::move(cachePath)) {}
+
+    BaseUrlDiscovery::~BaseUrlDiscovery() {
+        if (listener_) browser_->unsubscribe(listener_);
+    }
+
+    void BaseUrlDiscovery::start() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            deadline_ = browser_->running() ? std::chrono::steady_clock::now() + timeout_
+                                            : std::chrono::steady_clock::now();  // Nothing will turn up
+            url_ = loadCache();
+            fromCache_ = url_.has_value();
+            if (url_) published_.store(std::make_shared<const std::string>(*url_));
+        }
+        // Weak, so the listener does not keep the client's discovery alive
+        std::weak_ptr<BaseUrlDiscovery> weak = shared_from_this();
+        listener_ = browser_->subscribe([weak](DiscoveryEvent, const DiscoveredServer&) {
+            if (auto self = weak.lock()) self->update();
+        });
+        update();  // The shared browser may know servers already
+    }
+
+    std::optional<std::string> BaseUrlDiscovery::baseUrl() const {
+        if (std::shared_ptr<const std::string> url = published_.load()) return *url;
+        std::unique_lock<std::mutex> lock(mutex_);
+        found_.wait_until(lock, deadline_, [this] { return url_.has_value(); });
+        return url_;
+    }
+
+    // Switch to the browser's preferred server if it differs from the current one
+    void BaseUrlDiscovery::update() {
+        std::optional<DiscoveredServer> preferred = browser_->preferred();
+        if (!preferred) return;  // Keep the last server; it may come back
+        const std::string url = preferred->url();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (url_ == url && !fromCache_) return;
+            url_ = url;
+            fromCache_ = false;
+            published_.store(std::make_shared<const std::string>(url));
+        }
+        found_.notify_all();
+        saveCache(*preferred);
+    }
+
+    std::optional<std::string> BaseUrlDiscovery::loadCache() const {
+        if (cachePath_.empty()) return std::nullopt;
+        std::ifstream file(cachePath_);
+        if (!file) return std::nullopt;
+        try {
+            const json cached = json::parse(file);
+            std::string url = cached.at("url").get<std::string>();
+            if (url.empty()) return std::nullopt;
+            return url;
+        } catch (const json::exception&) {
+            return std::nullopt;  // Damaged cache; discover from scratch
+        }
+    }
+
+    // Best effort: a failed write only costs the next run its head start
+    void BaseUrlDiscovery::saveCache(const DiscoveredServer& server) const {
+        if (cachePath_.empty()) return;
+        const json cached = {{"url", server.url()}, {"name", server.name}, {"hostName", server.hostName}};
+        const std::string temporary = cachePath_ + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::trunc);
+            if (!(file << cached.dump() << '\n')) return;
+        }
+        if (std::rename(temporary.c_str(), cachePath_.c_str()) != 0) std::remove(temporary.c_str());
+    }
+
+} // namespace prefab
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include "prefab/discovery.h"
+#include "published_ptr.h"
+
+namespace prefab {
+
+    /**
+     * @brief Follows the preferred server of a ServiceBrowser for one client
+     *
+     * start() returns at once. A URL saved by an earlier run (if a cache path
+     * is set) is used right away, until the browser finds a server of its
+     * own. Each server the client switches to is saved again.
+     *
+     * baseUrl() waits for the first result only until the deadline set at
+     * start(); after that it answers at once, with nothing if no server has
+     * been found yet. Once a server is known, it answers without locking.
+     *
+     * Create it with std::make_shared: the browser's listener keeps a reference.
+     */
+    class BaseUrlDiscovery : public std::enable_shared_from_this<BaseUrlDiscovery> {
+    public:
+        BaseUrlDiscovery(std::shared_ptr<ServiceBrowser> browser, std::chrono::milliseconds timeout,
+                         std::string cachePath);
+        ~BaseUrlDiscovery();
+
+        BaseUrlDiscovery(const BaseUrlDiscovery&) = delete;
+        BaseUrlDiscovery& operator=(const BaseUrlDiscovery&) = delete;
+
+        void start();
+
+        std::optional<std::string> baseUrl() const;
+
+    private:
+        void update();
+        std::optional<std::string> loadCache() const;
+        void saveCache(const DiscoveredServer& server) const;
+
+        const std::shared_ptr<ServiceBrowser> browser_;
+        const std::chrono::milliseconds timeout_;
+        const std::string cachePath_;
+        size_t listener_ = 0;
+
+        mutable std::mutex mutex_;
+        mutable std::condition_variable found_;
+        std::chrono::steady_clock::time_point deadline_;
+        std::optional<std::string> url_;
+        bool fromCache_ = false;  // url_ came from the cache file, not from the browser
+        PublishedPtr<const std::string> published_;  // Copy of url_ for readers that should not lock
+    };
+
+} // namespace prefab
@@ -0,0 +1,170 @@
+#include "prefab/batch.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace prefab {
+
+    using Clock = std::chrono::steady_clock;
+
+    size_t BatchResult::succeeded() const {
+        return static_cast<size_t>(std::count_if(items.begin(), items.end(),
+                                                 [](const BatchItemResult& item) { return item.success; }));
+    }
+
+    BatchUpdate::BatchUpdate(PrefabClient& client) : client_(client) {}
+
+    BatchUpdate& BatchUpdate::add(const std::string& homeName, const std::string& roomName,
+                                  const std::string& accessoryName, const UpdateAccessoryInput& update) {
+        items_.push_back(Item{homeName, roomName, accessoryName, update, std::string()});
+        return *this;
+    }
+
+    BatchUpdate& BatchUpdate::addByType(const std::string& homeName, const std::string& roomName,
+                                        const std::string& accessoryName, const std::string& characteristicType,
+                                        const std::string& value) {
+        UpdateAccessoryInput update;
+        update.value = value;
+        items_.push_back(Item{homeName, roomName, accessoryName, update, characteristicType});
+        return *this;
+    }
+
+    BatchUpdate& BatchUpdate::maxParallelRequests(int maxParallel) {
+        maxParallel_ = static_cast<size_t>(std::max(maxParallel, 1));
+        return *this;
+    }
+
+    /**
+     * @brief One send of a batch; owns a copy of the items so the builder can be reused
+     *
+     * A fixed number of workers each send one write at a time and pick up the
+     * next unsent item when their write finishes. Results go to fixed slots.
+     *
+     * Writes rejected locally (invalid values, a full request queue, shutdown)
+     * complete before the call that sent them returns; the worker then takes
+     * the next item in a loop rather than from the completion, so a long run of
+     * such items does not grow the stack.
+     */
+    class BatchUpdate::Run : public std::enable_shared_from_this<BatchUpdate::Run> {
+    public:
+        Run(PrefabClient& client, std::vector<Item> items, size_t maxParallel, AsyncCallback<BatchResult> done)
+            : client_(client), items_(std::move(items)), maxParallel_(maxParallel), done_(std::move(done)) {
+            result_.items.resize(items_.size());
+            for (size_t i = 0; i < items_.size(); ++i) {
+                BatchItemResult& item = result_.items[i];
+                item.homeName = items_[i].homeName;
+                item.roomName = items_[i].roomName;
+                item.accessoryName = items_[i].accessoryName;
+                item.characteristic = items_[i].characteristicType.empty() ? items_[i].update.characteristicId
+                                                                          : items_[i].characteristicType;
+            }
+        }
+
+        void start() {
+            started_ = Clock::now();
+            remaining_ = items_.size();
+            size_t workers = std::min(maxParallel_, items_.size());
+            for (size_t w = 0; w < workers; ++w) {
+                work();
+            }
+        }
+
+    private:
+        PrefabClient& client_;
+        std::vector<Item> items_;
+        size_t maxParallel_;
+        AsyncCallback<BatchResult> done_;
+
+        std::atomic<size_t> next_{0};
+        std::mutex mutex_;
+        size_t remaining_ = 0;
+        size_t inFlight_ = 0;
+        BatchResult result_;
+        Clock::time_point started_;
+
+        // One worker: sends items until one of them is still in flight when its call returns
+        void work() {
+            enum { kSending, kCompletedInline, kReturned };
+            while (true) {
+                size_t index = next_.fetch_add(1);
+                if (index >= items_.size()) return;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    result_.peakInFlight = std::max(result_.peakInFlight, ++inFlight_);
+                }
+
+                auto self = shared_from_this();
+                auto state = std::make_shared<std::atomic<int>>(kSending);
+                const auto& item = items_[index];
+                Clock::time_point begin = Clock::now();
+                AsyncCallback<std::string> finished = [self, index, begin, state](AsyncResult<std::string> response) {
+                    self->finished(index, begin, std::move(response));
+                    // Whoever comes second moves the worker on
+                    if (state->exchange(kCompletedInline) == kReturned) self->work();
+                };
+
+                if (item.characteristicType.empty()) {
+                    client_.updateAccessoryAsync(item.homeName, item.roomName, item.accessoryName, item.update,
+                                                 std::move(finished));
+                } else {
+                    client_.updateCharacteristicByTypeAsync(item.homeName, item.roomName, item.accessoryName,
+                                                            item.characteristicType, item.update.value,
+                                                            std::move(finished));
+                }
+                if (state->exchange(kReturned) != kCompletedInline) return;
+            }
+        }
+
+        void finished(size_t index, Clock::time_point begin, AsyncResult<std::string> response) {
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - begin);
+            bool allDone = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                BatchItemResult& item = result_.items[index];
+                item.latency = latency;
+                try {
+                    item.response = std::move(response.value());
+                    item.success = true;
+                } catch (const PrefabException& e) {
+                    item.error = e.what();
+                    item.httpCode = e.getHttpCode();
+                } catch (const std::exception& e) {
+                    item.error = e.what();
+                } catch (...) {
+                    item.error = "Unknown error";
+                }
+                inFlight_--;
+                allDone = --remaining_ == 0;
+            }
+
+            if (allDone) {
+                result_.totalTime = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started_);
+                done_(AsyncResult<BatchResult>::success(std::move(result_)));
+            }
+        }
+    };
+
+    void BatchUpdate::sendAsync(AsyncCallback<BatchResult> callback) {
+        if (items_.empty()) {
+            callback(AsyncResult<BatchResult>::success(BatchResult()));
+            return;
+        }
+        auto run = std::make_shared<Run>(client_, items_, maxParallel_, std::move(callback));
+        run->start();
+    }
+
+    std::future<BatchResult> BatchUpdate::sendAsync() {
+        auto promise = std::make_shared<std::promise<BatchResult>>();
+        std::future<BatchResult> future = promise->get_future();
+        sendAsync([promise](AsyncResult<BatchResult> result) {
+            promise->set_value(std::move(result.value()));
+        });
+        return future;
+    }
+
+    BatchResult BatchUpdate::send() {
+        return sendAsync().get();
+    }
+
+} // namespace prefab
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <optional>
+#include "prefab/client.h"
+#include "tracer.h"
+
+namespace prefab {
+
+    // What a continuation on the network thread carries over from the thread that started the operation
+    struct CallerContext {
+        std::optional<RequestDeadline::Clock::time_point> deadline = RequestDeadline::current();
+        std::optional<SpanContext> span = currentSpanContext();
+        std::optional<RequestPriority> priority = RequestPriorityScope::current();
+    };
+
+    // Re-installs a caller's deadline, trace context and priority for the rest of a scope
+    class CallerScope {
+    public:
+        explicit CallerScope(const CallerContext& caller) : span_(caller.span) {
+            if (caller.deadline) deadline_.emplace(*caller.deadline);
+            if (caller.priority) priority_.emplace(*caller.priority);
+        }
+
+    private:
+        SpanContextScope span_;
+        std::optional<RequestDeadline> deadline_;
+        std::optional<RequestPriorityScope> priority_;
+    };
+
+} // namespace prefab
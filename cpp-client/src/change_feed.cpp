@@ -0,0 +1,477 @@
+#include "prefab/change_feed.h"
+#include "endpoint_set.h"
+#include "reactor.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace prefab {
+
+    namespace {
+
+        std::string accessoryKey(const std::string& homeName, const std::string& roomName,
+                                 const std::string& accessoryName) {
+            return homeName + '\n' + roomName + '\n' + accessoryName;
+        }
+
+        template <typename AccessoryModel>
+        auto findCharacteristic(AccessoryModel& accessory, const Uuid& characteristicId)
+            -> decltype(&accessory.services->front().characteristics.front()) {
+            if (!accessory.services) return nullptr;
+            for (auto& service : *accessory.services) {
+                for (auto& characteristic : service.characteristics) {
+                    if (characteristic.uniqueIdentifier == characteristicId) return &characteristic;
+                }
+            }
+            return nullptr;
+        }
+
+        void setValue(Characteristic& characteristic, const std::string& value) {
+            characteristic.value = value;
+            characteristic.typedValue = characteristic.metadata.constraints.decode(value);
+        }
+
+        // Values that differ between two reads of the same accessory, reported as changes
+        void diff(const Accessory& before, const Accessory& after, uint64_t sequence,
+                  std::vector<CharacteristicChange>& changes) {
+            if (!after.services) return;
+            for (const auto& service : *after.services) {
+                for (const auto& characteristic : service.characteristics) {
+                    const Characteristic* old = findCharacteristic(before, characteristic.uniqueIdentifier);
+                    if (!old || old->value == characteristic.value) continue;
+                    changes.push_back(CharacteristicChange{sequence, after.home, after.room, after.name,
+                                                           service.uniqueIdentifier, characteristic.uniqueIdentifier,
+                                                           characteristic.value});
+                }
+            }
+        }
+
+    } // namespace
+
+    /**
+     * @brief The feed's state, shared with the requests and timers in flight
+     *
+     * Everything after start() runs on the client's reactor thread. Each
+     * start() begins a new generation; completions from an older generation
+     * (or after stop()) find it out of date and do nothing.
+     */
+    class ChangeFeed::Session : public std::enable_shared_from_this<Session> {
+    public:
+        Session(PrefabClient& client, const ChangeFeedOptions& options)
+            : client_(client), options_(options), retryDelayMs_(std::max(options.retryDelayMs, 1)) {}
+
+        void watch(const std::string& homeName, const std::string& roomName, const std::string& accessoryName) {
+            uint64_t generation;
+            const std::string key = accessoryKey(homeName, roomName, accessoryName);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (entries_.count(key)) return;
+                Entry& entry = entries_[key];
+                entry.home = homeName;
+                entry.room = roomName;
+                entry.name = accessoryName;
+                if (!running_) return;
+                entry.loading = true;
+                generation = generation_;
+            }
+            fetch(generation, key);
+        }
+
+        size_t subscribe(Callback callback) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t id = nextCallbackId_++;
+            callbacks_.emplace(id, std::move(callback));
+            return id;
+        }
+
+        void unsubscribe(size_t id) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            callbacks_.erase(id);
+        }
+
+        void start() {
+            uint64_t generation;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (running_) return;
+                running_ = true;
+                generation = ++generation_;
+            }
+            resync(generation);
+        }
+
+        void stop() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+            synchronized_ = false;
+            ++generation_;
+        }
+
+        std::optional<std::string> value(const std::string& homeName, const std::string& roomName,
+                                         const std::string& accessoryName, const std::string& characteristicType) const {
+            const std::optional<Uuid> type = Uuid::parse(characteristicType);
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto found = entries_.find(accessoryKey(homeName, roomName, accessoryName));
+            if (found == entries_.end() || !found->second.accessory || !found->second.accessory->services) {
+                return std::nullopt;
+            }
+            for (const auto& service : *found->second.accessory->services) {
+                for (const auto& characteristic : service.characteristics) {
+                    if ((type && characteristic.type == *type) || characteristic.typeName == characteristicType) {
+                        return characteristic.value;
+                    }
+                }
+            }
+            return std::nullopt;
+        }
+
+        std::optional<Accessory> accessory(const std::string& homeName, const std::string& roomName,
+                                           const std::string& accessoryName) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto found = entries_.find(accessoryKey(homeName, roomName, accessoryName));
+            if (found == entries_.end()) return std::nullopt;
+            return found->second.accessory;
+        }
+
+        bool synchronized() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return synchronized_;
+        }
+
+        uint64_t sequence() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return sequence_;
+        }
+
+        size_t resyncCount() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return resyncs_;
+        }
+
+    private:
+        struct Entry {
+            std::string home;
+            std::string room;
+            std::string name;
+            std::optional<Accessory> accessory;
+            bool loading = false;                       // Read in flight for an accessory watched while running
+            int retryDelayMs = 0;                       // Backoff of that read after it failed
+            std::vector<CharacteristicChange> pending;  // Changes that arrived while loading
+        };
+
+        // Outcome of reading every watched accessory during a resync
+        struct Reads {
+            std::mutex mutex;
+            size_t remaining = 0;
+            bool failed = false;
+            std::map<std::string, std::optional<Accessory>> accessories;  // nullopt: the accessory is gone
+        };
+
+        bool current(uint64_t generation) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return running_ && generation_ == generation;
+        }
+
+        // Note the current sequence first, then reread; changes after it are replayed by the next poll
+        void resync(uint64_t generation) {
+            auto self = shared_from_this();
+            RequestPriorityScope background(RequestPriority::Background);
+            EndpointPin::Scope pinned(pin_);
+            client_.getChangesAsync(std::nullopt, 0, [self, generation](AsyncResult<ChangeBatch> result) {
+                if (!self->current(generation)) return;
+                if (!result.ok()) return self->retry(generation);
+                self->read(generation, std::move(result.value()));
+            });
+        }
+
+        void read(uint64_t generation, ChangeBatch start) {
+            std::vector<std::pair<std::string, Entry>> watched;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (const auto& [key, entry] : entries_) {
+                    Entry copy;
+                    copy.home = entry.home;
+                    copy.room = entry.room;
+                    copy.name = entry.name;
+                    watched.emplace_back(key, std::move(copy));
+                }
+            }
+            auto reads = std::make_shared<Reads>();
+            if (watched.empty()) return finishResync(generation, std::move(start), *reads);
+
+            reads->remaining = watched.size();
+            auto self = shared_from_this();
+            auto batch = std::make_shared<ChangeBatch>(std::move(start));
+            RequestPriorityScope background(RequestPriority::Background);
+            EndpointPin::Scope pinned(pin_);
+            for (const auto& [key, entry] : watched) {
+                client_.invalidateAccessoryState(entry.home, entry.room, entry.name);
+                client_.getAccessoryAsync(entry.home, entry.room, entry.name,
+                    [self, generation, reads, batch, key = key](AsyncResult<Accessory> result) {
+                        bool done;
+                        {
+                            std::lock_guard<std::mutex> lock(reads->mutex);
+                            if (result.ok()) {
+                                reads->accessories[key] = std::move(result.value());
+                            } else if (isNotFound(result)) {
+                                reads->accessories[key] = std::nullopt;
+                            } else {
+                                reads->failed = true;
+                            }
+                            done = --reads->remaining == 0;
+                        }
+                        if (!done || !self->current(generation)) return;
+                        if (reads->failed) return self->retry(generation);
+                        self->finishResync(generation, std::move(*batch), *reads);
+                    });
+            }
+        }
+
+        void finishResync(uint64_t generation, ChangeBatch start, Reads& reads) {
+            std::vector<CharacteristicChange> changes;
+            std::vector<Callback> callbacks;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!running_ || generation_ != generation) return;
+                for (auto& [key, accessory] : reads.accessories) {
+                    auto found = entries_.find(key);
+                    if (found == entries_.end()) continue;
+                    Entry& entry = found->second;
+                    if (entry.accessory && accessory) diff(*entry.accessory, *accessory, start.sequence, changes);
+                    entry.accessory = std::move(accessory);
+                    entry.loading = false;
+                    entry.retryDelayMs = 0;
+                    entry.pending.clear();
+                }
+                epoch_ = start.epoch;
+                sequence_ = start.sequence;
+                synchronized_ = true;
+                resyncs_++;
+                retryDelayMs_ = std::max(options_.retryDelayMs, 1);
+                if (!changes.empty()) callbacks = callbacksLocked();
+            }
+            notify(callbacks, changes);
+            poll(generation);
+        }
+
+        void poll(uint64_t generation) {
+            uint64_t since;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                since = sequence_;
+            }
+            auto self = shared_from_this();
+            RequestPriorityScope background(RequestPriority::Background);
+            EndpointPin::Scope pinned(pin_);
+            client_.getChangesAsync(since, options_.waitSeconds, [self, generation](AsyncResult<ChangeBatch> result) {
+                if (!self->current(generation)) return;
+                if (!result.ok()) {
+                    self->markUnsynchronized();
+                    return self->retry(generation);
+                }
+                ChangeBatch& batch = result.value();
+                if (batch.reset || batch.epoch != self->epoch()) {
+                    self->markUnsynchronized();
+                    return self->resync(generation);
+                }
+                self->apply(generation, batch);
+                self->poll(generation);
+            });
+        }
+
+        void apply(uint64_t generation, const ChangeBatch& batch) {
+            std::vector<CharacteristicChange> changes;
+            std::vector<Callback> callbacks;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!running_ || generation_ != generation) return;
+                for (const auto& change : batch.changes) {
+                    if (change.sequence <= sequence_) continue;
+                    changes.push_back(change);
+
+                    auto found = entries_.find(accessoryKey(change.home, change.room, change.accessory));
+                    if (found == entries_.end()) continue;
+                    Entry& entry = found->second;
+                    if (entry.loading) {
+                        entry.pending.push_back(change);
+                    } else if (entry.accessory) {
+                        if (Characteristic* characteristic = findCharacteristic(*entry.accessory, change.characteristicId)) {
+                            setValue(*characteristic, change.value);
+                        }
+                    }
+                }
+                sequence_ = std::max(sequence_, batch.sequence);
+                if (!changes.empty()) callbacks = callbacksLocked();
+            }
+
+            // Cached reads of these accessories are stale now
+            for (const auto& change : changes) {
+                client_.invalidateAccessoryState(change.home, change.room, change.accessory);
+            }
+            notify(callbacks, changes);
+        }
+
+        // Read one accessory watched while the feed is running
+        void fetch(uint64_t generation, const std::string& key) {
+            std::string home, room, name;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                const Entry& entry = entries_.at(key);
+                home = entry.home;
+                room = entry.room;
+                name = entry.name;
+            }
+            client_.invalidateAccessoryState(home, room, name);
+            auto self = shared_from_this();
+            RequestPriorityScope background(RequestPriority::Background);
+            EndpointPin::Scope pinned(pin_);
+            client_.getAccessoryAsync(home, room, name, [self, generation, key](AsyncResult<Accessory> result) {
+                std::unique_lock<std::mutex> lock(self->mutex_);
+                Entry& entry = self->entries_.at(key);
+                if (!entry.loading) return;  // A resync has read it since
+                const bool current = self->running_ && self->generation_ == generation;
+                if (current && !result.ok() && !isNotFound(result)) {
+                    // Keep collecting changes and read it again; a healthy feed has no resync to do it
+                    const int first = std::max(self->options_.retryDelayMs, 1);
+                    entry.retryDelayMs = entry.retryDelayMs == 0
+                        ? first
+                        : std::min(entry.retryDelayMs * 2, std::max(self->options_.maxRetryDelayMs, first));
+                    const int delay = entry.retryDelayMs;
+                    lock.unlock();
+                    self->client_.reactor_->schedule(std::chrono::milliseconds(delay), [self, generation, key]() {
+                        self->refetch(generation, key);
+                    });
+                    return;
+                }
+                entry.loading = false;
+                entry.retryDelayMs = 0;
+                if (current && result.ok()) {
+                    entry.accessory = std::move(result.value());
+                    // The read may predate these; values are absolute, so replaying them is safe
+                    for (const auto& change : entry.pending) {
+                        if (Characteristic* characteristic = findCharacteristic(*entry.accessory, change.characteristicId)) {
+                            setValue(*characteristic, change.value);
+                        }
+                    }
+                }
+                // Otherwise the accessory is gone, or the next resync reads it
+                entry.pending.clear();
+            });
+        }
+
+        void refetch(uint64_t generation, const std::string& key) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!running_ || generation_ != generation || !entries_.at(key).loading) return;
+            }
+            fetch(generation, key);
+        }
+
+        void retry(uint64_t generation) {
+            int delay;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                delay = retryDelayMs_;
+                retryDelayMs_ = std::min(retryDelayMs_ * 2, std::max(options_.maxRetryDelayMs, retryDelayMs_));
+            }
+            auto self = shared_from_this();
+            client_.reactor_->schedule(std::chrono::milliseconds(delay), [self, generation]() {
+                if (self->current(generation)) self->resync(generation);
+            });
+        }
+
+        void markUnsynchronized() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            synchronized_ = false;
+        }
+
+        std::string epoch() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return epoch_;
+        }
+
+        std::vector<Callback> callbacksLocked() const {
+            std::vector<Callback> callbacks;
+            callbacks.reserve(callbacks_.size());
+            for (const auto& [id, callback] : callbacks_) callbacks.push_back(callback);
+            return callbacks;
+        }
+
+        static void notify(const std::vector<Callback>& callbacks, const std::vector<CharacteristicChange>& changes) {
+            for (const auto& change : changes) {
+                for (const auto& callback : callbacks) callback(change);
+            }
+        }
+
+        static bool isNotFound(const AsyncResult<Accessory>& result) {
+            try {
+                std::rethrow_exception(result.error());
+            } catch (const PrefabException& e) {
+                return e.getHttpCode() == 404;
+            } catch (...) {
+                return false;
+            }
+        }
+
+        PrefabClient& client_;
+        const ChangeFeedOptions options_;
+        // With load balancing, keeps the feed on one server's event epoch until that server fails
+        const std::shared_ptr<EndpointPin> pin_ = std::make_shared<EndpointPin>();
+
+        mutable std::mutex mutex_;
+        std::map<std::string, Entry> entries_;
+        std::map<size_t, Callback> callbacks_;
+        size_t nextCallbackId_ = 1;
+        bool running_ = false;
+        bool synchronized_ = false;
+        uint64_t generation_ = 0;
+        std::string epoch_;
+        uint64_t sequence_ = 0;
+        size_t resyncs_ = 0;
+        int retryDelayMs_;
+    };
+
+    ChangeFeed::ChangeFeed(PrefabClient& client, const ChangeFeedOptions& options)
+        : session_(std::make_shared<Session>(client, options)) {}
+
+    ChangeFeed::~ChangeFeed() {
+        session_->stop();
+    }
+
+    void ChangeFeed::watch(const std::string& homeName, const std::string& roomName, const std::string& accessoryName) {
+        session_->watch(homeName, roomName, accessoryName);
+    }
+
+    size_t ChangeFeed::subscribe(Callback callback) {
+        return session_->subscribe(std::move(callback));
+    }
+
+    void ChangeFeed::unsubscribe(size_t id) {
+        session_->unsubscribe(id);
+    }
+
+    void ChangeFeed::start() {
+        session_->start();
+    }
+
+    void ChangeFeed::stop() {
+        session_->stop();
+    }
+
+    std::optional<std::string> ChangeFeed::value(const std::string& homeName, const std::string& roomName,
+                                                 const std::string& accessoryName,
+                                                 const std::string& characteristicType) const {
+        return session_->value(homeName, roomName, accessoryName, characteristicType);
+    }
+
+    std::optional<Accessory> ChangeFeed::accessory(const std::string& homeName, const std::string& roomName,
+                                                   const std::string& accessoryName) const {
+        return session_->accessory(homeName, roomName, accessoryName);
+    }
+
+    bool ChangeFeed::synchronized() const { return session_->synchronized(); }
+    uint64_t ChangeFeed::sequence() const { return session_->sequence(); }
+    size_t ChangeFeed::resyncCount() const { return session_->resyncCount(); }
+
+} // namespace prefab
@@ -0,0 +1,101 @@
+#include "characteristic_index.h"
+
+namespace prefab {
+
+    // Names may contain any character but NUL, so it makes an unambiguous separator
+    std::string CharacteristicIndex::homeKey(const std::string& homeName) {
+        std::string key = homeName;
+        key.push_back('\0');
+        return key;
+    }
+
+    std::string CharacteristicIndex::accessoryKey(const std::string& homeName, const std::string& roomName,
+                                                  const std::string& accessoryName) {
+        std::string key = homeKey(homeName);
+        key += roomName;
+        key.push_back('\0');
+        key += accessoryName;
+        return key;
+    }
+
+    std::optional<CharacteristicIndex::Location> CharacteristicIndex::find(const std::string& homeName,
+                                                                           const std::string& roomName,
+                                                                           const std::string& accessoryName,
+                                                                           const std::string& characteristicType) const {
+        // Resolve the text before locking: a type is either a UUID or a type name that was interned when learned
+        const std::optional<Uuid> type = Uuid::parse(characteristicType);
+        const std::optional<InternedString> typeName = InternedString::find(characteristicType);
+        if (!type && !typeName) return std::nullopt;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto accessory = accessories_.find(accessoryKey(homeName, roomName, accessoryName));
+        if (accessory == accessories_.end()) return std::nullopt;
+
+        const Characteristics& characteristics = accessory->second;
+        if (type) {
+            auto found = characteristics.byType.find(*type);
+            if (found != characteristics.byType.end()) return characteristics.locations[found->second];
+        }
+        if (typeName) {
+            auto found = characteristics.byTypeName.find(*typeName);
+            if (found != characteristics.byTypeName.end()) return characteristics.locations[found->second];
+        }
+        return std::nullopt;
+    }
+
+    // Regular and arena accessories have the same shape
+    template <typename AccessoryModel>
+    CharacteristicIndex::Characteristics CharacteristicIndex::index(const AccessoryModel& accessory) {
+        Characteristics characteristics;
+        for (const auto& service : accessory.services.value()) {
+            for (const auto& characteristic : service.characteristics) {
+                // First match wins, the same order a linear search over the services would use
+                const size_t index = characteristics.locations.size();
+                characteristics.locations.push_back(Location{service.uniqueIdentifier, characteristic.uniqueIdentifier,
+                                                             characteristic.metadata.constraints});
+                characteristics.byType.emplace(characteristic.type, index);
+                characteristics.byTypeName.emplace(characteristic.typeName, index);
+            }
+        }
+        return characteristics;
+    }
+
+    void CharacteristicIndex::learn(const std::string& homeName, const std::string& roomName,
+                                    const std::string& accessoryName, const Accessory& accessory) {
+        if (!accessory.services.has_value()) return;
+        Characteristics characteristics = index(accessory);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        accessories_[accessoryKey(homeName, roomName, accessoryName)] = std::move(characteristics);
+    }
+
+    void CharacteristicIndex::learn(const std::string& homeName, const std::string& roomName,
+                                    const std::string& accessoryName, const pmr::Accessory& accessory) {
+        if (!accessory.services.has_value()) return;
+        Characteristics characteristics = index(accessory);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        accessories_[accessoryKey(homeName, roomName, accessoryName)] = std::move(characteristics);
+    }
+
+    void CharacteristicIndex::forget(const std::string& homeName, const std::string& roomName,
+                                     const std::string& accessoryName) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        accessories_.erase(accessoryKey(homeName, roomName, accessoryName));
+    }
+
+    void CharacteristicIndex::forgetHome(const std::string& homeName) {
+        std::string prefix = homeKey(homeName);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = accessories_.lower_bound(prefix);
+        while (it != accessories_.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+            it = accessories_.erase(it);
+        }
+    }
+
+    void CharacteristicIndex::clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        accessories_.clear();
+    }
+
+} // namespace prefab
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "prefab/arena.h"
+#include "prefab/models.h"
+
+namespace prefab {
+
+    /**
+     * @brief Remembers where a characteristic lives inside an accessory
+     *
+     * Maps (home, room, accessory, characteristic type or typeName) to the
+     * service and characteristic identifiers needed for a write, and the value
+     * constraints to check it against, so that updateCharacteristicByType does
+     * not have to fetch the full accessory tree before every update. Entries
+     * are learned from accessory details and forgotten when the server
+     * rejects them.
+     *
+     * The index is safe to use from multiple threads.
+     */
+    class CharacteristicIndex {
+    public:
+        struct Location {
+            Uuid serviceId;
+            Uuid characteristicId;
+            ValueConstraints constraints;  // For checking writes before they are sent
+        };
+
+        std::optional<Location> find(const std::string& homeName, const std::string& roomName,
+                                     const std::string& accessoryName, const std::string& characteristicType) const;
+
+        /**
+         * @brief Replace everything known about an accessory with its current services
+         */
+        void learn(const std::string& homeName, const std::string& roomName,
+                   const std::string& accessoryName, const Accessory& accessory);
+        void learn(const std::string& homeName, const std::string& roomName,
+                   const std::string& accessoryName, const pmr::Accessory& accessory);
+
+        void forget(const std::string& homeName, const std::string& roomName, const std::string& accessoryName);
+        void forgetHome(const std::string& homeName);
+        void clear();
+
+    private:
+        // Everything known about one accessory; types are matched as UUIDs, type names by interned pointer
+        struct Characteristics {
+            std::vector<Location> locations;
+            std::unordered_map<Uuid, size_t> byType;
+            std::unordered_map<InternedString, size_t> byTypeName;
+        };
+
+        template <typename AccessoryModel>
+        static Characteristics index(const AccessoryModel& accessory);
+
+        static std::string homeKey(const std::string& homeName);
+        static std::string accessoryKey(const std::string& homeName, const std::string& roomName,
+                                        const std::string& accessoryName);
+
+        mutable std::mutex mutex_;
+        std::map<std::string, Characteristics> accessories_;  // Ordered so a home can be dropped by prefix
+    };
+
+} // namespace prefab
@@ -1,129 +1,1092 @@
 #include "prefab/client.h"
+#include "connection_pool.h"
+#include "reactor.h"
+#include "response_cache.h"
+#include "characteristic_index.h"
+#include "write_coalescer.h"
+#include "model_parser.h"
+#include "base_url_discovery.h"
+#include "endpoint_set.h"
+#include "hedge_policy.h"
+#include "metrics_registry.h"
+#include "logging.h"
+#include "tracer.h"
+#include "request_scheduler.h"
+#include "published_ptr.h"
+#include "caller_context.h"
 #include <curl/curl.h>
 #include <sstream>
-#include <iostream>
 #include <nlohmann/json.hpp>
-// threading/sync for non-blocking Avahi discovery
-#include <thread>
-#include <mutex>
-#include <condition_variable>
 #include <chrono>
-
-#include <avahi-client/client.h>
-#include <avahi-client/lookup.h>
-#include <avahi-common/simple-watch.h>
-#include <avahi-common/malloc.h>
-#include <avahi-common/error.h>
-#include <arpa/inet.h>
-#include <netdb.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
 
 using json = nlohmann::json;
 
 namespace prefab {
 
+    /**
+     * @brief State of one HTTP exchange; must outlive the transfer on its curl handle
+     */
+    struct Transfer {
+        CURL* handle = nullptr;
+        std::string url;
+        std::string body;
+        std::string response;
+        struct curl_slist* headers = nullptr;
+        std::shared_ptr<const std::atomic<bool>> cancelled;  // Aborts the transfer once set
+        std::string traceparent;                             // Sent as a traceparent header unless empty
+        std::chrono::microseconds serverTime{-1};            // From the Server-Timing header, if any
+
+        Transfer() = default;
+        Transfer(const Transfer&) = delete;
+        Transfer& operator=(const Transfer&) = delete;
+        ~Transfer() { curl_slist_free_all(headers); }
+    };
+
+    // Never trust Content-Length for more than this much up-front allocation
+    static constexpr curl_off_t kMaxReserveBytes = 16 * 1024 * 1024;
+
     // Callback function for curl to write response data
-    static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp) {
-        userp->append((char*)contents, size * nmemb);
+    static size_t WriteCallback(void* contents, size_t size, size_t nmemb, Transfer* transfer) {
+        if (transfer->response.empty()) {
+            // Size the buffer once from Content-Length instead of growing it chunk by chunk
+            curl_off_t length = -1;
+            if (curl_easy_getinfo(transfer->handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length) == CURLE_OK &&
+                length > 0) {
+                transfer->response.reserve(static_cast<size_t>(std::min(length, kMaxReserveBytes)));
+            }
+        }
+        transfer->response.append((char*)contents, size * nmemb);
         return size * nmemb;
     }
 
-    PrefabClient::PrefabClient(const ClientConfig& config) : config_(config) {
-        // Initialize curl
-        curl_global_init(CURL_GLOBAL_DEFAULT);
-        
-        // If mDNS discovery is enabled and no specific URL provided, try to discover
-        if (config_.enableMdnsDiscovery && config_.baseUrl == "http://localhost:8080") {
-            discoverService();
+    // Picks the server's own time out of a Server-Timing header, e.g. "Server-Timing: app;dur=12.5"
+    static size_t HeaderCallback(char* buffer, size_t size, size_t nitems, Transfer* transfer) {
+        static constexpr char kName[] = "server-timing:";
+        const size_t length = size * nitems;
+        const size_t nameLength = sizeof(kName) - 1;
+        if (length <= nameLength) return length;
+        for (size_t i = 0; i < nameLength; ++i) {
+            if (std::tolower(static_cast<unsigned char>(buffer[i])) != kName[i]) return length;
         }
+        const std::string value(buffer + nameLength, length - nameLength);
+        const size_t duration = value.find("dur=");
+        if (duration != std::string::npos) {
+            const double ms = std::strtod(value.c_str() + duration + 4, nullptr);
+            transfer->serverTime = std::chrono::microseconds(std::llround(ms * 1000));
+        }
+        return length;
     }
 
-    PrefabClient::~PrefabClient() {
-        curl_global_cleanup();
+    static int ProgressCallback(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+        const auto* transfer = static_cast<const Transfer*>(clientp);
+        return transfer->cancelled->load() ? 1 : 0;
     }
 
-    std::string PrefabClient::makeHttpRequest(const std::string& method, const std::string& path, const std::string& body) const {
-        CURL* curl;
-        CURLcode res;
-        std::string response;
-
-        curl = curl_easy_init();
-        if (!curl) {
-            throw PrefabException("Failed to initialize CURL");
-        }
-
-    std::string url = getBaseUrl() + path;
-    // Log the outgoing request for diagnostics
-    
-        
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    static void prepareTransfer(CURL* curl, Transfer& transfer, const std::string& method, long timeoutMs) {
+        transfer.handle = curl;
+        curl_easy_setopt(curl, CURLOPT_URL, transfer.url.c_str());
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, config_.timeoutSeconds);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeoutMs);
         curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &transfer);
+        if (transfer.cancelled) {
+            // Pooled handles are reset on release, so this never outlives the transfer
+            curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallback);
+            curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &transfer);
+            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        }
 
         // Set HTTP method and body
         if (method == "POST" || method == "PUT") {
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, body.length());
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, transfer.body.c_str());
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, transfer.body.length());
             
-            struct curl_slist* headers = nullptr;
-            headers = curl_slist_append(headers, "Content-Type: application/json");
-            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+            transfer.headers = curl_slist_append(transfer.headers, "Content-Type: application/json");
             
             if (method == "PUT") {
                 curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
             }
         }
 
-        res = curl_easy_perform(curl);
-        
-        long httpCode = 0;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
-        
-        curl_easy_cleanup(curl);
+        if (!transfer.traceparent.empty()) {
+            transfer.headers = curl_slist_append(transfer.headers, ("traceparent: " + transfer.traceparent).c_str());
+        }
+        if (transfer.headers) {
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer.headers);
+        }
+    }
+
+    // Turn a finished transfer into its response body, or throw on transport/HTTP errors
+    static std::string checkTransfer(CURLcode res, long httpCode, std::string&& response) {
+        if (res == CURLE_ABORTED_BY_CALLBACK) {
+            throw PrefabException("Request cancelled: client is shutting down");
+        }
 
         if (res != CURLE_OK) {
             throw PrefabException("CURL request failed: " + std::string(curl_easy_strerror(res)));
         }
 
         if (httpCode >= 400) {
-            // Log a short snippet of the response to help debugging
-            std::string resp_snip = response.size() > 200 ? response.substr(0, 200) + "..." : response;
-            
             throw PrefabException("HTTP error: " + response, (int)httpCode);
-        } else {
-            
         }
 
-        return response;
+        return std::move(response);
+    }
+
+    struct PrefabClient::TransferOutcome {
+        CURLcode code = CURLE_OK;
+        long httpCode = 0;
+        std::string response;
+        // Phase timings from curl, each measured from the start of the transfer
+        std::chrono::microseconds nameLookup{0};
+        std::chrono::microseconds connected{0};
+        std::chrono::microseconds total{0};
+        std::chrono::microseconds serverTime{-1};  // As reported by the server; negative if it did not say
+    };
+
+    static std::chrono::microseconds transferTime(CURL* curl, CURLINFO info) {
+        curl_off_t us = 0;
+        curl_easy_getinfo(curl, info, &us);
+        return std::chrono::microseconds(us);
+    }
+
+    template <typename Outcome>
+    static void readTimings(CURL* curl, Outcome& outcome) {
+        outcome.nameLookup = transferTime(curl, CURLINFO_NAMELOOKUP_TIME_T);
+        outcome.connected = transferTime(curl, CURLINFO_CONNECT_TIME_T);
+        outcome.total = transferTime(curl, CURLINFO_TOTAL_TIME_T);
+    }
+
+    // Time from name resolution to an established connection
+    template <typename Outcome>
+    static std::chrono::microseconds connectTime(const Outcome& outcome) {
+        return std::max(outcome.connected - outcome.nameLookup, std::chrono::microseconds(0));
+    }
+
+    // Time from an established connection to the end of the response
+    template <typename Outcome>
+    static std::chrono::microseconds exchangeTime(const Outcome& outcome) {
+        return std::max(outcome.total - std::max(outcome.connected, outcome.nameLookup), std::chrono::microseconds(0));
+    }
+
+    static std::string errorMessage(std::exception_ptr error) {
+        try {
+            std::rethrow_exception(error);
+        } catch (const std::exception& e) {
+            return e.what();
+        } catch (...) {
+            return "unknown error";
+        }
+    }
+
+    // Spans of one request: the request itself, with a child span per attempt
+    struct RequestTrace {
+        std::shared_ptr<Tracer> tracer;
+        std::shared_ptr<ActiveSpan> span;
+        std::atomic<int> attempts{0};
+
+        std::shared_ptr<ActiveSpan> startAttempt(const std::string& url) {
+            auto attempt = tracer->startSpan("attempt", SpanKind::Client, span->context());
+            attempt->setAttribute("url.full", url);
+            attempt->setAttribute("prefab.attempt", std::to_string(++attempts));
+            return attempt;
+        }
+
+        // Header value that makes the server's work a child of the attempt
+        std::string traceparent(const ActiveSpan& attempt) const {
+            return tracer->propagate() ? attempt.context().traceparent() : std::string();
+        }
+
+        template <typename Outcome>
+        void endAttempt(ActiveSpan& attempt, const Outcome& outcome) {
+            auto micros = [](std::chrono::microseconds time) { return std::to_string(time.count()); };
+            attempt.setAttribute("prefab.dns_us", micros(outcome.nameLookup));
+            attempt.setAttribute("prefab.connect_us", micros(connectTime(outcome)));
+            attempt.setAttribute("prefab.transfer_us", micros(exchangeTime(outcome)));
+            if (outcome.serverTime.count() >= 0) attempt.setAttribute("prefab.server_us", micros(outcome.serverTime));
+            if (outcome.code == CURLE_ABORTED_BY_CALLBACK) {
+                // Another attempt won, or the client is shutting down; not a failure of this one
+                attempt.setAttribute("prefab.cancelled", "true");
+                attempt.end();
+                return;
+            }
+            if (outcome.httpCode > 0) {
+                const std::string status = std::to_string(outcome.httpCode);
+                attempt.setAttribute("http.response.status_code", status);
+                span->setAttribute("http.response.status_code", status);
+            }
+            attempt.end(outcome.code != CURLE_OK ? curl_easy_strerror(outcome.code)
+                        : outcome.httpCode >= 400 ? "HTTP " + std::to_string(outcome.httpCode)
+                                                  : std::string());
+        }
+
+        void end(const std::string& error) {
+            span->setAttribute("prefab.attempts", std::to_string(attempts.load()));
+            span->end(error);
+        }
+    };
+
+    // Opens the span of a request under the calling thread's trace context; null when tracing is off
+    static std::shared_ptr<RequestTrace> traceRequest(const std::shared_ptr<Tracer>& tracer, const std::string& method,
+                                                      const std::string& path) {
+        if (!tracer) return nullptr;
+        auto trace = std::make_shared<RequestTrace>();
+        trace->tracer = tracer;
+        const std::string route = MetricsRegistry::routeOf(path);
+        trace->span = tracer->startSpan(method + " " + route, SpanKind::Internal, currentSpanContext());
+        trace->span->setAttribute("http.request.method", method);
+        trace->span->setAttribute("http.route", route);
+        trace->span->setAttribute("url.path", path);
+        return trace;
+    }
+
+    // A request and its endpoint's failover state, when load balancing is on
+    struct PrefabClient::AsyncAttempt {
+        std::string method;
+        std::string path;
+        std::string body;
+        long timeoutMs = 0;  // As requested; 0 uses the configured timeout
+        std::optional<RequestDeadline::Clock::time_point> deadline;
+        std::function<void(std::string&&, std::exception_ptr)> done;
+        std::shared_ptr<EndpointSet> endpoints;
+        std::optional<EndpointSet::Lease> lease;
+        std::vector<std::string> tried;
+        std::shared_ptr<std::atomic<bool>> cancelled;  // Set once the other attempt of a hedged GET won
+        std::shared_ptr<RequestTrace> trace;           // Set when tracing is enabled
+        RequestPriority priority = RequestPriority::Normal;  // Of the request; each attempt is admitted with it
+        std::function<void()> onSend;                  // Runs once, when the first transfer starts
+        std::shared_ptr<EndpointPin> pin;              // Set when started inside an EndpointPin::Scope
+
+        // Fails the request before a transfer was sent; the endpoint did nothing wrong
+        void abandon(std::exception_ptr error) {
+            if (lease) endpoints->release(*lease, true, false);
+            lease.reset();
+            done(std::string(), error);
+        }
+    };
+
+    // The attempts of one hedged GET; the first success is delivered and the rest cancelled
+    struct PrefabClient::HedgeRace {
+        std::string path;
+        std::optional<RequestDeadline::Clock::time_point> deadline;
+        RequestPriority priority = RequestPriority::Normal;
+        std::string avoid;  // Endpoint of the first attempt; the hedge goes elsewhere if it can
+        std::function<void(std::string&&, std::exception_ptr)> done;
+        std::shared_ptr<RequestTrace> trace;
+
+        std::mutex mutex;
+        bool settled = false;
+        int running = 0;
+        std::vector<std::shared_ptr<std::atomic<bool>>> attempts;
+
+        // A failure is only delivered once no other attempt is left to succeed
+        void finish(bool hedge, std::string&& response, std::exception_ptr error, HedgePolicy& policy) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (settled) return;
+                running--;
+                if (error && running > 0) return;
+                settled = true;
+                for (const auto& cancelled : attempts) cancelled->store(true);
+            }
+            if (hedge && !error) policy.recordHedgeWin();
+            done(std::move(response), error);
+        }
+    };
+
+    struct PrefabClient::Upstream {
+        std::string baseUrl;                          // Used when nothing below knows better
+        std::shared_ptr<BaseUrlDiscovery> discovery;  // Set while the base URL comes from mDNS
+        std::shared_ptr<EndpointSet> endpoints;       // Set when load balancing is configured
+    };
+
+    static thread_local std::optional<RequestDeadline::Clock::time_point> currentDeadline;
+
+    RequestDeadline::RequestDeadline(std::chrono::milliseconds timeout)
+        : RequestDeadline(Clock::now() + timeout) {}
+
+    RequestDeadline::RequestDeadline(Clock::time_point deadline) : previous_(currentDeadline) {
+        currentDeadline = previous_ ? std::min(*previous_, deadline) : deadline;
+    }
+
+    RequestDeadline::~RequestDeadline() {
+        currentDeadline = previous_;
+    }
+
+    std::optional<RequestDeadline::Clock::time_point> RequestDeadline::current() {
+        return currentDeadline;
+    }
+
+    static thread_local std::optional<RequestPriority> currentPriority;
+
+    RequestPriorityScope::RequestPriorityScope(RequestPriority priority) : previous_(currentPriority) {
+        currentPriority = priority;
+    }
+
+    RequestPriorityScope::~RequestPriorityScope() {
+        currentPriority = previous_;
+    }
+
+    std::optional<RequestPriority> RequestPriorityScope::current() {
+        return currentPriority;
+    }
+
+    // Writes are what a user is waiting on; reads can usually wait a little
+    static RequestPriority priorityFor(const std::string& method) {
+        if (std::optional<RequestPriority> priority = RequestPriorityScope::current()) return *priority;
+        return method == "GET" ? RequestPriority::Normal : RequestPriority::Interactive;
+    }
+
+    // Requests addressing a single accessory share its rate limit; others only the server's
+    static std::string accessoryKey(const std::string& path) {
+        if (MetricsRegistry::routeOf(path) != "/accessories/:home/:room/:accessory") return std::string();
+        return path.substr(0, path.find('?'));
+    }
+
+    static bool expired(const std::optional<RequestDeadline::Clock::time_point>& deadline) {
+        return deadline && RequestDeadline::Clock::now() >= *deadline;
+    }
+
+    // Whether an outcome says the endpoint is in trouble rather than the request. A timeout
+    // cut short by the caller's deadline (clipped) says nothing about the endpoint
+    static bool endpointFailed(CURLcode code, long httpCode, bool clipped) {
+        if (code == CURLE_ABORTED_BY_CALLBACK) return false;
+        if (code == CURLE_OPERATION_TIMEDOUT && clipped) return false;
+        return code != CURLE_OK || httpCode == 502 || httpCode == 503 || httpCode == 504;
+    }
+
+    // Reads may go to another endpoint after any endpoint failure; writes only if they never left
+    static bool canFailOver(const std::string& method, CURLcode code, long httpCode, bool clipped) {
+        if (!endpointFailed(code, httpCode, clipped)) return false;
+        if (method == "GET") return true;
+        return code == CURLE_COULDNT_CONNECT || code == CURLE_COULDNT_RESOLVE_HOST;
+    }
+
+    static void finishRequest(const std::function<void(std::string&&, std::exception_ptr)>& done,
+                              CURLcode code, long httpCode, std::string&& body) {
+        std::string response;
+        std::exception_ptr error;
+        try {
+            response = checkTransfer(code, httpCode, std::move(body));
+        } catch (...) {
+            error = std::current_exception();
+        }
+        done(std::move(response), error);
+    }
+
+    template <typename T>
+    static T parseResponse(const std::string& response, const char* what) {
+        try {
+            json j = json::parse(response);
+            return j.get<T>();
+        } catch (const json::exception& e) {
+            throw PrefabException("Failed to parse " + std::string(what) + " response: " + std::string(e.what()));
+        }
+    }
+
+    // Accessory payloads are the largest responses; parse them without building a DOM
+    template <>
+    Accessory parseResponse<Accessory>(const std::string& response, const char* what) {
+        Accessory accessory;
+        std::string error;
+        if (!parseAccessoryJson(response, accessory, error)) {
+            throw PrefabException("Failed to parse " + std::string(what) + " response: " + error);
+        }
+        return accessory;
+    }
+
+    template <>
+    std::vector<Accessory> parseResponse<std::vector<Accessory>>(const std::string& response, const char* what) {
+        std::vector<Accessory> accessories;
+        std::string error;
+        if (!parseAccessoryListJson(response, accessories, error)) {
+            throw PrefabException("Failed to parse " + std::string(what) + " response: " + error);
+        }
+        return accessories;
+    }
+
+    // Adapt a raw response completion into a typed AsyncCallback that parses the body
+    template <typename T>
+    static std::function<void(std::string&&, std::exception_ptr)> parseThen(const char* what, AsyncCallback<T> callback) {
+        return [what, callback = std::move(callback)](std::string&& response, std::exception_ptr error) {
+            AsyncResult<T> result = AsyncResult<T>::failure(error);
+            if (!error) {
+                try {
+                    result = AsyncResult<T>::success(parseResponse<T>(response, what));
+                } catch (...) {
+                    result = AsyncResult<T>::failure(std::current_exception());
+                }
+            }
+            callback(std::move(result));
+        };
+    }
+
+    // Pair an AsyncCallback with the future it fulfils
+    template <typename T>
+    static std::pair<AsyncCallback<T>, std::future<T>> futureCallback() {
+        auto promise = std::make_shared<std::promise<T>>();
+        std::future<T> future = promise->get_future();
+        AsyncCallback<T> callback = [promise](AsyncResult<T> result) {
+            if (result.ok()) {
+                promise->set_value(std::move(result.value()));
+            } else {
+                promise->set_exception(result.error());
+            }
+        };
+        return {std::move(callback), std::move(future)};
+    }
+
+    // Runs a cache invalidation once a write attempt finishes, whether it returned or threw
+    template <typename F>
+    struct AfterWrite {
+        F invalidate;
+        ~AfterWrite() { invalidate(); }
+    };
+    template <typename F>
+    AfterWrite(F) -> AfterWrite<F>;
+
+    // Reject a write the characteristic's metadata rules out before it reaches the server
+    static void checkValue(const ValueConstraints& constraints, const std::string& characteristicType,
+                           const std::string& value) {
+        std::string error;
+        if (!constraints.check(value, error)) {
+            throw PrefabException("Invalid value for " + characteristicType + ": " + error);
+        }
+    }
+
+    // Find the characteristic with the matching type (UUID or typeName) in a detailed
+    // accessory and build the update for it with both service and characteristic IDs
+    static UpdateAccessoryInput buildCharacteristicUpdate(const Accessory& accessory,
+                                                          const std::string& characteristicType,
+                                                          const std::string& value) {
+        if (!accessory.services.has_value()) {
+            throw PrefabException("Accessory has no services");
+        }
+        
+        // Match by UUID (type field) or by typeName, comparing binary UUIDs and interned names
+        const std::optional<Uuid> type = Uuid::parse(characteristicType);
+        const std::optional<InternedString> typeName = InternedString::find(characteristicType);
+        const Service* matchedService = nullptr;
+        const Characteristic* matchedCharacteristic = nullptr;
+        for (const auto& service : accessory.services.value()) {
+            for (const auto& characteristic : service.characteristics) {
+                if ((type && characteristic.type == *type) ||
+                    (typeName && characteristic.typeName == *typeName)) {
+                    matchedService = &service;
+                    matchedCharacteristic = &characteristic;
+                    break;
+                }
+            }
+            if (matchedService) break;
+        }
+        
+        if (!matchedService) {
+            throw PrefabException("Characteristic type not found: " + characteristicType);
+        }
+        checkValue(matchedCharacteristic->metadata.constraints, characteristicType, value);
+        
+        // Create update request with both serviceId and characteristicId to match Swift server API
+        UpdateAccessoryInput update;
+        update.serviceId = matchedService->uniqueIdentifier.toString();
+        update.characteristicId = matchedCharacteristic->uniqueIdentifier.toString();
+        update.value = value;
+        return update;
+    }
+
+    // Write request for a characteristic whose location is already known
+    static UpdateAccessoryInput resolvedUpdate(const CharacteristicIndex::Location& location,
+                                               const std::string& characteristicType, const std::string& value) {
+        checkValue(location.constraints, characteristicType, value);
+        UpdateAccessoryInput update;
+        update.serviceId = location.serviceId.toString();
+        update.characteristicId = location.characteristicId.toString();
+        update.value = value;
+        return update;
+    }
+
+    // The server names the missing service or characteristic in its 404; an unknown
+    // home, room or accessory is a 404 too, but another lookup would not fix it
+    static bool isStaleIdentifier(const PrefabException& e) {
+        if (e.getHttpCode() != 404) return false;
+        const std::string message = e.what();
+        return message.find("Service not found") != std::string::npos ||
+               message.find("Characteristic not found") != std::string::npos;
+    }
+
+    // Avahi wants the type without the trailing dot of ClientConfig::serviceName
+    static std::string browseType(const std::string& serviceName) {
+        std::string type = serviceName;
+        while (!type.empty() && type.back() == '.') type.pop_back();
+        return type;
+    }
+
+    // Tasks started by saveInBackground; close() waits for them, and later ones run inline
+    struct PrefabClient::BackgroundSaves {
+        std::mutex mutex;
+        std::vector<std::future<void>> running;
+        bool closed = false;
+
+        void close() {
+            std::vector<std::future<void>> waiting;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+                waiting.swap(running);
+            }
+            for (auto& task : waiting) task.wait();
+        }
+    };
+
+    void PrefabClient::saveInBackground(std::function<void()> task) const {
+        {
+            std::lock_guard<std::mutex> lock(saves_->mutex);
+            if (!saves_->closed) {
+                auto& running = saves_->running;
+                running.erase(std::remove_if(running.begin(), running.end(), [](const std::future<void>& done) {
+                    return done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                }), running.end());
+                running.push_back(std::async(std::launch::async, std::move(task)));
+                return;
+            }
+        }
+        task();  // The client is shutting down
+    }
+
+    PrefabClient::PrefabClient(const ClientConfig& config) : config_(config) {
+        pool_ = std::make_unique<ConnectionPool>(
+            static_cast<size_t>(std::max(config_.maxPooledConnections, 0)),
+            std::chrono::seconds(std::max(config_.connectionIdleTimeoutSeconds, 1)),
+            config_.enableKeepAlive);
+        reactor_ = std::make_unique<Reactor>();
+        saves_ = std::make_unique<BackgroundSaves>();
+        characteristics_ = std::make_unique<CharacteristicIndex>();
+        if (config_.coalescing.enabled) {
+            coalescer_ = std::make_shared<WriteCoalescer>(
+                *reactor_, std::chrono::milliseconds(std::max(config_.coalescing.holdWindowMs, 0)),
+                [this](const WriteCoalescer::Target& target, const UpdateAccessoryInput& update,
+                       AsyncCallback<std::string> done) {
+                    sendAccessoryUpdateAsync(target.homeName, target.roomName, target.accessoryName, update,
+                                             std::move(done));
+                });
+        }
+        if (config_.cache.enabled) {
+            cache_ = std::make_unique<ResponseCache>(config_.cache.maxBytes);
+        }
+        if (config_.enableMetrics) {
+            metrics_ = std::make_unique<MetricsRegistry>();
+        }
+        if (config_.hedging.enabled) {
+            hedge_ = std::make_unique<HedgePolicy>(config_.hedging);
+        }
+        if (config_.tracing.enabled) {
+            tracer_ = std::make_shared<Tracer>(config_.tracing);
+        }
+        if (config_.scheduling.enabled) {
+            scheduler_ = std::make_shared<RequestScheduler>(*reactor_, config_.scheduling);
+        }
+        
+        auto upstream = std::make_shared<Upstream>();
+        upstream->baseUrl = config_.baseUrl;
+        const LoadBalancingConfig& balancing = config_.loadBalancing;
+        if (!balancing.endpoints.empty() || balancing.useDiscoveredServers) {
+            upstream->endpoints = std::make_shared<EndpointSet>(balancing, *reactor_,
+                [this](const std::string& url, std::function<void(bool)> done) {
+                    // Any answer short of a gateway error means the server is back
+                    try {
+                        const long timeoutMs = std::min(attemptTimeoutMs(0, std::nullopt), 5000L);
+                        transferAsync("GET", url + "/homes", "", timeoutMs, [done](TransferOutcome&& outcome) {
+                            done(!endpointFailed(outcome.code, outcome.httpCode, false));
+                        });
+                    } catch (...) {
+                        done(false);
+                    }
+                });
+            if (balancing.useDiscoveredServers) {
+                auto browser = ServiceBrowser::shared(browseType(config_.serviceName));
+                upstream->endpoints->follow(browser);
+                if (balancing.endpoints.empty() && !config_.lazyDiscovery && browser->running()) {
+                    browser->waitForServer(std::chrono::milliseconds(std::max(config_.discoveryTimeoutMs, 0)));
+                }
+            }
+        } else if (config_.enableMdnsDiscovery && config_.baseUrl == "http://localhost:8080") {
+            // If mDNS discovery is enabled and no specific URL provided, try to discover
+            upstream->discovery = std::make_shared<BaseUrlDiscovery>(
+                ServiceBrowser::shared(browseType(config_.serviceName)),
+                std::chrono::milliseconds(std::max(config_.discoveryTimeoutMs, 0)), config_.discoveryCachePath);
+            upstream->discovery->start();
+            if (!config_.lazyDiscovery) upstream->discovery->baseUrl();  // Wait here rather than in the first request
+        }
+        upstream_ = std::make_unique<PublishedPtr<const Upstream>>(std::move(upstream));
+    }
+
+    PrefabClient::~PrefabClient() {
+        saves_->close();  // Their refreshed callbacks may still use the client
+        // Fail held and outstanding async requests first; their handles go back to
+        // the pool, so it goes last
+        if (coalescer_) coalescer_->shutdown();
+        if (scheduler_) scheduler_->shutdown();
+        reactor_->shutdown();  // Completions failed here may still issue requests through reactor_
+        reactor_.reset();
+        flushTraces();
+        pool_.reset();
+    }
+
+    std::shared_ptr<const PrefabClient::Upstream> PrefabClient::upstream() const {
+        return upstream_->load();
+    }
+
+    long PrefabClient::attemptTimeoutMs(long timeoutMs,
+                                        const std::optional<RequestDeadline::Clock::time_point>& deadline,
+                                        bool* clipped) const {
+        long timeout = timeoutMs > 0           ? timeoutMs
+                       : config_.timeoutMs > 0 ? config_.timeoutMs
+                                               : config_.timeoutSeconds * 1000L;
+        if (clipped) *clipped = false;
+        if (deadline) {
+            const long left = static_cast<long>(
+                std::chrono::ceil<std::chrono::milliseconds>(*deadline - RequestDeadline::Clock::now()).count());
+            if (left <= 0) throw PrefabException("Deadline exceeded");
+            if (timeout <= 0 || left < timeout) {  // 0 would mean no timeout at all
+                timeout = left;
+                if (clipped) *clipped = true;
+            }
+        }
+        return timeout;
+    }
+
+    void PrefabClient::recordAttempt(const std::string& method, const std::string& path, size_t bytesSent,
+                                     const TransferOutcome& outcome) const {
+        if (!metrics_ || outcome.code == CURLE_ABORTED_BY_CALLBACK) return;  // Not for cancellations and shutdown
+        MetricsRegistry::Sample sample;
+        sample.transportError = outcome.code != CURLE_OK;
+        sample.httpCode = outcome.httpCode;
+        sample.bytesSent = bytesSent;
+        sample.bytesReceived = outcome.response.size();
+        sample.total = outcome.total;
+        sample.dns = outcome.nameLookup;
+        sample.connect = connectTime(outcome);
+        sample.transfer = exchangeTime(outcome);
+        metrics_->record(method, path, sample);
+    }
+
+    PrefabClient::TransferOutcome PrefabClient::performTransfer(const std::string& method, const std::string& url,
+                                                                const std::string& body, long timeoutMs,
+                                                                const std::string& traceparent) const {
+        ConnectionPool::Lease lease = pool_->acquire();
+        CURL* curl = lease.get();
+
+        Transfer transfer;
+        transfer.url = url;
+        transfer.body = body;
+        transfer.traceparent = traceparent;
+        prepareTransfer(curl, transfer, method, timeoutMs);
+
+        TransferOutcome outcome;
+        outcome.code = curl_easy_perform(curl);
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &outcome.httpCode);
+        readTimings(curl, outcome);
+        outcome.serverTime = transfer.serverTime;
+        outcome.response = std::move(transfer.response);
+        return outcome;
+    }
+
+    std::string PrefabClient::makeHttpRequest(const std::string& method, const std::string& path, const std::string& body,
+                                              long timeoutMs) const {
+        if (hedge_ && method == "GET" && timeoutMs == 0) {
+            // Hedging needs both attempts in flight at once, so wait on the asynchronous path
+            auto promise = std::make_shared<std::promise<std::string>>();
+            std::future<std::string> future = promise->get_future();
+            requestAsync(method, path, body, [promise](std::string&& response, std::exception_ptr error) {
+                if (error) {
+                    promise->set_exception(error);
+                } else {
+                    promise->set_value(std::move(response));
+                }
+            });
+            return future.get();
+        }
+        const RequestPriority priority = priorityFor(method);
+        const std::optional<RequestDeadline::Clock::time_point> deadline = RequestDeadline::current();
+        const std::shared_ptr<RequestTrace> trace = traceRequest(tracer_, method, path);
+        auto attempt = [&](const std::string& url, long timeout) {
+            std::shared_ptr<ActiveSpan> span = trace ? trace->startAttempt(url) : nullptr;
+            TransferOutcome outcome =
+                performTransfer(method, url, body, timeout, span ? trace->traceparent(*span) : std::string());
+            if (span) trace->endAttempt(*span, outcome);
+            recordAttempt(method, path, body.size(), outcome);
+            return outcome;
+        };
+
+        try {
+            std::optional<TransferOutcome> last;
+
+            // Each attempt on a different endpoint, as long as the failure and the deadline allow another try
+            if (std::shared_ptr<EndpointSet> endpoints = upstream()->endpoints) {
+                const std::shared_ptr<EndpointPin> pin = EndpointPin::current();
+                std::vector<std::string> tried;
+                while (tried.size() < endpoints->maxAttempts()) {
+                    if (last && expired(deadline)) break;
+                    bool clipped = false;
+                    std::optional<EndpointSet::Lease> lease = endpoints->acquire(tried, pin ? pin->url() : "");
+                    if (!lease) break;
+                    long timeout = 0;
+                    try {
+                        if (scheduler_) awaitAdmission(priority, lease->url, path);
+                        timeout = attemptTimeoutMs(timeoutMs, deadline, &clipped);
+                    } catch (...) {
+                        endpoints->release(*lease, true, false);
+                        throw;
+                    }
+                    TransferOutcome outcome = attempt(lease->url + path, timeout);
+                    // A timeout cut short by the deadline is neither a failure nor a latency sample
+                    const bool cutShort = clipped && outcome.code == CURLE_OPERATION_TIMEDOUT;
+                    endpoints->release(*lease, !endpointFailed(outcome.code, outcome.httpCode, clipped),
+                                       timeoutMs == 0 && !cutShort);
+                    if (pin && !endpointFailed(outcome.code, outcome.httpCode, false)) pin->set(lease->url);
+                    tried.push_back(lease->url);
+                    const bool again = canFailOver(method, outcome.code, outcome.httpCode, clipped);
+                    last = std::move(outcome);
+                    if (!again) break;
+                }
+            }
+            if (!last) {
+                const std::string server = getBaseUrl();
+                if (scheduler_) awaitAdmission(priority, server, path);
+                last = attempt(server + path, attemptTimeoutMs(timeoutMs, deadline));
+            }
+
+            std::string response = checkTransfer(last->code, last->httpCode, std::move(last->response));
+            if (trace) trace->end("");
+            return response;
+        } catch (const std::exception& e) {
+            if (trace) trace->end(e.what());
+            throw;
+        }
+    }
+
+    void PrefabClient::transferAsync(const std::string& method, const std::string& url, const std::string& body,
+                                     long timeoutMs, std::function<void(TransferOutcome&&)> done,
+                                     std::shared_ptr<const std::atomic<bool>> cancelled,
+                                     const std::string& traceparent) const {
+        CURL* curl = nullptr;
+        auto transfer = std::make_shared<Transfer>();
+        try {
+            curl = pool_->acquire().detach();
+            transfer->url = url;
+            transfer->body = body;
+            transfer->cancelled = std::move(cancelled);
+            transfer->traceparent = traceparent;
+            prepareTransfer(curl, *transfer, method, timeoutMs);
+        } catch (...) {
+            pool_->release(curl);
+            throw;
+        }
+
+        ConnectionPool* pool = pool_.get();
+        reactor_->submit(curl, [pool, curl, transfer, done = std::move(done)](CURLcode res) {
+            TransferOutcome outcome;
+            outcome.code = res;
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &outcome.httpCode);
+            readTimings(curl, outcome);
+            outcome.serverTime = transfer->serverTime;
+            pool->release(curl);
+            outcome.response = std::move(transfer->response);
+            done(std::move(outcome));
+        });
+    }
+
+    void PrefabClient::awaitAdmission(RequestPriority priority, const std::string& server,
+                                      const std::string& path) const {
+        // The refusal crosses threads as a message, so the exception thrown here is this thread's own
+        // and is not released on the network thread while the caller still reads it
+        auto refusal = std::make_shared<std::promise<std::optional<std::string>>>();
+        std::future<std::optional<std::string>> future = refusal->get_future();
+        scheduler_->submit(priority, server, accessoryKey(path), RequestDeadline::current(),
+                           [refusal]() { refusal->set_value(std::nullopt); },
+                           [refusal](std::exception_ptr error) { refusal->set_value(errorMessage(error)); });
+        if (std::optional<std::string> message = future.get()) throw PrefabException(*message);
+    }
+
+    void PrefabClient::requestAsync(const std::string& method, const std::string& path, const std::string& body,
+                                    std::function<void(std::string&&, std::exception_ptr)> done,
+                                    long timeoutMs) const {
+        auto attempt = std::make_shared<AsyncAttempt>();
+        attempt->method = method;
+        attempt->path = path;
+        attempt->body = body;
+        attempt->timeoutMs = timeoutMs;
+        attempt->deadline = RequestDeadline::current();
+        attempt->priority = priorityFor(method);
+        attempt->endpoints = upstream()->endpoints;
+        attempt->trace = traceRequest(tracer_, method, path);
+        if (attempt->trace) {
+            done = [trace = attempt->trace, done = std::move(done)](std::string&& response, std::exception_ptr error) {
+                trace->end(error ? errorMessage(error) : std::string());
+                done(std::move(response), error);
+            };
+        }
+        attempt->pin = EndpointPin::current();
+        if (attempt->endpoints) {
+            attempt->lease = attempt->endpoints->acquire(attempt->tried, attempt->pin ? attempt->pin->url() : "");
+        }
+
+        if (!hedge_ || method != "GET" || timeoutMs != 0) {
+            attempt->done = std::move(done);
+            attemptAsync(std::move(attempt));
+            return;
+        }
+
+        auto race = std::make_shared<HedgeRace>();
+        race->path = path;
+        race->deadline = attempt->deadline;
+        race->priority = attempt->priority;
+        race->trace = attempt->trace;
+        if (attempt->lease) race->avoid = attempt->lease->url;
+        race->done = std::move(done);
+        race->running = 1;
+        attempt->cancelled = std::make_shared<std::atomic<bool>>(false);
+        race->attempts.push_back(attempt->cancelled);
+        HedgePolicy* policy = hedge_.get();
+        attempt->done = [race, policy](std::string&& response, std::exception_ptr error) {
+            race->finish(false, std::move(response), error, *policy);
+        };
+        // The hedge delay counts from when the first attempt is sent, not from any wait for admission
+        attempt->onSend = [this, race]() {
+            reactor_->schedule(hedge_->delay(), [this, race]() { hedgeAsync(race); });
+        };
+        attemptAsync(std::move(attempt));
+    }
+
+    // Second attempt of a GET that has not been answered within the hedge delay
+    void PrefabClient::hedgeAsync(std::shared_ptr<HedgeRace> race) const {
+        auto attempt = std::make_shared<AsyncAttempt>();
+        attempt->method = "GET";
+        attempt->path = race->path;
+        attempt->deadline = race->deadline;
+        attempt->priority = race->priority;
+        attempt->endpoints = upstream()->endpoints;
+        attempt->trace = race->trace;
+        attempt->cancelled = std::make_shared<std::atomic<bool>>(false);
+        {
+            std::lock_guard<std::mutex> lock(race->mutex);
+            if (race->settled) return;
+            race->running++;
+            race->attempts.push_back(attempt->cancelled);
+        }
+        hedge_->recordHedge();
+
+        HedgePolicy* policy = hedge_.get();
+        attempt->done = [race, policy](std::string&& response, std::exception_ptr error) {
+            race->finish(true, std::move(response), error, *policy);
+        };
+        if (attempt->endpoints) {
+            attempt->lease = attempt->endpoints->acquire({race->avoid});
+            if (!attempt->lease) attempt->lease = attempt->endpoints->acquire({});
+        }
+        attemptAsync(std::move(attempt));
+    }
+
+    // Every attempt, failovers and hedges included, takes its own tokens for the endpoint it goes to
+    void PrefabClient::attemptAsync(std::shared_ptr<AsyncAttempt> attempt) const {
+        if (!scheduler_) {
+            sendAttempt(std::move(attempt));
+            return;
+        }
+        try {
+            const std::string server = attempt->lease ? attempt->lease->url : getBaseUrl();
+            scheduler_->submit(attempt->priority, server, accessoryKey(attempt->path), attempt->deadline,
+                               [this, attempt]() { sendAttempt(attempt); },
+                               [attempt](std::exception_ptr error) { attempt->abandon(error); });
+        } catch (...) {
+            attempt->abandon(std::current_exception());
+        }
+    }
+
+    void PrefabClient::sendAttempt(std::shared_ptr<AsyncAttempt> attempt) const {
+        if (attempt->cancelled && attempt->cancelled->load()) {
+            // The race was settled while this attempt waited for admission
+            if (attempt->lease) attempt->endpoints->release(*attempt->lease, true, false);
+            return;
+        }
+        if (attempt->onSend) std::exchange(attempt->onSend, nullptr)();
+        try {
+            bool clipped = false;
+            const long timeout = attemptTimeoutMs(attempt->timeoutMs, attempt->deadline, &clipped);
+            const std::string url = (attempt->lease ? attempt->lease->url : getBaseUrl()) + attempt->path;
+            const auto started = std::chrono::steady_clock::now();
+            std::shared_ptr<ActiveSpan> span = attempt->trace ? attempt->trace->startAttempt(url) : nullptr;
+            const std::string traceparent = span ? attempt->trace->traceparent(*span) : std::string();
+            transferAsync(attempt->method, url, attempt->body, timeout,
+                          [this, attempt, started, span, clipped](TransferOutcome&& outcome) {
+                if (span) attempt->trace->endAttempt(*span, outcome);
+                if (attempt->cancelled && attempt->cancelled->load()) {
+                    // The other attempt won; this endpoint did nothing wrong
+                    if (attempt->lease) attempt->endpoints->release(*attempt->lease, true, false);
+                    return;
+                }
+                recordAttempt(attempt->method, attempt->path, attempt->body.size(), outcome);
+                if (hedge_ && attempt->method == "GET" && attempt->timeoutMs == 0 &&
+                    outcome.code == CURLE_OK && outcome.httpCode < 400) {
+                    hedge_->recordLatency(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - started));
+                }
+                if (attempt->lease) {
+                    EndpointSet& endpoints = *attempt->endpoints;
+                    const bool cutShort = clipped && outcome.code == CURLE_OPERATION_TIMEDOUT;
+                    endpoints.release(*attempt->lease, !endpointFailed(outcome.code, outcome.httpCode, clipped),
+                                      attempt->timeoutMs == 0 && !cutShort);
+                    if (attempt->pin && !endpointFailed(outcome.code, outcome.httpCode, false)) {
+                        attempt->pin->set(attempt->lease->url);
+                    }
+                    attempt->tried.push_back(attempt->lease->url);
+                    attempt->lease.reset();
+                    if (canFailOver(attempt->method, outcome.code, outcome.httpCode, clipped) &&
+                        !expired(attempt->deadline) &&
+                        attempt->tried.size() < endpoints.maxAttempts()) {
+                        attempt->lease = endpoints.acquire(attempt->tried);
+                        if (attempt->lease) return attemptAsync(attempt);
+                    }
+                }
+                finishRequest(attempt->done, outcome.code, outcome.httpCode, std::move(outcome.response));
+            }, attempt->cancelled, traceparent);
+        } catch (...) {
+            attempt->abandon(std::current_exception());
+        }
+    }
+
+    std::string PrefabClient::cachedGet(const std::string& path, int ttlMs) const {
+        if (!cache_ || ttlMs <= 0) {
+            return makeHttpRequest("GET", path);
+        }
+
+        if (ResponseCache::Body cached = cache_->get(path)) {
+            return *cached;
+        }
+
+        uint64_t generation = cache_->generation();
+        std::string response = makeHttpRequest("GET", path);
+        cache_->put(path, response, std::chrono::milliseconds(ttlMs), generation);
+        return response;
+    }
+
+    void PrefabClient::cachedGetAsync(const std::string& path, int ttlMs,
+                                      std::function<void(std::string&&, std::exception_ptr)> done) const {
+        if (!cache_ || ttlMs <= 0) {
+            requestAsync("GET", path, "", std::move(done));
+            return;
+        }
+
+        if (ResponseCache::Body cached = cache_->get(path)) {
+            done(std::string(*cached), nullptr);
+            return;
+        }
+
+        uint64_t generation = cache_->generation();
+        ResponseCache* cache = cache_.get();
+        requestAsync("GET", path, "", [cache, path, ttlMs, generation, done = std::move(done)](std::string&& response, std::exception_ptr error) {
+            if (!error) {
+                cache->put(path, response, std::chrono::milliseconds(ttlMs), generation);
+            }
+            done(std::move(response), error);
+        });
+    }
+
+    // A write may have been applied even if it reported an error (e.g. a timeout),
+    // so cached state is dropped after every write attempt, not only successful ones
+    void PrefabClient::invalidateAccessoryState(const std::string& homeName, const std::string& roomName,
+                                                const std::string& accessoryName) {
+        if (!cache_) return;
+        cache_->invalidate("/accessories/" + urlEncode(homeName) + "/" + urlEncode(roomName) + "/" + urlEncode(accessoryName));
+    }
+
+    void PrefabClient::invalidateHomeState(const std::string& homeName) {
+        if (!cache_) return;
+        // Groups and scenes can touch accessories in any room of the home
+        cache_->invalidatePrefix("/accessories/" + urlEncode(homeName) + "/");
+    }
+
+    void PrefabClient::invalidateCache() {
+        characteristics_->clear();
+        if (cache_) cache_->clear();
+    }
+
+    void PrefabClient::invalidateCache(const std::string& homeName) {
+        characteristics_->forgetHome(homeName);
+        if (!cache_) return;
+        std::string home = urlEncode(homeName);
+        cache_->invalidate("/homes");
+        for (const char* resource : {"/homes/", "/rooms/", "/accessories/", "/scenes/", "/groups/"}) {
+            cache_->invalidate(resource + home);
+            cache_->invalidatePrefix(resource + home + "/");
+        }
+    }
+
+    CacheStats PrefabClient::getCacheStats() const {
+        return cache_ ? cache_->stats() : CacheStats();
+    }
+
+    std::vector<EndpointStatus> PrefabClient::getEndpointStatus() const {
+        const std::shared_ptr<EndpointSet> endpoints = upstream()->endpoints;
+        return endpoints ? endpoints->status() : std::vector<EndpointStatus>();
+    }
+
+    HedgingStats PrefabClient::getHedgingStats() const {
+        return hedge_ ? hedge_->stats() : HedgingStats();
+    }
+
+    MetricsSnapshot PrefabClient::getMetrics() const {
+        MetricsSnapshot snapshot = metrics_ ? metrics_->snapshot() : MetricsSnapshot();
+        if (scheduler_) snapshot.queues = scheduler_->stats();
+        return snapshot;
+    }
+
+    void PrefabClient::flushTraces() const {
+        if (tracer_) tracer_->flush();
     }
 
     std::string PrefabClient::urlEncode(const std::string& value) const {
-        CURL* curl = curl_easy_init();
-        if (!curl) {
-            return value; // Fallback to unencoded value
-        }
-        
-        char* encoded = curl_easy_escape(curl, value.c_str(), value.length());
-        if (!encoded) {
-            curl_easy_cleanup(curl);
-            return value;
+        // Same escaping as curl_easy_escape (everything but RFC 3986 unreserved
+        // characters), without creating a curl handle per path segment
+        static const char hex[] = "0123456789ABCDEF";
+        std::string result;
+        result.reserve(value.size() * 3);
+        for (unsigned char c : value) {
+            if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                c == '-' || c == '.' || c == '_' || c == '~') {
+                result += static_cast<char>(c);
+            } else {
+                result += '%';
+                result += hex[c >> 4];
+                result += hex[c & 0x0F];
+            }
         }
-        
-        std::string result(encoded);
-        curl_free(encoded);
-        curl_easy_cleanup(curl);
-        
         return result;
     }
 
+    // Requests in flight keep the upstream they started with; discovery and load balancing stop
+    // once the last of them lets go
     void PrefabClient::setBaseUrl(const std::string& baseUrl) {
-        config_.baseUrl = baseUrl;
-        discoveredBaseUrl_ = baseUrl;
+        auto upstream = std::make_shared<Upstream>();
+        upstream->baseUrl = baseUrl;
+        upstream_->store(std::move(upstream));
     }
 
     std::string PrefabClient::getBaseUrl() const {
-        return discoveredBaseUrl_.empty() ? config_.baseUrl : discoveredBaseUrl_;
+        const std::shared_ptr<const Upstream> upstream = this->upstream();
+        if (upstream->endpoints) {
+            if (std::optional<std::string> best = upstream->endpoints->best()) return *best;
+        }
+        if (upstream->discovery) {
+            if (std::optional<std::string> discovered = upstream->discovery->baseUrl()) return *discovered;
+        }
+        return upstream->baseUrl;
     }
 
     bool PrefabClient::testConnection() {
@@ -136,89 +1099,80 @@ namespace prefab {
     }
 
     std::vector<Home> PrefabClient::getHomes() {
-        std::string response = makeHttpRequest("GET", "/homes");
+        std::string response = cachedGet("/homes", config_.cache.homesTtlMs);
         
-        try {
-            json j = json::parse(response);
-            return j.get<std::vector<Home>>();
-        } catch (const json::exception& e) {
-            throw PrefabException("Failed to parse homes response: " + std::string(e.what()));
-        }
+        return parseResponse<std::vector<Home>>(response, "homes");
     }
 
     Home PrefabClient::getHome(const std::string& homeName) {
         std::string path = "/homes/" + urlEncode(homeName);
-        std::string response = makeHttpRequest("GET", path);
+        std::string response = cachedGet(path, config_.cache.homesTtlMs);
         
-        try {
-            json j = json::parse(response);
-            return j.get<Home>();
-        } catch (const json::exception& e) {
-            throw PrefabException("Failed to parse home response: " + std::string(e.what()));
-        }
+        return parseResponse<Home>(response, "home");
     }
 
     std::vector<Room> PrefabClient::getRooms(const std::string& homeName) {
         std::string path = "/rooms/" + urlEncode(homeName);
-        std::string response = makeHttpRequest("GET", path);
+        std::string response = cachedGet(path, config_.cache.roomsTtlMs);
         
-        try {
-            json j = json::parse(response);
-            return j.get<std::vector<Room>>();
-        } catch (const json::exception& e) {
-            throw PrefabException("Failed to parse rooms response: " + std::string(e.what()));
-        }
+        return parseResponse<std::vector<Room>>(response, "rooms");
     }
 
     Room PrefabClient::getRoom(const std::string& homeName, const std::string& roomName) {
         std::string path = "/rooms/" + urlEncode(homeName) + "/" + urlEncode(roomName);
-        std::string response = makeHttpRequest("GET", path);
+        std::string response = cachedGet(path, config_.cache.roomsTtlMs);
         
-        try {
-            json j = json::parse(response);
-            return j.get<Room>();
-        } catch (const json::exception& e) {
-            throw PrefabException("Failed to parse room response: " + std::string(e.what()));
-        }
+        return parseResponse<Room>(response, "room");
     }
 
     std::vector<Accessory> PrefabClient::getAccessories(const std::string& homeName, const std::string& roomName) {
         std::string path = "/accessories/" + urlEncode(homeName) + "/" + urlEncode(roomName);
-        // Diagnostic log: show constructed path and source parameters so we can detect empty room names
-        try {
-            std::cerr << "PrefabClient: getAccessories called home=\"" << homeName
-                      << "\" room=\"" << roomName << "\" path=\"" << path << "\"" << std::endl;
-        } catch (...) {
-            // best-effort logging
-        }
-    
-        std::string response = makeHttpRequest("GET", path);
+        // Shows the constructed path next to its parameters, so empty room names stand out
+        PREFAB_LOG(LogLevel::Debug, "client", "getAccessories",
+                   {{"home", homeName}, {"room", roomName}, {"path", path}});
+
+        std::string response = cachedGet(path, config_.cache.accessoriesTtlMs);
         
-        try {
-            json j = json::parse(response);
-            return j.get<std::vector<Accessory>>();
-        } catch (const json::exception& e) {
-            throw PrefabException("Failed to parse accessories response: " + std::string(e.what()));
-        }
+        return parseResponse<std::vector<Accessory>>(response, "accessories");
     }
 
     Accessory PrefabClient::getAccessory(const std::string& homeName, const std::string& roomName, const std::string& accessoryName) {
         std::string path = "/accessories/" + urlEncode(homeName) + "/" + urlEncode(roomName) + "/" + urlEncode(accessoryName);
-        // Diagnostic log: show constructed path and parameters so callers can see when roomName is empty
-        try {
-            std::cerr << "PrefabClient: getAccessory called home=\"" << homeName
-                      << "\" room=\"" << roomName << "\" accessory=\"" << accessoryName
-                      << "\" path=\"" << path << "\"" << std::endl;
-        } catch (...) {}
+        PREFAB_LOG(LogLevel::Debug, "client", "getAccessory",
+                   {{"home", homeName}, {"room", roomName}, {"accessory", accessoryName}, {"path", path}});
 
-        std::string response = makeHttpRequest("GET", path);
+        std::string response = cachedGet(path, config_.cache.accessoryTtlMs);
         
-        try {
-            json j = json::parse(response);
-            return j.get<Accessory>();
-        } catch (const json::exception& e) {
-            throw PrefabException("Failed to parse accessory response: " + std::string(e.what()));
+        Accessory accessory = parseResponse<Accessory>(response, "accessory");
+        characteristics_->learn(homeName, roomName, accessoryName, accessory);
+        return accessory;
+    }
+
+    void PrefabClient::getAccessories(const std::string& homeName, const std::string& roomName,
+                                      AccessoryArena& arena) {
+        std::string path = "/accessories/" + urlEncode(homeName) + "/" + urlEncode(roomName);
+        std::string response = cachedGet(path, config_.cache.accessoriesTtlMs);
+
+        std::string error;
+        if (!parseAccessoryListJson(response, arena.accessories(), error)) {
+            throw PrefabException("Failed to parse accessories response: " + error);
+        }
+    }
+
+    const pmr::Accessory& PrefabClient::getAccessory(const std::string& homeName, const std::string& roomName,
+                                                     const std::string& accessoryName, AccessoryArena& arena) {
+        std::string path = "/accessories/" + urlEncode(homeName) + "/" + urlEncode(roomName) + "/" + urlEncode(accessoryName);
+        std::string response = cachedGet(path, config_.cache.accessoryTtlMs);
+
+        auto& accessories = arena.accessories();
+        pmr::Accessory& accessory = accessories.emplace_back();
+        std::string error;
+        if (!parseAccessoryJson(response, accessory, error)) {
+            accessories.pop_back();
+            throw PrefabException("Failed to parse accessory response: " + error);
         }
+        characteristics_->learn(homeName, roomName, accessoryName, accessory);
+        return accessory;
     }
 
     std::string PrefabClient::updateAccessory(const std::string& homeName,
@@ -226,16 +1180,17 @@ namespace prefab {
                                             const std::string& accessoryName,
                                             const UpdateAccessoryInput& update) {
         std::string path = "/accessories/" + urlEncode(homeName) + "/" + urlEncode(roomName) + "/" + urlEncode(accessoryName);
-        // Diagnostic log: update path and params
-        try {
-            std::cerr << "PrefabClient: updateAccessory called home=\"" << homeName
-                      << "\" room=\"" << roomName << "\" accessory=\"" << accessoryName
-                      << "\" path=\"" << path << "\"" << std::endl;
-        } catch (...) {}
+        PREFAB_LOG(LogLevel::Debug, "client", "updateAccessory",
+                   {{"home", homeName}, {"room", roomName}, {"accessory", accessoryName}, {"path", path}});
+
+        if (coalescer_) {
+            return updateAccessoryAsync(homeName, roomName, accessoryName, update).get();
+        }
         
         try {
             json j = update;
             std::string body = j.dump();
+            AfterWrite afterWrite{[&] { invalidateAccessoryState(homeName, roomName, accessoryName); }};
             return makeHttpRequest("PUT", path, body);
         } catch (const json::exception& e) {
             throw PrefabException("Failed to serialize update request: " + std::string(e.what()));
@@ -247,247 +1202,58 @@ namespace prefab {
                                                        const std::string& accessoryName,
                                                        const std::string& characteristicType,
                                                        const std::string& value) {
-        // First, get the accessory details to find the characteristic
-        Accessory accessory = getAccessory(homeName, roomName, accessoryName);
-        
-        if (!accessory.services.has_value()) {
-            throw PrefabException("Accessory has no services");
+        TraceSpan span(*this, "updateCharacteristicByType");
+        if (tracer_) {
+            span.setAttribute("prefab.home", homeName);
+            span.setAttribute("prefab.room", roomName);
+            span.setAttribute("prefab.accessory", accessoryName);
+            span.setAttribute("prefab.characteristic", characteristicType);
         }
-        
-        // Find the characteristic with the matching type (UUID or typeName) and get both service and characteristic IDs
-        std::string serviceId;
-        std::string characteristicId;
-        for (const auto& service : accessory.services.value()) {
-            for (const auto& characteristic : service.characteristics) {
-                // Match by UUID (type field) or by typeName
-                if (characteristic.type == characteristicType || 
-                    characteristic.typeName == characteristicType) {
-                    serviceId = service.uniqueIdentifier;
-                    characteristicId = characteristic.uniqueIdentifier;
-                    break;
+
+        try {
+            auto location = characteristics_->find(homeName, roomName, accessoryName, characteristicType);
+            if (location) {
+                try {
+                    return updateAccessory(homeName, roomName, accessoryName,
+                                           resolvedUpdate(*location, characteristicType, value));
+                } catch (const PrefabException& e) {
+                    if (!isStaleIdentifier(e)) throw;
+                    characteristics_->forget(homeName, roomName, accessoryName);
+                    span.setAttribute("prefab.stale_index", "true");
                 }
             }
-            if (!characteristicId.empty()) break;
-        }
-        
-        if (characteristicId.empty()) {
-            throw PrefabException("Characteristic type not found: " + characteristicType);
-        }
-        
-        // Create update request with both serviceId and characteristicId to match Swift server API
-        UpdateAccessoryInput update;
-        update.serviceId = serviceId;
-        update.characteristicId = characteristicId;
-        update.value = value;
-        
-        return updateAccessory(homeName, roomName, accessoryName, update);
-    }
 
-    // Avahi discovery implementation (always compiled)
-    struct AvahiDiscoveryData {
-        ServiceDiscoveryCallback callback;
-        bool foundService;
-        AvahiSimplePoll* simple_poll;
-        std::mutex mutex;
-        std::condition_variable cv;
-    };
+            // Get the accessory details to find the characteristic (this also refreshes the index)
+            Accessory accessory = getAccessory(homeName, roomName, accessoryName);
+            UpdateAccessoryInput update = buildCharacteristicUpdate(accessory, characteristicType, value);
 
-    static void resolve_callback(
-        AvahiServiceResolver *r,
-        [[maybe_unused]] AvahiIfIndex interface,
-        [[maybe_unused]] AvahiProtocol protocol,
-        AvahiResolverEvent event,
-        [[maybe_unused]] const char *name,
-        [[maybe_unused]] const char *type,
-        [[maybe_unused]] const char *domain,
-        [[maybe_unused]] const char *host_name,
-        const AvahiAddress *address,
-        uint16_t port,
-        [[maybe_unused]] AvahiStringList *txt,
-        [[maybe_unused]] AvahiLookupResultFlags flags,
-        void* userdata) {
-        
-        AvahiDiscoveryData* data = static_cast<AvahiDiscoveryData*>(userdata);
-        
-        switch (event) {
-            case AVAHI_RESOLVER_FAILURE:
-                break;
-                
-            case AVAHI_RESOLVER_FOUND: {
-                char addr_str[AVAHI_ADDRESS_STR_MAX];
-                avahi_address_snprint(addr_str, sizeof(addr_str), address);
-                
-                data->callback(std::string(addr_str), port);
-                {
-                    std::lock_guard<std::mutex> lk(data->mutex);
-                    data->foundService = true;
-                }
-                data->cv.notify_one();
-                // Stop polling after first service found
-                avahi_simple_poll_quit(data->simple_poll);
-                break;
-            }
-        }
-        
-        avahi_service_resolver_free(r);
-    }
-
-    static void browse_callback(
-        AvahiServiceBrowser *b,
-        AvahiIfIndex interface,
-        AvahiProtocol protocol,
-        AvahiBrowserEvent event,
-        const char *name,
-        const char *type,
-        const char *domain,
-        [[maybe_unused]] AvahiLookupResultFlags flags,
-        void* userdata) {
-        
-        AvahiDiscoveryData* data = static_cast<AvahiDiscoveryData*>(userdata);
-        AvahiClient* client = avahi_service_browser_get_client(b);
-        
-        switch (event) {
-            case AVAHI_BROWSER_FAILURE:
-                avahi_simple_poll_quit(data->simple_poll);
-                break;
-                
-            case AVAHI_BROWSER_NEW:
-                // Resolve the service
-                if (!(avahi_service_resolver_new(client, interface, protocol, name, type, domain, 
-                                               AVAHI_PROTO_UNSPEC, static_cast<AvahiLookupFlags>(0), 
-                                               resolve_callback, userdata))) {
-                    avahi_simple_poll_quit(data->simple_poll);
-                }
-                break;
-                
-            case AVAHI_BROWSER_REMOVE:
-            case AVAHI_BROWSER_ALL_FOR_NOW:
-            case AVAHI_BROWSER_CACHE_EXHAUSTED:
-                break;
+            return updateAccessory(homeName, roomName, accessoryName, update);
+        } catch (const std::exception& e) {
+            span.setError(e.what());
+            throw;
         }
     }
 
-    static void client_callback([[maybe_unused]] AvahiClient *c, AvahiClientState state, void *userdata) {
-        AvahiDiscoveryData* data = static_cast<AvahiDiscoveryData*>(userdata);
-        if (!data) return;
-        if (state == AVAHI_CLIENT_FAILURE) {
-            {
-                std::lock_guard<std::mutex> lk(data->mutex);
-                data->foundService = false;
-            }
-            data->cv.notify_one();
-            avahi_simple_poll_quit(data->simple_poll);
-        }
+    std::string PrefabClient::updateCharacteristicByType(const std::string& homeName,
+                                                       const std::string& roomName,
+                                                       const std::string& accessoryName,
+                                                       const std::string& characteristicType,
+                                                       const CharacteristicValue& value) {
+        return updateCharacteristicByType(homeName, roomName, accessoryName, characteristicType, value.toString());
     }
 
-    bool PrefabClient::discoverService() {
-        AvahiSimplePoll *simple_poll = avahi_simple_poll_new();
-        if (!simple_poll) return false;
-        
-        // Prepare discovery data BEFORE creating the Avahi client so the client callback
-        // can safely access the userdata pointer.
-        AvahiDiscoveryData data;
-        data.foundService = false;
-        data.simple_poll = simple_poll;
-        data.callback = [this](const std::string& hostname, int port) {
-            std::string url = "http://" + hostname + ":" + std::to_string(port);
-            this->discoveredBaseUrl_ = url;
-        };
-        
-        int error = 0;
-        AvahiClient *client = avahi_client_new(avahi_simple_poll_get(simple_poll),
-                                               static_cast<AvahiClientFlags>(0),
-                                               client_callback,
-                                               &data,
-                                               &error);
-        if (!client) {
-            avahi_simple_poll_free(simple_poll);
-            return false;
-        }
-        
-         AvahiServiceBrowser *sb = avahi_service_browser_new(client, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 
-                                                           "_prefab._tcp", nullptr, 
-                                                           static_cast<AvahiLookupFlags>(0), 
-                                                           browse_callback, &data);
-         if (!sb) {
-             avahi_client_free(client);
-             avahi_simple_poll_free(simple_poll);
-             return false;
-         }
-         
-         // Run the Avahi poll loop on a background thread and wait for a discovery
-         // event or timeout so this function returns instead of blocking forever.
-         std::thread poller([simple_poll]() {
-             avahi_simple_poll_loop(simple_poll);
-         });
-         
-         // Wait up to 5 seconds for discovery
-         {
-             std::unique_lock<std::mutex> lk(data.mutex);
-             data.cv.wait_for(lk, std::chrono::seconds(5), [&data]() { return data.foundService; });
-         }
-         
-         // Ensure the poll loop stops (resolve_callback may have already called quit)
-         avahi_simple_poll_quit(simple_poll);
-         if (poller.joinable()) poller.join();
-         
-         avahi_service_browser_free(sb);
-         avahi_client_free(client);
-         avahi_simple_poll_free(simple_poll);
-         
-         return data.foundService;
-     }
-
-     bool PrefabClient::discoverServices(ServiceDiscoveryCallback callback, [[maybe_unused]] int timeoutMs) {
-        AvahiSimplePoll *simple_poll = avahi_simple_poll_new();
-        if (!simple_poll) return false;
-        
-        AvahiDiscoveryData data;
-        data.foundService = false;
-        data.simple_poll = simple_poll;
-        data.callback = callback;
-        
-        int error = 0;
-        AvahiClient *client = avahi_client_new(avahi_simple_poll_get(simple_poll),
-                                               static_cast<AvahiClientFlags>(0),
-                                               client_callback,
-                                               &data,
-                                               &error);
-        if (!client) {
-            avahi_simple_poll_free(simple_poll);
-            return false;
-        }
-        
-        AvahiServiceBrowser *sb = avahi_service_browser_new(client, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC,
-                                                          "_prefab._tcp", nullptr,
-                                                          static_cast<AvahiLookupFlags>(0),
-                                                          browse_callback, &data);
-        if (!sb) {
-            avahi_client_free(client);
-            avahi_simple_poll_free(simple_poll);
-            return false;
-        }
-        
-        // Run poll loop on a background thread and wait for discovery or timeout
-        std::thread poller([simple_poll]() {
-            avahi_simple_poll_loop(simple_poll);
-        });
-        
-        int waitMs = (timeoutMs > 0) ? timeoutMs : 5000;
-        {
-            std::unique_lock<std::mutex> lk(data.mutex);
-            data.cv.wait_for(lk, std::chrono::milliseconds(waitMs), [&data]() { return data.foundService; });
-        }
-        
-        avahi_simple_poll_quit(simple_poll);
-        if (poller.joinable()) poller.join();
-        
-        avahi_service_browser_free(sb);
-        avahi_client_free(client);
-        avahi_simple_poll_free(simple_poll);
-        
-        return data.foundService;
-     }
+    // mDNS discovery through the shared background browser
+    bool PrefabClient::discoverServices(ServiceDiscoveryCallback callback, int timeoutMs) {
+        auto browser = ServiceBrowser::shared(browseType(config_.serviceName));
+        if (browser->running()) browser->waitForServer(std::chrono::milliseconds(std::max(timeoutMs, 0)));
+        std::vector<DiscoveredServer> servers = browser->servers();
+        for (const auto& server : servers) callback(server.address, server.port);
+        return !servers.empty();
+    }
+
+    std::vector<DiscoveredServer> PrefabClient::discoveredServers() const {
+        return ServiceBrowser::shared(browseType(config_.serviceName))->servers();
+    }
 
     // ========================================================================
     // Scene API methods
@@ -495,30 +1261,21 @@ namespace prefab {
 
     std::vector<HomeKitScene> PrefabClient::getScenes(const std::string& homeName) {
         std::string path = "/scenes/" + urlEncode(homeName);
-        std::string response = makeHttpRequest("GET", path);
+        std::string response = cachedGet(path, config_.cache.scenesTtlMs);
         
-        try {
-            json j = json::parse(response);
-            return j.get<std::vector<HomeKitScene>>();
-        } catch (const json::exception& e) {
-            throw PrefabException("Failed to parse scenes response: " + std::string(e.what()));
-        }
+        return parseResponse<std::vector<HomeKitScene>>(response, "scenes");
     }
 
     SceneDetail PrefabClient::getScene(const std::string& homeName, const std::string& sceneId) {
         std::string path = "/scenes/" + urlEncode(homeName) + "/" + urlEncode(sceneId);
-        std::string response = makeHttpRequest("GET", path);
+        std::string response = cachedGet(path, config_.cache.scenesTtlMs);
         
-        try {
-            json j = json::parse(response);
-            return j.get<SceneDetail>();
-        } catch (const json::exception& e) {
-            throw PrefabException("Failed to parse scene response: " + std::string(e.what()));
-        }
+        return parseResponse<SceneDetail>(response, "scene");
     }
 
     std::string PrefabClient::executeScene(const std::string& homeName, const std::string& sceneId) {
         std::string path = "/scenes/" + urlEncode(homeName) + "/" + urlEncode(sceneId) + "/execute";
+        AfterWrite afterWrite{[&] { invalidateHomeState(homeName); }};
         return makeHttpRequest("POST", path);
     }
 
@@ -528,26 +1285,16 @@ namespace prefab {
 
     std::vector<AccessoryGroup> PrefabClient::getGroups(const std::string& homeName) {
         std::string path = "/groups/" + urlEncode(homeName);
-        std::string response = makeHttpRequest("GET", path);
+        std::string response = cachedGet(path, config_.cache.groupsTtlMs);
         
-        try {
-            json j = json::parse(response);
-            return j.get<std::vector<AccessoryGroup>>();
-        } catch (const json::exception& e) {
-            throw PrefabException("Failed to parse groups response: " + std::string(e.what()));
-        }
+        return parseResponse<std::vector<AccessoryGroup>>(response, "groups");
     }
 
     AccessoryGroupDetail PrefabClient::getGroup(const std::string& homeName, const std::string& groupId) {
         std::string path = "/groups/" + urlEncode(homeName) + "/" + urlEncode(groupId);
-        std::string response = makeHttpRequest("GET", path);
+        std::string response = cachedGet(path, config_.cache.groupsTtlMs);
         
-        try {
-            json j = json::parse(response);
-            return j.get<AccessoryGroupDetail>();
-        } catch (const json::exception& e) {
-            throw PrefabException("Failed to parse group response: " + std::string(e.what()));
-        }
+        return parseResponse<AccessoryGroupDetail>(response, "group");
     }
 
     std::string PrefabClient::updateGroup(const std::string& homeName,
@@ -558,10 +1305,361 @@ namespace prefab {
         try {
             json j = update;
             std::string body = j.dump();
+            AfterWrite afterWrite{[&] { invalidateHomeState(homeName); }};
             return makeHttpRequest("PUT", path, body);
         } catch (const json::exception& e) {
             throw PrefabException("Failed to serialize group update request: " + std::string(e.what()));
         }
     }
 
-} // namespace prefab
\ No newline at end of file
+    // The request may stay open for waitSeconds before the server answers
+    static std::string changesPath(std::optional<uint64_t> since, int waitSeconds) {
+        std::string path = "/events";
+        if (since) {
+            path += "?since=" + std::to_string(*since) + "&wait=" + std::to_string(std::max(waitSeconds, 0));
+        }
+        return path;
+    }
+
+    ChangeBatch PrefabClient::getChanges(std::optional<uint64_t> since, int waitSeconds) {
+        const long timeout = attemptTimeoutMs(0, std::nullopt) + std::max(waitSeconds, 0) * 1000L;
+        std::string response = makeHttpRequest("GET", changesPath(since, waitSeconds), "", timeout);
+        return parseResponse<ChangeBatch>(response, "events");
+    }
+
+    // ========================================================================
+    // Asynchronous API
+    // ========================================================================
+
+    void PrefabClient::testConnectionAsync(AsyncCallback<bool> callback) {
+        requestAsync("GET", "/homes", "", [callback = std::move(callback)](std::string&&, std::exception_ptr error) {
+            callback(AsyncResult<bool>::success(!error));
+        });
+    }
+
+    std::future<bool> PrefabClient::testConnectionAsync() {
+        auto [callback, future] = futureCallback<bool>();
+        testConnectionAsync(std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::getHomesAsync(AsyncCallback<std::vector<Home>> callback) {
+        cachedGetAsync("/homes", config_.cache.homesTtlMs, parseThen("homes", std::move(callback)));
+    }
+
+    std::future<std::vector<Home>> PrefabClient::getHomesAsync() {
+        auto [callback, future] = futureCallback<std::vector<Home>>();
+        getHomesAsync(std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::getHomeAsync(const std::string& homeName, AsyncCallback<Home> callback) {
+        std::string path = "/homes/" + urlEncode(homeName);
+        cachedGetAsync(path, config_.cache.homesTtlMs, parseThen("home", std::move(callback)));
+    }
+
+    std::future<Home> PrefabClient::getHomeAsync(const std::string& homeName) {
+        auto [callback, future] = futureCallback<Home>();
+        getHomeAsync(homeName, std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::getRoomsAsync(const std::string& homeName, AsyncCallback<std::vector<Room>> callback) {
+        std::string path = "/rooms/" + urlEncode(homeName);
+        cachedGetAsync(path, config_.cache.roomsTtlMs, parseThen("rooms", std::move(callback)));
+    }
+
+    std::future<std::vector<Room>> PrefabClient::getRoomsAsync(const std::string& homeName) {
+        auto [callback, future] = futureCallback<std::vector<Room>>();
+        getRoomsAsync(homeName, std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::getRoomAsync(const std::string& homeName, const std::string& roomName,
+                                    AsyncCallback<Room> callback) {
+        std::string path = "/rooms/" + urlEncode(homeName) + "/" + urlEncode(roomName);
+        cachedGetAsync(path, config_.cache.roomsTtlMs, parseThen("room", std::move(callback)));
+    }
+
+    std::future<Room> PrefabClient::getRoomAsync(const std::string& homeName, const std::string& roomName) {
+        auto [callback, future] = futureCallback<Room>();
+        getRoomAsync(homeName, roomName, std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::getAccessoriesAsync(const std::string& homeName, const std::string& roomName,
+                                           AsyncCallback<std::vector<Accessory>> callback) {
+        std::string path = "/accessories/" + urlEncode(homeName) + "/" + urlEncode(roomName);
+        cachedGetAsync(path, config_.cache.accessoriesTtlMs, parseThen("accessories", std::move(callback)));
+    }
+
+    std::future<std::vector<Accessory>> PrefabClient::getAccessoriesAsync(const std::string& homeName,
+                                                                          const std::string& roomName) {
+        auto [callback, future] = futureCallback<std::vector<Accessory>>();
+        getAccessoriesAsync(homeName, roomName, std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::getAccessoryAsync(const std::string& homeName, const std::string& roomName,
+                                         const std::string& accessoryName, AsyncCallback<Accessory> callback) {
+        std::string path = "/accessories/" + urlEncode(homeName) + "/" + urlEncode(roomName) + "/" + urlEncode(accessoryName);
+        AsyncCallback<Accessory> learn = [this, homeName, roomName, accessoryName,
+                                          callback = std::move(callback)](AsyncResult<Accessory> result) {
+            if (result.ok()) {
+                characteristics_->learn(homeName, roomName, accessoryName, result.value());
+            }
+            callback(std::move(result));
+        };
+        cachedGetAsync(path, config_.cache.accessoryTtlMs, parseThen("accessory", std::move(learn)));
+    }
+
+    std::future<Accessory> PrefabClient::getAccessoryAsync(const std::string& homeName, const std::string& roomName,
+                                                           const std::string& accessoryName) {
+        auto [callback, future] = futureCallback<Accessory>();
+        getAccessoryAsync(homeName, roomName, accessoryName, std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::updateAccessoryAsync(const std::string& homeName, const std::string& roomName,
+                                            const std::string& accessoryName, const UpdateAccessoryInput& update,
+                                            AsyncCallback<std::string> callback) {
+        if (coalescer_) {
+            coalescer_->submit(WriteCoalescer::Target{homeName, roomName, accessoryName}, update, std::move(callback));
+            return;
+        }
+        sendAccessoryUpdateAsync(homeName, roomName, accessoryName, update, std::move(callback));
+    }
+
+    void PrefabClient::sendAccessoryUpdateAsync(const std::string& homeName, const std::string& roomName,
+                                                const std::string& accessoryName, const UpdateAccessoryInput& update,
+                                                AsyncCallback<std::string> callback) {
+        std::string path = "/accessories/" + urlEncode(homeName) + "/" + urlEncode(roomName) + "/" + urlEncode(accessoryName);
+        std::string body;
+        try {
+            json j = update;
+            body = j.dump();
+        } catch (const json::exception& e) {
+            callback(AsyncResult<std::string>::failure(std::make_exception_ptr(
+                PrefabException("Failed to serialize update request: " + std::string(e.what())))));
+            return;
+        }
+        requestAsync("PUT", path, body, [this, homeName, roomName, accessoryName, callback = std::move(callback)](
+                                            std::string&& response, std::exception_ptr error) {
+            invalidateAccessoryState(homeName, roomName, accessoryName);
+            callback(error ? AsyncResult<std::string>::failure(error)
+                           : AsyncResult<std::string>::success(std::move(response)));
+        });
+    }
+
+    std::future<std::string> PrefabClient::updateAccessoryAsync(const std::string& homeName, const std::string& roomName,
+                                                                const std::string& accessoryName,
+                                                                const UpdateAccessoryInput& update) {
+        auto [callback, future] = futureCallback<std::string>();
+        updateAccessoryAsync(homeName, roomName, accessoryName, update, std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::updateCharacteristicByTypeAsync(const std::string& homeName, const std::string& roomName,
+                                                       const std::string& accessoryName,
+                                                       const std::string& characteristicType,
+                                                       const std::string& value,
+                                                       AsyncCallback<std::string> callback) {
+        // The span stays current while the first request is issued; continuations carry it over
+        std::optional<SpanContextScope> scope;
+        if (tracer_) {
+            std::shared_ptr<ActiveSpan> span =
+                tracer_->startSpan("updateCharacteristicByType", SpanKind::Internal, currentSpanContext());
+            span->setAttribute("prefab.home", homeName);
+            span->setAttribute("prefab.room", roomName);
+            span->setAttribute("prefab.accessory", accessoryName);
+            span->setAttribute("prefab.characteristic", characteristicType);
+            scope.emplace(span->context());
+            callback = [span, callback = std::move(callback)](AsyncResult<std::string> result) {
+                span->end(result.ok() ? std::string() : errorMessage(result.error()));
+                callback(std::move(result));
+            };
+        }
+
+        auto location = characteristics_->find(homeName, roomName, accessoryName, characteristicType);
+        if (location) {
+            UpdateAccessoryInput update;
+            try {
+                update = resolvedUpdate(*location, characteristicType, value);
+            } catch (...) {
+                callback(AsyncResult<std::string>::failure(std::current_exception()));
+                return;
+            }
+            updateAccessoryAsync(homeName, roomName, accessoryName, update,
+                [this, homeName, roomName, accessoryName, characteristicType, value, caller = CallerContext(),
+                 callback = std::move(callback)](AsyncResult<std::string> result) mutable {
+                    if (!result.ok()) {
+                        try {
+                            std::rethrow_exception(result.error());
+                        } catch (const PrefabException& e) {
+                            if (isStaleIdentifier(e)) {
+                                CallerScope scope(caller);
+                                characteristics_->forget(homeName, roomName, accessoryName);
+                                resolveAndUpdateAsync(homeName, roomName, accessoryName, characteristicType, value,
+                                                      std::move(callback));
+                                return;
+                            }
+                        } catch (...) {}
+                    }
+                    callback(std::move(result));
+                });
+            return;
+        }
+
+        resolveAndUpdateAsync(homeName, roomName, accessoryName, characteristicType, value, std::move(callback));
+    }
+
+    void PrefabClient::resolveAndUpdateAsync(const std::string& homeName, const std::string& roomName,
+                                             const std::string& accessoryName,
+                                             const std::string& characteristicType,
+                                             const std::string& value,
+                                             AsyncCallback<std::string> callback) {
+        getAccessoryAsync(homeName, roomName, accessoryName,
+            [this, homeName, roomName, accessoryName, characteristicType, value, caller = CallerContext(),
+             callback = std::move(callback)](AsyncResult<Accessory> result) {
+                CallerScope scope(caller);
+                UpdateAccessoryInput update;
+                try {
+                    update = buildCharacteristicUpdate(result.value(), characteristicType, value);
+                } catch (...) {
+                    callback(AsyncResult<std::string>::failure(std::current_exception()));
+                    return;
+                }
+                updateAccessoryAsync(homeName, roomName, accessoryName, update, std::move(callback));
+            });
+    }
+
+    std::future<std::string> PrefabClient::updateCharacteristicByTypeAsync(const std::string& homeName,
+                                                                           const std::string& roomName,
+                                                                           const std::string& accessoryName,
+                                                                           const std::string& characteristicType,
+                                                                           const std::string& value) {
+        auto [callback, future] = futureCallback<std::string>();
+        updateCharacteristicByTypeAsync(homeName, roomName, accessoryName, characteristicType, value,
+                                        std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::updateCharacteristicByTypeAsync(const std::string& homeName, const std::string& roomName,
+                                                       const std::string& accessoryName,
+                                                       const std::string& characteristicType,
+                                                       const CharacteristicValue& value,
+                                                       AsyncCallback<std::string> callback) {
+        updateCharacteristicByTypeAsync(homeName, roomName, accessoryName, characteristicType, value.toString(),
+                                        std::move(callback));
+    }
+
+    std::future<std::string> PrefabClient::updateCharacteristicByTypeAsync(const std::string& homeName,
+                                                                           const std::string& roomName,
+                                                                           const std::string& accessoryName,
+                                                                           const std::string& characteristicType,
+                                                                           const CharacteristicValue& value) {
+        return updateCharacteristicByTypeAsync(homeName, roomName, accessoryName, characteristicType,
+                                               value.toString());
+    }
+
+    void PrefabClient::getScenesAsync(const std::string& homeName, AsyncCallback<std::vector<HomeKitScene>> callback) {
+        std::string path = "/scenes/" + urlEncode(homeName);
+        cachedGetAsync(path, config_.cache.scenesTtlMs, parseThen("scenes", std::move(callback)));
+    }
+
+    std::future<std::vector<HomeKitScene>> PrefabClient::getScenesAsync(const std::string& homeName) {
+        auto [callback, future] = futureCallback<std::vector<HomeKitScene>>();
+        getScenesAsync(homeName, std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::getSceneAsync(const std::string& homeName, const std::string& sceneId,
+                                     AsyncCallback<SceneDetail> callback) {
+        std::string path = "/scenes/" + urlEncode(homeName) + "/" + urlEncode(sceneId);
+        cachedGetAsync(path, config_.cache.scenesTtlMs, parseThen("scene", std::move(callback)));
+    }
+
+    std::future<SceneDetail> PrefabClient::getSceneAsync(const std::string& homeName, const std::string& sceneId) {
+        auto [callback, future] = futureCallback<SceneDetail>();
+        getSceneAsync(homeName, sceneId, std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::executeSceneAsync(const std::string& homeName, const std::string& sceneId,
+                                         AsyncCallback<std::string> callback) {
+        std::string path = "/scenes/" + urlEncode(homeName) + "/" + urlEncode(sceneId) + "/execute";
+        requestAsync("POST", path, "", [this, homeName, callback = std::move(callback)](std::string&& response, std::exception_ptr error) {
+            invalidateHomeState(homeName);
+            callback(error ? AsyncResult<std::string>::failure(error)
+                           : AsyncResult<std::string>::success(std::move(response)));
+        });
+    }
+
+    std::future<std::string> PrefabClient::executeSceneAsync(const std::string& homeName, const std::string& sceneId) {
+        auto [callback, future] = futureCallback<std::string>();
+        executeSceneAsync(homeName, sceneId, std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::getGroupsAsync(const std::string& homeName, AsyncCallback<std::vector<AccessoryGroup>> callback) {
+        std::string path = "/groups/" + urlEncode(homeName);
+        cachedGetAsync(path, config_.cache.groupsTtlMs, parseThen("groups", std::move(callback)));
+    }
+
+    std::future<std::vector<AccessoryGroup>> PrefabClient::getGroupsAsync(const std::string& homeName) {
+        auto [callback, future] = futureCallback<std::vector<AccessoryGroup>>();
+        getGroupsAsync(homeName, std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::getGroupAsync(const std::string& homeName, const std::string& groupId,
+                                     AsyncCallback<AccessoryGroupDetail> callback) {
+        std::string path = "/groups/" + urlEncode(homeName) + "/" + urlEncode(groupId);
+        cachedGetAsync(path, config_.cache.groupsTtlMs, parseThen("group", std::move(callback)));
+    }
+
+    std::future<AccessoryGroupDetail> PrefabClient::getGroupAsync(const std::string& homeName, const std::string& groupId) {
+        auto [callback, future] = futureCallback<AccessoryGroupDetail>();
+        getGroupAsync(homeName, groupId, std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::updateGroupAsync(const std::string& homeName, const std::string& groupId,
+                                        const UpdateGroupInput& update, AsyncCallback<std::string> callback) {
+        std::string path = "/groups/" + urlEncode(homeName) + "/" + urlEncode(groupId);
+        std::string body;
+        try {
+            json j = update;
+            body = j.dump();
+        } catch (const json::exception& e) {
+            callback(AsyncResult<std::string>::failure(std::make_exception_ptr(
+                PrefabException("Failed to serialize group update request: " + std::string(e.what())))));
+            return;
+        }
+        requestAsync("PUT", path, body, [this, homeName, callback = std::move(callback)](std::string&& response, std::exception_ptr error) {
+            invalidateHomeState(homeName);
+            callback(error ? AsyncResult<std::string>::failure(error)
+                           : AsyncResult<std::string>::success(std::move(response)));
+        });
+    }
+
+    std::future<std::string> PrefabClient::updateGroupAsync(const std::string& homeName, const std::string& groupId,
+                                                            const UpdateGroupInput& update) {
+        auto [callback, future] = futureCallback<std::string>();
+        updateGroupAsync(homeName, groupId, update, std::move(callback));
+        return std::move(future);
+    }
+
+    void PrefabClient::getChangesAsync(std::optional<uint64_t> since, int waitSeconds,
+                                       AsyncCallback<ChangeBatch> callback) {
+        const long timeout = attemptTimeoutMs(0, std::nullopt) + std::max(waitSeconds, 0) * 1000L;
+        requestAsync("GET", changesPath(since, waitSeconds), "", parseThen("events", std::move(callback)), timeout);
+    }
+
+    std::future<ChangeBatch> PrefabClient::getChangesAsync(std::optional<uint64_t> since, int waitSeconds) {
+        auto [callback, future] = futureCallback<ChangeBatch>();
+        getChangesAsync(since, waitSeconds, std::move(callback));
+        return std::move(future);
+    }
+
+} // namespace prefab
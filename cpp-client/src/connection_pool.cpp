@@ -0,0 +1,124 @@
+#include "connection_pool.h"
+#include "prefab/client.h"
+
+namespace prefab {
+
+    void initCurlOnce() {
+        static std::once_flag once;
+        std::call_once(once, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+    }
+
+    ConnectionPool::ConnectionPool(size_t maxIdle, std::chrono::seconds idleTimeout, bool keepAlive)
+        : maxIdle_(maxIdle), idleTimeout_(idleTimeout), keepAlive_(keepAlive) {
+        initCurlOnce();
+        share_ = curl_share_init();
+        if (share_) {
+            curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, lockShare);
+            curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, unlockShare);
+            curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        }
+    }
+
+    ConnectionPool::~ConnectionPool() {
+        for (auto& idle : idle_) {
+            curl_easy_cleanup(idle.handle);
+        }
+        idle_.clear();
+        if (share_) {
+            curl_share_cleanup(share_);
+        }
+    }
+
+    void ConnectionPool::lockShare([[maybe_unused]] CURL* handle, curl_lock_data data,
+                                   [[maybe_unused]] curl_lock_access access, void* userptr) {
+        static_cast<ConnectionPool*>(userptr)->shareLocks_[data].lock();
+    }
+
+    void ConnectionPool::unlockShare([[maybe_unused]] CURL* handle, curl_lock_data data, void* userptr) {
+        static_cast<ConnectionPool*>(userptr)->shareLocks_[data].unlock();
+    }
+
+    void ConnectionPool::applyDefaults(CURL* handle) const {
+        if (share_) {
+            curl_easy_setopt(handle, CURLOPT_SHARE, share_);
+        }
+        if (keepAlive_) {
+            curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+            curl_easy_setopt(handle, CURLOPT_TCP_KEEPIDLE, 30L);
+            curl_easy_setopt(handle, CURLOPT_TCP_KEEPINTVL, 15L);
+        } else {
+            curl_easy_setopt(handle, CURLOPT_FORBID_REUSE, 1L);
+        }
+        // Never reuse a cached connection that sat idle past the eviction window
+        curl_easy_setopt(handle, CURLOPT_MAXAGE_CONN, static_cast<long>(idleTimeout_.count()));
+        curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    }
+
+    ConnectionPool::Lease ConnectionPool::acquire() {
+        CURL* handle = nullptr;
+        std::vector<CURL*> expired;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            expired = takeExpiredLocked(std::chrono::steady_clock::now());
+            if (!idle_.empty()) {
+                handle = idle_.back().handle;
+                idle_.pop_back();
+            }
+        }
+        for (CURL* stale : expired) curl_easy_cleanup(stale);
+
+        if (!handle) {
+            handle = curl_easy_init();
+            if (!handle) {
+                throw PrefabException("Failed to initialize CURL");
+            }
+        }
+
+        applyDefaults(handle);
+        return Lease(this, handle);
+    }
+
+    void ConnectionPool::release(CURL* handle) {
+        if (!handle) return;
+
+        // Drop per-request options; the handle keeps its open connections for the next lease
+        curl_easy_reset(handle);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (idle_.size() < maxIdle_) {
+                idle_.push_back({handle, std::chrono::steady_clock::now()});
+                return;
+            }
+        }
+        curl_easy_cleanup(handle);  // Closes its connections, so not under the lock
+    }
+
+    void ConnectionPool::evictIdle() {
+        std::vector<CURL*> expired;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            expired = takeExpiredLocked(std::chrono::steady_clock::now());
+        }
+        for (CURL* handle : expired) curl_easy_cleanup(handle);
+    }
+
+    std::vector<CURL*> ConnectionPool::takeExpiredLocked(std::chrono::steady_clock::time_point now) {
+        std::vector<CURL*> expired;
+        while (expired.size() < idle_.size() && now - idle_[expired.size()].since > idleTimeout_) {
+            expired.push_back(idle_[expired.size()].handle);
+        }
+        if (!expired.empty()) {
+            idle_.erase(idle_.begin(), idle_.begin() + expired.size());
+        }
+        return expired;
+    }
+
+    size_t ConnectionPool::idleCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return idle_.size();
+    }
+
+} // namespace prefab
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace prefab {
+
+    /**
+     * @brief curl_global_init, once per process; safe to call from any thread
+     *
+     * curl_global_init and curl_global_cleanup are not thread-safe, so the
+     * library initializes once and leaves cleanup to process exit.
+     */
+    void initCurlOnce();
+
+    /**
+     * @brief Pool of reusable curl easy handles sharing DNS and TLS session caches
+     *
+     * All handles handed out by the pool are attached to a single CURLSH object
+     * that shares the DNS and TLS session caches. Connections are not shared:
+     * libcurl does not support one connection cache used by handles running on
+     * different threads at once, as the reactor's and the callers' do. Each
+     * handle keeps its own keep-alive connections between requests instead.
+     * Released handles are kept for reuse (up to the configured pool size) and
+     * evicted once they have been idle for longer than the idle timeout.
+     *
+     * The pool is safe to use from multiple threads.
+     */
+    class ConnectionPool {
+    public:
+        /**
+         * @brief RAII lease on a pooled handle; returns it to the pool on destruction
+         */
+        class Lease {
+        public:
+            Lease(ConnectionPool* pool, CURL* handle) : pool_(pool), handle_(handle) {}
+            Lease(Lease&& other) noexcept : pool_(other.pool_), handle_(other.handle_) {
+                other.handle_ = nullptr;
+            }
+            Lease(const Lease&) = delete;
+            Lease& operator=(const Lease&) = delete;
+            Lease& operator=(Lease&&) = delete;
+            ~Lease() {
+                if (handle_) pool_->release(handle_);
+            }
+
+            CURL* get() const { return handle_; }
+
+            /**
+             * @brief Take ownership of the handle; the caller must hand it back via release()
+             */
+            CURL* detach() {
+                CURL* handle = handle_;
+                handle_ = nullptr;
+                return handle;
+            }
+
+        private:
+            ConnectionPool* pool_;
+            CURL* handle_;
+        };
+
+        /**
+         * @param maxIdle Maximum number of idle handles kept for reuse
+         * @param idleTimeout Idle handles and cached connections older than this are dropped
+         * @param keepAlive Enable TCP keep-alive probes on pooled connections
+         */
+        ConnectionPool(size_t maxIdle, std::chrono::seconds idleTimeout, bool keepAlive);
+        ~ConnectionPool();
+
+        ConnectionPool(const ConnectionPool&) = delete;
+        ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+        /**
+         * @brief Get a handle with the pool defaults applied
+         *
+         * @throws PrefabException if a new handle cannot be created
+         */
+        Lease acquire();
+
+        /**
+         * @brief Return a handle to the pool
+         *
+         * The handle's options are reset; its open connections stay with it.
+         */
+        void release(CURL* handle);
+
+        /**
+         * @brief Drop idle handles that exceeded the idle timeout
+         */
+        void evictIdle();
+
+        /**
+         * @brief Number of handles currently idle in the pool
+         */
+        size_t idleCount() const;
+
+    private:
+        struct IdleHandle {
+            CURL* handle;
+            std::chrono::steady_clock::time_point since;
+        };
+
+        void applyDefaults(CURL* handle) const;
+        // Removes the handles idle past the timeout; the caller cleans them up once unlocked
+        std::vector<CURL*> takeExpiredLocked(std::chrono::steady_clock::time_point now);
+
+        static void lockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+        static void unlockShare(CURL* handle, curl_lock_data data, void* userptr);
+
+        size_t maxIdle_;
+        std::chrono::seconds idleTimeout_;
+        bool keepAlive_;
+
+        CURLSH* share_ = nullptr;
+        std::mutex shareLocks_[CURL_LOCK_DATA_LAST];
+
+        mutable std::mutex mutex_;
+        // Ordered oldest first; reuse takes from the back so warm handles are preferred
+        std::vector<IdleHandle> idle_;
+    };
+
+} // namespace prefab
@@ -0,0 +1,341 @@
+#include "prefab/discovery.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <tuple>
+
+#include <avahi-client/client.h>
+#include <avahi-client/lookup.h>
+#include <avahi-common/thread-watch.h>
+#include <avahi-common/malloc.h>
+#include <avahi-common/error.h>
+
+namespace prefab {
+
+    std::string DiscoveredServer::url() const {
+        const std::string host = ipv6 ? "[" + address + "]" : address;
+        return "http://" + host + ":" + std::to_string(port);
+    }
+
+    /**
+     * @brief Avahi objects and the registry
+     *
+     * The Avahi client, browser and resolvers are created and freed on the
+     * threaded poll's thread (from its callbacks), or by start()/stop() while
+     * that thread is locked out or stopped. mutex_ guards the registry and the
+     * listeners, which other threads read.
+     */
+    class ServiceBrowser::Impl {
+    public:
+        explicit Impl(std::string serviceType) : serviceType_(std::move(serviceType)) {}
+
+        ~Impl() { stop(); }
+
+        bool start() {
+            std::lock_guard<std::mutex> control(controlMutex_);
+            if (poll_) return true;
+
+            poll_ = avahi_threaded_poll_new();
+            if (!poll_) return false;
+            // NO_FAIL: wait for a daemon that is not running yet, and reconnect when it restarts
+            int error = 0;
+            client_ = avahi_client_new(avahi_threaded_poll_get(poll_), AVAHI_CLIENT_NO_FAIL,
+                                       clientCallback, this, &error);
+            if (!client_ || avahi_threaded_poll_start(poll_) < 0) {
+                if (client_) avahi_client_free(client_);
+                client_ = nullptr;
+                avahi_threaded_poll_free(poll_);
+                poll_ = nullptr;
+                return false;
+            }
+            return true;
+        }
+
+        void stop() {
+            std::lock_guard<std::mutex> control(controlMutex_);
+            if (!poll_) return;
+            avahi_threaded_poll_stop(poll_);
+            forget();
+            avahi_client_free(client_);
+            client_ = nullptr;
+            avahi_threaded_poll_free(poll_);
+            poll_ = nullptr;
+        }
+
+        bool running() const {
+            std::lock_guard<std::mutex> control(controlMutex_);
+            return poll_ != nullptr;
+        }
+
+        std::vector<DiscoveredServer> servers() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return serversLocked();
+        }
+
+        std::optional<DiscoveredServer> preferred() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return preferredLocked();
+        }
+
+        std::optional<DiscoveredServer> waitForServer(std::chrono::milliseconds timeout) const {
+            std::unique_lock<std::mutex> lock(mutex_);
+            resolvedChanged_.wait_for(lock, timeout, [this] { return resolvedCount_ > 0; });
+            return preferredLocked();
+        }
+
+        size_t subscribe(Listener listener) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const size_t id = nextListenerId_++;
+            listeners_.emplace(id, std::move(listener));
+            return id;
+        }
+
+        void unsubscribe(size_t id) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            listeners_.erase(id);
+        }
+
+    private:
+        // Interface, protocol, name and domain identify an instance; the type is fixed
+        using Key = std::tuple<AvahiIfIndex, AvahiProtocol, std::string, std::string>;
+
+        struct Instance;
+
+        struct ResolverContext {
+            Impl* impl;
+            Key key;
+        };
+
+        struct Instance {
+            AvahiServiceResolver* resolver = nullptr;  // Kept open to follow address changes
+            std::unique_ptr<ResolverContext> context;
+            std::optional<DiscoveredServer> server;
+            uint64_t order = 0;                         // Order of first resolution
+        };
+
+        std::vector<DiscoveredServer> serversLocked() const {
+            std::vector<const Instance*> resolved;
+            for (const auto& [key, instance] : instances_) {
+                if (instance.server) resolved.push_back(&instance);
+            }
+            std::sort(resolved.begin(), resolved.end(),
+                      [](const Instance* a, const Instance* b) { return a->order < b->order; });
+            std::vector<DiscoveredServer> servers;
+            servers.reserve(resolved.size());
+            for (const Instance* instance : resolved) servers.push_back(*instance->server);
+            return servers;
+        }
+
+        std::optional<DiscoveredServer> preferredLocked() const {
+            std::vector<DiscoveredServer> found = serversLocked();
+            if (found.empty()) return std::nullopt;
+            auto ipv4 = std::find_if(found.begin(), found.end(), [](const auto& server) { return !server.ipv6; });
+            return ipv4 != found.end() ? *ipv4 : found.front();
+        }
+
+        void notify(DiscoveryEvent event, const DiscoveredServer& server) {
+            std::vector<Listener> listeners;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (const auto& [id, listener] : listeners_) listeners.push_back(listener);
+            }
+            for (const auto& listener : listeners) listener(event, server);
+        }
+
+        // Free the browser and every resolver and empty the registry; Avahi thread or stopped poll
+        void forget() {
+            if (browser_) avahi_service_browser_free(browser_);
+            browser_ = nullptr;
+
+            std::vector<DiscoveredServer> removed;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (auto& [key, instance] : instances_) {
+                    if (instance.resolver) avahi_service_resolver_free(instance.resolver);
+                    if (instance.server) removed.push_back(std::move(*instance.server));
+                }
+                instances_.clear();
+                resolvedCount_ = 0;
+            }
+            for (const auto& server : removed) notify(DiscoveryEvent::Removed, server);
+        }
+
+        static void clientCallback(AvahiClient* client, AvahiClientState state, void* userdata) {
+            Impl* impl = static_cast<Impl*>(userdata);
+            switch (state) {
+                case AVAHI_CLIENT_S_RUNNING:
+                    if (!impl->browser_) {
+                        // Called from inside avahi_client_new before client_ is set, so use the argument
+                        impl->browser_ = avahi_service_browser_new(client, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC,
+                                                                   impl->serviceType_.c_str(), nullptr,
+                                                                   static_cast<AvahiLookupFlags>(0),
+                                                                   browseCallback, impl);
+                    }
+                    break;
+                case AVAHI_CLIENT_CONNECTING:
+                case AVAHI_CLIENT_FAILURE:
+                    // The daemon went away; with NO_FAIL the client reconnects and reports RUNNING again
+                    impl->forget();
+                    break;
+                case AVAHI_CLIENT_S_REGISTERING:
+                case AVAHI_CLIENT_S_COLLISION:
+                    break;
+            }
+        }
+
+        static void browseCallback(AvahiServiceBrowser* browser, AvahiIfIndex interface, AvahiProtocol protocol,
+                                   AvahiBrowserEvent event, const char* name, const char* type, const char* domain,
+                                   [[maybe_unused]] AvahiLookupResultFlags flags, void* userdata) {
+            Impl* impl = static_cast<Impl*>(userdata);
+            switch (event) {
+                case AVAHI_BROWSER_NEW: {
+                    Key key{interface, protocol, name, domain};
+                    std::lock_guard<std::mutex> lock(impl->mutex_);
+                    Instance& instance = impl->instances_[key];
+                    if (instance.resolver) break;
+                    instance.context = std::make_unique<ResolverContext>(ResolverContext{impl, key});
+                    instance.resolver = avahi_service_resolver_new(
+                        avahi_service_browser_get_client(browser), interface, protocol, name, type, domain,
+                        AVAHI_PROTO_UNSPEC, static_cast<AvahiLookupFlags>(0), resolveCallback, instance.context.get());
+                    if (!instance.resolver) impl->instances_.erase(key);
+                    break;
+                }
+                case AVAHI_BROWSER_REMOVE: {
+                    std::optional<DiscoveredServer> removed;
+                    {
+                        std::lock_guard<std::mutex> lock(impl->mutex_);
+                        auto found = impl->instances_.find(Key{interface, protocol, name, domain});
+                        if (found == impl->instances_.end()) break;
+                        if (found->second.resolver) avahi_service_resolver_free(found->second.resolver);
+                        if (found->second.server) {
+                            removed = std::move(found->second.server);
+                            impl->resolvedCount_--;
+                        }
+                        impl->instances_.erase(found);
+                    }
+                    if (removed) impl->notify(DiscoveryEvent::Removed, *removed);
+                    break;
+                }
+                case AVAHI_BROWSER_FAILURE:
+                    impl->forget();
+                    break;
+                case AVAHI_BROWSER_ALL_FOR_NOW:
+                case AVAHI_BROWSER_CACHE_EXHAUSTED:
+                    break;
+            }
+        }
+
+        static void resolveCallback([[maybe_unused]] AvahiServiceResolver* resolver,
+                                    AvahiIfIndex interface, [[maybe_unused]] AvahiProtocol protocol,
+                                    AvahiResolverEvent event, const char* name,
+                                    [[maybe_unused]] const char* type, [[maybe_unused]] const char* domain,
+                                    const char* hostName, const AvahiAddress* address, uint16_t port,
+                                    AvahiStringList* txt, [[maybe_unused]] AvahiLookupResultFlags flags,
+                                    void* userdata) {
+            // A failed resolve leaves the instance unresolved; the resolver stays open and may find it later
+            if (event != AVAHI_RESOLVER_FOUND) return;
+
+            ResolverContext* context = static_cast<ResolverContext*>(userdata);
+            Impl* impl = context->impl;
+
+            DiscoveredServer server;
+            server.name = name;
+            server.hostName = hostName ? hostName : "";
+            char addressText[AVAHI_ADDRESS_STR_MAX];
+            avahi_address_snprint(addressText, sizeof(addressText), address);
+            server.address = addressText;
+            server.ipv6 = address->proto == AVAHI_PROTO_INET6;
+            server.port = port;
+            server.interfaceIndex = interface;
+            for (AvahiStringList* item = txt; item; item = avahi_string_list_get_next(item)) {
+                char* key = nullptr;
+                char* value = nullptr;
+                if (avahi_string_list_get_pair(item, &key, &value, nullptr) == 0) {
+                    server.txt[key] = value ? value : "";
+                    avahi_free(key);
+                    avahi_free(value);
+                }
+            }
+            server.resolvedAt = std::chrono::steady_clock::now();
+
+            DiscoveryEvent discoveryEvent;
+            {
+                std::lock_guard<std::mutex> lock(impl->mutex_);
+                auto found = impl->instances_.find(context->key);
+                if (found == impl->instances_.end()) return;
+                Instance& instance = found->second;
+                if (instance.server) {
+                    const DiscoveredServer& known = *instance.server;
+                    if (known.address == server.address && known.port == server.port && known.txt == server.txt) {
+                        instance.server->resolvedAt = server.resolvedAt;
+                        return;
+                    }
+                    discoveryEvent = DiscoveryEvent::Updated;
+                } else {
+                    discoveryEvent = DiscoveryEvent::Added;
+                    instance.order = impl->nextOrder_++;
+                    impl->resolvedCount_++;
+                }
+                instance.server = server;
+            }
+            impl->resolvedChanged_.notify_all();
+            impl->notify(discoveryEvent, server);
+        }
+
+        const std::string serviceType_;
+
+        mutable std::mutex controlMutex_;  // Serializes start() and stop()
+        AvahiThreadedPoll* poll_ = nullptr;
+        AvahiClient* client_ = nullptr;
+        AvahiServiceBrowser* browser_ = nullptr;
+
+        mutable std::mutex mutex_;
+        mutable std::condition_variable resolvedChanged_;
+        std::map<Key, Instance> instances_;
+        size_t resolvedCount_ = 0;
+        uint64_t nextOrder_ = 0;
+        std::map<size_t, Listener> listeners_;
+        size_t nextListenerId_ = 1;
+    };
+
+    ServiceBrowser::ServiceBrowser(const std::string& serviceType)
+        : impl_(std::make_unique<Impl>(serviceType)) {}
+
+    ServiceBrowser::~ServiceBrowser() = default;
+
+    std::shared_ptr<ServiceBrowser> ServiceBrowser::shared(const std::string& serviceType) {
+        static std::mutex mutex;
+        static std::map<std::string, std::shared_ptr<ServiceBrowser>> browsers;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<ServiceBrowser>& browser = browsers[serviceType];
+        if (!browser) browser = std::make_shared<ServiceBrowser>(serviceType);
+        browser->start();
+        return browser;
+    }
+
+    bool ServiceBrowser::start() { return impl_->start(); }
+    void ServiceBrowser::stop() { impl_->stop(); }
+    bool ServiceBrowser::running() const { return impl_->running(); }
+
+    std::vector<DiscoveredServer> ServiceBrowser::servers() const {
+        return impl_->servers();
+    }
+
+    std::optional<DiscoveredServer> ServiceBrowser::preferred() const {
+        return impl_->preferred();
+    }
+
+    std::optional<DiscoveredServer> ServiceBrowser::waitForServer(std::chrono::milliseconds timeout) const {
+        return impl_->waitForServer(timeout);
+    }
+
+    size_t ServiceBrowser::subscribe(Listener listener) {
+        return impl_->subscribe(std::move(listener));
+    }
+
+    void ServiceBrowser::unsubscribe(size_t id) {
+        impl_->unsubscribe(id);
+    }
+
+} // namespace prefab
@@ -0,0 +1,232 @@
+#include "endpoint_set.h"
+#include "logging.h"
+#include <limits>
+
+namespace prefab {
+
+    static thread_local std::shared_ptr<EndpointPin> currentPin;
+
+    EndpointPin::Scope::Scope(std::shared_ptr<EndpointPin> pin) : previous_(std::move(currentPin)) {
+        currentPin = std::move(pin);
+    }
+
+    EndpointPin::Scope::~Scope() {
+        currentPin = std::move(previous_);
+    }
+
+    std::shared_ptr<EndpointPin> EndpointPin::current() {
+        return currentPin;
+    }
+
+    std::string EndpointPin::url() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return url_;
+    }
+
+    void EndpointPin::set(const std::string& url) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        url_ = url;
+    }
+
+    struct EndpointSet::Endpoint {
+        std::string url;
+        bool healthy = true;
+        bool probing = false;
+        size_t outstanding = 0;
+        double latencyUs = 0;  // Exponentially weighted; 0 until the first measured response
+        size_t requests = 0;
+        size_t failures = 0;
+        std::chrono::steady_clock::time_point downSince;
+    };
+
+    EndpointSet::EndpointSet(const LoadBalancingConfig& config, Reactor& reactor, Probe probe)
+        : config_(config), reactor_(reactor), probe_(std::move(probe)) {
+        setEndpoints(config_.endpoints);
+    }
+
+    EndpointSet::~EndpointSet() {
+        if (browser_) browser_->unsubscribe(listener_);
+    }
+
+    void EndpointSet::setEndpoints(const std::vector<std::string>& urls) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::shared_ptr<Endpoint>> endpoints;
+        for (std::string url : urls) {
+            while (!url.empty() && url.back() == '/') url.pop_back();
+            if (url.empty()) continue;
+            auto same = [&url](const std::shared_ptr<Endpoint>& endpoint) { return endpoint->url == url; };
+            if (std::any_of(endpoints.begin(), endpoints.end(), same)) continue;
+            auto known = std::find_if(endpoints_.begin(), endpoints_.end(), same);
+            if (known != endpoints_.end()) {
+                endpoints.push_back(*known);
+            } else {
+                auto endpoint = std::make_shared<Endpoint>();
+                endpoint->url = url;
+                endpoints.push_back(std::move(endpoint));
+            }
+        }
+        endpoints_ = std::move(endpoints);
+    }
+
+    void EndpointSet::follow(std::shared_ptr<ServiceBrowser> browser) {
+        std::weak_ptr<EndpointSet> weak = shared_from_this();
+        auto update = [weak]() {
+            auto self = weak.lock();
+            if (!self) return;
+            std::vector<std::string> urls = self->config_.endpoints;
+            for (const auto& server : self->browser_->servers()) urls.push_back(server.url());
+            self->setEndpoints(urls);
+        };
+        browser_ = std::move(browser);
+        listener_ = browser_->subscribe([update](DiscoveryEvent, const DiscoveredServer&) { update(); });
+        update();
+    }
+
+    std::optional<EndpointSet::Lease> EndpointSet::acquire(const std::vector<std::string>& tried,
+                                                           const std::string& preferred) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_ptr<Endpoint> endpoint;
+        if (!preferred.empty() && std::find(tried.begin(), tried.end(), preferred) == tried.end()) {
+            for (const auto& candidate : endpoints_) {
+                if (candidate->url == preferred && candidate->healthy) endpoint = candidate;
+            }
+        }
+        if (!endpoint) endpoint = pickLocked(tried);
+        if (!endpoint) return std::nullopt;
+        endpoint->outstanding++;
+        endpoint->requests++;
+        return Lease{endpoint, endpoint->url, std::chrono::steady_clock::now()};
+    }
+
+    void EndpointSet::release(const Lease& lease, bool healthy, bool measured) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Endpoint& endpoint = *lease.endpoint;
+        endpoint.outstanding--;
+        if (!healthy) {
+            endpoint.failures++;
+            const bool wentDown = endpoint.healthy;
+            if (wentDown) {
+                endpoint.healthy = false;
+                endpoint.downSince = std::chrono::steady_clock::now();
+            }
+            scheduleHealthCheckLocked();
+            lock.unlock();
+            if (wentDown) PREFAB_LOG(LogLevel::Warn, "endpoints", "endpoint marked down", {{"url", lease.url}});
+            return;
+        }
+
+        endpoint.healthy = true;
+        if (measured) {
+            const double sample = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - lease.started).count());
+            const double weight = std::clamp(config_.latencyWeight, 0.01, 1.0);
+            endpoint.latencyUs = endpoint.latencyUs > 0 ? weight * sample + (1 - weight) * endpoint.latencyUs
+                                                        : std::max(sample, 1.0);
+        }
+    }
+
+    std::optional<std::string> EndpointSet::best() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_ptr<Endpoint> endpoint = pickLocked({});
+        if (!endpoint) return std::nullopt;
+        return endpoint->url;
+    }
+
+    std::vector<EndpointStatus> EndpointSet::status() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<EndpointStatus> status;
+        for (const auto& endpoint : endpoints_) {
+            EndpointStatus entry;
+            entry.url = endpoint->url;
+            entry.healthy = endpoint->healthy;
+            entry.outstanding = endpoint->outstanding;
+            entry.latency = std::chrono::microseconds(static_cast<long long>(endpoint->latencyUs));
+            entry.requests = endpoint->requests;
+            entry.failures = endpoint->failures;
+            status.push_back(std::move(entry));
+        }
+        return status;
+    }
+
+    std::shared_ptr<EndpointSet::Endpoint> EndpointSet::pickLocked(const std::vector<std::string>& tried) const {
+        auto untried = [&tried](const Endpoint& endpoint) {
+            return std::find(tried.begin(), tried.end(), endpoint.url) == tried.end();
+        };
+
+        // Endpoints without a measurement yet count as the fastest known one, so they get tried
+        double fastest = std::numeric_limits<double>::max();
+        for (const auto& endpoint : endpoints_) {
+            if (endpoint->latencyUs > 0) fastest = std::min(fastest, endpoint->latencyUs);
+        }
+        if (fastest == std::numeric_limits<double>::max()) fastest = 1;
+
+        std::shared_ptr<Endpoint> best;
+        auto better = [&](const Endpoint& a, const Endpoint& b) {
+            const double latencyA = a.latencyUs > 0 ? a.latencyUs : fastest;
+            const double latencyB = b.latencyUs > 0 ? b.latencyUs : fastest;
+            if (config_.selection == EndpointSelection::LeastOutstanding) {
+                if (a.outstanding != b.outstanding) return a.outstanding < b.outstanding;
+                if (latencyA != latencyB) return latencyA < latencyB;
+            } else {
+                const double scoreA = latencyA * static_cast<double>(a.outstanding + 1);
+                const double scoreB = latencyB * static_cast<double>(b.outstanding + 1);
+                if (scoreA != scoreB) return scoreA < scoreB;
+            }
+            return a.requests < b.requests;  // Spread ties
+        };
+        for (const auto& endpoint : endpoints_) {
+            if (!endpoint->healthy || !untried(*endpoint)) continue;
+            if (!best || better(*endpoint, *best)) best = endpoint;
+        }
+        if (best) return best;
+
+        // Nothing healthy left: try the endpoint that has been down the longest, it may be back
+        for (const auto& endpoint : endpoints_) {
+            if (!untried(*endpoint)) continue;
+            if (!best || endpoint->downSince < best->downSince) best = endpoint;
+        }
+        return best;
+    }
+
+    void EndpointSet::scheduleHealthCheckLocked() {
+        if (healthCheckScheduled_) return;
+        healthCheckScheduled_ = true;
+        std::weak_ptr<EndpointSet> weak = shared_from_this();
+        reactor_.schedule(std::chrono::milliseconds(std::max(config_.healthCheckIntervalMs, 1)), [weak]() {
+            if (auto self = weak.lock()) self->healthCheck();
+        });
+    }
+
+    // Probe every endpoint that is down; keeps rescheduling itself while any is
+    void EndpointSet::healthCheck() {
+        std::vector<std::shared_ptr<Endpoint>> down;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            healthCheckScheduled_ = false;
+            for (const auto& endpoint : endpoints_) {
+                if (endpoint->healthy) continue;
+                if (!endpoint->probing) down.push_back(endpoint);
+            }
+            if (std::any_of(endpoints_.begin(), endpoints_.end(), [](const auto& e) { return !e->healthy; })) {
+                scheduleHealthCheckLocked();
+            }
+            for (const auto& endpoint : down) endpoint->probing = true;
+        }
+
+        std::weak_ptr<EndpointSet> weak = shared_from_this();
+        for (const auto& endpoint : down) {
+            probe_(endpoint->url, [weak, endpoint](bool healthy) {
+                auto self = weak.lock();
+                if (!self) return;
+                {
+                    std::lock_guard<std::mutex> lock(self->mutex_);
+                    endpoint->probing = false;
+                    if (!healthy || endpoint->healthy) return;
+                    endpoint->healthy = true;
+                }
+                PREFAB_LOG(LogLevel::Info, "endpoints", "endpoint back up", {{"url", endpoint->url}});
+            });
+        }
+    }
+
+} // namespace prefab
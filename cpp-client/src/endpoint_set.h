@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "prefab/client.h"
+#include "prefab/discovery.h"
+#include "reactor.h"
+
+namespace prefab {
+
+    /**
+     * @brief Keeps a series of requests on one endpoint while it stays healthy
+     *
+     * Requests started on a thread inside a Scope go to the endpoint that last
+     * answered one of them, unless it is down or was already tried for the
+     * request; whichever endpoint answers becomes the pinned one. The change
+     * feed pins its requests, because every server numbers its events in an
+     * epoch of its own and a switch between servers forces a resync.
+     */
+    class EndpointPin {
+    public:
+        class Scope {
+        public:
+            explicit Scope(std::shared_ptr<EndpointPin> pin);
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            std::shared_ptr<EndpointPin> previous_;
+        };
+
+        // Pin of the innermost Scope on this thread; null outside any
+        static std::shared_ptr<EndpointPin> current();
+
+        std::string url() const;
+        void set(const std::string& url);
+
+    private:
+        mutable std::mutex mutex_;
+        std::string url_;
+    };
+
+    /**
+     * @brief Servers for the same homes, with health and latency per server
+     *
+     * acquire() picks a healthy endpoint the request has not tried yet, by
+     * LoadBalancingConfig::selection, and counts the request as outstanding
+     * until release(). An endpoint whose request failed in transport (or was
+     * answered 502/503/504) is marked down and only used again when nothing
+     * healthy is left, or once a health check on the reactor finds it
+     * answering again. Any completed request also marks its endpoint healthy.
+     *
+     * Create it with std::make_shared: health-check timers and the discovery
+     * listener keep references to it.
+     */
+    class EndpointSet : public std::enable_shared_from_this<EndpointSet> {
+    public:
+        // Checks one base URL and reports whether it answered
+        using Probe = std::function<void(const std::string& url, std::function<void(bool healthy)> done)>;
+
+        struct Endpoint;
+
+        struct Lease {
+            std::shared_ptr<Endpoint> endpoint;
+            std::string url;
+            std::chrono::steady_clock::time_point started;
+        };
+
+        EndpointSet(const LoadBalancingConfig& config, Reactor& reactor, Probe probe);
+        ~EndpointSet();
+
+        EndpointSet(const EndpointSet&) = delete;
+        EndpointSet& operator=(const EndpointSet&) = delete;
+
+        /**
+         * @brief Replace the endpoint list; endpoints that stay keep their statistics
+         */
+        void setEndpoints(const std::vector<std::string>& urls);
+
+        /**
+         * @brief Keep the list at the configured endpoints plus every server the browser knows
+         */
+        void follow(std::shared_ptr<ServiceBrowser> browser);
+
+        /**
+         * @brief Pick an endpoint not in tried
+         * @param preferred Taken over the usual choice if it is healthy and untried (see EndpointPin)
+         * @return std::nullopt if every endpoint has been tried (or there are none)
+         */
+        std::optional<Lease> acquire(const std::vector<std::string>& tried, const std::string& preferred = "");
+
+        /**
+         * @param healthy False for transport errors, timeouts and 502/503/504 answers
+         * @param measured Feed the elapsed time into the latency average (not for long polls)
+         */
+        void release(const Lease& lease, bool healthy, bool measured);
+
+        /**
+         * @brief The endpoint acquire() would pick now, without acquiring it
+         */
+        std::optional<std::string> best() const;
+
+        size_t maxAttempts() const { return static_cast<size_t>(std::max(config_.maxAttempts, 1)); }
+
+        std::vector<EndpointStatus> status() const;
+
+    private:
+        std::shared_ptr<Endpoint> pickLocked(const std::vector<std::string>& tried) const;
+        void scheduleHealthCheckLocked();
+        void healthCheck();
+
+        const LoadBalancingConfig config_;
+        Reactor& reactor_;
+        const Probe probe_;
+
+        mutable std::mutex mutex_;
+        std::vector<std::shared_ptr<Endpoint>> endpoints_;
+        bool healthCheckScheduled_ = false;
+
+        std::shared_ptr<ServiceBrowser> browser_;
+        size_t listener_ = 0;
+    };
+
+} // namespace prefab
@@ -0,0 +1,66 @@
+#include "hedge_policy.h"
+#include <algorithm>
+#include <cmath>
+
+namespace prefab {
+
+    HedgePolicy::HedgePolicy(const HedgingConfig& config) : config_(config) {
+        samples_.reserve(std::max<size_t>(config_.window, 1));
+    }
+
+    std::chrono::milliseconds HedgePolicy::delay() const {
+        const int lower = std::max(config_.minDelayMs, 1);
+        const int upper = std::max(config_.maxDelayMs, lower);
+
+        std::vector<std::chrono::microseconds> samples;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (samples_.empty() || samples_.size() < config_.minSamples) {
+                return std::chrono::milliseconds(std::clamp(config_.initialDelayMs, lower, upper));
+            }
+            samples = samples_;
+        }
+
+        // Nearest-rank percentile
+        const double percentile = std::clamp(config_.percentile, 0.0, 100.0);
+        size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(samples.size())));
+        rank = std::clamp<size_t>(rank, 1, samples.size()) - 1;
+        std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(rank), samples.end());
+
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(samples[rank]).count();
+        return std::chrono::milliseconds(std::clamp<long long>(ms, lower, upper));
+    }
+
+    void HedgePolicy::recordLatency(std::chrono::microseconds latency) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const size_t window = std::max<size_t>(config_.window, 1);
+        if (samples_.size() < window) {
+            samples_.push_back(latency);
+        } else {
+            samples_[next_] = latency;
+            next_ = (next_ + 1) % window;
+        }
+    }
+
+    void HedgePolicy::recordHedge() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hedged_++;
+    }
+
+    void HedgePolicy::recordHedgeWin() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hedgeWins_++;
+    }
+
+    HedgingStats HedgePolicy::stats() const {
+        HedgingStats stats;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats.hedged = hedged_;
+            stats.hedgeWins = hedgeWins_;
+        }
+        stats.delay = delay();
+        return stats;
+    }
+
+} // namespace prefab
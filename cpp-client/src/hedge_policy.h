@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "prefab/client.h"
+
+namespace prefab {
+
+    /**
+     * @brief Decides when a slow GET gets a second attempt
+     *
+     * Keeps the latencies of the most recent successful GETs in a ring and
+     * hedges after HedgingConfig::percentile of them, clamped to the
+     * configured bounds. Until minSamples latencies are known the initial
+     * delay is used.
+     *
+     * Safe to use from multiple threads.
+     */
+    class HedgePolicy {
+    public:
+        explicit HedgePolicy(const HedgingConfig& config);
+
+        HedgePolicy(const HedgePolicy&) = delete;
+        HedgePolicy& operator=(const HedgePolicy&) = delete;
+
+        /**
+         * @brief How long a GET may be outstanding before it is hedged
+         */
+        std::chrono::milliseconds delay() const;
+
+        void recordLatency(std::chrono::microseconds latency);
+        void recordHedge();
+        void recordHedgeWin();
+
+        HedgingStats stats() const;
+
+    private:
+        const HedgingConfig config_;
+
+        mutable std::mutex mutex_;
+        std::vector<std::chrono::microseconds> samples_;  // Ring of recent latencies
+        size_t next_ = 0;
+        size_t hedged_ = 0;
+        size_t hedgeWins_ = 0;
+    };
+
+} // namespace prefab
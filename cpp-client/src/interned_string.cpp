@@ -0,0 +1,74 @@
+#include "prefab/interned_string.h"
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace prefab {
+
+    namespace {
+
+        /**
+         * @brief Process-wide storage behind InternedString
+         *
+         * Strings live in a deque so their addresses never change; the map's
+         * keys are views of them. Lookups of known text take a shared lock and
+         * do not allocate.
+         */
+        class StringTable {
+        public:
+            static StringTable& instance() {
+                // Leaked on purpose: InternedStrings in static objects may outlive any destructor order
+                static StringTable* table = new StringTable();
+                return *table;
+            }
+
+            const std::string* find(std::string_view text) const {
+                std::shared_lock<std::shared_mutex> lock(mutex_);
+                auto it = index_.find(text);
+                return it == index_.end() ? nullptr : it->second;
+            }
+
+            const std::string* intern(std::string_view text) {
+                if (const std::string* existing = find(text)) return existing;
+
+                std::unique_lock<std::shared_mutex> lock(mutex_);
+                auto it = index_.find(text);
+                if (it != index_.end()) return it->second;
+                const std::string* stored = &strings_.emplace_back(text);
+                index_.emplace(std::string_view(*stored), stored);
+                return stored;
+            }
+
+            const std::string* empty() {
+                static const std::string* emptyString = intern(std::string_view());
+                return emptyString;
+            }
+
+        private:
+            mutable std::shared_mutex mutex_;
+            std::deque<std::string> strings_;
+            std::unordered_map<std::string_view, const std::string*> index_;
+        };
+
+    } // namespace
+
+    InternedString::InternedString() : text_(StringTable::instance().empty()) {}
+
+    InternedString::InternedString(std::string_view text) : text_(StringTable::instance().intern(text)) {}
+
+    std::optional<InternedString> InternedString::find(std::string_view text) {
+        const std::string* existing = StringTable::instance().find(text);
+        if (!existing) return std::nullopt;
+        return InternedString(existing);
+    }
+
+    void to_json(nlohmann::json& j, const InternedString& interned) {
+        j = interned.str();
+    }
+
+    void from_json(const nlohmann::json& j, InternedString& interned) {
+        interned = InternedString(j.get_ref<const nlohmann::json::string_t&>());
+    }
+
+} // namespace prefab
@@ -0,0 +1,183 @@
+#include "prefab/log.h"
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+
+namespace prefab {
+
+    const char* toString(LogLevel level) {
+        switch (level) {
+            case LogLevel::Trace: return "TRACE";
+            case LogLevel::Debug: return "DEBUG";
+            case LogLevel::Info: return "INFO";
+            case LogLevel::Warn: return "WARN";
+            case LogLevel::Error: return "ERROR";
+            case LogLevel::Off: return "OFF";
+        }
+        return "UNKNOWN";
+    }
+
+    StreamLogSink::StreamLogSink(std::ostream& out) : out_(out) {}
+
+    StreamLogSink::StreamLogSink() : out_(std::cerr) {}
+
+    void StreamLogSink::write(const LogRecord& record) {
+        const auto sinceEpoch = record.time.time_since_epoch();
+        const std::time_t seconds = static_cast<std::time_t>(
+            std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch).count());
+        const long millis = static_cast<long>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(sinceEpoch).count() % 1000);
+        std::tm utc{};
+        gmtime_r(&seconds, &utc);
+        char stamp[64];
+        std::snprintf(stamp, sizeof(stamp), "%04d-%02d-%02dT%02d:%02d:%02d.%03ldZ", utc.tm_year + 1900,
+                      utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, millis);
+
+        std::string line = std::string(stamp) + ' ' + toString(record.level) + ' ' + record.component + ": " +
+                           record.message;
+        for (const auto& [key, value] : record.fields) line += ' ' + key + "=\"" + value + '"';
+        line += '\n';
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        out_ << line;
+    }
+
+    void StreamLogSink::flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out_.flush();
+    }
+
+    static size_t ringSize(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        return size;
+    }
+
+    AsyncLogSink::AsyncLogSink(std::shared_ptr<LogSink> target, size_t capacity)
+        : target_(std::move(target)), mask_(ringSize(capacity) - 1), slots_(new Slot[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; ++i) slots_[i].sequence.store(i, std::memory_order_relaxed);
+        thread_ = std::thread(&AsyncLogSink::run, this);
+    }
+
+    AsyncLogSink::~AsyncLogSink() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+        if (target_) target_->flush();
+    }
+
+    // Bounded multi-producer queue after Dmitry Vyukov: a slot's sequence says whose turn it is
+    void AsyncLogSink::write(const LogRecord& record) {
+        size_t position = enqueue_.load(std::memory_order_relaxed);
+        Slot* slot = nullptr;
+        while (true) {
+            slot = &slots_[position & mask_];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+            if (difference == 0) {
+                if (enqueue_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            } else if (difference < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);  // Full: the reader is a whole ring behind
+                return;
+            } else {
+                position = enqueue_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->record = record;
+        slot->sequence.store(position + 1, std::memory_order_release);
+        accepted_.fetch_add(1, std::memory_order_release);
+    }
+
+    bool AsyncLogSink::pop(LogRecord& record) {
+        Slot& slot = slots_[dequeue_ & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeue_ + 1) return false;
+        record = std::move(slot.record);
+        slot.sequence.store(dequeue_ + mask_ + 1, std::memory_order_release);
+        dequeue_++;
+        return true;
+    }
+
+    void AsyncLogSink::flush() {
+        const uint64_t target = accepted_.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.notify_all();
+        drained_.wait(lock, [&] { return delivered_.load(std::memory_order_acquire) >= target || stopping_; });
+        lock.unlock();
+        if (target_) target_->flush();
+    }
+
+    // Writers never signal, so the reader also wakes on its own every few milliseconds
+    void AsyncLogSink::run() {
+        LogRecord record;
+        auto drain = [&] {
+            bool delivered = false;
+            while (pop(record)) {
+                if (target_) {
+                    try {
+                        target_->write(record);
+                    } catch (...) {
+                        // A failing sink loses the record, not the logger
+                    }
+                }
+                delivered_.fetch_add(1, std::memory_order_release);
+                delivered = true;
+            }
+            return delivered;
+        };
+
+        while (true) {
+            const bool delivered = drain();
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (delivered) drained_.notify_all();
+            if (stopping_) break;
+            wake_.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        drain();  // Written just before the destructor
+    }
+
+    std::atomic<int> Logger::level_{static_cast<int>(LogLevel::Warn)};
+
+    static std::shared_ptr<LogSink>& sinkSlot() {
+        static std::shared_ptr<LogSink> sink = std::make_shared<AsyncLogSink>(std::make_shared<StreamLogSink>());
+        return sink;
+    }
+
+    void Logger::setLevel(LogLevel level) {
+        level_.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    LogLevel Logger::level() {
+        return static_cast<LogLevel>(level_.load(std::memory_order_relaxed));
+    }
+
+    void Logger::setSink(std::shared_ptr<LogSink> sink) {
+        std::atomic_store(&sinkSlot(), std::move(sink));
+    }
+
+    // std::atomic_load on a shared_ptr briefly takes a lock inside libstdc++. Only records that
+    // passed the level check get here, and this also works during static destruction at exit,
+    // when thread-local caches may already be gone
+    std::shared_ptr<LogSink> Logger::sink() {
+        return std::atomic_load(&sinkSlot());
+    }
+
+    void Logger::write(LogLevel level, const char* component, std::string message, LogFields fields) {
+        std::shared_ptr<LogSink> target = sink();
+        if (!target) return;
+        LogRecord record;
+        record.level = level;
+        record.time = std::chrono::system_clock::now();
+        record.component = component;
+        record.message = std::move(message);
+        record.fields = std::move(fields);
+        try {
+            target->write(record);
+        } catch (...) {
+            // Logging is best effort
+        }
+    }
+
+} // namespace prefab
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "prefab/log.h"
+
+// Lowest level compiled in (0 = Trace ... 5 = Off); set from the PREFAB_LOG_LEVEL CMake option
+#ifndef PREFAB_LOG_MIN_LEVEL
+#define PREFAB_LOG_MIN_LEVEL 0
+#endif
+
+/**
+ * Log through prefab::Logger. The arguments after the level are those of
+ * Logger::write and are only evaluated when the level is enabled, so a
+ * disabled statement costs one relaxed load, or nothing if compiled out:
+ *
+ *     PREFAB_LOG(LogLevel::Debug, "client", "request", {{"path", path}});
+ */
+#define PREFAB_LOG(level, ...)                                                              \
+    do {                                                                                    \
+        if constexpr (static_cast<int>(level) >= PREFAB_LOG_MIN_LEVEL) {                    \
+            if (::prefab::Logger::enabled(level)) ::prefab::Logger::write(level, __VA_ARGS__); \
+        }                                                                                   \
+    } while (0)
@@ -0,0 +1,151 @@
+#include "prefab/metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace prefab {
+
+    // Values below kSubBuckets get a bucket each; every octave above is split in kSubBuckets
+    static constexpr int kSubBucketBits = 3;
+    static constexpr uint64_t kSubBuckets = 1u << kSubBucketBits;
+    static constexpr int kMaxShift = static_cast<int>((HistogramSnapshot::kBuckets - kSubBuckets) / kSubBuckets) - 1;
+
+    std::chrono::microseconds HistogramSnapshot::bucketUpperBound(size_t index) {
+        if (index < kSubBuckets) return std::chrono::microseconds(static_cast<long long>(index));
+        const uint64_t shift = (index - kSubBuckets) / kSubBuckets;
+        const uint64_t sub = (index - kSubBuckets) % kSubBuckets;
+        return std::chrono::microseconds(static_cast<long long>(((kSubBuckets + sub + 1) << shift) - 1));
+    }
+
+    size_t HistogramSnapshot::bucketFor(std::chrono::microseconds value) {
+        const uint64_t v = static_cast<uint64_t>(std::max<long long>(value.count(), 0));
+        if (v < kSubBuckets) return static_cast<size_t>(v);
+        int msb = 63;
+        while (!(v >> msb)) msb--;
+        const int shift = msb - kSubBucketBits;
+        if (shift > kMaxShift) return kBuckets - 1;
+        const uint64_t sub = (v >> shift) - kSubBuckets;
+        return static_cast<size_t>(kSubBuckets + static_cast<uint64_t>(shift) * kSubBuckets + sub);
+    }
+
+    std::chrono::microseconds HistogramSnapshot::percentile(double percentile) const {
+        if (count == 0 || buckets.empty()) return std::chrono::microseconds(0);
+        // Nearest rank
+        const double clamped = std::clamp(percentile, 0.0, 100.0);
+        const uint64_t rank = std::max<uint64_t>(
+            static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(count))), 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            seen += buckets[i];
+            if (seen >= rank) return std::min(bucketUpperBound(i), max);
+        }
+        return max;
+    }
+
+    uint64_t HistogramSnapshot::countAtOrBelow(std::chrono::microseconds bound) const {
+        uint64_t total = 0;
+        for (size_t i = 0; i < buckets.size() && bucketUpperBound(i) <= bound; ++i) total += buckets[i];
+        return total;
+    }
+
+    static std::string escapeLabel(const std::string& value) {
+        std::string escaped;
+        escaped.reserve(value.size());
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                escaped += '\\';
+                escaped += c;
+            } else if (c == '\n') {
+                escaped += "\\n";
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    static std::string seconds(std::chrono::microseconds value) {
+        std::ostringstream out;
+        out << static_cast<double>(value.count()) / 1e6;
+        return out.str();
+    }
+
+    std::string formatPrometheus(const MetricsSnapshot& snapshot, const std::string& prefix) {
+        // Coarse bucket bounds for the export; the fine buckets are folded into them
+        static const std::chrono::microseconds bounds[] = {
+            std::chrono::microseconds(500), std::chrono::milliseconds(1), std::chrono::microseconds(2500),
+            std::chrono::milliseconds(5), std::chrono::milliseconds(10), std::chrono::milliseconds(25),
+            std::chrono::milliseconds(50), std::chrono::milliseconds(100), std::chrono::milliseconds(250),
+            std::chrono::milliseconds(500), std::chrono::seconds(1), std::chrono::microseconds(2500000),
+            std::chrono::seconds(5), std::chrono::seconds(10), std::chrono::seconds(30)};
+
+        std::ostringstream out;
+        auto buckets = [&](const std::string& histogram, const std::string& labels, const HistogramSnapshot& values) {
+            for (const auto& bound : bounds) {
+                out << histogram << "_bucket{" << labels << ",le=\"" << seconds(bound) << "\"} "
+                    << values.countAtOrBelow(bound) << '\n';
+            }
+            out << histogram << "_bucket{" << labels << ",le=\"+Inf\"} " << values.count << '\n';
+            out << histogram << "_sum{" << labels << "} " << seconds(values.sum) << '\n';
+            out << histogram << "_count{" << labels << "} " << values.count << '\n';
+        };
+        auto labels = [](const RouteMetrics& route) {
+            return "method=\"" + escapeLabel(route.method) + "\",route=\"" + escapeLabel(route.route) + "\"";
+        };
+        auto counter = [&](const std::string& name, const std::string& help, uint64_t RouteMetrics::*field) {
+            out << "# HELP " << prefix << name << ' ' << help << '\n';
+            out << "# TYPE " << prefix << name << " counter\n";
+            for (const auto& route : snapshot.routes) {
+                out << prefix << name << '{' << labels(route) << "} " << route.*field << '\n';
+            }
+        };
+
+        counter("_requests_total", "HTTP requests sent, counting every attempt", &RouteMetrics::requests);
+
+        out << "# HELP " << prefix << "_errors_total Failed requests by HTTP status (0: transport error or timeout)\n";
+        out << "# TYPE " << prefix << "_errors_total counter\n";
+        for (const auto& route : snapshot.routes) {
+            for (const auto& [code, count] : route.errorsByCode) {
+                out << prefix << "_errors_total{" << labels(route) << ",code=\"" << code << "\"} " << count << '\n';
+            }
+        }
+
+        counter("_sent_bytes_total", "Request body bytes sent", &RouteMetrics::bytesSent);
+        counter("_received_bytes_total", "Response body bytes received", &RouteMetrics::bytesReceived);
+
+        const std::string histogram = prefix + "_request_duration_seconds";
+        out << "# HELP " << histogram << " Request latency by phase\n";
+        out << "# TYPE " << histogram << " histogram\n";
+        const std::pair<const char*, HistogramSnapshot RouteMetrics::*> phases[] = {
+            {"total", &RouteMetrics::latency}, {"dns", &RouteMetrics::dns},
+            {"connect", &RouteMetrics::connect}, {"transfer", &RouteMetrics::transfer}};
+        for (const auto& route : snapshot.routes) {
+            for (const auto& [phase, field] : phases) {
+                const HistogramSnapshot& values = route.*field;
+                buckets(histogram, labels(route) + ",phase=\"" + phase + "\"", values);
+            }
+        }
+
+        if (snapshot.queues.empty()) return out.str();
+        auto queueLabels = [](const QueueMetrics& queue) { return "priority=\"" + escapeLabel(queue.priority) + "\""; };
+        auto queueSeries = [&](const std::string& name, const char* type, const std::string& help,
+                               uint64_t QueueMetrics::*field) {
+            out << "# HELP " << prefix << name << ' ' << help << '\n';
+            out << "# TYPE " << prefix << name << ' ' << type << '\n';
+            for (const auto& queue : snapshot.queues) {
+                out << prefix << name << '{' << queueLabels(queue) << "} " << queue.*field << '\n';
+            }
+        };
+        queueSeries("_queue_depth", "gauge", "Requests waiting for the scheduler", &QueueMetrics::depth);
+        queueSeries("_queue_admitted_total", "counter", "Requests the scheduler let through", &QueueMetrics::admitted);
+        queueSeries("_queue_rejected_total", "counter", "Requests failed while queued or refused by a full queue",
+                    &QueueMetrics::rejected);
+
+        const std::string wait = prefix + "_queue_wait_seconds";
+        out << "# HELP " << wait << " Time requests waited for the scheduler\n";
+        out << "# TYPE " << wait << " histogram\n";
+        for (const auto& queue : snapshot.queues) buckets(wait, queueLabels(queue), queue.wait);
+        return out.str();
+    }
+
+} // namespace prefab
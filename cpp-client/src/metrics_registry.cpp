@@ -0,0 +1,118 @@
+#include "metrics_registry.h"
+#include <algorithm>
+#include <vector>
+
+namespace prefab {
+
+    void LatencyHistogram::record(std::chrono::microseconds value) {
+        const uint64_t us = static_cast<uint64_t>(std::max<long long>(value.count(), 0));
+        buckets_[HistogramSnapshot::bucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sumUs_.fetch_add(us, std::memory_order_relaxed);
+        uint64_t max = maxUs_.load(std::memory_order_relaxed);
+        while (us > max && !maxUs_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+    }
+
+    // Not an atomic copy: a value recorded meanwhile may be in the buckets but not yet in count
+    HistogramSnapshot LatencyHistogram::snapshot() const {
+        HistogramSnapshot snapshot;
+        snapshot.count = count_.load(std::memory_order_relaxed);
+        snapshot.sum = std::chrono::microseconds(static_cast<long long>(sumUs_.load(std::memory_order_relaxed)));
+        snapshot.max = std::chrono::microseconds(static_cast<long long>(maxUs_.load(std::memory_order_relaxed)));
+        if (snapshot.count == 0) return snapshot;
+        snapshot.buckets.reserve(buckets_.size());
+        for (const auto& bucket : buckets_) snapshot.buckets.push_back(bucket.load(std::memory_order_relaxed));
+        return snapshot;
+    }
+
+    std::string MetricsRegistry::routeOf(const std::string& path) {
+        static const std::map<std::string, std::vector<std::string>> parameters = {
+            {"homes", {":home"}},
+            {"rooms", {":home", ":room"}},
+            {"accessories", {":home", ":room", ":accessory"}},
+            {"scenes", {":home", ":scene"}},
+            {"groups", {":home", ":group"}},
+        };
+
+        const std::string bare = path.substr(0, path.find('?'));
+        std::vector<std::string> segments;
+        size_t start = bare.empty() || bare[0] != '/' ? 0 : 1;
+        while (start <= bare.size()) {
+            size_t end = bare.find('/', start);
+            if (end == std::string::npos) end = bare.size();
+            segments.push_back(bare.substr(start, end - start));
+            start = end + 1;
+        }
+
+        std::string route;
+        const auto names = segments.empty() ? parameters.end() : parameters.find(segments[0]);
+        for (size_t i = 0; i < segments.size(); ++i) {
+            route += '/';
+            if (i == 0 || segments[i].empty()) {
+                route += segments[i];
+            } else if (names == parameters.end()) {
+                route += ":param";
+            } else if (i - 1 < names->second.size()) {
+                route += names->second[i - 1];
+            } else {
+                route += segments[i];  // Action after the names, e.g. execute
+            }
+        }
+        return route;
+    }
+
+    MetricsRegistry::Route& MetricsRegistry::routeFor(const std::string& method, const std::string& route) {
+        const std::string key = method + ' ' + route;
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::unique_ptr<Route>& entry = routes_[key];
+        if (!entry) entry = std::make_unique<Route>();
+        return *entry;
+    }
+
+    void MetricsRegistry::record(const std::string& method, const std::string& path, const Sample& sample) {
+        Route& route = routeFor(method, routeOf(path));
+        route.requests.fetch_add(1, std::memory_order_relaxed);
+        route.bytesSent.fetch_add(sample.bytesSent, std::memory_order_relaxed);
+        route.bytesReceived.fetch_add(sample.bytesReceived, std::memory_order_relaxed);
+        route.latency.record(sample.total);
+        route.dns.record(sample.dns);
+        route.connect.record(sample.connect);
+        route.transfer.record(sample.transfer);
+
+        if (sample.transportError || sample.httpCode >= 400) {
+            route.errors.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(route.codesMutex);
+            route.errorsByCode[sample.transportError ? 0 : static_cast<int>(sample.httpCode)]++;
+        }
+    }
+
+    MetricsSnapshot MetricsRegistry::snapshot() const {
+        MetricsSnapshot snapshot;
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshot.routes.reserve(routes_.size());
+        for (const auto& [key, route] : routes_) {
+            RouteMetrics metrics;
+            const size_t space = key.find(' ');
+            metrics.method = key.substr(0, space);
+            metrics.route = key.substr(space + 1);
+            metrics.requests = route->requests.load(std::memory_order_relaxed);
+            metrics.errors = route->errors.load(std::memory_order_relaxed);
+            metrics.bytesSent = route->bytesSent.load(std::memory_order_relaxed);
+            metrics.bytesReceived = route->bytesReceived.load(std::memory_order_relaxed);
+            metrics.latency = route->latency.snapshot();
+            metrics.dns = route->dns.snapshot();
+            metrics.connect = route->connect.snapshot();
+            metrics.transfer = route->transfer.snapshot();
+            {
+                std::lock_guard<std::mutex> codesLock(route->codesMutex);
+                metrics.errorsByCode = route->errorsByCode;
+            }
+            snapshot.routes.push_back(std::move(metrics));
+        }
+        std::sort(snapshot.routes.begin(), snapshot.routes.end(), [](const RouteMetrics& a, const RouteMetrics& b) {
+            return a.route != b.route ? a.route < b.route : a.method < b.method;
+        });
+        return snapshot;
+    }
+
+} // namespace prefab
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "prefab/metrics.h"
+
+namespace prefab {
+
+    /**
+     * @brief Lock-free recording side of a HistogramSnapshot
+     */
+    class LatencyHistogram {
+    public:
+        void record(std::chrono::microseconds value);
+        HistogramSnapshot snapshot() const;
+
+    private:
+        std::array<std::atomic<uint64_t>, HistogramSnapshot::kBuckets> buckets_{};
+        std::atomic<uint64_t> count_{0};
+        std::atomic<uint64_t> sumUs_{0};
+        std::atomic<uint64_t> maxUs_{0};
+    };
+
+    /**
+     * @brief Per-route request metrics of one client
+     *
+     * Recording takes a short lock to find the route, then only updates
+     * atomics; error codes, which are rare, take the route's own lock.
+     */
+    class MetricsRegistry {
+    public:
+        // What one finished attempt contributes
+        struct Sample {
+            bool transportError = false;  // Includes timeouts
+            long httpCode = 0;
+            size_t bytesSent = 0;
+            size_t bytesReceived = 0;
+            std::chrono::microseconds total{0};
+            std::chrono::microseconds dns{0};
+            std::chrono::microseconds connect{0};
+            std::chrono::microseconds transfer{0};
+        };
+
+        void record(const std::string& method, const std::string& path, const Sample& sample);
+        MetricsSnapshot snapshot() const;
+
+        /**
+         * @brief The path with every name segment replaced by a placeholder
+         *
+         * "/accessories/Home/Kitchen/Lamp?x=1" becomes
+         * "/accessories/:home/:room/:accessory", so the number of routes stays
+         * bounded however many homes and accessories there are.
+         */
+        static std::string routeOf(const std::string& path);
+
+    private:
+        struct Route {
+            std::atomic<uint64_t> requests{0};
+            std::atomic<uint64_t> errors{0};
+            std::atomic<uint64_t> bytesSent{0};
+            std::atomic<uint64_t> bytesReceived{0};
+            LatencyHistogram latency;
+            LatencyHistogram dns;
+            LatencyHistogram connect;
+            LatencyHistogram transfer;
+
+            mutable std::mutex codesMutex;
+            std::map<int, uint64_t> errorsByCode;
+        };
+
+        Route& routeFor(const std::string& method, const std::string& route);
+
+        mutable std::mutex mutex_;
+        // Keyed by "METHOD route"; routes are never removed, so references stay valid
+        std::unordered_map<std::string, std::unique_ptr<Route>> routes_;
+    };
+
+} // namespace prefab
@@ -0,0 +1,533 @@
+#include "model_parser.h"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <iterator>
+
+using json = nlohmann::json;
+
+namespace prefab {
+
+    namespace {
+
+        enum class Kind { String, Bool, Array, Object };
+
+        struct Field {
+            const char* name;
+            Kind kind;
+            bool required;
+            bool nullable;
+        };
+
+        // Mirrors the from_json overloads in models.h
+        const Field accessoryFields[] = {
+            {"home", Kind::String, true, false},
+            {"room", Kind::String, true, false},
+            {"name", Kind::String, true, false},
+            {"category", Kind::String, false, true},
+            {"isReachable", Kind::Bool, false, true},
+            {"supportsIdentify", Kind::Bool, false, true},
+            {"isBridged", Kind::Bool, false, true},
+            {"services", Kind::Array, false, true},
+            {"firmwareVersion", Kind::String, false, true},
+            {"manufacturer", Kind::String, false, true},
+            {"model", Kind::String, false, true},
+        };
+
+        const Field serviceFields[] = {
+            {"uniqueIdentifier", Kind::String, true, false},
+            {"name", Kind::String, true, false},
+            {"typeName", Kind::String, true, false},
+            {"type", Kind::String, true, false},
+            {"isPrimary", Kind::Bool, true, false},
+            {"isUserInteractive", Kind::Bool, true, false},
+            {"associatedType", Kind::String, false, true},
+            {"characteristics", Kind::Array, true, false},
+        };
+
+        const Field characteristicFields[] = {
+            {"uniqueIdentifier", Kind::String, true, false},
+            {"description", Kind::String, true, false},
+            {"properties", Kind::Array, true, false},
+            {"typeName", Kind::String, true, false},
+            {"type", Kind::String, true, false},
+            {"metadata", Kind::Object, true, true},
+            {"value", Kind::String, true, false},
+        };
+
+        const Field metadataFields[] = {
+            {"manufacturerDescription", Kind::String, false, true},
+            {"validValues", Kind::Array, false, true},
+            {"minimumValue", Kind::String, false, true},
+            {"maximumValue", Kind::String, false, true},
+            {"stepValue", Kind::String, false, true},
+            {"maxLength", Kind::String, false, true},
+            {"format", Kind::String, false, true},
+            {"units", Kind::String, false, true},
+        };
+
+        // The two model families the handler can fill
+        struct HeapModels {
+            using Accessory = prefab::Accessory;
+            using Service = prefab::Service;
+            using Characteristic = prefab::Characteristic;
+            using String = std::string;
+            using List = std::vector<prefab::Accessory>;
+        };
+
+        struct ArenaModels {
+            using Accessory = pmr::Accessory;
+            using Service = pmr::Service;
+            using Characteristic = pmr::Characteristic;
+            using String = std::pmr::string;
+            using List = std::pmr::vector<pmr::Accessory>;
+        };
+
+        /**
+         * @brief SAX handler that fills accessories field by field
+         *
+         * A stack of frames tracks where in the document the parser is. Values
+         * under keys the models do not know about are skipped, including whole
+         * nested objects and arrays. For the arena models every string and
+         * vector is created with the arena's allocator.
+         */
+        template <typename Models>
+        class AccessoryHandler : public json::json_sax_t {
+        public:
+            using Accessory = typename Models::Accessory;
+            using Service = typename Models::Service;
+            using Characteristic = typename Models::Characteristic;
+            using String = typename Models::String;
+            using List = typename Models::List;
+
+            AccessoryHandler(Accessory* single, List* list, const pmr::allocator_type& alloc = {})
+                : single_(single), list_(list), alloc_(alloc) {}
+
+            const std::string& error() const { return error_; }
+
+            bool null() override {
+                if (skipDepth_ > 0) return true;
+                if (stack_.empty()) return rootScalar();
+                const Field* field = currentField();
+                if (!field) return inObject() || fail("unexpected null in array");
+                if (!field->nullable) return fail(std::string("field '") + field->name + "' must not be null");
+                markSeen();
+                return true;
+            }
+
+            bool boolean(bool value) override {
+                if (skipDepth_ > 0) return true;
+                if (stack_.empty()) return rootScalar();
+                if (!expect(Kind::Bool)) return error_.empty();
+                bool* slot = nullptr;
+                switch (top().frame) {
+                    case Frame::Accessory: {
+                        Accessory& a = accessory();
+                        if (key_ == "isReachable") slot = &a.isReachable.emplace();
+                        else if (key_ == "supportsIdentify") slot = &a.supportsIdentify.emplace();
+                        else slot = &a.isBridged.emplace();
+                        break;
+                    }
+                    case Frame::Service:
+                        slot = key_ == "isPrimary" ? &service().isPrimary : &service().isUserInteractive;
+                        break;
+                    default:
+                        break;
+                }
+                if (slot) *slot = value;
+                markSeen();
+                return true;
+            }
+
+            bool number_integer(number_integer_t) override { return scalar("number"); }
+            bool number_unsigned(number_unsigned_t) override { return scalar("number"); }
+            bool number_float(number_float_t, const string_t&) override { return scalar("number"); }
+            bool binary(binary_t&) override { return scalar("binary value"); }
+
+            bool string(string_t& value) override {
+                if (skipDepth_ > 0) return true;
+                if (stack_.empty()) return rootScalar();
+                switch (top().frame) {
+                    case Frame::Properties:
+                        appendString(characteristic().properties, value);
+                        return true;
+                    case Frame::ValidValues:
+                        appendString(*characteristic().metadata.validValues, value);
+                        return true;
+                    default:
+                        break;
+                }
+                if (!expect(Kind::String)) return error_.empty();
+                if (Uuid* uuid = uuidSlot()) {
+                    auto parsed = Uuid::parse(value);
+                    if (!parsed) return fail("field '" + key_ + "' is not a UUID");
+                    *uuid = *parsed;
+                } else if (InternedString* name = internedSlot()) {
+                    *name = InternedString(value);
+                } else {
+                    assignString(*stringSlot(), value);
+                }
+                markSeen();
+                return true;
+            }
+
+            bool key(string_t& value) override {
+                if (skipDepth_ == 0) key_ = std::move(value);
+                return true;
+            }
+
+            bool start_object(std::size_t) override {
+                if (skipDepth_ > 0) {
+                    skipDepth_++;
+                    return true;
+                }
+                if (stack_.empty()) {
+                    if (list_) return fail("expected an array of accessories");
+                    return push(Frame::Accessory);
+                }
+                switch (top().frame) {
+                    case Frame::AccessoryList:
+                        list_->emplace_back();
+                        return push(Frame::Accessory);
+                    case Frame::Services:
+                        accessory().services->emplace_back();
+                        return push(Frame::Service);
+                    case Frame::Characteristics:
+                        service().characteristics.emplace_back();
+                        return push(Frame::Characteristic);
+                    case Frame::Properties:
+                    case Frame::ValidValues:
+                        return fail("expected a string array element");
+                    default:
+                        break;
+                }
+                if (!expect(Kind::Object)) return error_.empty();
+                markSeen();
+                return push(Frame::Metadata);
+            }
+
+            bool end_object() override {
+                if (skipDepth_ > 0) {
+                    skipDepth_--;
+                    return true;
+                }
+                const Frame frame = top().frame;
+                const uint32_t seen = top().seen;
+                size_t count = 0;
+                const Field* fields = fieldsOf(frame, count);
+                for (size_t i = 0; i < count; ++i) {
+                    if (fields[i].required && !(seen & (1u << i))) {
+                        return fail(std::string("missing required field '") + fields[i].name + "' in " + nameOf(frame));
+                    }
+                }
+                if (frame == Frame::Characteristic) {
+                    // Decode the typed value once, as from_json does
+                    Characteristic& c = characteristic();
+                    c.metadata.constraints = ValueConstraints::fromMetadata(c.metadata);
+                    c.typedValue = c.metadata.constraints.decode(c.value);
+                }
+                stack_.pop_back();
+                return true;
+            }
+
+            bool start_array(std::size_t) override {
+                if (skipDepth_ > 0) {
+                    skipDepth_++;
+                    return true;
+                }
+                if (stack_.empty()) {
+                    if (!list_) return fail("expected an accessory object");
+                    return push(Frame::AccessoryList);
+                }
+                if (!inObject()) return fail("unexpected nested array");
+                if (!expect(Kind::Array)) return error_.empty();
+                markSeen();
+                switch (top().frame) {
+                    case Frame::Accessory:
+                        emplaceOptional(accessory().services);
+                        return push(Frame::Services);
+                    case Frame::Service:
+                        return push(Frame::Characteristics);
+                    case Frame::Characteristic:
+                        return push(Frame::Properties);
+                    default:
+                        emplaceOptional(characteristic().metadata.validValues);
+                        return push(Frame::ValidValues);
+                }
+            }
+
+            bool end_array() override {
+                if (skipDepth_ > 0) {
+                    skipDepth_--;
+                    return true;
+                }
+                stack_.pop_back();
+                return true;
+            }
+
+            bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& e) override {
+                return fail(e.what());
+            }
+
+        private:
+            enum class Frame { AccessoryList, Accessory, Services, Service, Characteristics, Characteristic,
+                               Properties, Metadata, ValidValues };
+
+            struct State {
+                Frame frame;
+                uint32_t seen;  // Bit i set once field i of the frame's table has a value
+            };
+
+            Accessory* single_;
+            List* list_;
+            pmr::allocator_type alloc_;
+            std::vector<State> stack_;
+            std::string key_;
+            size_t skipDepth_ = 0;
+            std::string error_;
+
+            State& top() { return stack_.back(); }
+
+            bool push(Frame frame) {
+                stack_.push_back(State{frame, 0});
+                return true;
+            }
+
+            bool fail(std::string message) {
+                error_ = std::move(message);
+                return false;
+            }
+
+            bool inObject() {
+                switch (top().frame) {
+                    case Frame::Accessory:
+                    case Frame::Service:
+                    case Frame::Characteristic:
+                    case Frame::Metadata:
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            static const Field* fieldsOf(Frame frame, size_t& count) {
+                switch (frame) {
+                    case Frame::Accessory:
+                        count = std::size(accessoryFields);
+                        return accessoryFields;
+                    case Frame::Service:
+                        count = std::size(serviceFields);
+                        return serviceFields;
+                    case Frame::Characteristic:
+                        count = std::size(characteristicFields);
+                        return characteristicFields;
+                    case Frame::Metadata:
+                        count = std::size(metadataFields);
+                        return metadataFields;
+                    default:
+                        count = 0;
+                        return nullptr;
+                }
+            }
+
+            static const char* nameOf(Frame frame) {
+                switch (frame) {
+                    case Frame::Accessory: return "accessory";
+                    case Frame::Service: return "service";
+                    case Frame::Characteristic: return "characteristic";
+                    default: return "metadata";
+                }
+            }
+
+            // Index of the current key in the current object's field table, or -1
+            int fieldIndex() {
+                size_t count = 0;
+                const Field* fields = fieldsOf(top().frame, count);
+                for (size_t i = 0; i < count; ++i) {
+                    if (key_ == fields[i].name) return static_cast<int>(i);
+                }
+                return -1;
+            }
+
+            const Field* currentField() {
+                if (!inObject()) return nullptr;
+                int index = fieldIndex();
+                if (index < 0) return nullptr;
+                size_t count = 0;
+                return &fieldsOf(top().frame, count)[index];
+            }
+
+            void markSeen() {
+                int index = fieldIndex();
+                if (index >= 0) top().seen |= 1u << index;
+            }
+
+            /**
+             * @brief Check the value about to be stored against the current key
+             *
+             * Returns false both for unknown keys (value skipped, error_ empty)
+             * and for a type mismatch (error_ set). Nested values under an
+             * unknown key switch the handler into skip mode.
+             */
+            bool expect(Kind kind) {
+                if (!inObject()) {
+                    fail("unexpected value in array");
+                    return false;
+                }
+                const Field* field = currentField();
+                if (!field) {
+                    if (kind == Kind::Array || kind == Kind::Object) skipDepth_ = 1;
+                    return false;
+                }
+                if (field->kind != kind) {
+                    fail(std::string("field '") + field->name + "' has the wrong type");
+                    return false;
+                }
+                return true;
+            }
+
+            bool rootScalar() {
+                return fail(list_ ? "expected an array of accessories" : "expected an accessory object");
+            }
+
+            bool scalar(const char* what) {
+                if (skipDepth_ > 0) return true;
+                if (stack_.empty()) return rootScalar();
+                if (!inObject()) return fail(std::string("unexpected ") + what + " in array");
+                const Field* field = currentField();
+                if (field) return fail(std::string("field '") + field->name + "' has the wrong type");
+                return true;
+            }
+
+            Accessory& accessory() {
+                return list_ ? list_->back() : *single_;
+            }
+
+            Service& service() {
+                return accessory().services->back();
+            }
+
+            Characteristic& characteristic() {
+                return service().characteristics.back();
+            }
+
+            // Identifiers and types of services and characteristics are stored as binary UUIDs
+            Uuid* uuidSlot() {
+                const bool id = key_ == "uniqueIdentifier";
+                if (!id && key_ != "type") return nullptr;
+                switch (top().frame) {
+                    case Frame::Service: return id ? &service().uniqueIdentifier : &service().type;
+                    case Frame::Characteristic: return id ? &characteristic().uniqueIdentifier : &characteristic().type;
+                    default: return nullptr;
+                }
+            }
+
+            InternedString* internedSlot() {
+                if (key_ != "typeName") return nullptr;
+                switch (top().frame) {
+                    case Frame::Service: return &service().typeName;
+                    case Frame::Characteristic: return &characteristic().typeName;
+                    default: return nullptr;
+                }
+            }
+
+            // Optional members of the arena models must be created with the arena's allocator
+            template <typename T>
+            T& emplaceOptional(std::optional<T>& slot) {
+                if constexpr (std::uses_allocator_v<T, pmr::allocator_type>) {
+                    return slot.emplace(alloc_);
+                } else {
+                    return slot.emplace();
+                }
+            }
+
+            template <typename Strings>
+            static void appendString(Strings& strings, std::string& value) {
+                if constexpr (std::is_same_v<String, std::string>) {
+                    strings.push_back(std::move(value));
+                } else {
+                    strings.emplace_back(value.data(), value.size());
+                }
+            }
+
+            static void assignString(String& slot, std::string& value) {
+                if constexpr (std::is_same_v<String, std::string>) {
+                    slot = std::move(value);
+                } else {
+                    slot.assign(value.data(), value.size());
+                }
+            }
+
+            String* stringSlot() {
+                switch (top().frame) {
+                    case Frame::Accessory: {
+                        Accessory& a = accessory();
+                        if (key_ == "home") return &a.home;
+                        if (key_ == "room") return &a.room;
+                        if (key_ == "name") return &a.name;
+                        if (key_ == "category") return &emplaceOptional(a.category);
+                        if (key_ == "firmwareVersion") return &emplaceOptional(a.firmwareVersion);
+                        if (key_ == "manufacturer") return &emplaceOptional(a.manufacturer);
+                        return &emplaceOptional(a.model);
+                    }
+                    case Frame::Service: {
+                        Service& s = service();
+                        if (key_ == "name") return &s.name;
+                        return &emplaceOptional(s.associatedType);
+                    }
+                    case Frame::Characteristic: {
+                        Characteristic& c = characteristic();
+                        if (key_ == "description") return &c.description;
+                        return &c.value;
+                    }
+                    default: {
+                        auto& m = characteristic().metadata;
+                        if (key_ == "manufacturerDescription") return &emplaceOptional(m.manufacturerDescription);
+                        if (key_ == "minimumValue") return &emplaceOptional(m.minimumValue);
+                        if (key_ == "maximumValue") return &emplaceOptional(m.maximumValue);
+                        if (key_ == "stepValue") return &emplaceOptional(m.stepValue);
+                        if (key_ == "maxLength") return &emplaceOptional(m.maxLength);
+                        if (key_ == "format") return &emplaceOptional(m.format);
+                        return &emplaceOptional(m.units);
+                    }
+                }
+            }
+        };
+
+        template <typename Models>
+        bool parseWith(AccessoryHandler<Models>& handler, const std::string& body, std::string& error) {
+            if (json::sax_parse(body, &handler)) return true;
+            error = handler.error().empty() ? "malformed JSON" : handler.error();
+            return false;
+        }
+
+    } // namespace
+
+    bool parseAccessoryJson(const std::string& body, Accessory& accessory, std::string& error) {
+        accessory = Accessory();
+        AccessoryHandler<HeapModels> handler(&accessory, nullptr);
+        return parseWith(handler, body, error);
+    }
+
+    bool parseAccessoryListJson(const std::string& body, std::vector<Accessory>& accessories, std::string& error) {
+        accessories.clear();
+        AccessoryHandler<HeapModels> handler(nullptr, &accessories);
+        return parseWith(handler, body, error);
+    }
+
+    bool parseAccessoryJson(const std::string& body, pmr::Accessory& accessory, std::string& error) {
+        accessory = pmr::Accessory(accessory.get_allocator());
+        AccessoryHandler<ArenaModels> handler(&accessory, nullptr, accessory.get_allocator());
+        return parseWith(handler, body, error);
+    }
+
+    bool parseAccessoryListJson(const std::string& body, std::pmr::vector<pmr::Accessory>& accessories,
+                                std::string& error) {
+        const size_t existing = accessories.size();
+        AccessoryHandler<ArenaModels> handler(nullptr, &accessories, accessories.get_allocator());
+        if (parseWith(handler, body, error)) return true;
+        accessories.erase(accessories.begin() + static_cast<std::ptrdiff_t>(existing), accessories.end());
+        return false;
+    }
+
+} // namespace prefab
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "prefab/arena.h"
+#include "prefab/models.h"
+
+namespace prefab {
+
+    /**
+     * @brief Parse accessory JSON straight into the model structs
+     *
+     * Builds Accessory, Service and Characteristic values from SAX events
+     * without an intermediate nlohmann::json document, moving each string out
+     * of the parser instead of copying it. Accepts the same input as the
+     * from_json overloads in models.h: required fields must be present,
+     * optional fields may be null or missing, and unknown keys are skipped.
+     *
+     * @param body Complete JSON response body
+     * @param error Receives a description of the problem on failure
+     * @return false if the body is not valid JSON or does not match the model
+     */
+    bool parseAccessoryJson(const std::string& body, Accessory& accessory, std::string& error);
+
+    /**
+     * @brief Like parseAccessoryJson() for a JSON array of accessories
+     */
+    bool parseAccessoryListJson(const std::string& body, std::vector<Accessory>& accessories, std::string& error);
+
+    /**
+     * @brief Parse into an arena model; every allocation uses the accessory's allocator
+     */
+    bool parseAccessoryJson(const std::string& body, pmr::Accessory& accessory, std::string& error);
+
+    /**
+     * @brief Append the accessories of a JSON array to an arena vector
+     *
+     * On failure the vector is left as it was.
+     */
+    bool parseAccessoryListJson(const std::string& body, std::pmr::vector<pmr::Accessory>& accessories,
+                                std::string& error);
+
+} // namespace prefab
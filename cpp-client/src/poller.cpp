@@ -0,0 +1,323 @@
+#include "prefab/poller.h"
+#include "reactor.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace prefab {
+
+    namespace {
+
+        std::string accessoryKey(const std::string& homeName, const std::string& roomName,
+                                 const std::string& accessoryName) {
+            return homeName + '\n' + roomName + '\n' + accessoryName;
+        }
+
+        const Characteristic* findCharacteristic(const Accessory& accessory, const std::string& characteristicType) {
+            if (!accessory.services) return nullptr;
+            const std::optional<Uuid> type = Uuid::parse(characteristicType);
+            for (const auto& service : *accessory.services) {
+                for (const auto& characteristic : service.characteristics) {
+                    if ((type && characteristic.type == *type) || characteristic.typeName == characteristicType) {
+                        return &characteristic;
+                    }
+                }
+            }
+            return nullptr;
+        }
+
+    } // namespace
+
+    /**
+     * @brief The poller's state, shared with the reads and timers in flight
+     *
+     * The wheel advances one slot per tick on the client's reactor thread.
+     * A slot holds the ids of watches whose due tick maps to it; watches due
+     * in a later turn stay put, and ids of removed or rescheduled watches are
+     * dropped when their slot comes up. As in ChangeFeed, each start()
+     * begins a new generation so ticks and reads from before a stop() end.
+     */
+    class Poller::Session : public std::enable_shared_from_this<Session> {
+    public:
+        Session(PrefabClient& client, const PollerOptions& options)
+            : client_(client), options_(normalized(options)), wheel_(options_.wheelSlots),
+              random_(std::random_device()()) {}
+
+        size_t add(const std::string& homeName, const std::string& roomName, const std::string& accessoryName,
+                   const std::string& characteristicType, Callback callback) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const size_t id = nextId_++;
+            Watch& watch = watches_[id];
+            watch.home = homeName;
+            watch.room = roomName;
+            watch.accessory = accessoryName;
+            watch.type = characteristicType;
+            watch.callback = std::move(callback);
+            watch.intervalMs = options_.initialIntervalMs;
+
+            // Spread first reads over the initial interval
+            std::uniform_int_distribution<uint64_t> offset(1, ticks(watch.intervalMs));
+            scheduleLocked(id, watch, tick_ + offset(random_));
+            return id;
+        }
+
+        void remove(size_t id) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            watches_.erase(id);
+        }
+
+        void start() {
+            uint64_t generation;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (running_) return;
+                running_ = true;
+                generation = ++generation_;
+                tokens_ = burst();
+            }
+            scheduleTick(generation);
+        }
+
+        void stop() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+            ++generation_;
+            // Reads in flight are dropped; read those watches first after the next start()
+            for (auto& [id, watch] : watches_) {
+                if (!watch.reading) continue;
+                watch.reading = false;
+                scheduleLocked(id, watch, tick_ + 1);
+            }
+        }
+
+        std::optional<std::string> value(size_t id) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto found = watches_.find(id);
+            if (found == watches_.end()) return std::nullopt;
+            return found->second.value;
+        }
+
+        std::optional<std::chrono::milliseconds> interval(size_t id) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto found = watches_.find(id);
+            if (found == watches_.end()) return std::nullopt;
+            return std::chrono::milliseconds(found->second.intervalMs);
+        }
+
+        PollerStats stats() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return stats_;
+        }
+
+    private:
+        struct Watch {
+            std::string home;
+            std::string room;
+            std::string accessory;
+            std::string type;
+            Callback callback;
+            int intervalMs = 0;
+            uint64_t dueTick = 0;
+            bool reading = false;  // Part of a read in flight; not rescheduled until it returns
+            std::optional<std::string> value;
+        };
+
+        // Watches of one accessory that are due in the same tick
+        struct Read {
+            std::string home;
+            std::string room;
+            std::string accessory;
+            std::vector<size_t> due;
+        };
+
+        static PollerOptions normalized(PollerOptions options) {
+            options.tickMs = std::max(options.tickMs, 1);
+            options.minIntervalMs = std::max(options.minIntervalMs, options.tickMs);
+            options.maxIntervalMs = std::max(options.maxIntervalMs, options.minIntervalMs);
+            options.initialIntervalMs = std::clamp(options.initialIntervalMs, options.minIntervalMs, options.maxIntervalMs);
+            options.wheelSlots = std::max<size_t>(options.wheelSlots, 1);
+            if (!(options.maxRequestsPerSecond > 0)) options.maxRequestsPerSecond = 0;  // Unlimited
+            return options;
+        }
+
+        uint64_t ticks(int ms) const {
+            return std::max<uint64_t>(1, static_cast<uint64_t>((ms + options_.tickMs - 1) / options_.tickMs));
+        }
+
+        // Tokens the bucket may hold: one tick's worth, so the cap cannot be spent in a burst
+        double burst() const {
+            return std::max(1.0, options_.maxRequestsPerSecond * options_.tickMs / 1000.0);
+        }
+
+        void scheduleLocked(size_t id, Watch& watch, uint64_t dueTick) {
+            watch.dueTick = dueTick;
+            wheel_[dueTick % wheel_.size()].push_back(id);
+        }
+
+        // Next read after an interval with +/-10% jitter, so watches do not fall into step
+        void rescheduleLocked(size_t id, Watch& watch) {
+            std::uniform_real_distribution<double> jitter(0.9, 1.1);
+            const int delayMs = static_cast<int>(watch.intervalMs * jitter(random_));
+            scheduleLocked(id, watch, tick_ + ticks(delayMs));
+        }
+
+        void scheduleTick(uint64_t generation) {
+            auto self = shared_from_this();
+            client_.reactor_->schedule(std::chrono::milliseconds(options_.tickMs), [self, generation]() {
+                self->tick(generation);
+            });
+        }
+
+        void tick(uint64_t generation) {
+            std::vector<Read> reads;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!running_ || generation_ != generation) return;
+                tick_++;
+                const double rate = options_.maxRequestsPerSecond * options_.tickMs / 1000.0;
+                tokens_ = std::min(tokens_ + rate, burst());
+
+                std::vector<size_t> slot;
+                slot.swap(wheel_[tick_ % wheel_.size()]);
+                std::map<std::string, size_t> byAccessory;  // Index into reads
+                for (size_t id : slot) {
+                    auto found = watches_.find(id);
+                    if (found == watches_.end()) continue;
+                    Watch& watch = found->second;
+                    if (watch.dueTick != tick_) {
+                        // Due in a later turn of the wheel; entries left behind by a reschedule are dropped
+                        if (watch.dueTick > tick_ && watch.dueTick % wheel_.size() == tick_ % wheel_.size()) {
+                            wheel_[tick_ % wheel_.size()].push_back(id);
+                        }
+                        continue;
+                    }
+                    if (watch.reading) continue;  // Rescheduled when its read returns
+                    watch.reading = true;
+
+                    const std::string key = accessoryKey(watch.home, watch.room, watch.accessory);
+                    auto [entry, inserted] = byAccessory.emplace(key, reads.size());
+                    if (inserted) reads.push_back(Read{watch.home, watch.room, watch.accessory, {}});
+                    reads[entry->second].due.push_back(id);
+                }
+
+                // Reads over the rate cap wait for the next tick
+                size_t allowed = options_.maxRequestsPerSecond > 0 ? 0 : reads.size();
+                while (allowed < reads.size() && tokens_ >= 1.0) {
+                    tokens_ -= 1.0;
+                    allowed++;
+                }
+                for (size_t i = allowed; i < reads.size(); ++i) {
+                    stats_.deferred++;
+                    for (size_t id : reads[i].due) {
+                        Watch& watch = watches_.at(id);
+                        watch.reading = false;
+                        scheduleLocked(id, watch, tick_ + 1);
+                    }
+                }
+                reads.resize(allowed);
+                stats_.reads += reads.size();
+            }
+
+            for (auto& read : reads) issue(generation, std::move(read));
+            scheduleTick(generation);
+        }
+
+        void issue(uint64_t generation, Read read) {
+            // The point of polling is a fresh value, so skip the response cache
+            client_.invalidateAccessoryState(read.home, read.room, read.accessory);
+            auto self = shared_from_this();
+            const std::string home = read.home, room = read.room, accessory = read.accessory;
+            RequestPriorityScope background(RequestPriority::Background);  // Interactive writes go first
+            client_.getAccessoryAsync(home, room, accessory,
+                [self, generation, read = std::move(read)](AsyncResult<Accessory> result) {
+                    self->complete(generation, read, result);
+                });
+        }
+
+        void complete(uint64_t generation, const Read& read, AsyncResult<Accessory>& result) {
+            std::vector<std::pair<Callback, std::string>> notifications;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!running_ || generation_ != generation) return;
+                if (!result.ok()) stats_.errors++;
+
+                for (auto& [id, watch] : watches_) {
+                    if (watch.home != read.home || watch.room != read.room || watch.accessory != read.accessory) continue;
+                    const bool due = std::find(read.due.begin(), read.due.end(), id) != read.due.end();
+
+                    bool changed = false;
+                    if (result.ok()) {
+                        if (const Characteristic* characteristic = findCharacteristic(result.value(), watch.type)) {
+                            changed = watch.value && *watch.value != characteristic->value;
+                            if (changed) notifications.emplace_back(watch.callback, characteristic->value);
+                            watch.value = characteristic->value;
+                        }
+                    }
+                    if (changed) {
+                        watch.intervalMs = std::max(options_.minIntervalMs, watch.intervalMs / 2);
+                    } else if (due && result.ok()) {
+                        watch.intervalMs = std::min(options_.maxIntervalMs, watch.intervalMs + watch.intervalMs / 4 + 1);
+                    }
+                    if (due) {
+                        // Failed reads keep their interval and try again after it
+                        watch.reading = false;
+                        rescheduleLocked(id, watch);
+                    } else if (changed) {
+                        // A change seen by a neighbour's read pulls this watch's next read closer
+                        const uint64_t dueTick = tick_ + ticks(watch.intervalMs);
+                        if (!watch.reading && dueTick < watch.dueTick) scheduleLocked(id, watch, dueTick);
+                    }
+                }
+                stats_.changes += notifications.size();
+            }
+            for (const auto& [callback, value] : notifications) {
+                if (callback) callback(value);
+            }
+        }
+
+        PrefabClient& client_;
+        const PollerOptions options_;
+
+        mutable std::mutex mutex_;
+        std::map<size_t, Watch> watches_;
+        std::vector<std::vector<size_t>> wheel_;
+        std::mt19937 random_;
+        size_t nextId_ = 1;
+        uint64_t tick_ = 0;
+        double tokens_ = 0;
+        bool running_ = false;
+        uint64_t generation_ = 0;
+        PollerStats stats_;
+    };
+
+    Poller::Poller(PrefabClient& client, const PollerOptions& options)
+        : session_(std::make_shared<Session>(client, options)) {}
+
+    Poller::~Poller() {
+        session_->stop();
+    }
+
+    size_t Poller::add(const std::string& homeName, const std::string& roomName, const std::string& accessoryName,
+                       const std::string& characteristicType, Callback callback) {
+        return session_->add(homeName, roomName, accessoryName, characteristicType, std::move(callback));
+    }
+
+    void Poller::remove(size_t id) {
+        session_->remove(id);
+    }
+
+    void Poller::start() {
+        session_->start();
+    }
+
+    void Poller::stop() {
+        session_->stop();
+    }
+
+    std::optional<std::string> Poller::value(size_t id) const { return session_->value(id); }
+    std::optional<std::chrono::milliseconds> Poller::interval(size_t id) const { return session_->interval(id); }
+    PollerStats Poller::stats() const { return session_->stats(); }
+
+} // namespace prefab
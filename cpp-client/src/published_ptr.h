@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace prefab {
+
+    /**
+     * @brief A shared_ptr that many threads read and few threads replace
+     *
+     * std::atomic_load on a shared_ptr takes a lock inside libstdc++. Here
+     * every store gets a version number that is unique across all instances,
+     * and each thread remembers the last few versions it read, as weak
+     * references. A read whose version is still current costs one atomic load
+     * and a weak_ptr::lock(), and takes no lock. Only the first read on a thread
+     * and the first read after a store go through the mutex.
+     *
+     * The per-thread cache holds weak references only, so a replaced value is
+     * released as soon as its last real owner lets go.
+     */
+    template <typename T>
+    class PublishedPtr {
+    public:
+        explicit PublishedPtr(std::shared_ptr<T> value = nullptr)
+            : value_(std::move(value)), version_(nextVersion()) {}
+
+        PublishedPtr(const PublishedPtr&) = delete;
+        PublishedPtr& operator=(const PublishedPtr&) = delete;
+
+        std::shared_ptr<T> load() const {
+            const uint64_t version = version_.load(std::memory_order_acquire);
+            Cache& cache = threadCache();
+            for (const Entry& entry : cache.entries) {
+                if (entry.version != version) continue;
+                if (std::shared_ptr<T> value = entry.value.lock()) return value;
+                if (entry.empty) return nullptr;
+                break;  // Replaced since the version was read; ask under the lock
+            }
+
+            std::shared_ptr<T> value;
+            Entry fresh;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                value = value_;
+                fresh.version = version_.load(std::memory_order_relaxed);
+            }
+            fresh.value = value;
+            fresh.empty = !value;
+            cache.entries[cache.next] = std::move(fresh);
+            cache.next = (cache.next + 1) % cache.entries.size();
+            return value;
+        }
+
+        void store(std::shared_ptr<T> value) {
+            std::shared_ptr<T> previous;  // Released outside the lock
+            std::lock_guard<std::mutex> lock(mutex_);
+            previous = std::move(value_);
+            value_ = std::move(value);
+            version_.store(nextVersion(), std::memory_order_release);
+        }
+
+    private:
+        struct Entry {
+            uint64_t version = 0;  // 0: unused
+            std::weak_ptr<T> value;
+            bool empty = false;    // The stored value was null
+        };
+
+        // A few slots, so a thread reading several instances in turn still hits
+        struct Cache {
+            std::array<Entry, 4> entries;
+            size_t next = 0;
+        };
+
+        static uint64_t nextVersion() {
+            static std::atomic<uint64_t> counter{0};
+            return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        static Cache& threadCache() {
+            static thread_local Cache cache;
+            return cache;
+        }
+
+        mutable std::mutex mutex_;
+        std::shared_ptr<T> value_;
+        std::atomic<uint64_t> version_;
+    };
+
+} // namespace prefab
@@ -0,0 +1,167 @@
+#include "reactor.h"
+#include "prefab/client.h"
+#include <algorithm>
+
+namespace prefab {
+
+    Reactor::Reactor() {
+        multi_ = curl_multi_init();
+        if (!multi_) {
+            throw PrefabException("Failed to initialize CURL multi handle");
+        }
+    }
+
+    Reactor::~Reactor() {
+        shutdown();
+        curl_multi_cleanup(multi_);
+    }
+
+    void Reactor::shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (shutDown_) return;
+            shutDown_ = true;
+            stopping_ = true;
+        }
+        curl_multi_wakeup(multi_);
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        abortAll();
+    }
+
+    void Reactor::submit(CURL* handle, Completion done) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!stopping_) {
+                incoming_.emplace_back(handle, std::move(done));
+                startLocked();
+                done = nullptr;
+            }
+        }
+
+        if (done) {
+            // Shutting down: fail the request immediately rather than leak it
+            done(CURLE_ABORTED_BY_CALLBACK);
+            return;
+        }
+        curl_multi_wakeup(multi_);
+    }
+
+    void Reactor::schedule(std::chrono::milliseconds delay, Task task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            timers_.push(Timer{Clock::now() + delay, timerSequence_++, std::move(task)});
+            startLocked();
+        }
+        curl_multi_wakeup(multi_);
+    }
+
+    void Reactor::startLocked() {
+        if (!started_) {
+            started_ = true;
+            thread_ = std::thread(&Reactor::run, this);
+        }
+    }
+
+    void Reactor::run() {
+        std::vector<std::pair<CURL*, Completion>> batch;
+
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_) break;
+                batch.swap(incoming_);
+            }
+
+            for (auto& entry : batch) {
+                CURLMcode rc = curl_multi_add_handle(multi_, entry.first);
+                if (rc != CURLM_OK) {
+                    try {
+                        entry.second(CURLE_FAILED_INIT);
+                    } catch (...) {}
+                    continue;
+                }
+                active_.emplace(entry.first, std::move(entry.second));
+            }
+            batch.clear();
+
+            int running = 0;
+            curl_multi_perform(multi_, &running);
+            completeFinished();
+
+            int timeoutMs = runDueTimers();
+            curl_multi_poll(multi_, nullptr, 0, timeoutMs, nullptr);
+        }
+    }
+
+    void Reactor::completeFinished() {
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi_, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            CURL* handle = msg->easy_handle;
+            CURLcode result = msg->data.result;
+            curl_multi_remove_handle(multi_, handle);
+
+            auto it = active_.find(handle);
+            if (it == active_.end()) continue;
+            Completion done = std::move(it->second);
+            active_.erase(it);
+
+            try {
+                done(result);
+            } catch (...) {
+                // A throwing completion must not take down the event loop
+            }
+        }
+    }
+
+    // Fire every timer that is due; returns how long the loop may sleep before the next one
+    int Reactor::runDueTimers() {
+        int timeoutMs = 1000;
+        while (true) {
+            Task task;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (timers_.empty()) break;
+
+                Clock::time_point now = Clock::now();
+                const Timer& next = timers_.top();
+                if (next.due > now) {
+                    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next.due - now).count() + 1;
+                    timeoutMs = static_cast<int>(std::min<long long>(wait, timeoutMs));
+                    break;
+                }
+                task = std::move(const_cast<Timer&>(next).task);
+                timers_.pop();
+            }
+
+            try {
+                task();
+            } catch (...) {}
+        }
+        return timeoutMs;
+    }
+
+    void Reactor::abortAll() {
+        std::vector<std::pair<CURL*, Completion>> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending.swap(incoming_);
+        }
+        for (auto& entry : active_) {
+            curl_multi_remove_handle(multi_, entry.first);
+            pending.emplace_back(entry.first, std::move(entry.second));
+        }
+        active_.clear();
+
+        for (auto& entry : pending) {
+            try {
+                entry.second(CURLE_ABORTED_BY_CALLBACK);
+            } catch (...) {}
+        }
+    }
+
+} // namespace prefab
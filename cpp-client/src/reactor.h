@@ -0,0 +1,100 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace prefab {
+
+    /**
+     * @brief Single-threaded curl multi event loop
+     *
+     * Easy handles submitted from any thread are added to one curl multi handle
+     * and driven by a dedicated reactor thread, so any number of requests can be
+     * in flight without a thread per request. The completion for a handle is
+     * invoked on the reactor thread once the transfer finishes; completions must
+     * not block.
+     *
+     * The reactor also runs one-shot timers on the same thread, which lets
+     * components delay work without a thread of their own.
+     *
+     * The reactor thread is started on the first submission. Transfers still in
+     * flight when the reactor is destroyed complete with CURLE_ABORTED_BY_CALLBACK;
+     * timers that have not fired yet are discarded.
+     */
+    class Reactor {
+    public:
+        using Completion = std::function<void(CURLcode)>;
+        using Task = std::function<void()>;
+
+        Reactor();
+        ~Reactor();
+
+        Reactor(const Reactor&) = delete;
+        Reactor& operator=(const Reactor&) = delete;
+
+        /**
+         * @brief Stop the reactor thread and fail everything in flight; idempotent
+         *
+         * Completions run during shutdown may still call submit() and schedule()
+         * on this reactor: submissions fail at once and timers are dropped. The
+         * destructor calls this too, but owners whose completions reach the
+         * reactor through a member pointer should call it before resetting that
+         * pointer.
+         */
+        void shutdown();
+
+        /**
+         * @brief Queue a configured easy handle for transfer
+         *
+         * Ownership of the handle stays with the caller; it is removed from the
+         * multi handle before the completion runs.
+         */
+        void submit(CURL* handle, Completion done);
+
+        /**
+         * @brief Run a task on the reactor thread once the delay has elapsed
+         */
+        void schedule(std::chrono::milliseconds delay, Task task);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Timer {
+            Clock::time_point due;
+            uint64_t sequence;  // Keeps timers with the same deadline in scheduling order
+            Task task;
+
+            bool operator>(const Timer& other) const {
+                return due != other.due ? due > other.due : sequence > other.sequence;
+            }
+        };
+
+        void startLocked();
+        void run();
+        void completeFinished();
+        int runDueTimers();
+        void abortAll();
+
+        CURLM* multi_ = nullptr;
+        std::thread thread_;
+
+        std::mutex mutex_;
+        std::vector<std::pair<CURL*, Completion>> incoming_;
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+        uint64_t timerSequence_ = 0;
+        bool started_ = false;
+        bool stopping_ = false;
+        bool shutDown_ = false;  // shutdown() has finished or is running
+
+        // Owned by the reactor thread
+        std::unordered_map<CURL*, Completion> active_;
+    };
+
+} // namespace prefab
@@ -0,0 +1,210 @@
+#include "request_scheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace prefab {
+
+    static constexpr size_t kMaxIdleBuckets = 1024;
+
+    static const char* const kPriorityNames[] = {"interactive", "normal", "background"};
+
+    RequestScheduler::RequestScheduler(Reactor& reactor, const SchedulingConfig& config)
+        : reactor_(reactor),
+          serverLimit_{config.serverRate, std::max(config.serverBurst, 1)},
+          accessoryLimit_{config.accessoryRate, std::max(config.accessoryBurst, 1)},
+          maxQueued_(std::max<size_t>(config.maxQueued, 1)) {}
+
+    std::string RequestScheduler::keyFor(const std::string& server, const std::string& accessory) {
+        std::string key = server;
+        key.push_back('\0');
+        key += accessory;
+        return key;
+    }
+
+    RequestScheduler::Bucket& RequestScheduler::refill(std::unordered_map<std::string, Bucket>& buckets,
+                                                       const std::string& key, const Limit& limit,
+                                                       Clock::time_point now) {
+        auto [it, created] = buckets.try_emplace(key);
+        Bucket& bucket = it->second;
+        if (created) {
+            bucket.tokens = limit.burst;
+        } else {
+            const double elapsed = std::chrono::duration<double>(now - bucket.refilled).count();
+            bucket.tokens = std::min<double>(limit.burst, bucket.tokens + elapsed * limit.rate);
+        }
+        bucket.refilled = now;
+        return bucket;
+    }
+
+    RequestScheduler::Clock::time_point RequestScheduler::refillAt(const Bucket& bucket, const Limit& limit) {
+        const double missing = std::max(1.0 - bucket.tokens, 0.0);
+        return bucket.refilled + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(missing / limit.rate));
+    }
+
+    // Buckets that have refilled completely behave like new ones, so they can go
+    void RequestScheduler::prune(std::unordered_map<std::string, Bucket>& buckets, const Limit& limit,
+                                 Clock::time_point now) {
+        if (buckets.size() <= kMaxIdleBuckets) return;
+        for (auto it = buckets.begin(); it != buckets.end();) {
+            const double elapsed = std::chrono::duration<double>(now - it->second.refilled).count();
+            if (it->second.tokens + elapsed * limit.rate >= limit.burst) {
+                it = buckets.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void RequestScheduler::submit(RequestPriority priority, const std::string& server, const std::string& accessory,
+                                  std::optional<Clock::time_point> deadline, Start start, Reject reject) {
+        const char* refusal = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Queue& queue = queues_[static_cast<size_t>(priority)];
+            if (closed_) {
+                refusal = "Request cancelled: client is shutting down";
+            } else if (queue.entries.size() >= maxQueued_) {
+                refusal = "Request queue full";
+            }
+            if (refusal) {
+                queue.rejected.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                queue.entries.push_back(
+                    Entry{server, accessory, deadline, Clock::now(), std::move(start), std::move(reject)});
+                queued_++;
+            }
+        }
+        if (refusal) {
+            reject(std::make_exception_ptr(PrefabException(refusal)));
+        } else {
+            pump();
+        }
+    }
+
+    // Starts whatever the buckets allow, highest priority first, and arms a timer for the rest
+    void RequestScheduler::pump() {
+        std::vector<Start> started;
+        std::vector<Reject> expired;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closed_) return;
+            const Clock::time_point now = Clock::now();
+            if (wakeAt_ && *wakeAt_ <= now) wakeAt_.reset();
+
+            std::optional<Clock::time_point> next;
+            auto wakeBy = [&next](Clock::time_point at) { next = next ? std::min(*next, at) : at; };
+
+            for (Queue& queue : queues_) {
+                for (auto it = queue.entries.begin(); it != queue.entries.end();) {
+                    Entry& entry = *it;
+                    if (entry.deadline && now >= *entry.deadline) {
+                        queue.rejected.fetch_add(1, std::memory_order_relaxed);
+                        expired.push_back(std::move(entry.reject));
+                        it = queue.entries.erase(it);
+                        queued_--;
+                        continue;
+                    }
+
+                    Bucket* serverBucket = nullptr;
+                    Bucket* accessoryBucket = nullptr;
+                    bool blocked = false;
+                    if (serverLimit_.rate > 0) {
+                        serverBucket = &refill(servers_, entry.server, serverLimit_, now);
+                        if (serverBucket->tokens < 1) {
+                            wakeBy(refillAt(*serverBucket, serverLimit_));
+                            blocked = true;
+                        }
+                    }
+                    if (!entry.accessory.empty() && accessoryLimit_.rate > 0) {
+                        accessoryBucket = &refill(accessories_, keyFor(entry.server, entry.accessory),
+                                                  accessoryLimit_, now);
+                        if (accessoryBucket->tokens < 1) {
+                            wakeBy(refillAt(*accessoryBucket, accessoryLimit_));
+                            blocked = true;
+                        }
+                    }
+                    if (blocked) {
+                        if (entry.deadline) wakeBy(*entry.deadline);
+                        ++it;
+                        continue;
+                    }
+
+                    if (serverBucket) serverBucket->tokens -= 1;
+                    if (accessoryBucket) accessoryBucket->tokens -= 1;
+                    queue.admitted.fetch_add(1, std::memory_order_relaxed);
+                    queue.wait.record(std::chrono::duration_cast<std::chrono::microseconds>(now - entry.queued));
+                    started.push_back(std::move(entry.start));
+                    it = queue.entries.erase(it);
+                    queued_--;
+                }
+            }
+
+            prune(accessories_, accessoryLimit_, now);
+            prune(servers_, serverLimit_, now);
+            if (queued_ > 0 && next) armLocked(*next);
+        }
+
+        for (auto& reject : expired) {
+            try {
+                reject(std::make_exception_ptr(PrefabException("Deadline exceeded")));
+            } catch (...) {}
+        }
+        for (auto& start : started) {
+            try {
+                start();
+            } catch (...) {
+                // A request that failed to start must not keep the others from starting
+            }
+        }
+    }
+
+    void RequestScheduler::armLocked(Clock::time_point wakeAt) {
+        if (wakeAt_ && *wakeAt_ <= wakeAt) return;  // An earlier timer will look again
+        wakeAt_ = wakeAt;
+        const auto delay = std::max(std::chrono::ceil<std::chrono::milliseconds>(wakeAt - Clock::now()),
+                                    std::chrono::milliseconds(1));
+        std::weak_ptr<RequestScheduler> weak = weak_from_this();
+        reactor_.schedule(delay, [weak]() {
+            if (auto self = weak.lock()) self->pump();
+        });
+    }
+
+    void RequestScheduler::shutdown() {
+        std::vector<Reject> queued;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            for (Queue& queue : queues_) {
+                queue.rejected.fetch_add(queue.entries.size(), std::memory_order_relaxed);
+                for (Entry& entry : queue.entries) queued.push_back(std::move(entry.reject));
+                queue.entries.clear();
+            }
+            queued_ = 0;
+        }
+
+        for (auto& reject : queued) {
+            try {
+                reject(std::make_exception_ptr(PrefabException("Request cancelled: client is shutting down")));
+            } catch (...) {}
+        }
+    }
+
+    std::vector<QueueMetrics> RequestScheduler::stats() const {
+        std::vector<QueueMetrics> stats;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < kPriorities; ++i) {
+            const Queue& queue = queues_[i];
+            QueueMetrics metrics;
+            metrics.priority = kPriorityNames[i];
+            metrics.depth = queue.entries.size();
+            metrics.admitted = queue.admitted.load(std::memory_order_relaxed);
+            metrics.rejected = queue.rejected.load(std::memory_order_relaxed);
+            metrics.wait = queue.wait.snapshot();
+            stats.push_back(std::move(metrics));
+        }
+        return stats;
+    }
+
+} // namespace prefab
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "prefab/client.h"
+#include "metrics_registry.h"
+#include "reactor.h"
+
+namespace prefab {
+
+    /**
+     * @brief Admits requests under per-server and per-accessory rate limits, by priority
+     *
+     * Each server and each accessory has a token bucket. A request is started
+     * once both of its buckets hold a token; until then it waits in the queue
+     * of its priority. Queues are served from the highest priority down, and a
+     * request blocked only by its accessory's bucket does not hold up requests
+     * for other accessories behind it.
+     *
+     * Create it with std::make_shared: wake-up timers keep references to it.
+     */
+    class RequestScheduler : public std::enable_shared_from_this<RequestScheduler> {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Start = std::function<void()>;
+        using Reject = std::function<void(std::exception_ptr)>;
+
+        /**
+         * @param reactor Runs wake-up timers; must outlive the scheduler's use
+         */
+        RequestScheduler(Reactor& reactor, const SchedulingConfig& config);
+
+        /**
+         * @brief Start the request now or once the limits allow
+         *
+         * Exactly one of start and reject is called, possibly before submit()
+         * returns. Both run without the scheduler's lock held.
+         *
+         * @param server Base URL the request goes to
+         * @param accessory Key of the accessory it addresses; empty if none
+         * @param deadline Queued requests are rejected once it passes
+         */
+        void submit(RequestPriority priority, const std::string& server, const std::string& accessory,
+                    std::optional<Clock::time_point> deadline, Start start, Reject reject);
+
+        /**
+         * @brief Reject every queued request and stop accepting new ones
+         */
+        void shutdown();
+
+        /**
+         * @brief Depth, admissions, rejections and wait times of each priority class
+         */
+        std::vector<QueueMetrics> stats() const;
+
+    private:
+        static constexpr size_t kPriorities = 3;
+
+        struct Bucket {
+            double tokens = 0;
+            Clock::time_point refilled;
+        };
+
+        struct Entry {
+            std::string server;
+            std::string accessory;
+            std::optional<Clock::time_point> deadline;
+            Clock::time_point queued;
+            Start start;
+            Reject reject;
+        };
+
+        struct Queue {
+            std::deque<Entry> entries;
+            std::atomic<uint64_t> admitted{0};
+            std::atomic<uint64_t> rejected{0};
+            LatencyHistogram wait;
+        };
+
+        struct Limit {
+            double rate;
+            int burst;
+        };
+
+        static std::string keyFor(const std::string& server, const std::string& accessory);
+
+        // Tops the bucket up to now; creates a full bucket on first use
+        static Bucket& refill(std::unordered_map<std::string, Bucket>& buckets, const std::string& key,
+                              const Limit& limit, Clock::time_point now);
+        // When the bucket will next hold a whole token
+        static Clock::time_point refillAt(const Bucket& bucket, const Limit& limit);
+        static void prune(std::unordered_map<std::string, Bucket>& buckets, const Limit& limit, Clock::time_point now);
+
+        void pump();
+        void armLocked(Clock::time_point wakeAt);
+
+        Reactor& reactor_;
+        const Limit serverLimit_;
+        const Limit accessoryLimit_;
+        const size_t maxQueued_;
+
+        mutable std::mutex mutex_;
+        std::array<Queue, kPriorities> queues_;
+        size_t queued_ = 0;
+        std::unordered_map<std::string, Bucket> servers_;
+        std::unordered_map<std::string, Bucket> accessories_;
+        std::optional<Clock::time_point> wakeAt_;  // Earliest wake-up timer armed
+        bool closed_ = false;
+    };
+
+} // namespace prefab
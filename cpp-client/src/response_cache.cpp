@@ -0,0 +1,133 @@
+#include "response_cache.h"
+
+namespace prefab {
+
+    static constexpr size_t kMaxInvalidations = 1024;
+
+    ResponseCache::ResponseCache(size_t maxBytes) : maxBytes_(maxBytes) {}
+
+    size_t ResponseCache::footprint(const Entry& entry) {
+        // Body and key dominate; the constant approximates list/map node overhead
+        return entry.key.size() * 2 + entry.body->size() + 128;
+    }
+
+    ResponseCache::Body ResponseCache::get(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            stats_.misses++;
+            return nullptr;
+        }
+
+        if (std::chrono::steady_clock::now() >= it->second->expires) {
+            eraseLocked(it);
+            stats_.misses++;
+            return nullptr;
+        }
+
+        lru_.splice(lru_.begin(), lru_, it->second);
+        stats_.hits++;
+        return it->second->body;
+    }
+
+    void ResponseCache::put(const std::string& key, std::string body, std::chrono::milliseconds ttl, uint64_t startedAt) {
+        if (ttl.count() <= 0) return;
+
+        Entry entry{key, std::make_shared<const std::string>(std::move(body)),
+                    std::chrono::steady_clock::now() + ttl};
+        size_t size = footprint(entry);
+        if (size > maxBytes_) return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (invalidatedSinceLocked(key, startedAt)) {
+            // Invalidated while the request was in flight; the body may predate a write
+            return;
+        }
+
+        auto existing = index_.find(key);
+        if (existing != index_.end()) {
+            eraseLocked(existing);
+        }
+
+        while (bytes_ + size > maxBytes_ && !lru_.empty()) {
+            eraseLocked(index_.find(lru_.back().key));
+            stats_.evictions++;
+        }
+
+        lru_.push_front(std::move(entry));
+        index_.emplace(key, lru_.begin());
+        bytes_ += size;
+    }
+
+    bool ResponseCache::invalidatedSinceLocked(const std::string& key, uint64_t startedAt) const {
+        if (floor_ > startedAt) return true;
+        auto exact = invalidatedKeys_.find(key);
+        if (exact != invalidatedKeys_.end() && exact->second > startedAt) return true;
+        // Keys are paths, so every prefix that can cover one ends at one of its slashes
+        for (size_t slash = key.find('/'); slash != std::string::npos; slash = key.find('/', slash + 1)) {
+            auto prefix = invalidatedPrefixes_.find(key.substr(0, slash + 1));
+            if (prefix != invalidatedPrefixes_.end() && prefix->second > startedAt) return true;
+        }
+        return false;
+    }
+
+    uint64_t ResponseCache::bumpLocked() {
+        const uint64_t generation = generation_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        if (invalidatedKeys_.size() + invalidatedPrefixes_.size() >= kMaxInvalidations) {
+            floor_ = generation - 1;
+            invalidatedKeys_.clear();
+            invalidatedPrefixes_.clear();
+        }
+        return generation;
+    }
+
+    void ResponseCache::invalidate(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        invalidatedKeys_[key] = bumpLocked();
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            eraseLocked(it);
+        }
+    }
+
+    void ResponseCache::invalidatePrefix(const std::string& prefix) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint64_t generation = bumpLocked();
+        if (!prefix.empty() && prefix.back() == '/') {
+            invalidatedPrefixes_[prefix] = generation;
+        } else {
+            floor_ = generation;  // Not a path prefix that put() could look up; drop everything in flight
+        }
+        auto it = index_.lower_bound(prefix);
+        while (it != index_.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+            auto next = std::next(it);
+            eraseLocked(it);
+            it = next;
+        }
+    }
+
+    void ResponseCache::clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        floor_ = generation_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        invalidatedKeys_.clear();
+        invalidatedPrefixes_.clear();
+        index_.clear();
+        lru_.clear();
+        bytes_ = 0;
+    }
+
+    CacheStats ResponseCache::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        CacheStats stats = stats_;
+        stats.entries = index_.size();
+        stats.bytes = bytes_;
+        return stats;
+    }
+
+    void ResponseCache::eraseLocked(std::map<std::string, LruList::iterator>::iterator it) {
+        bytes_ -= footprint(*it->second);
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+} // namespace prefab
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "prefab/client.h"
+
+namespace prefab {
+
+    /**
+     * @brief LRU cache of raw GET response bodies keyed by request path
+     *
+     * Entries expire after a per-entry TTL and the least recently used entries
+     * are evicted once the total size exceeds the byte budget. Keys are kept in
+     * an ordered map so that a whole subtree (for example every accessory of a
+     * home) can be invalidated by path prefix.
+     *
+     * Every invalidation bumps a generation counter and records the generation
+     * at which its key or prefix was invalidated. A response is only stored if
+     * its own key was not invalidated since its request was started, so a read
+     * that raced with a write can never re-insert pre-write data, while writes
+     * elsewhere do not cost unrelated reads their cache entry.
+     *
+     * The cache is safe to use from multiple threads.
+     */
+    class ResponseCache {
+    public:
+        using Body = std::shared_ptr<const std::string>;
+
+        explicit ResponseCache(size_t maxBytes);
+
+        /**
+         * @brief Fresh body for the key, or null on a miss or expired entry
+         */
+        Body get(const std::string& key);
+
+        /**
+         * @brief Current invalidation generation; capture it before issuing a request
+         */
+        uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+        /**
+         * @brief Store a body unless its key was invalidated after @p startedAt
+         */
+        void put(const std::string& key, std::string body, std::chrono::milliseconds ttl, uint64_t startedAt);
+
+        void invalidate(const std::string& key);
+        void invalidatePrefix(const std::string& prefix);
+        void clear();
+
+        CacheStats stats() const;
+
+    private:
+        struct Entry {
+            std::string key;
+            Body body;
+            std::chrono::steady_clock::time_point expires;
+        };
+
+        using LruList = std::list<Entry>;
+
+        static size_t footprint(const Entry& entry);
+        void eraseLocked(std::map<std::string, LruList::iterator>::iterator it);
+        bool invalidatedSinceLocked(const std::string& key, uint64_t startedAt) const;
+        // Returns the generation of the new invalidation
+        uint64_t bumpLocked();
+
+        size_t maxBytes_;
+        std::atomic<uint64_t> generation_{0};
+
+        // Generation of the latest invalidation of each key and prefix. Once
+        // there are too many, they are folded into floor_: everything started
+        // before it is treated as invalidated.
+        std::map<std::string, uint64_t> invalidatedKeys_;
+        std::map<std::string, uint64_t> invalidatedPrefixes_;
+        uint64_t floor_ = 0;
+
+        mutable std::mutex mutex_;
+        LruList lru_;  // Most recently used at the front
+        std::map<std::string, LruList::iterator> index_;
+        size_t bytes_ = 0;
+        CacheStats stats_;
+    };
+
+} // namespace prefab
@@ -0,0 +1,317 @@
+#include "prefab/snapshot.h"
+#include "prefab/client.h"
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace prefab {
+
+    using Clock = std::chrono::steady_clock;
+
+    size_t HomeSnapshot::roomCount() const {
+        size_t count = 0;
+        for (const auto& home : homes) {
+            count += home.rooms.size();
+        }
+        return count;
+    }
+
+    size_t HomeSnapshot::accessoryCount() const {
+        size_t count = 0;
+        for (const auto& home : homes) {
+            for (const auto& room : home.rooms) {
+                count += room.accessories.size();
+            }
+        }
+        return count;
+    }
+
+    const Accessory* HomeSnapshot::findAccessory(const std::string& homeName,
+                                                 const std::string& roomName,
+                                                 const std::string& accessoryName) const {
+        for (const auto& home : homes) {
+            if (home.home.name != homeName) continue;
+            for (const auto& room : home.rooms) {
+                if (room.room.name != roomName) continue;
+                for (const auto& accessory : room.accessories) {
+                    if (accessory.name == accessoryName) return &accessory;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    namespace {
+
+        /**
+         * @brief Drives one snapshot crawl over the client's asynchronous API
+         *
+         * Each level is expanded as soon as its parent response arrives, so the
+         * crawl is pipelined across homes and rooms instead of level by level.
+         * A simple admission queue keeps at most maxParallel requests in flight.
+         * Result vectors are sized before their children are launched, so every
+         * response writes to a fixed slot; all mutation happens under mutex_.
+         */
+        class SnapshotCrawler : public std::enable_shared_from_this<SnapshotCrawler> {
+        public:
+            SnapshotCrawler(PrefabClient& client, const SnapshotOptions& options, AsyncCallback<HomeSnapshot> done)
+                : client_(client),
+                  options_(options),
+                  maxParallel_(static_cast<size_t>(std::max(options.maxParallelRequests, 1))),
+                  done_(std::move(done)) {}
+
+            void start() {
+                started_ = Clock::now();
+                auto self = shared_from_this();
+                launch(Homes, [self](std::function<void()> finished) {
+                    self->client_.getHomesAsync([self, finished](AsyncResult<std::vector<Home>> result) {
+                        self->onHomes(std::move(result));
+                        finished();
+                    });
+                });
+            }
+
+        private:
+            using Launch = std::function<void(std::function<void()> finished)>;
+
+            enum Phase { Homes, Rooms, Accessories, Details, PhaseCount };
+
+            struct PhaseTiming {
+                Clock::time_point first = Clock::time_point::max();
+                Clock::time_point last = Clock::time_point::min();
+            };
+
+            PrefabClient& client_;
+            SnapshotOptions options_;
+            size_t maxParallel_;
+            AsyncCallback<HomeSnapshot> done_;
+
+            std::mutex mutex_;
+            HomeSnapshot snapshot_;
+            std::exception_ptr fatal_;
+            std::deque<std::function<void()>> queued_;
+            size_t inFlight_ = 0;
+            size_t outstanding_ = 0;
+            Clock::time_point started_;
+            PhaseTiming timings_[PhaseCount];
+
+            CrawlPhaseStats& stats(Phase phase) {
+                switch (phase) {
+                    case Homes: return snapshot_.stats.homes;
+                    case Rooms: return snapshot_.stats.rooms;
+                    case Accessories: return snapshot_.stats.accessories;
+                    default: return snapshot_.stats.details;
+                }
+            }
+
+            // Queue a request; it starts immediately if a parallelism slot is free
+            void launch(Phase phase, Launch request) {
+                auto self = shared_from_this();
+                std::function<void()> run = [self, phase, request = std::move(request)]() {
+                    Clock::time_point begin = Clock::now();
+                    {
+                        std::lock_guard<std::mutex> lock(self->mutex_);
+                        PhaseTiming& timing = self->timings_[phase];
+                        timing.first = std::min(timing.first, begin);
+                        self->stats(phase).requests++;
+                    }
+                    request([self, phase, begin]() { self->finished(phase, begin); });
+                };
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    outstanding_++;
+                    if (inFlight_ >= maxParallel_) {
+                        queued_.push_back(std::move(run));
+                        return;
+                    }
+                    inFlight_++;
+                    snapshot_.stats.peakInFlight = std::max(snapshot_.stats.peakInFlight, inFlight_);
+                }
+                run();
+            }
+
+            void finished(Phase phase, Clock::time_point begin) {
+                Clock::time_point end = Clock::now();
+                std::function<void()> next;
+                bool allDone = false;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+                    CrawlPhaseStats& phaseStats = stats(phase);
+                    phaseStats.totalLatency += latency;
+                    phaseStats.maxLatency = std::max(phaseStats.maxLatency, latency);
+                    PhaseTiming& timing = timings_[phase];
+                    timing.last = std::max(timing.last, end);
+
+                    outstanding_--;
+                    if (!queued_.empty()) {
+                        next = std::move(queued_.front());
+                        queued_.pop_front();
+                    } else {
+                        inFlight_--;
+                        allDone = outstanding_ == 0;
+                    }
+                }
+
+                if (next) {
+                    next();
+                } else if (allDone) {
+                    complete();
+                }
+            }
+
+            void fail(Phase phase, const std::string& what, std::exception_ptr error) {
+                std::string message = what;
+                try {
+                    std::rethrow_exception(error);
+                } catch (const std::exception& e) {
+                    message += ": " + std::string(e.what());
+                } catch (...) {}
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                stats(phase).failures++;
+                snapshot_.stats.errors.push_back(std::move(message));
+            }
+
+            void onHomes(AsyncResult<std::vector<Home>> result) {
+                if (!result.ok()) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    fatal_ = result.error();
+                    snapshot_.stats.homes.failures++;
+                    return;
+                }
+
+                std::vector<Home>& homes = result.value();
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    snapshot_.homes.resize(homes.size());
+                    for (size_t h = 0; h < homes.size(); ++h) {
+                        snapshot_.homes[h].home = homes[h];
+                    }
+                }
+
+                auto self = shared_from_this();
+                for (size_t h = 0; h < homes.size(); ++h) {
+                    std::string homeName = homes[h].name;
+                    launch(Rooms, [self, h, homeName](std::function<void()> finished) {
+                        self->client_.getRoomsAsync(homeName, [self, h, homeName, finished](AsyncResult<std::vector<Room>> rooms) {
+                            self->onRooms(h, homeName, std::move(rooms));
+                            finished();
+                        });
+                    });
+                }
+            }
+
+            void onRooms(size_t h, const std::string& homeName, AsyncResult<std::vector<Room>> result) {
+                if (!result.ok()) {
+                    fail(Rooms, "rooms of " + homeName, result.error());
+                    return;
+                }
+
+                std::vector<Room>& rooms = result.value();
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    auto& nodes = snapshot_.homes[h].rooms;
+                    nodes.resize(rooms.size());
+                    for (size_t r = 0; r < rooms.size(); ++r) {
+                        nodes[r].room = rooms[r];
+                    }
+                }
+
+                auto self = shared_from_this();
+                for (size_t r = 0; r < rooms.size(); ++r) {
+                    std::string roomName = rooms[r].name;
+                    launch(Accessories, [self, h, r, homeName, roomName](std::function<void()> finished) {
+                        self->client_.getAccessoriesAsync(homeName, roomName,
+                            [self, h, r, homeName, roomName, finished](AsyncResult<std::vector<Accessory>> accessories) {
+                                self->onAccessories(h, r, homeName, roomName, std::move(accessories));
+                                finished();
+                            });
+                    });
+                }
+            }
+
+            void onAccessories(size_t h, size_t r, const std::string& homeName, const std::string& roomName,
+                               AsyncResult<std::vector<Accessory>> result) {
+                if (!result.ok()) {
+                    fail(Accessories, "accessories of " + homeName + "/" + roomName, result.error());
+                    return;
+                }
+
+                std::vector<Accessory>& accessories = result.value();
+                std::vector<std::string> names;
+                names.reserve(accessories.size());
+                for (const auto& accessory : accessories) {
+                    names.push_back(accessory.name);
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    snapshot_.homes[h].rooms[r].accessories = std::move(accessories);
+                }
+
+                if (!options_.includeDetails) return;
+
+                auto self = shared_from_this();
+                for (size_t a = 0; a < names.size(); ++a) {
+                    std::string accessoryName = names[a];
+                    launch(Details, [self, h, r, a, homeName, roomName, accessoryName](std::function<void()> finished) {
+                        self->client_.getAccessoryAsync(homeName, roomName, accessoryName,
+                            [self, h, r, a, homeName, roomName, accessoryName, finished](AsyncResult<Accessory> detail) {
+                                if (detail.ok()) {
+                                    std::lock_guard<std::mutex> lock(self->mutex_);
+                                    self->snapshot_.homes[h].rooms[r].accessories[a] = std::move(detail.value());
+                                } else {
+                                    self->fail(Details,
+                                               "accessory " + homeName + "/" + roomName + "/" + accessoryName,
+                                               detail.error());
+                                }
+                                finished();
+                            });
+                    });
+                }
+            }
+
+            void complete() {
+                AsyncResult<HomeSnapshot> result;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    snapshot_.stats.totalTime = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started_);
+
+                    auto wall = [](const PhaseTiming& timing) {
+                        if (timing.last < timing.first) return std::chrono::microseconds(0);
+                        return std::chrono::duration_cast<std::chrono::microseconds>(timing.last - timing.first);
+                    };
+                    for (int phase = 0; phase < PhaseCount; ++phase) {
+                        this->stats(static_cast<Phase>(phase)).wallTime = wall(timings_[phase]);
+                    }
+
+                    result = fatal_ ? AsyncResult<HomeSnapshot>::failure(fatal_)
+                                    : AsyncResult<HomeSnapshot>::success(std::move(snapshot_));
+                }
+                done_(std::move(result));
+            }
+        };
+
+    } // namespace
+
+    void PrefabClient::getSnapshotAsync(const SnapshotOptions& options, AsyncCallback<HomeSnapshot> callback) {
+        auto crawler = std::make_shared<SnapshotCrawler>(*this, options, std::move(callback));
+        crawler->start();
+    }
+
+    HomeSnapshot PrefabClient::getSnapshot(const SnapshotOptions& options) {
+        auto promise = std::make_shared<std::promise<HomeSnapshot>>();
+        std::future<HomeSnapshot> future = promise->get_future();
+        getSnapshotAsync(options, [promise](AsyncResult<HomeSnapshot> result) {
+            if (result.ok()) {
+                promise->set_value(std::move(result.value()));
+            } else {
+                promise->set_exception(result.error());
+            }
+        });
+        return future.get();
+    }
+
+} // namespace prefab
@@ -0,0 +1,771 @@
+#include "prefab/snapshot_file.h"
+#include "prefab/client.h"
+#include "characteristic_index.h"
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace prefab {
+
+    /*
+     * File layout, version 1, native byte order (checked through byteOrder):
+     *
+     *   Header
+     *   HomeRecord[]             each table starts on an 8-byte boundary
+     *   RoomRecord[]
+     *   AccessoryRecord[]
+     *   ServiceRecord[]
+     *   CharacteristicRecord[]
+     *   StringRef[]              characteristic properties and valid values
+     *   char[]                   deduplicated string bytes, not NUL-terminated
+     *
+     * Children are stored contiguously and referenced by a Range of indices
+     * into the next table. Any change to a record is a new format version.
+     */
+    namespace snapshot_format {
+
+        constexpr char kMagic[8] = {'P', 'R', 'E', 'F', 'A', 'B', 'S', 'N'};
+        constexpr uint32_t kByteOrderMark = 0x01020304;
+        constexpr uint32_t kAbsent = std::numeric_limits<uint32_t>::max();
+
+        // optional<bool> is stored as one byte
+        enum : uint8_t { kUnset = 0, kFalse = 1, kTrue = 2 };
+
+        struct StringRef {
+            uint32_t offset;  // kAbsent for std::nullopt
+            uint32_t size;
+        };
+
+        struct Range {
+            uint32_t first;
+            uint32_t count;
+        };
+
+        struct Table {
+            uint64_t offset;
+            uint32_t count;
+            uint32_t recordSize;
+        };
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t byteOrder;
+            uint64_t fileSize;
+            int64_t savedAtMs;  // Unix time
+            uint64_t checksum;  // FNV-1a of every byte after the header
+            Table homes;
+            Table rooms;
+            Table accessories;
+            Table services;
+            Table characteristics;
+            Table lists;
+            uint64_t stringsOffset;
+            uint64_t stringsSize;
+        };
+
+        struct HomeRecord {
+            StringRef name;
+            Range rooms;
+        };
+
+        struct RoomRecord {
+            StringRef home;
+            StringRef name;
+            Range accessories;
+        };
+
+        struct AccessoryRecord {
+            StringRef home;
+            StringRef room;
+            StringRef name;
+            StringRef category;
+            StringRef firmwareVersion;
+            StringRef manufacturer;
+            StringRef model;
+            Range services;
+            uint8_t isReachable;
+            uint8_t supportsIdentify;
+            uint8_t isBridged;
+            uint8_t hasServices;
+            uint8_t reserved[4];
+        };
+
+        struct ServiceRecord {
+            uint64_t uniqueIdentifier[2];
+            uint64_t type[2];
+            StringRef name;
+            StringRef typeName;
+            StringRef associatedType;
+            Range characteristics;
+            uint8_t isPrimary;
+            uint8_t isUserInteractive;
+            uint8_t reserved[6];
+        };
+
+        struct CharacteristicRecord {
+            uint64_t uniqueIdentifier[2];
+            uint64_t type[2];
+            StringRef description;
+            StringRef typeName;
+            StringRef value;
+            Range properties;
+            StringRef manufacturerDescription;
+            StringRef minimumValue;
+            StringRef maximumValue;
+            StringRef stepValue;
+            StringRef maxLength;
+            StringRef format;
+            StringRef units;
+            Range validValues;
+            uint8_t hasValidValues;
+            uint8_t reserved[7];
+        };
+
+        static_assert(std::is_trivially_copyable_v<Header> && sizeof(Header) == 152, "snapshot header layout changed");
+        static_assert(sizeof(AccessoryRecord) == 72 && sizeof(ServiceRecord) == 72 && sizeof(CharacteristicRecord) == 136,
+                      "snapshot record layout changed");
+
+    } // namespace snapshot_format
+
+    using namespace snapshot_format;
+
+    namespace {
+
+        uint64_t fnv1a(const std::byte* data, size_t size) {
+            uint64_t hash = 0xcbf29ce484222325ULL;
+            for (size_t i = 0; i < size; ++i) {
+                hash ^= static_cast<uint8_t>(data[i]);
+                hash *= 0x100000001b3ULL;
+            }
+            return hash;
+        }
+
+        size_t align8(size_t offset) {
+            return (offset + 7) & ~size_t(7);
+        }
+
+        uint8_t encodeBool(const std::optional<bool>& value) {
+            if (!value) return kUnset;
+            return *value ? kTrue : kFalse;
+        }
+
+        std::optional<bool> decodeBool(uint8_t value) {
+            if (value == kUnset) return std::nullopt;
+            return value == kTrue;
+        }
+
+        std::optional<std::string> toOptionalString(const std::optional<std::string_view>& value) {
+            if (!value) return std::nullopt;
+            return std::string(*value);
+        }
+
+        // Flattens a HomeSnapshot into the record tables
+        class SnapshotWriter {
+        public:
+            std::vector<HomeRecord> homes;
+            std::vector<RoomRecord> rooms;
+            std::vector<AccessoryRecord> accessories;
+            std::vector<ServiceRecord> services;
+            std::vector<CharacteristicRecord> characteristics;
+            std::vector<StringRef> lists;
+            std::string strings;
+
+            void add(const HomeSnapshot& snapshot) {
+                for (const auto& home : snapshot.homes) {
+                    homes.push_back(HomeRecord{ref(home.home.name), range(rooms.size(), home.rooms.size())});
+                    for (const auto& room : home.rooms) {
+                        rooms.push_back(RoomRecord{ref(room.room.home), ref(room.room.name),
+                                                   range(accessories.size(), room.accessories.size())});
+                        for (const auto& accessory : room.accessories) add(accessory);
+                    }
+                }
+            }
+
+            std::vector<std::byte> serialize() const {
+                Header header{};
+                std::memcpy(header.magic, kMagic, sizeof(kMagic));
+                header.version = MappedSnapshot::kFormatVersion;
+                header.byteOrder = kByteOrderMark;
+                header.savedAtMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+
+                size_t offset = sizeof(Header);
+                offset = place(header.homes, homes, offset);
+                offset = place(header.rooms, rooms, offset);
+                offset = place(header.accessories, accessories, offset);
+                offset = place(header.services, services, offset);
+                offset = place(header.characteristics, characteristics, offset);
+                offset = place(header.lists, lists, offset);
+                header.stringsOffset = offset;
+                header.stringsSize = strings.size();
+                header.fileSize = offset + strings.size();
+
+                std::vector<std::byte> file(header.fileSize);
+                copy(file, header.homes, homes);
+                copy(file, header.rooms, rooms);
+                copy(file, header.accessories, accessories);
+                copy(file, header.services, services);
+                copy(file, header.characteristics, characteristics);
+                copy(file, header.lists, lists);
+                std::memcpy(file.data() + header.stringsOffset, strings.data(), strings.size());
+                header.checksum = fnv1a(file.data() + sizeof(Header), file.size() - sizeof(Header));
+                std::memcpy(file.data(), &header, sizeof(Header));
+                return file;
+            }
+
+        private:
+            std::unordered_map<std::string, uint32_t> offsets_;
+
+            void add(const Accessory& accessory) {
+                AccessoryRecord record{};
+                record.home = ref(accessory.home);
+                record.room = ref(accessory.room);
+                record.name = ref(accessory.name);
+                record.category = ref(accessory.category);
+                record.firmwareVersion = ref(accessory.firmwareVersion);
+                record.manufacturer = ref(accessory.manufacturer);
+                record.model = ref(accessory.model);
+                record.isReachable = encodeBool(accessory.isReachable);
+                record.supportsIdentify = encodeBool(accessory.supportsIdentify);
+                record.isBridged = encodeBool(accessory.isBridged);
+                record.hasServices = accessory.services.has_value();
+                size_t serviceCount = accessory.services ? accessory.services->size() : 0;
+                record.services = range(services.size(), serviceCount);
+                accessories.push_back(record);
+                if (!accessory.services) return;
+
+                // Services first, so each accessory's services stay contiguous
+                size_t firstService = services.size();
+                for (const auto& service : *accessory.services) {
+                    ServiceRecord serviceRecord{};
+                    words(serviceRecord.uniqueIdentifier, service.uniqueIdentifier);
+                    words(serviceRecord.type, service.type);
+                    serviceRecord.name = ref(service.name);
+                    serviceRecord.typeName = ref(service.typeName.str());
+                    serviceRecord.associatedType = ref(service.associatedType);
+                    serviceRecord.isPrimary = service.isPrimary;
+                    serviceRecord.isUserInteractive = service.isUserInteractive;
+                    services.push_back(serviceRecord);
+                }
+                for (size_t i = 0; i < accessory.services->size(); ++i) {
+                    const auto& serviceCharacteristics = (*accessory.services)[i].characteristics;
+                    services[firstService + i].characteristics = range(characteristics.size(), serviceCharacteristics.size());
+                    for (const auto& characteristic : serviceCharacteristics) add(characteristic);
+                }
+            }
+
+            void add(const Characteristic& characteristic) {
+                CharacteristicRecord record{};
+                words(record.uniqueIdentifier, characteristic.uniqueIdentifier);
+                words(record.type, characteristic.type);
+                record.description = ref(characteristic.description);
+                record.typeName = ref(characteristic.typeName.str());
+                record.value = ref(characteristic.value);
+                record.properties = list(characteristic.properties);
+
+                const CharacteristicMetadata& metadata = characteristic.metadata;
+                record.manufacturerDescription = ref(metadata.manufacturerDescription);
+                record.minimumValue = ref(metadata.minimumValue);
+                record.maximumValue = ref(metadata.maximumValue);
+                record.stepValue = ref(metadata.stepValue);
+                record.maxLength = ref(metadata.maxLength);
+                record.format = ref(metadata.format);
+                record.units = ref(metadata.units);
+                record.hasValidValues = metadata.validValues.has_value();
+                record.validValues = metadata.validValues ? list(*metadata.validValues) : Range{0, 0};
+                characteristics.push_back(record);
+            }
+
+            StringRef ref(const std::string& text) {
+                auto found = offsets_.find(text);
+                if (found != offsets_.end()) return StringRef{found->second, static_cast<uint32_t>(text.size())};
+
+                if (strings.size() + text.size() >= kAbsent) {
+                    throw PrefabException("Snapshot is too large for the snapshot file format");
+                }
+                uint32_t offset = static_cast<uint32_t>(strings.size());
+                strings += text;
+                offsets_.emplace(text, offset);
+                return StringRef{offset, static_cast<uint32_t>(text.size())};
+            }
+
+            StringRef ref(const std::optional<std::string>& text) {
+                return text ? ref(*text) : StringRef{kAbsent, 0};
+            }
+
+            Range list(const std::vector<std::string>& values) {
+                Range result = range(lists.size(), values.size());
+                for (const auto& value : values) lists.push_back(ref(value));
+                return result;
+            }
+
+            static Range range(size_t first, size_t count) {
+                if (first + count >= kAbsent) {
+                    throw PrefabException("Snapshot is too large for the snapshot file format");
+                }
+                return Range{static_cast<uint32_t>(first), static_cast<uint32_t>(count)};
+            }
+
+            static void words(uint64_t (&out)[2], const Uuid& uuid) {
+                out[0] = uuid.high();
+                out[1] = uuid.low();
+            }
+
+            template <typename Record>
+            static size_t place(Table& table, const std::vector<Record>& records, size_t offset) {
+                table.offset = align8(offset);
+                table.count = static_cast<uint32_t>(records.size());
+                table.recordSize = sizeof(Record);
+                return table.offset + records.size() * sizeof(Record);
+            }
+
+            template <typename Record>
+            static void copy(std::vector<std::byte>& file, const Table& table, const std::vector<Record>& records) {
+                if (!records.empty()) std::memcpy(file.data() + table.offset, records.data(), records.size() * sizeof(Record));
+            }
+        };
+
+        [[noreturn]] void throwFileError(const std::string& action, const std::string& path) {
+            throw PrefabException("Failed to " + action + " snapshot file " + path + ": " + std::strerror(errno));
+        }
+
+        void writeAll(int fd, const std::vector<std::byte>& data, const std::string& path) {
+            size_t written = 0;
+            while (written < data.size()) {
+                ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throwFileError("write", path);
+                }
+                written += static_cast<size_t>(n);
+            }
+        }
+
+    } // namespace
+
+    void saveSnapshotFile(const HomeSnapshot& snapshot, const std::string& path) {
+        SnapshotWriter writer;
+        writer.add(snapshot);
+        std::vector<std::byte> file = writer.serialize();
+
+        const std::string temporary = path + ".tmp";
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) throwFileError("create", temporary);
+        try {
+            writeAll(fd, file, temporary);
+            if (::fsync(fd) != 0) throwFileError("sync", temporary);
+        } catch (...) {
+            ::close(fd);
+            ::unlink(temporary.c_str());
+            throw;
+        }
+        ::close(fd);
+        if (::rename(temporary.c_str(), path.c_str()) != 0) {
+            int error = errno;
+            ::unlink(temporary.c_str());
+            errno = error;
+            throwFileError("replace", path);
+        }
+    }
+
+    std::shared_ptr<const MappedSnapshot> MappedSnapshot::open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throwFileError("open", path);
+
+        struct stat info{};
+        if (::fstat(fd, &info) != 0) {
+            int error = errno;
+            ::close(fd);
+            errno = error;
+            throwFileError("stat", path);
+        }
+        size_t size = static_cast<size_t>(info.st_size);
+        if (size < sizeof(Header)) {
+            ::close(fd);
+            throw PrefabException("Snapshot file " + path + " is truncated");
+        }
+
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        int error = errno;
+        ::close(fd);  // The mapping keeps the file alive
+        if (data == MAP_FAILED) {
+            errno = error;
+            throwFileError("map", path);
+        }
+
+        std::shared_ptr<MappedSnapshot> snapshot(new MappedSnapshot(static_cast<const std::byte*>(data), size));
+        snapshot->validate(path);
+        return snapshot;
+    }
+
+    MappedSnapshot::MappedSnapshot(const std::byte* data, size_t size)
+        : data_(data),
+          size_(size),
+          header_(reinterpret_cast<const Header*>(data)),
+          homes_(nullptr),
+          rooms_(nullptr),
+          accessories_(nullptr),
+          services_(nullptr),
+          characteristics_(nullptr),
+          lists_(nullptr),
+          strings_(nullptr) {}
+
+    MappedSnapshot::~MappedSnapshot() {
+        ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+
+    // Everything is checked here once, so the accessors can index without checks
+    void MappedSnapshot::validate(const std::string& path) {
+        auto fail = [&path](const std::string& reason) {
+            throw PrefabException("Snapshot file " + path + " " + reason);
+        };
+
+        const Header& header = *header_;
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) fail("is not a snapshot file");
+        if (header.byteOrder != kByteOrderMark) fail("was written with a different byte order");
+        if (header.version != kFormatVersion) {
+            fail("has format version " + std::to_string(header.version) + ", expected " + std::to_string(kFormatVersion));
+        }
+        if (header.fileSize != size_) fail("is truncated");
+        if (fnv1a(data_ + sizeof(Header), size_ - sizeof(Header)) != header.checksum) fail("is corrupt (checksum mismatch)");
+
+        auto table = [&](const Table& table, size_t recordSize, auto*& records) {
+            using Record = std::remove_const_t<std::remove_pointer_t<std::remove_reference_t<decltype(records)>>>;
+            if (table.recordSize != recordSize || table.offset % alignof(Record) != 0 ||
+                table.offset > size_ || table.count > (size_ - table.offset) / recordSize) {
+                fail("has an invalid record table");
+            }
+            records = reinterpret_cast<const Record*>(data_ + table.offset);
+        };
+        table(header.homes, sizeof(HomeRecord), homes_);
+        table(header.rooms, sizeof(RoomRecord), rooms_);
+        table(header.accessories, sizeof(AccessoryRecord), accessories_);
+        table(header.services, sizeof(ServiceRecord), services_);
+        table(header.characteristics, sizeof(CharacteristicRecord), characteristics_);
+        table(header.lists, sizeof(StringRef), lists_);
+        if (header.stringsOffset > size_ || header.stringsSize > size_ - header.stringsOffset) fail("has an invalid string table");
+        strings_ = reinterpret_cast<const char*>(data_ + header.stringsOffset);
+
+        auto checkRange = [&](const Range& range, uint32_t count) {
+            if (range.first > count || range.count > count - range.first) fail("has an out-of-range index");
+        };
+        auto checkString = [&](const StringRef& ref) {
+            if (ref.offset == kAbsent) return;
+            if (ref.offset > header.stringsSize || ref.size > header.stringsSize - ref.offset) {
+                fail("has an out-of-range string");
+            }
+        };
+
+        for (uint32_t i = 0; i < header.homes.count; ++i) {
+            checkString(homes_[i].name);
+            checkRange(homes_[i].rooms, header.rooms.count);
+        }
+        for (uint32_t i = 0; i < header.rooms.count; ++i) {
+            checkString(rooms_[i].home);
+            checkString(rooms_[i].name);
+            checkRange(rooms_[i].accessories, header.accessories.count);
+        }
+        for (uint32_t i = 0; i < header.accessories.count; ++i) {
+            const AccessoryRecord& record = accessories_[i];
+            for (const StringRef* ref : {&record.home, &record.room, &record.name, &record.category,
+                                         &record.firmwareVersion, &record.manufacturer, &record.model}) {
+                checkString(*ref);
+            }
+            checkRange(record.services, header.services.count);
+        }
+        for (uint32_t i = 0; i < header.services.count; ++i) {
+            const ServiceRecord& record = services_[i];
+            checkString(record.name);
+            checkString(record.typeName);
+            checkString(record.associatedType);
+            checkRange(record.characteristics, header.characteristics.count);
+        }
+        for (uint32_t i = 0; i < header.characteristics.count; ++i) {
+            const CharacteristicRecord& record = characteristics_[i];
+            for (const StringRef* ref : {&record.description, &record.typeName, &record.value,
+                                         &record.manufacturerDescription, &record.minimumValue, &record.maximumValue,
+                                         &record.stepValue, &record.maxLength, &record.format, &record.units}) {
+                checkString(*ref);
+            }
+            checkRange(record.properties, header.lists.count);
+            checkRange(record.validValues, header.lists.count);
+        }
+        for (uint32_t i = 0; i < header.lists.count; ++i) {
+            checkString(lists_[i]);
+        }
+    }
+
+    std::string_view MappedSnapshot::string(const StringRef& ref) const {
+        if (ref.offset == kAbsent) return {};
+        return std::string_view(strings_ + ref.offset, ref.size);
+    }
+
+    std::optional<std::string_view> MappedSnapshot::optionalString(const StringRef& ref) const {
+        if (ref.offset == kAbsent) return std::nullopt;
+        return string(ref);
+    }
+
+    std::chrono::system_clock::time_point MappedSnapshot::savedAt() const {
+        return std::chrono::system_clock::time_point(std::chrono::milliseconds(header_->savedAtMs));
+    }
+
+    size_t MappedSnapshot::homeCount() const { return header_->homes.count; }
+    size_t MappedSnapshot::roomCount() const { return header_->rooms.count; }
+    size_t MappedSnapshot::accessoryCount() const { return header_->accessories.count; }
+
+    MappedSnapshot::HomeView MappedSnapshot::home(size_t index) const {
+        return HomeView(this, &homes_[index]);
+    }
+
+    std::optional<MappedSnapshot::AccessoryView> MappedSnapshot::findAccessory(std::string_view homeName,
+                                                                               std::string_view roomName,
+                                                                               std::string_view accessoryName) const {
+        for (size_t h = 0; h < homeCount(); ++h) {
+            HomeView home = this->home(h);
+            if (home.name() != homeName) continue;
+            for (size_t r = 0; r < home.roomCount(); ++r) {
+                RoomView room = home.room(r);
+                if (room.name() != roomName) continue;
+                for (size_t a = 0; a < room.accessoryCount(); ++a) {
+                    AccessoryView accessory = room.accessory(a);
+                    if (accessory.name() == accessoryName) return accessory;
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    HomeSnapshot MappedSnapshot::toSnapshot() const {
+        HomeSnapshot snapshot;
+        snapshot.homes.reserve(homeCount());
+        for (size_t h = 0; h < homeCount(); ++h) {
+            HomeView homeView = home(h);
+            HomeSnapshot::HomeNode& homeNode = snapshot.homes.emplace_back();
+            homeNode.home.name = std::string(homeView.name());
+            homeNode.rooms.reserve(homeView.roomCount());
+            for (size_t r = 0; r < homeView.roomCount(); ++r) {
+                RoomView roomView = homeView.room(r);
+                HomeSnapshot::RoomNode& roomNode = homeNode.rooms.emplace_back();
+                roomNode.room.home = std::string(roomView.home());
+                roomNode.room.name = std::string(roomView.name());
+                roomNode.accessories.reserve(roomView.accessoryCount());
+                for (size_t a = 0; a < roomView.accessoryCount(); ++a) {
+                    roomNode.accessories.push_back(roomView.accessory(a).toAccessory());
+                }
+            }
+        }
+        return snapshot;
+    }
+
+    // Views
+
+    std::string_view MappedSnapshot::HomeView::name() const { return snapshot_->string(record_->name); }
+    size_t MappedSnapshot::HomeView::roomCount() const { return record_->rooms.count; }
+
+    MappedSnapshot::RoomView MappedSnapshot::HomeView::room(size_t index) const {
+        return RoomView(snapshot_, &snapshot_->rooms_[record_->rooms.first + index]);
+    }
+
+    std::string_view MappedSnapshot::RoomView::home() const { return snapshot_->string(record_->home); }
+    std::string_view MappedSnapshot::RoomView::name() const { return snapshot_->string(record_->name); }
+    size_t MappedSnapshot::RoomView::accessoryCount() const { return record_->accessories.count; }
+
+    MappedSnapshot::AccessoryView MappedSnapshot::RoomView::accessory(size_t index) const {
+        return AccessoryView(snapshot_, &snapshot_->accessories_[record_->accessories.first + index]);
+    }
+
+    std::string_view MappedSnapshot::AccessoryView::home() const { return snapshot_->string(record_->home); }
+    std::string_view MappedSnapshot::AccessoryView::room() const { return snapshot_->string(record_->room); }
+    std::string_view MappedSnapshot::AccessoryView::name() const { return snapshot_->string(record_->name); }
+
+    std::optional<std::string_view> MappedSnapshot::AccessoryView::category() const {
+        return snapshot_->optionalString(record_->category);
+    }
+
+    std::optional<bool> MappedSnapshot::AccessoryView::isReachable() const { return decodeBool(record_->isReachable); }
+    std::optional<bool> MappedSnapshot::AccessoryView::supportsIdentify() const { return decodeBool(record_->supportsIdentify); }
+    std::optional<bool> MappedSnapshot::AccessoryView::isBridged() const { return decodeBool(record_->isBridged); }
+
+    std::optional<std::string_view> MappedSnapshot::AccessoryView::firmwareVersion() const {
+        return snapshot_->optionalString(record_->firmwareVersion);
+    }
+
+    std::optional<std::string_view> MappedSnapshot::AccessoryView::manufacturer() const {
+        return snapshot_->optionalString(record_->manufacturer);
+    }
+
+    std::optional<std::string_view> MappedSnapshot::AccessoryView::model() const {
+        return snapshot_->optionalString(record_->model);
+    }
+
+    bool MappedSnapshot::AccessoryView::hasServices() const { return record_->hasServices != 0; }
+    size_t MappedSnapshot::AccessoryView::serviceCount() const { return record_->services.count; }
+
+    MappedSnapshot::ServiceView MappedSnapshot::AccessoryView::service(size_t index) const {
+        return ServiceView(snapshot_, &snapshot_->services_[record_->services.first + index]);
+    }
+
+    Accessory MappedSnapshot::AccessoryView::toAccessory() const {
+        Accessory accessory;
+        accessory.home = std::string(home());
+        accessory.room = std::string(room());
+        accessory.name = std::string(name());
+        accessory.category = toOptionalString(category());
+        accessory.isReachable = isReachable();
+        accessory.supportsIdentify = supportsIdentify();
+        accessory.isBridged = isBridged();
+        accessory.firmwareVersion = toOptionalString(firmwareVersion());
+        accessory.manufacturer = toOptionalString(manufacturer());
+        accessory.model = toOptionalString(model());
+        if (!hasServices()) return accessory;
+
+        auto& services = accessory.services.emplace();
+        services.reserve(serviceCount());
+        for (size_t s = 0; s < serviceCount(); ++s) {
+            ServiceView view = service(s);
+            Service& service = services.emplace_back();
+            service.uniqueIdentifier = view.uniqueIdentifier();
+            service.name = std::string(view.name());
+            service.typeName = InternedString(view.typeName());
+            service.type = view.type();
+            service.isPrimary = view.isPrimary();
+            service.isUserInteractive = view.isUserInteractive();
+            service.associatedType = toOptionalString(view.associatedType());
+            service.characteristics.reserve(view.characteristicCount());
+            for (size_t c = 0; c < view.characteristicCount(); ++c) {
+                service.characteristics.push_back(view.characteristic(c).toCharacteristic());
+            }
+        }
+        return accessory;
+    }
+
+    Uuid MappedSnapshot::ServiceView::uniqueIdentifier() const {
+        return Uuid(record_->uniqueIdentifier[0], record_->uniqueIdentifier[1]);
+    }
+
+    Uuid MappedSnapshot::ServiceView::type() const { return Uuid(record_->type[0], record_->type[1]); }
+    std::string_view MappedSnapshot::ServiceView::name() const { return snapshot_->string(record_->name); }
+    std::string_view MappedSnapshot::ServiceView::typeName() const { return snapshot_->string(record_->typeName); }
+    bool MappedSnapshot::ServiceView::isPrimary() const { return record_->isPrimary != 0; }
+    bool MappedSnapshot::ServiceView::isUserInteractive() const { return record_->isUserInteractive != 0; }
+
+    std::optional<std::string_view> MappedSnapshot::ServiceView::associatedType() const {
+        return snapshot_->optionalString(record_->associatedType);
+    }
+
+    size_t MappedSnapshot::ServiceView::characteristicCount() const { return record_->characteristics.count; }
+
+    MappedSnapshot::CharacteristicView MappedSnapshot::ServiceView::characteristic(size_t index) const {
+        return CharacteristicView(snapshot_, &snapshot_->characteristics_[record_->characteristics.first + index]);
+    }
+
+    Uuid MappedSnapshot::CharacteristicView::uniqueIdentifier() const {
+        return Uuid(record_->uniqueIdentifier[0], record_->uniqueIdentifier[1]);
+    }
+
+    Uuid MappedSnapshot::CharacteristicView::type() const { return Uuid(record_->type[0], record_->type[1]); }
+    std::string_view MappedSnapshot::CharacteristicView::description() const { return snapshot_->string(record_->description); }
+    std::string_view MappedSnapshot::CharacteristicView::typeName() const { return snapshot_->string(record_->typeName); }
+    std::string_view MappedSnapshot::CharacteristicView::value() const { return snapshot_->string(record_->value); }
+
+    std::optional<std::string_view> MappedSnapshot::CharacteristicView::format() const {
+        return snapshot_->optionalString(record_->format);
+    }
+
+    std::optional<std::string_view> MappedSnapshot::CharacteristicView::units() const {
+        return snapshot_->optionalString(record_->units);
+    }
+
+    size_t MappedSnapshot::CharacteristicView::propertyCount() const { return record_->properties.count; }
+
+    std::string_view MappedSnapshot::CharacteristicView::property(size_t index) const {
+        return snapshot_->string(snapshot_->lists_[record_->properties.first + index]);
+    }
+
+    Characteristic MappedSnapshot::CharacteristicView::toCharacteristic() const {
+        Characteristic characteristic;
+        characteristic.uniqueIdentifier = uniqueIdentifier();
+        characteristic.description = std::string(description());
+        characteristic.properties.reserve(propertyCount());
+        for (size_t i = 0; i < propertyCount(); ++i) characteristic.properties.emplace_back(property(i));
+        characteristic.typeName = InternedString(typeName());
+        characteristic.type = type();
+        characteristic.value = std::string(value());
+
+        CharacteristicMetadata& metadata = characteristic.metadata;
+        metadata.manufacturerDescription = toOptionalString(snapshot_->optionalString(record_->manufacturerDescription));
+        metadata.minimumValue = toOptionalString(snapshot_->optionalString(record_->minimumValue));
+        metadata.maximumValue = toOptionalString(snapshot_->optionalString(record_->maximumValue));
+        metadata.stepValue = toOptionalString(snapshot_->optionalString(record_->stepValue));
+        metadata.maxLength = toOptionalString(snapshot_->optionalString(record_->maxLength));
+        metadata.format = toOptionalString(format());
+        metadata.units = toOptionalString(units());
+        if (record_->hasValidValues) {
+            auto& validValues = metadata.validValues.emplace();
+            validValues.reserve(record_->validValues.count);
+            for (uint32_t i = 0; i < record_->validValues.count; ++i) {
+                validValues.emplace_back(snapshot_->string(snapshot_->lists_[record_->validValues.first + i]));
+            }
+        }
+        metadata.constraints = ValueConstraints::fromMetadata(metadata);
+        characteristic.typedValue = metadata.constraints.decode(characteristic.value);
+        return characteristic;
+    }
+
+    // Client integration
+
+    std::shared_ptr<const MappedSnapshot> PrefabClient::loadSnapshot(const std::string& path,
+                                                                     const SnapshotOptions& options,
+                                                                     AsyncCallback<HomeSnapshot> refreshed) {
+        std::shared_ptr<const MappedSnapshot> saved;
+        try {
+            saved = MappedSnapshot::open(path);
+        } catch (const PrefabException&) {
+            // Missing, stale-format or damaged files just mean a cold start
+        }
+
+        if (saved) {
+            // Seed the characteristic index so by-type writes work before the refresh completes
+            for (size_t h = 0; h < saved->homeCount(); ++h) {
+                auto home = saved->home(h);
+                for (size_t r = 0; r < home.roomCount(); ++r) {
+                    auto room = home.room(r);
+                    for (size_t a = 0; a < room.accessoryCount(); ++a) {
+                        auto accessory = room.accessory(a);
+                        if (!accessory.hasServices()) continue;
+                        characteristics_->learn(std::string(home.name()), std::string(room.name()),
+                                                std::string(accessory.name()), accessory.toAccessory());
+                    }
+                }
+            }
+        }
+
+        getSnapshotAsync(options, [this, path, refreshed = std::move(refreshed)](AsyncResult<HomeSnapshot> result) {
+            if (!result.ok() || !result.value().stats.errors.empty()) {
+                if (refreshed) refreshed(std::move(result));
+                return;
+            }
+            // Only a complete crawl replaces the saved file. Writing and syncing it would stall
+            // every request on the network thread, so it happens on a thread of its own
+            auto fresh = std::make_shared<AsyncResult<HomeSnapshot>>(std::move(result));
+            saveInBackground([path, refreshed, fresh]() {
+                try {
+                    saveSnapshotFile(fresh->value(), path);
+                } catch (const PrefabException& e) {
+                    fresh->value().stats.errors.push_back(e.what());
+                }
+                if (refreshed) refreshed(std::move(*fresh));
+            });
+        });
+        return saved;
+    }
+
+} // namespace prefab
@@ -0,0 +1,183 @@
+#include "tracer.h"
+#include "prefab/client.h"
+#include <algorithm>
+#include <random>
+
+namespace prefab {
+
+    static thread_local std::optional<SpanContext> currentContext;
+
+    // Random lowercase hex; per-thread generators keep span creation lock-free
+    static std::string randomHex(size_t digits) {
+        static thread_local std::mt19937_64 generator(std::random_device{}() ^
+            static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+        static const char hex[] = "0123456789abcdef";
+        std::string id;
+        id.reserve(digits);
+        while (id.size() < digits) {
+            uint64_t bits = generator();
+            for (int i = 0; i < 16 && id.size() < digits; ++i, bits >>= 4) id += hex[bits & 0xF];
+        }
+        // All-zero IDs are invalid in W3C trace context
+        if (id.find_first_not_of('0') == std::string::npos) id.back() = '1';
+        return id;
+    }
+
+    ActiveSpan::ActiveSpan(std::shared_ptr<Tracer> tracer, SpanRecord record, bool sampled)
+        : tracer_(std::move(tracer)), context_{record.traceId, record.spanId, sampled}, record_(std::move(record)) {}
+
+    ActiveSpan::~ActiveSpan() {
+        end();
+    }
+
+    void ActiveSpan::setAttribute(const std::string& key, const std::string& value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ended_) return;
+        for (auto& attribute : record_.attributes) {
+            if (attribute.first == key) {
+                attribute.second = value;
+                return;
+            }
+        }
+        record_.attributes.emplace_back(key, value);
+    }
+
+    void ActiveSpan::end(const std::string& error) {
+        SpanRecord record;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ended_) return;
+            ended_ = true;
+            if (!context_.sampled) return;
+            record = std::move(record_);
+        }
+        record.end = std::chrono::system_clock::now();
+        record.error = !error.empty();
+        record.statusMessage = error;
+        tracer_->finished(std::move(record));
+    }
+
+    Tracer::Tracer(const TracingConfig& config) : config_(config) {
+        if (config_.exporter) thread_ = std::thread(&Tracer::run, this);
+    }
+
+    Tracer::~Tracer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    std::shared_ptr<ActiveSpan> Tracer::startSpan(std::string name, SpanKind kind,
+                                                  const std::optional<SpanContext>& parent) {
+        SpanRecord record;
+        bool sampled;
+        if (parent) {
+            record.traceId = parent->traceId;
+            record.parentSpanId = parent->spanId;
+            sampled = parent->sampled;
+        } else {
+            record.traceId = randomHex(32);
+            static thread_local std::mt19937 coin(std::random_device{}());
+            sampled = std::uniform_real_distribution<double>(0.0, 1.0)(coin) < config_.sampleRatio;
+        }
+        sampled = sampled && config_.exporter != nullptr;
+        record.spanId = randomHex(16);
+        record.name = std::move(name);
+        record.kind = kind;
+        record.start = std::chrono::system_clock::now();
+        return std::make_shared<ActiveSpan>(shared_from_this(), std::move(record), sampled);
+    }
+
+    void Tracer::finished(SpanRecord&& record) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= config_.maxQueuedSpans) return;  // Exporter cannot keep up; drop
+        queue_.push_back(std::move(record));
+    }
+
+    void Tracer::flush() {
+        if (!config_.exporter) return;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            flushRequested_ = true;
+            wake_.notify_all();
+            exported_.wait(lock, [this] { return (queue_.empty() && !exporting_) || stopping_; });
+        }
+        config_.exporter->flush();
+    }
+
+    void Tracer::run() {
+        const auto interval = std::chrono::milliseconds(std::max(config_.exportIntervalMs, 1));
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait_for(lock, interval, [this] { return stopping_ || flushRequested_; });
+            flushRequested_ = false;
+            if (!queue_.empty()) {
+                std::vector<SpanRecord> batch;
+                batch.swap(queue_);
+                exporting_ = true;
+                lock.unlock();
+                try {
+                    config_.exporter->exportSpans(batch);
+                } catch (...) {
+                    // A failed export loses the batch, not the client
+                }
+                lock.lock();
+                exporting_ = false;
+            }
+            exported_.notify_all();
+            if (stopping_ && queue_.empty()) break;
+        }
+    }
+
+    std::optional<SpanContext> currentSpanContext() {
+        return currentContext;
+    }
+
+    SpanContextScope::SpanContextScope(std::optional<SpanContext> context) : previous_(currentContext) {
+        currentContext = std::move(context);
+    }
+
+    SpanContextScope::~SpanContextScope() {
+        currentContext = previous_;
+    }
+
+    TraceSpan::TraceSpan(const PrefabClient& client, std::string name) : previous_(currentContext) {
+        if (!client.tracer_) return;
+        span_ = client.tracer_->startSpan(std::move(name), SpanKind::Internal, currentContext);
+        currentContext = span_->context();
+    }
+
+    TraceSpan::TraceSpan(const PrefabClient& client, std::string name, const std::string& traceparent)
+        : previous_(currentContext) {
+        if (!client.tracer_) return;
+        span_ = client.tracer_->startSpan(std::move(name), SpanKind::Internal, SpanContext::parse(traceparent));
+        currentContext = span_->context();
+    }
+
+    TraceSpan::~TraceSpan() {
+        if (!span_) return;
+        currentContext = previous_;
+        span_->end(error_);
+    }
+
+    void TraceSpan::setAttribute(const std::string& key, const std::string& value) {
+        if (span_) span_->setAttribute(key, value);
+    }
+
+    void TraceSpan::setError(const std::string& message) {
+        error_ = message;
+    }
+
+    std::optional<SpanContext> TraceSpan::context() const {
+        if (!span_) return std::nullopt;
+        return span_->context();
+    }
+
+    std::optional<SpanContext> TraceSpan::current() {
+        return currentContext;
+    }
+
+} // namespace prefab
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "prefab/tracing.h"
+
+namespace prefab {
+
+    class Tracer;
+
+    /**
+     * @brief A span that is still open; ends (and is queued for export) once
+     *
+     * Attributes may be set from any thread until the span ends.
+     */
+    class ActiveSpan {
+    public:
+        ActiveSpan(std::shared_ptr<Tracer> tracer, SpanRecord record, bool sampled);
+        ~ActiveSpan();
+
+        ActiveSpan(const ActiveSpan&) = delete;
+        ActiveSpan& operator=(const ActiveSpan&) = delete;
+
+        const SpanContext& context() const { return context_; }
+
+        void setAttribute(const std::string& key, const std::string& value);
+
+        /**
+         * @param error Status message; empty for success
+         */
+        void end(const std::string& error = "");
+
+    private:
+        const std::shared_ptr<Tracer> tracer_;
+        const SpanContext context_;
+        std::mutex mutex_;
+        SpanRecord record_;
+        bool ended_ = false;
+    };
+
+    /**
+     * @brief Creates spans for one client and exports them in batches
+     *
+     * Finished spans are queued and handed to the exporter from a background
+     * thread every TracingConfig::exportIntervalMs, so ending a span on the
+     * network thread never waits for I/O.
+     *
+     * Create it with std::make_shared: open spans keep a reference.
+     */
+    class Tracer : public std::enable_shared_from_this<Tracer> {
+    public:
+        explicit Tracer(const TracingConfig& config);
+        ~Tracer();
+
+        Tracer(const Tracer&) = delete;
+        Tracer& operator=(const Tracer&) = delete;
+
+        /**
+         * @brief Open a span under parent, or as the root of a new trace
+         */
+        std::shared_ptr<ActiveSpan> startSpan(std::string name, SpanKind kind,
+                                              const std::optional<SpanContext>& parent);
+
+        bool propagate() const { return config_.propagate; }
+
+        /**
+         * @brief Export everything finished so far
+         */
+        void flush();
+
+    private:
+        friend class ActiveSpan;
+        void finished(SpanRecord&& record);
+        void run();
+
+        const TracingConfig config_;
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable exported_;
+        std::vector<SpanRecord> queue_;
+        bool exporting_ = false;        // A batch taken from the queue is being exported
+        bool flushRequested_ = false;
+        bool stopping_ = false;
+        std::thread thread_;
+    };
+
+    /**
+     * @brief Trace context of the current thread: the innermost open TraceSpan
+     */
+    std::optional<SpanContext> currentSpanContext();
+
+    /**
+     * @brief Makes a span the current thread's trace context while in scope
+     *
+     * Used to carry a caller's context into continuations that run on the
+     * network thread.
+     */
+    class SpanContextScope {
+    public:
+        explicit SpanContextScope(std::optional<SpanContext> context);
+        ~SpanContextScope();
+
+        SpanContextScope(const SpanContextScope&) = delete;
+        SpanContextScope& operator=(const SpanContextScope&) = delete;
+
+    private:
+        std::optional<SpanContext> previous_;
+    };
+
+} // namespace prefab
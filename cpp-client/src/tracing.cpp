@@ -0,0 +1,131 @@
+#include "prefab/tracing.h"
+#include "prefab/client.h"
+#include "connection_pool.h"
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace prefab {
+
+    static bool isLowerHex(const std::string& value) {
+        return value.find_first_not_of("0123456789abcdef") == std::string::npos;
+    }
+
+    std::string SpanContext::traceparent() const {
+        return "00-" + traceId + "-" + spanId + (sampled ? "-01" : "-00");
+    }
+
+    std::optional<SpanContext> SpanContext::parse(const std::string& traceparent) {
+        // version(2)-traceId(32)-spanId(16)-flags(2)
+        if (traceparent.size() < 55 || traceparent[2] != '-' || traceparent[35] != '-' || traceparent[52] != '-') {
+            return std::nullopt;
+        }
+        const std::string version = traceparent.substr(0, 2);
+        SpanContext context;
+        context.traceId = traceparent.substr(3, 32);
+        context.spanId = traceparent.substr(36, 16);
+        const std::string flags = traceparent.substr(53, 2);
+        if (!isLowerHex(version) || version == "ff" || !isLowerHex(context.traceId) ||
+            !isLowerHex(context.spanId) || !isLowerHex(flags)) {
+            return std::nullopt;
+        }
+        if (version == "00" && traceparent.size() != 55) return std::nullopt;
+        if (context.traceId.find_first_not_of('0') == std::string::npos ||
+            context.spanId.find_first_not_of('0') == std::string::npos) {
+            return std::nullopt;
+        }
+        context.sampled = (std::stoi(flags, nullptr, 16) & 1) != 0;
+        return context;
+    }
+
+    static std::string unixNanos(std::chrono::system_clock::time_point time) {
+        return std::to_string(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+    }
+
+    static json stringAttribute(const std::string& key, const std::string& value) {
+        return {{"key", key}, {"value", {{"stringValue", value}}}};
+    }
+
+    std::string toOtlpJson(const std::vector<SpanRecord>& spans, const std::string& serviceName) {
+        json encoded = json::array();
+        for (const auto& span : spans) {
+            json attributes = json::array();
+            for (const auto& [key, value] : span.attributes) attributes.push_back(stringAttribute(key, value));
+            json entry = {
+                {"traceId", span.traceId},
+                {"spanId", span.spanId},
+                {"name", span.name},
+                {"kind", span.kind == SpanKind::Client ? 3 : 1},
+                {"startTimeUnixNano", unixNanos(span.start)},
+                {"endTimeUnixNano", unixNanos(span.end)},
+                {"attributes", std::move(attributes)},
+            };
+            if (!span.parentSpanId.empty()) entry["parentSpanId"] = span.parentSpanId;
+            if (span.error) {
+                entry["status"] = {{"code", 2}, {"message", span.statusMessage}};
+            } else {
+                entry["status"] = {{"code", 1}};
+            }
+            encoded.push_back(std::move(entry));
+        }
+
+        const json request = {{"resourceSpans", json::array({{
+            {"resource", {{"attributes", json::array({stringAttribute("service.name", serviceName)})}}},
+            {"scopeSpans", json::array({{
+                {"scope", {{"name", "prefab-client"}}},
+                {"spans", std::move(encoded)},
+            }})},
+        }})}};
+        return request.dump();
+    }
+
+    FileSpanExporter::FileSpanExporter(std::string path, std::string serviceName)
+        : serviceName_(std::move(serviceName)), file_(std::fopen(path.c_str(), "a")) {
+        if (!file_) throw PrefabException("Cannot open span file: " + path);
+    }
+
+    FileSpanExporter::~FileSpanExporter() {
+        std::fclose(file_);
+    }
+
+    void FileSpanExporter::exportSpans(const std::vector<SpanRecord>& spans) {
+        if (spans.empty()) return;
+        const std::string line = toOtlpJson(spans, serviceName_) + '\n';
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::fwrite(line.data(), 1, line.size(), file_);
+    }
+
+    void FileSpanExporter::flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::fflush(file_);
+    }
+
+    OtlpHttpSpanExporter::OtlpHttpSpanExporter(std::string url, std::string serviceName)
+        : url_(std::move(url)), serviceName_(std::move(serviceName)) {
+        initCurlOnce();
+    }
+
+    // One short-lived handle per batch; batches are seconds apart, so reuse would not pay off
+    void OtlpHttpSpanExporter::exportSpans(const std::vector<SpanRecord>& spans) {
+        if (spans.empty()) return;
+        const std::string body = toOtlpJson(spans, serviceName_);
+        CURL* curl = curl_easy_init();
+        if (!curl) return;
+        struct curl_slist* headers = curl_slist_append(nullptr, "Content-Type: application/json");
+        curl_easy_setopt(curl, CURLOPT_URL, url_.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, 5000L);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);  // Not on the main thread: no SIGALRM for timeouts
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](char*, size_t size, size_t count, void*) {
+            return size * count;  // The collector's answer is not needed
+        });
+        curl_easy_perform(curl);
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+    }
+
+} // namespace prefab
@@ -0,0 +1,91 @@
+#include "prefab/uuid.h"
+
+namespace prefab {
+
+    namespace {
+
+        // A json::exception, so code that turns JSON errors into a PrefabException covers it too
+        class InvalidUuidError : public nlohmann::json::exception {
+        public:
+            explicit InvalidUuidError(const std::string& message) : exception(302, message.c_str()) {}
+        };
+
+        int hexValue(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        bool isDashPosition(size_t i) {
+            return i == 8 || i == 13 || i == 18 || i == 23;
+        }
+
+    } // namespace
+
+    std::optional<Uuid> Uuid::parse(std::string_view text) {
+        if (text.size() != 36) return std::nullopt;
+
+        uint64_t words[2] = {0, 0};
+        int digits = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (isDashPosition(i)) {
+                if (text[i] != '-') return std::nullopt;
+                continue;
+            }
+            int value = hexValue(text[i]);
+            if (value < 0) return std::nullopt;
+            uint64_t& word = words[digits / 16];
+            word = (word << 4) | static_cast<uint64_t>(value);
+            digits++;
+        }
+
+        Uuid uuid;
+        uuid.high_ = words[0];
+        uuid.low_ = words[1];
+        return uuid;
+    }
+
+    std::string Uuid::toString() const {
+        static const char digits[] = "0123456789ABCDEF";
+        std::string text(36, '-');
+        size_t nibble = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (isDashPosition(i)) continue;
+            uint64_t word = nibble < 16 ? high_ : low_;
+            text[i] = digits[(word >> (60 - 4 * (nibble % 16))) & 0xF];
+            nibble++;
+        }
+        return text;
+    }
+
+    std::array<uint8_t, 16> Uuid::bytes() const {
+        std::array<uint8_t, 16> result{};
+        for (size_t i = 0; i < 8; ++i) {
+            result[i] = static_cast<uint8_t>(high_ >> (56 - 8 * i));
+            result[i + 8] = static_cast<uint8_t>(low_ >> (56 - 8 * i));
+        }
+        return result;
+    }
+
+    bool operator==(const Uuid& uuid, std::string_view text) {
+        auto parsed = Uuid::parse(text);
+        return parsed && *parsed == uuid;
+    }
+
+    std::ostream& operator<<(std::ostream& out, const Uuid& uuid) {
+        return out << uuid.toString();
+    }
+
+    void to_json(nlohmann::json& j, const Uuid& uuid) {
+        j = uuid.toString();
+    }
+
+    void from_json(const nlohmann::json& j, Uuid& uuid) {
+        const auto& text = j.get_ref<const nlohmann::json::string_t&>();
+        auto parsed = Uuid::parse(text);
+        if (!parsed) throw InvalidUuidError("not a UUID: \"" + text + "\"");
+        uuid = *parsed;
+    }
+
+} // namespace prefab
@@ -0,0 +1,340 @@
+#include "prefab/value.h"
+#include "prefab/models.h"
+#include "prefab/arena.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+namespace prefab {
+
+    namespace {
+
+        struct FormatName {
+            ValueFormat format;
+            const char* name;
+        };
+
+        const FormatName formatNames[] = {
+            {ValueFormat::Bool, "bool"},
+            {ValueFormat::UInt8, "uint8"},
+            {ValueFormat::UInt16, "uint16"},
+            {ValueFormat::UInt32, "uint32"},
+            {ValueFormat::UInt64, "uint64"},
+            {ValueFormat::Int, "int"},
+            {ValueFormat::Float, "float"},
+            {ValueFormat::String, "string"},
+            {ValueFormat::TLV8, "tlv8"},
+            {ValueFormat::Data, "data"},
+        };
+
+        bool equalsIgnoreCase(std::string_view text, const char* word) {
+            size_t i = 0;
+            for (; i < text.size() && word[i]; ++i) {
+                if (std::tolower(static_cast<unsigned char>(text[i])) != word[i]) return false;
+            }
+            return i == text.size() && !word[i];
+        }
+
+        // strtoll/strtod need a terminated string; anything longer than the buffer is not a HomeKit number
+        bool terminatedCopy(std::string_view text, char (&buffer)[64]) {
+            if (text.empty() || text.size() >= sizeof(buffer) || std::isspace(static_cast<unsigned char>(text[0]))) {
+                return false;
+            }
+            text.copy(buffer, text.size());
+            buffer[text.size()] = '\0';
+            return true;
+        }
+
+        // Whole-string conversions; leading or trailing garbage is rejected
+        std::optional<int64_t> parseInteger(std::string_view text) {
+            char buffer[64];
+            if (!terminatedCopy(text, buffer)) return std::nullopt;
+            errno = 0;
+            char* end = nullptr;
+            long long value = std::strtoll(buffer, &end, 10);
+            if (errno == ERANGE || end != buffer + text.size()) return std::nullopt;
+            return static_cast<int64_t>(value);
+        }
+
+        std::optional<double> parseReal(std::string_view text) {
+            char buffer[64];
+            if (!terminatedCopy(text, buffer)) return std::nullopt;
+            errno = 0;
+            char* end = nullptr;
+            double value = std::strtod(buffer, &end);
+            if (errno == ERANGE || end != buffer + text.size() || !std::isfinite(value)) return std::nullopt;
+            return value;
+        }
+
+        // Shortest "%g" text that reads back as the same double
+        std::string formatReal(double value) {
+            char buffer[32];
+            for (int precision = 15; precision <= 17; ++precision) {
+                std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+                if (std::strtod(buffer, nullptr) == value) break;
+            }
+            return buffer;
+        }
+
+        bool isIntegerFormat(ValueFormat format) {
+            switch (format) {
+                case ValueFormat::UInt8:
+                case ValueFormat::UInt16:
+                case ValueFormat::UInt32:
+                case ValueFormat::UInt64:
+                case ValueFormat::Int:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // Limits implied by the format itself, independent of the metadata range
+        void formatLimits(ValueFormat format, double& low, double& high) {
+            switch (format) {
+                case ValueFormat::UInt8: low = 0; high = 255; break;
+                case ValueFormat::UInt16: low = 0; high = 65535; break;
+                case ValueFormat::UInt32: low = 0; high = 4294967295.0; break;
+                case ValueFormat::UInt64: low = 0; high = 18446744073709551615.0; break;
+                case ValueFormat::Int: low = -2147483648.0; high = 2147483647.0; break;
+                default:
+                    low = -std::numeric_limits<double>::infinity();
+                    high = std::numeric_limits<double>::infinity();
+                    break;
+            }
+        }
+
+        bool fail(std::string& error, std::string message) {
+            error = std::move(message);
+            return false;
+        }
+
+    } // namespace
+
+    ValueFormat parseValueFormat(std::string_view format) {
+        for (const auto& entry : formatNames) {
+            if (format == entry.name) return entry.format;
+        }
+        return ValueFormat::Unknown;
+    }
+
+    const char* valueFormatName(ValueFormat format) {
+        for (const auto& entry : formatNames) {
+            if (entry.format == format) return entry.name;
+        }
+        return "unknown";
+    }
+
+    CharacteristicValue CharacteristicValue::fromBool(bool value) {
+        CharacteristicValue result;
+        result.type_ = Type::Bool;
+        result.boolean_ = value;
+        return result;
+    }
+
+    CharacteristicValue CharacteristicValue::fromInt(int64_t value) {
+        CharacteristicValue result;
+        result.type_ = Type::Int;
+        result.integer_ = value;
+        return result;
+    }
+
+    CharacteristicValue CharacteristicValue::fromFloat(double value) {
+        CharacteristicValue result;
+        result.type_ = Type::Float;
+        result.real_ = value;
+        return result;
+    }
+
+    CharacteristicValue CharacteristicValue::fromString(std::string value) {
+        CharacteristicValue result;
+        result.type_ = Type::String;
+        result.text_ = std::move(value);
+        return result;
+    }
+
+    CharacteristicValue CharacteristicValue::fromData(std::string value) {
+        CharacteristicValue result;
+        result.type_ = Type::Data;
+        result.text_ = std::move(value);
+        return result;
+    }
+
+    std::optional<CharacteristicValue> CharacteristicValue::parse(std::string_view text, ValueFormat format) {
+        switch (format) {
+            case ValueFormat::String:
+            case ValueFormat::Unknown:
+                return fromString(std::string(text));
+            case ValueFormat::TLV8:
+            case ValueFormat::Data:
+                return fromData(std::string(text));
+            default:
+                break;
+        }
+        if (text.empty()) return CharacteristicValue();
+
+        if (format == ValueFormat::Bool) {
+            // Same spellings the server accepts for writes, plus their opposites
+            if (text == "1" || equalsIgnoreCase(text, "true") || equalsIgnoreCase(text, "on")) return fromBool(true);
+            if (text == "0" || equalsIgnoreCase(text, "false") || equalsIgnoreCase(text, "off")) return fromBool(false);
+            return std::nullopt;
+        }
+        if (format == ValueFormat::Float) {
+            auto value = parseReal(text);
+            if (!value) return std::nullopt;
+            return fromFloat(*value);
+        }
+
+        auto value = parseInteger(text);
+        if (!value) return std::nullopt;
+        return fromInt(*value);
+    }
+
+    bool CharacteristicValue::asBool() const {
+        switch (type_) {
+            case Type::Bool: return boolean_;
+            case Type::Int: return integer_ != 0;
+            case Type::Float: return real_ != 0;
+            default: return false;
+        }
+    }
+
+    int64_t CharacteristicValue::asInt() const {
+        switch (type_) {
+            case Type::Bool: return boolean_ ? 1 : 0;
+            case Type::Int: return integer_;
+            case Type::Float: return static_cast<int64_t>(real_);
+            default: return 0;
+        }
+    }
+
+    double CharacteristicValue::asFloat() const {
+        switch (type_) {
+            case Type::Bool: return boolean_ ? 1.0 : 0.0;
+            case Type::Int: return static_cast<double>(integer_);
+            case Type::Float: return real_;
+            default: return 0;
+        }
+    }
+
+    std::string CharacteristicValue::toString() const {
+        switch (type_) {
+            case Type::Empty: return std::string();
+            case Type::Bool: return boolean_ ? "1" : "0";
+            case Type::Int: return std::to_string(integer_);
+            case Type::Float: return formatReal(real_);
+            default: return text_;
+        }
+    }
+
+    bool CharacteristicValue::operator==(const CharacteristicValue& other) const {
+        if (type_ != other.type_) return false;
+        switch (type_) {
+            case Type::Empty: return true;
+            case Type::Bool: return boolean_ == other.boolean_;
+            case Type::Int: return integer_ == other.integer_;
+            case Type::Float: return real_ == other.real_;
+            default: return text_ == other.text_;
+        }
+    }
+
+    // The regular and the arena metadata have the same fields with different string types
+    template <typename Metadata>
+    static ValueConstraints decodeConstraints(const Metadata& metadata) {
+        ValueConstraints constraints;
+        if (metadata.format) constraints.format = parseValueFormat(*metadata.format);
+        if (metadata.minimumValue) constraints.minimum = parseReal(*metadata.minimumValue);
+        if (metadata.maximumValue) constraints.maximum = parseReal(*metadata.maximumValue);
+        if (metadata.stepValue) constraints.step = parseReal(*metadata.stepValue);
+        if (metadata.maxLength) {
+            auto length = parseInteger(*metadata.maxLength);
+            if (length && *length >= 0) constraints.maxLength = static_cast<size_t>(*length);
+        }
+        if (metadata.validValues) {
+            for (const auto& text : *metadata.validValues) {
+                if (auto value = parseReal(text)) constraints.validValues.push_back(*value);
+            }
+        }
+        return constraints;
+    }
+
+    ValueConstraints ValueConstraints::fromMetadata(const CharacteristicMetadata& metadata) {
+        return decodeConstraints(metadata);
+    }
+
+    ValueConstraints ValueConstraints::fromMetadata(const pmr::CharacteristicMetadata& metadata) {
+        return decodeConstraints(metadata);
+    }
+
+    CharacteristicValue ValueConstraints::decode(std::string_view text) const {
+        auto value = CharacteristicValue::parse(text, format);
+        return value ? std::move(*value) : CharacteristicValue::fromString(std::string(text));
+    }
+
+    bool ValueConstraints::check(const CharacteristicValue& value, std::string& error) const {
+        if (format == ValueFormat::Unknown) return true;
+        if (value.isEmpty()) return fail(error, "a value is required");
+
+        switch (format) {
+            case ValueFormat::String:
+                if (!value.isString()) return fail(error, "expected a string value");
+                if (maxLength && value.asString().size() > *maxLength) {
+                    return fail(error, "string is longer than the maximum length " + std::to_string(*maxLength));
+                }
+                return true;
+            case ValueFormat::TLV8:
+            case ValueFormat::Data:
+                if (!value.isData() && !value.isString()) return fail(error, "expected a data value");
+                return true;
+            default:
+                break;
+        }
+
+        if (!value.isNumber()) return fail(error, std::string("expected a ") + valueFormatName(format) + " value");
+        const double number = value.asFloat();
+        if (format == ValueFormat::Bool && number != 0 && number != 1) {
+            return fail(error, "expected a bool value, got " + value.toString());
+        }
+        if (isIntegerFormat(format)) {
+            if (value.isFloat() && std::trunc(number) != number) {
+                return fail(error, "expected an integer, got " + value.toString());
+            }
+            double low = 0;
+            double high = 0;
+            formatLimits(format, low, high);
+            if (number < low || number > high) {
+                return fail(error, "value " + value.toString() + " is out of range for " + valueFormatName(format));
+            }
+        }
+
+        if (minimum && number < *minimum) {
+            return fail(error, "value " + value.toString() + " is below the minimum " + formatReal(*minimum));
+        }
+        if (maximum && number > *maximum) {
+            return fail(error, "value " + value.toString() + " is above the maximum " + formatReal(*maximum));
+        }
+        if (step && *step > 0) {
+            const double steps = (number - minimum.value_or(0)) / *step;
+            if (std::fabs(steps - std::round(steps)) > 1e-9 * std::max(1.0, std::fabs(steps))) {
+                return fail(error, "value " + value.toString() + " is not a multiple of the step " + formatReal(*step));
+            }
+        }
+        if (!validValues.empty()) {
+            bool valid = false;
+            for (double candidate : validValues) valid = valid || candidate == number;
+            if (!valid) return fail(error, "value " + value.toString() + " is not one of the valid values");
+        }
+        return true;
+    }
+
+    bool ValueConstraints::check(std::string_view text, std::string& error) const {
+        auto value = CharacteristicValue::parse(text, format);
+        if (!value) return fail(error, "'" + std::string(text) + "' is not a valid " + valueFormatName(format) + " value");
+        return check(*value, error);
+    }
+
+} // namespace prefab
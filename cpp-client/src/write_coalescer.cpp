@@ -0,0 +1,148 @@
+#include "write_coalescer.h"
+#include <algorithm>
+
+namespace prefab {
+
+    WriteCoalescer::WriteCoalescer(Reactor& reactor, std::chrono::milliseconds holdWindow, Send send)
+        : reactor_(reactor), holdWindow_(holdWindow), send_(std::move(send)) {}
+
+    std::string WriteCoalescer::keyFor(const Target& target, const std::string& characteristicId) {
+        std::string key;
+        for (const std::string* part : {&target.homeName, &target.roomName, &target.accessoryName}) {
+            key += *part;
+            key.push_back('\0');
+        }
+        key += characteristicId;
+        return key;
+    }
+
+    // No priority scope means a write's own priority, Interactive, which nothing outranks
+    static void mergeCaller(CallerContext& burst, CallerContext next) {
+        if (burst.deadline) next.deadline = next.deadline ? std::min(*next.deadline, *burst.deadline) : burst.deadline;
+        if (!burst.priority) {
+            next.priority.reset();
+        } else if (next.priority) {
+            next.priority = std::min(*next.priority, *burst.priority);
+        }
+        burst = std::move(next);  // The span of the newest write, whose value is sent
+    }
+
+    void WriteCoalescer::submit(const Target& target, const UpdateAccessoryInput& update,
+                                AsyncCallback<std::string> callback) {
+        std::string key = keyFor(target, update.characteristicId);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (closed_) {
+            lock.unlock();
+            callback(AsyncResult<std::string>::failure(std::make_exception_ptr(
+                PrefabException("Request cancelled: client is shutting down"))));
+            return;
+        }
+
+        Slot& slot = slots_[key];
+        slot.target = target;
+        slot.update = update;
+        slot.waiting.push_back(std::move(callback));
+        if (slot.held) {
+            mergeCaller(slot.caller, CallerContext());
+        } else {
+            slot.caller = CallerContext();
+        }
+        slot.held = true;
+
+        // A pending timer or the request in flight will pick up the new value
+        if (slot.inFlight || slot.timerArmed) return;
+
+        if (holdWindow_.count() <= 0) {
+            sendLocked(key, slot, lock);
+            return;
+        }
+
+        slot.timerArmed = true;
+        lock.unlock();
+
+        std::weak_ptr<WriteCoalescer> weak = weak_from_this();
+        reactor_.schedule(holdWindow_, [weak, key]() {
+            if (auto self = weak.lock()) self->holdExpired(key);
+        });
+    }
+
+    void WriteCoalescer::holdExpired(const std::string& key) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = slots_.find(key);
+        if (closed_ || it == slots_.end()) return;
+
+        Slot& slot = it->second;
+        slot.timerArmed = false;
+        if (slot.held && !slot.inFlight) {
+            sendLocked(key, slot, lock);
+        }
+    }
+
+    // Sends the held value of a slot; releases the lock before issuing the request
+    void WriteCoalescer::sendLocked(const std::string& key, Slot& slot, std::unique_lock<std::mutex>& lock) {
+        Target target = slot.target;
+        UpdateAccessoryInput update = slot.update;
+        std::vector<AsyncCallback<std::string>> waiting = std::move(slot.waiting);
+        const CallerContext caller = slot.caller;
+        slot.waiting.clear();
+        slot.held = false;
+        slot.inFlight = true;
+        lock.unlock();
+
+        CallerScope scope(caller);  // Usually on the network thread, which has none of its own
+        auto self = shared_from_this();
+        send_(target, update, [self, key, waiting = std::move(waiting)](AsyncResult<std::string> result) mutable {
+            self->finished(key, std::move(waiting), std::move(result));
+        });
+    }
+
+    void WriteCoalescer::finished(const std::string& key, std::vector<AsyncCallback<std::string>> waiting,
+                                  AsyncResult<std::string> result) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto it = slots_.find(key);
+            if (!closed_ && it != slots_.end()) {
+                Slot& slot = it->second;
+                slot.inFlight = false;
+                if (slot.held) {
+                    // Values that arrived during the request have already waited long enough
+                    sendLocked(key, slot, lock);
+                } else if (!slot.timerArmed) {
+                    slots_.erase(it);
+                }
+            }
+        }
+
+        for (auto& callback : waiting) {
+            try {
+                callback(result);
+            } catch (...) {
+                // One failing caller must not keep the others from hearing back
+            }
+        }
+    }
+
+    void WriteCoalescer::shutdown() {
+        std::vector<AsyncCallback<std::string>> held;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            for (auto& entry : slots_) {
+                for (auto& callback : entry.second.waiting) {
+                    held.push_back(std::move(callback));
+                }
+            }
+            slots_.clear();
+        }
+
+        auto cancelled = AsyncResult<std::string>::failure(std::make_exception_ptr(
+            PrefabException("Request cancelled: client is shutting down")));
+        for (auto& callback : held) {
+            try {
+                callback(cancelled);
+            } catch (...) {}
+        }
+    }
+
+} // namespace prefab
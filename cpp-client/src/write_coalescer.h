@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "prefab/client.h"
+#include "caller_context.h"
+#include "reactor.h"
+
+namespace prefab {
+
+    /**
+     * @brief Collapses rapid writes to the same characteristic into one request
+     *
+     * Writes are keyed by (home, room, accessory, characteristicId). The first
+     * write to an idle characteristic is held for the hold window, and any
+     * later write in that window replaces its value. At most one request per
+     * characteristic is in flight; writes arriving meanwhile are held and only
+     * the latest value is sent once the request finishes.
+     *
+     * The callback of a dropped write receives the result of the write that
+     * replaced it, so every caller learns whether the characteristic reached
+     * a value at least as new as its own.
+     *
+     * The request is sent under the callers' context (see CallerContext): the
+     * tightest deadline and most urgent priority among the writes it carries,
+     * and the trace span of the newest one.
+     *
+     * Create it with std::make_shared: timers and in-flight requests keep
+     * references to it.
+     */
+    class WriteCoalescer : public std::enable_shared_from_this<WriteCoalescer> {
+    public:
+        struct Target {
+            std::string homeName;
+            std::string roomName;
+            std::string accessoryName;
+        };
+
+        using Send = std::function<void(const Target&, const UpdateAccessoryInput&, AsyncCallback<std::string>)>;
+
+        /**
+         * @param reactor Runs hold-window timers; must outlive the coalescer's use
+         * @param holdWindow How long the first write of a burst waits for newer values
+         * @param send Issues the actual request
+         */
+        WriteCoalescer(Reactor& reactor, std::chrono::milliseconds holdWindow, Send send);
+
+        void submit(const Target& target, const UpdateAccessoryInput& update, AsyncCallback<std::string> callback);
+
+        /**
+         * @brief Fail every held write and stop accepting new ones
+         */
+        void shutdown();
+
+    private:
+        struct Slot {
+            Target target;
+            UpdateAccessoryInput update;
+            std::vector<AsyncCallback<std::string>> waiting;  // Callers of the held value and of those it replaced
+            CallerContext caller;   // Merged over the writes in waiting
+            bool held = false;      // A value is waiting to be sent
+            bool timerArmed = false;
+            bool inFlight = false;
+        };
+
+        static std::string keyFor(const Target& target, const std::string& characteristicId);
+
+        void holdExpired(const std::string& key);
+        void sendLocked(const std::string& key, Slot& slot, std::unique_lock<std::mutex>& lock);
+        void finished(const std::string& key, std::vector<AsyncCallback<std::string>> waiting,
+                      AsyncResult<std::string> result);
+
+        Reactor& reactor_;
+        std::chrono::milliseconds holdWindow_;
+        Send send_;
+
+        std::mutex mutex_;
+        std::unordered_map<std::string, Slot> slots_;
+        bool closed_ = false;
+    };
+
+} // namespace prefab
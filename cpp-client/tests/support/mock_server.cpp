@@ -0,0 +1,633 @@
+#include "mock_server.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace prefab {
+namespace testing {
+
+    namespace {
+
+        struct CharacteristicTemplate {
+            const char* typeName;
+            const char* type;
+            const char* format;
+            const char* units;
+            const char* value;
+        };
+
+        const CharacteristicTemplate characteristicTemplates[] = {
+            {"On", "00000025-0000-1000-8000-0026BB765291", "bool", nullptr, "0"},
+            {"Brightness", "00000008-0000-1000-8000-0026BB765291", "int", "percentage", "100"},
+            {"Hue", "00000013-0000-1000-8000-0026BB765291", "float", "arcdegrees", "0"},
+            {"Saturation", "0000002F-0000-1000-8000-0026BB765291", "float", "percentage", "0"},
+            {"Color Temperature", "000000CE-0000-1000-8000-0026BB765291", "uint32", nullptr, "140"},
+            {"Name", "00000023-0000-1000-8000-0026BB765291", "string", nullptr, "Light"},
+        };
+
+        const char* const lightbulbType = "00000043-0000-1000-8000-0026BB765291";
+
+        // Deterministic, UUID-shaped identifier; the generation changes every ID on re-pairing
+        std::string makeId(unsigned kind, unsigned a, unsigned b, unsigned c, uint64_t generation) {
+            char buffer[40];
+            std::snprintf(buffer, sizeof(buffer), "%08X-%04X-4%03X-8%03X-%012llX",
+                          kind, a & 0xFFFF, b & 0xFFF, c & 0xFFF,
+                          static_cast<unsigned long long>(generation & 0xFFFFFFFFFFFFULL));
+            return buffer;
+        }
+
+        std::string percentDecode(const std::string& value) {
+            std::string decoded;
+            decoded.reserve(value.size());
+            for (size_t i = 0; i < value.size(); ++i) {
+                if (value[i] == '%' && i + 2 < value.size()) {
+                    decoded.push_back(static_cast<char>(std::stoi(value.substr(i + 1, 2), nullptr, 16)));
+                    i += 2;
+                } else {
+                    decoded.push_back(value[i]);
+                }
+            }
+            return decoded;
+        }
+
+        const char* reasonPhrase(int status) {
+            switch (status) {
+                case 200: return "OK";
+                case 400: return "Bad Request";
+                case 404: return "Not Found";
+                case 405: return "Method Not Allowed";
+                default: return "Error";
+            }
+        }
+
+        bool sendAll(int fd, const std::string& data) {
+            size_t sent = 0;
+            while (sent < data.size()) {
+                ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0) return false;
+                sent += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+    } // namespace
+
+    // Each server, and each restart of one, reports an epoch no other has used, like the
+    // Swift server's UUID per launch
+    static int nextEpoch() {
+        static std::atomic<int> epochs{0};
+        return ++epochs;
+    }
+
+    MockPrefabServer::MockPrefabServer(const MockServerOptions& options) : options_(options), epoch_(nextEpoch()) {
+        generate();
+
+        listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd_ < 0) throw std::runtime_error("mock server: socket() failed");
+        int yes = 1;
+        ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<uint16_t>(options_.port));
+        if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(listenFd_, 1024) != 0) {
+            ::close(listenFd_);
+            throw std::runtime_error("mock server: cannot listen on port " + std::to_string(options_.port));
+        }
+
+        socklen_t length = sizeof(address);
+        ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&address), &length);
+        port_ = ntohs(address.sin_port);
+
+        acceptThread_ = std::thread(&MockPrefabServer::acceptLoop, this);
+    }
+
+    MockPrefabServer::~MockPrefabServer() {
+        {
+            // Wake long polls waiting for changes
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            changed_.notify_all();
+        }
+        ::shutdown(listenFd_, SHUT_RDWR);
+        ::close(listenFd_);
+        if (acceptThread_.joinable()) acceptThread_.join();
+
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (int fd : clientFds_) ::shutdown(fd, SHUT_RDWR);
+            threads.swap(clientThreads_);
+        }
+        for (auto& thread : threads) thread.join();
+    }
+
+    std::string MockPrefabServer::baseUrl() const {
+        return "http://127.0.0.1:" + std::to_string(port_);
+    }
+
+    std::string MockPrefabServer::homeName(int home) { return "Home " + std::to_string(home + 1); }
+    std::string MockPrefabServer::roomName(int room) { return "Room " + std::to_string(room + 1); }
+    std::string MockPrefabServer::accessoryName(int accessory) { return "Accessory " + std::to_string(accessory + 1); }
+
+    void MockPrefabServer::generate() {
+        const MockHomeLayout& layout = options_.layout;
+        const size_t templateCount = std::size(characteristicTemplates);
+        homes_.clear();
+
+        for (int h = 0; h < layout.homes; ++h) {
+            HomeData home;
+            home.name = homeName(h);
+            std::vector<GroupService> lights;
+
+            for (int r = 0; r < layout.roomsPerHome; ++r) {
+                std::string room = roomName(r);
+                home.rooms.push_back(room);
+                auto& accessories = home.accessories[room];
+
+                for (int a = 0; a < layout.accessoriesPerRoom; ++a) {
+                    Accessory accessory;
+                    accessory.home = home.name;
+                    accessory.room = room;
+                    accessory.name = accessoryName(a);
+                    accessory.category = "Lightbulb";
+                    accessory.isReachable = true;
+                    accessory.supportsIdentify = true;
+                    accessory.isBridged = false;
+                    accessory.manufacturer = "Prefab";
+                    accessory.model = "Mock Light";
+                    accessory.firmwareVersion = "1.0.0";
+                    accessory.services.emplace();
+
+                    unsigned accessoryIndex = static_cast<unsigned>((h * layout.roomsPerHome + r) * layout.accessoriesPerRoom + a);
+                    for (int s = 0; s < layout.servicesPerAccessory; ++s) {
+                        Service service;
+                        service.uniqueIdentifier =
+                            *Uuid::parse(makeId(1, accessoryIndex, static_cast<unsigned>(s), 0, idGeneration_));
+                        service.name = accessory.name + " " + std::to_string(s + 1);
+                        service.typeName = InternedString("Lightbulb");
+                        service.type = *Uuid::parse(lightbulbType);
+                        service.isPrimary = s == 0;
+                        service.isUserInteractive = true;
+
+                        for (int c = 0; c < layout.characteristicsPerService; ++c) {
+                            const CharacteristicTemplate& t = characteristicTemplates[c % templateCount];
+                            Characteristic characteristic;
+                            characteristic.uniqueIdentifier = *Uuid::parse(
+                                makeId(2, accessoryIndex, static_cast<unsigned>(s), static_cast<unsigned>(c), idGeneration_));
+                            characteristic.description = t.typeName;
+                            characteristic.properties = {"HMCharacteristicPropertyReadable",
+                                                         "HMCharacteristicPropertyWritable",
+                                                         "HMCharacteristicPropertySupportsEventNotification"};
+                            characteristic.typeName = InternedString(t.typeName);
+                            characteristic.type = *Uuid::parse(t.type);
+                            characteristic.metadata.format = t.format;
+                            if (t.units) characteristic.metadata.units = t.units;
+                            if (std::strcmp(t.format, "bool") != 0 && std::strcmp(t.format, "string") != 0) {
+                                characteristic.metadata.minimumValue = "0";
+                                characteristic.metadata.maximumValue = "100";
+                                characteristic.metadata.stepValue = "1";
+                            }
+                            characteristic.value = t.value;
+                            service.characteristics.push_back(std::move(characteristic));
+                        }
+
+                        if (s == 0) {
+                            lights.push_back(GroupService{accessory.name, service.name, service.type.toString(),
+                                                          service.uniqueIdentifier.toString()});
+                        }
+                        accessory.services->push_back(std::move(service));
+                    }
+                    accessories.push_back(std::move(accessory));
+                }
+            }
+
+            for (int s = 0; s < layout.scenesPerHome; ++s) {
+                SceneDetail scene;
+                scene.home = home.name;
+                scene.uniqueIdentifier = makeId(3, static_cast<unsigned>(h), static_cast<unsigned>(s), 0, 0);
+                scene.name = "Scene " + std::to_string(s + 1);
+                scene.isBuiltIn = s == 0;
+                for (const auto& light : lights) {
+                    scene.actions.push_back(SceneAction{light.accessoryName, light.serviceName,
+                                                        characteristicTemplates[0].type, s % 2 ? "1" : "0"});
+                }
+                home.scenes.push_back(std::move(scene));
+            }
+
+            for (int g = 0; g < layout.groupsPerHome; ++g) {
+                AccessoryGroupDetail group;
+                group.home = home.name;
+                group.uniqueIdentifier = makeId(4, static_cast<unsigned>(h), static_cast<unsigned>(g), 0, 0);
+                group.name = "Group " + std::to_string(g + 1);
+                for (size_t l = static_cast<size_t>(g); l < lights.size(); l += static_cast<size_t>(layout.groupsPerHome)) {
+                    group.services.push_back(lights[l]);
+                }
+                home.groups.push_back(std::move(group));
+            }
+
+            homes_.push_back(std::move(home));
+        }
+    }
+
+    void MockPrefabServer::regenerateIdentifiers() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idGeneration_++;
+        generate();
+    }
+
+    Accessory MockPrefabServer::accessory(const std::string& homeName, const std::string& roomName,
+                                          const std::string& accessoryName) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const Accessory* found = const_cast<MockPrefabServer*>(this)->findAccessory(homeName, roomName, accessoryName);
+        if (!found) throw std::runtime_error("mock server: no accessory " + accessoryName);
+        return *found;
+    }
+
+    size_t MockPrefabServer::requestCount(const std::string& method, const std::string& path) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = requestCounts_.find(method + " " + path);
+        return it == requestCounts_.end() ? 0 : it->second;
+    }
+
+    void MockPrefabServer::setCharacteristicValue(const std::string& homeName, const std::string& roomName,
+                                                  const std::string& accessoryName, const std::string& typeName,
+                                                  const std::string& value, bool notify) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Accessory* accessory = findAccessory(homeName, roomName, accessoryName);
+        if (!accessory) throw std::runtime_error("mock server: no accessory " + accessoryName);
+        for (auto& service : *accessory->services) {
+            for (auto& characteristic : service.characteristics) {
+                if (characteristic.typeName != typeName) continue;
+                characteristic.value = value;
+                if (notify) recordChange(*accessory, service, characteristic);
+                return;
+            }
+        }
+        throw std::runtime_error("mock server: no characteristic " + typeName);
+    }
+
+    void MockPrefabServer::restartEvents() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        epoch_ = nextEpoch();
+        sequence_ = 0;
+        changes_.clear();
+        changed_.notify_all();
+    }
+
+    void MockPrefabServer::failEvents(int count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failEvents_ = count;
+    }
+
+    void MockPrefabServer::failAccessoryReads(int count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failAccessoryReads_ = count;
+    }
+
+    // Caller holds mutex_
+    void MockPrefabServer::recordChange(const Accessory& accessory, const Service& service,
+                                        const Characteristic& characteristic) {
+        changes_.push_back(CharacteristicChange{++sequence_, accessory.home, accessory.room, accessory.name,
+                                                service.uniqueIdentifier, characteristic.uniqueIdentifier,
+                                                characteristic.value});
+        if (changes_.size() > 1024) changes_.pop_front();
+        changed_.notify_all();
+    }
+
+    // Same contract as the Swift route: no since answers at once, otherwise wait for a change after it
+    MockPrefabServer::Response MockPrefabServer::handleEvents(const std::string& query) {
+        std::optional<uint64_t> since;
+        long waitSeconds = 0;
+        size_t start = 0;
+        while (start < query.size()) {
+            size_t end = query.find('&', start);
+            if (end == std::string::npos) end = query.size();
+            std::string parameter = query.substr(start, end - start);
+            if (parameter.rfind("since=", 0) == 0) since = std::stoull(parameter.substr(6));
+            if (parameter.rfind("wait=", 0) == 0) waitSeconds = std::clamp(std::stol(parameter.substr(5)), 0L, 60L);
+            start = end + 1;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (failEvents_ > 0) {
+            failEvents_--;
+            return Response{503, "Service unavailable"};
+        }
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(waitSeconds);
+        while (true) {
+            ChangeBatch batch;
+            batch.epoch = "mock-" + std::to_string(epoch_);
+            batch.sequence = sequence_;
+            if (!since) return Response{200, json(batch).dump()};
+
+            const uint64_t oldest = changes_.empty() ? sequence_ + 1 : changes_.front().sequence;
+            if (*since > sequence_ || *since + 1 < oldest) {
+                batch.reset = true;
+                return Response{200, json(batch).dump()};
+            }
+            if (*since < sequence_) {
+                for (const auto& change : changes_) {
+                    if (change.sequence > *since) batch.changes.push_back(change);
+                }
+                return Response{200, json(batch).dump()};
+            }
+            if (stopping_ || changed_.wait_until(lock, deadline) == std::cv_status::timeout) {
+                return Response{200, json(batch).dump()};
+            }
+        }
+    }
+
+    std::string MockPrefabServer::lastTraceparent() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lastTraceparent_;
+    }
+
+    void MockPrefabServer::resetCounters() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requestCounts_.clear();
+        lastTraceparent_.clear();
+        totalRequests_ = 0;
+    }
+
+    void MockPrefabServer::acceptLoop() {
+        if (options_.onThreadStart) options_.onThreadStart();
+        while (!stopping_) {
+            int fd = ::accept(listenFd_, nullptr, nullptr);
+            if (fd < 0) {
+                if (stopping_) break;
+                continue;
+            }
+            int yes = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+            connections_++;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            clientFds_.push_back(fd);
+            clientThreads_.emplace_back(&MockPrefabServer::serve, this, fd);
+        }
+    }
+
+    void MockPrefabServer::serve(int fd) {
+        if (options_.onThreadStart) options_.onThreadStart();
+        std::string buffer;
+        char chunk[16384];
+
+        while (!stopping_) {
+            // Read until the end of the headers
+            size_t headerEnd;
+            while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+                ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) goto done;
+                buffer.append(chunk, static_cast<size_t>(n));
+            }
+
+            {
+                std::string head = buffer.substr(0, headerEnd);
+                size_t lineEnd = head.find("\r\n");
+                std::string requestLine = head.substr(0, lineEnd);
+                size_t firstSpace = requestLine.find(' ');
+                size_t secondSpace = requestLine.find(' ', firstSpace + 1);
+                std::string method = requestLine.substr(0, firstSpace);
+                std::string target = requestLine.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+
+                size_t contentLength = 0;
+                bool close = false;
+                std::string lowerHead = head;
+                std::transform(lowerHead.begin(), lowerHead.end(), lowerHead.begin(),
+                               [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                size_t lengthAt = lowerHead.find("\r\ncontent-length:");
+                if (lengthAt != std::string::npos) {
+                    contentLength = std::stoul(head.substr(lengthAt + 17));
+                }
+                if (lowerHead.find("\r\nconnection: close") != std::string::npos) close = true;
+                std::string traceparent;
+                size_t traceAt = lowerHead.find("\r\ntraceparent:");
+                if (traceAt != std::string::npos) {
+                    size_t valueAt = head.find_first_not_of(' ', traceAt + 14);
+                    traceparent = head.substr(valueAt, head.find("\r\n", valueAt) - valueAt);
+                }
+
+                while (buffer.size() < headerEnd + 4 + contentLength) {
+                    ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+                    if (n <= 0) goto done;
+                    buffer.append(chunk, static_cast<size_t>(n));
+                }
+                std::string body = buffer.substr(headerEnd + 4, contentLength);
+                buffer.erase(0, headerEnd + 4 + contentLength);
+
+                std::string path = target.substr(0, target.find('?'));
+                std::vector<std::string> segments;
+                std::string decodedPath;
+                size_t start = 1;
+                while (start <= path.size()) {
+                    size_t slash = path.find('/', start);
+                    if (slash == std::string::npos) slash = path.size();
+                    if (slash > start) {
+                        segments.push_back(percentDecode(path.substr(start, slash - start)));
+                        decodedPath += "/" + segments.back();
+                    }
+                    start = slash + 1;
+                }
+
+                const auto received = std::chrono::steady_clock::now();
+                totalRequests_++;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    requestCounts_[method + " " + (decodedPath.empty() ? "/" : decodedPath)]++;
+                    if (!traceparent.empty()) lastTraceparent_ = traceparent;
+                }
+
+                if (options_.latency.count() > 0) {
+                    std::this_thread::sleep_for(options_.latency);
+                }
+
+                const size_t queryAt = target.find('?');
+                Response response = method == "GET" && segments.size() == 1 && segments[0] == "events"
+                                        ? handleEvents(queryAt == std::string::npos ? "" : target.substr(queryAt + 1))
+                                        : handle(method, segments, body);
+                const double handledMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - received).count();
+                std::string reply = "HTTP/1.1 " + std::to_string(response.status) + " " + reasonPhrase(response.status) +
+                                    "\r\nServer-Timing: app;dur=" + std::to_string(handledMs) +
+                                    "\r\nContent-Type: application/json\r\nContent-Length: " +
+                                    std::to_string(response.body.size()) +
+                                    (close ? "\r\nConnection: close\r\n\r\n" : "\r\n\r\n") + response.body;
+                if (!sendAll(fd, reply) || close) break;
+            }
+        }
+
+    done:
+        std::lock_guard<std::mutex> lock(mutex_);
+        clientFds_.erase(std::remove(clientFds_.begin(), clientFds_.end(), fd), clientFds_.end());
+        ::close(fd);
+    }
+
+    const MockPrefabServer::HomeData* MockPrefabServer::findHome(const std::string& name) const {
+        for (const auto& home : homes_) {
+            if (home.name == name) return &home;
+        }
+        return nullptr;
+    }
+
+    Accessory* MockPrefabServer::findAccessory(const std::string& home, const std::string& room,
+                                               const std::string& accessory) {
+        for (auto& data : homes_) {
+            if (data.name != home) continue;
+            auto rooms = data.accessories.find(room);
+            if (rooms == data.accessories.end()) return nullptr;
+            for (auto& candidate : rooms->second) {
+                if (candidate.name == accessory) return &candidate;
+            }
+        }
+        return nullptr;
+    }
+
+    MockPrefabServer::Response MockPrefabServer::handle(const std::string& method,
+                                                        const std::vector<std::string>& segments,
+                                                        const std::string& body) {
+        const Response notFound{404, ""};
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (segments.empty()) return Response{200, ""};
+        const std::string& resource = segments[0];
+        const HomeData* home = segments.size() > 1 ? findHome(segments[1]) : nullptr;
+        if (segments.size() > 1 && !home) return notFound;
+
+        if (resource == "homes" && method == "GET") {
+            if (segments.size() == 1) {
+                json homes = json::array();
+                for (const auto& data : homes_) homes.push_back(Home{data.name});
+                return Response{200, homes.dump()};
+            }
+            if (segments.size() == 2) return Response{200, json(Home{home->name}).dump()};
+        }
+
+        if (resource == "rooms" && method == "GET") {
+            if (segments.size() == 2) {
+                json rooms = json::array();
+                for (const auto& room : home->rooms) rooms.push_back(Room{home->name, room});
+                return Response{200, rooms.dump()};
+            }
+            if (segments.size() == 3) {
+                if (!home->accessories.count(segments[2])) return notFound;
+                return Response{200, json(Room{home->name, segments[2]}).dump()};
+            }
+        }
+
+        if (resource == "accessories") {
+            if (segments.size() < 3) return notFound;
+            auto room = home->accessories.find(segments[2]);
+            if (room == home->accessories.end()) return notFound;
+
+            if (segments.size() == 3 && method == "GET") {
+                // Room listings only carry the basic fields, like the Swift server
+                json accessories = json::array();
+                for (const auto& accessory : room->second) {
+                    Accessory basic;
+                    basic.home = accessory.home;
+                    basic.room = accessory.room;
+                    basic.name = accessory.name;
+                    basic.category = accessory.category;
+                    accessories.push_back(basic);
+                }
+                return Response{200, accessories.dump()};
+            }
+
+            if (segments.size() == 4) {
+                Accessory* accessory = findAccessory(segments[1], segments[2], segments[3]);
+                if (!accessory) return notFound;
+                if (method == "GET" && failAccessoryReads_ > 0) {
+                    failAccessoryReads_--;
+                    return Response{503, "Service unavailable"};
+                }
+                if (method == "GET") return Response{200, json(*accessory).dump()};
+                if (method != "PUT") return Response{405, ""};
+
+                UpdateAccessoryInput update;
+                try {
+                    update = json::parse(body).get<UpdateAccessoryInput>();
+                } catch (const json::exception&) {
+                    return Response{400, "Invalid update object."};
+                }
+                const std::optional<Uuid> serviceId = Uuid::parse(update.serviceId);
+                const std::optional<Uuid> characteristicId = Uuid::parse(update.characteristicId);
+                for (auto& service : *accessory->services) {
+                    if (!serviceId || service.uniqueIdentifier != *serviceId) continue;
+                    for (auto& characteristic : service.characteristics) {
+                        if (characteristicId && characteristic.uniqueIdentifier == *characteristicId) {
+                            characteristic.value = update.value;
+                            recordChange(*accessory, service, characteristic);
+                            return Response{200, ""};
+                        }
+                    }
+                    return Response{404, "Characteristic not found."};
+                }
+                return Response{404, "Service not found."};
+            }
+        }
+
+        if (resource == "scenes") {
+            if (segments.size() == 2 && method == "GET") {
+                json scenes = json::array();
+                for (const auto& scene : home->scenes) {
+                    scenes.push_back(HomeKitScene{scene.home, scene.uniqueIdentifier, scene.name, scene.isBuiltIn});
+                }
+                return Response{200, scenes.dump()};
+            }
+            if (segments.size() >= 3) {
+                auto scene = std::find_if(home->scenes.begin(), home->scenes.end(),
+                                          [&](const SceneDetail& s) { return s.uniqueIdentifier == segments[2]; });
+                if (scene == home->scenes.end()) return notFound;
+                if (segments.size() == 3 && method == "GET") return Response{200, json(*scene).dump()};
+                if (segments.size() == 4 && segments[3] == "execute" && method == "POST") {
+                    return Response{200, json{{"success", true}, {"scene", scene->name}}.dump()};
+                }
+            }
+        }
+
+        if (resource == "groups") {
+            if (segments.size() == 2 && method == "GET") {
+                json groups = json::array();
+                for (const auto& group : home->groups) {
+                    groups.push_back(AccessoryGroup{group.home, group.uniqueIdentifier, group.name,
+                                                    static_cast<int>(group.services.size())});
+                }
+                return Response{200, groups.dump()};
+            }
+            if (segments.size() == 3) {
+                auto group = std::find_if(home->groups.begin(), home->groups.end(),
+                                          [&](const AccessoryGroupDetail& g) { return g.uniqueIdentifier == segments[2]; });
+                if (group == home->groups.end()) return notFound;
+                if (method == "GET") return Response{200, json(*group).dump()};
+                if (method == "PUT") {
+                    UpdateGroupInput update;
+                    try {
+                        update = json::parse(body).get<UpdateGroupInput>();
+                    } catch (const json::exception&) {
+                        return Response{400, "Invalid update object."};
+                    }
+                    return Response{200, json{{"success", true}, {"group", group->name},
+                                              {"updated", group->services.size()}, {"failed", 0}}.dump()};
+                }
+            }
+        }
+
+        return notFound;
+    }
+
+} // namespace testing
+} // namespace prefab
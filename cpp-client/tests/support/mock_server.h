@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <prefab/models.h>
+
+namespace prefab {
+namespace testing {
+
+    /**
+     * @brief Size of the generated HomeKit data set
+     */
+    struct MockHomeLayout {
+        int homes = 1;
+        int roomsPerHome = 4;
+        int accessoriesPerRoom = 6;
+        int servicesPerAccessory = 3;
+        int characteristicsPerService = 5;
+        int scenesPerHome = 4;
+        int groupsPerHome = 2;
+    };
+
+    struct MockServerOptions {
+        MockHomeLayout layout;
+        std::chrono::milliseconds latency{0};  ///< Artificial delay before every response
+        int port = 0;                          ///< 0 picks a free port
+        std::function<void()> onThreadStart;   ///< Runs first on every server thread
+
+        MockServerOptions() = default;
+    };
+
+    /**
+     * @brief In-process HTTP server that speaks the Prefab API
+     *
+     * Serves the same routes as Sources/PrefabServer/Routes+*.swift from a
+     * generated data set: homes named "Home 1".., rooms "Room 1".., and
+     * accessories "Accessory 1".. in every room. Writes update the stored
+     * characteristic values and are answered the way the Swift server answers
+     * them, including 404 "Service not found." or "Characteristic not found."
+     * for unknown IDs. Writes are published on the GET /events long-poll feed
+     * like Sources/PrefabServer/Routes+Events.swift does.
+     *
+     * Every connection gets its own thread and HTTP/1.1 keep-alive is
+     * supported. Responses carry a Server-Timing header with the time spent
+     * on the request, artificial latency included. Meant for tests and
+     * benchmarks only; it binds to 127.0.0.1.
+     */
+    class MockPrefabServer {
+    public:
+        explicit MockPrefabServer(const MockServerOptions& options = MockServerOptions());
+        ~MockPrefabServer();
+
+        MockPrefabServer(const MockPrefabServer&) = delete;
+        MockPrefabServer& operator=(const MockPrefabServer&) = delete;
+
+        int port() const { return port_; }
+        std::string baseUrl() const;
+
+        const MockHomeLayout& layout() const { return options_.layout; }
+
+        static std::string homeName(int home);
+        static std::string roomName(int room);
+        static std::string accessoryName(int accessory);
+
+        /**
+         * @brief Current model of an accessory, including written values
+         */
+        Accessory accessory(const std::string& homeName, const std::string& roomName,
+                            const std::string& accessoryName) const;
+
+        /**
+         * @brief Give every service and characteristic a new ID, as re-pairing would
+         */
+        void regenerateIdentifiers();
+
+        /**
+         * @brief Change a characteristic (by typeName) as if from outside the API, e.g. a wall switch
+         *
+         * With notify the change is published on GET /events like a write
+         * through the API; without it the change is silent, as if the feed
+         * missed it.
+         */
+        void setCharacteristicValue(const std::string& homeName, const std::string& roomName,
+                                    const std::string& accessoryName, const std::string& typeName,
+                                    const std::string& value, bool notify = true);
+
+        /**
+         * @brief Start a new event epoch and drop buffered changes, as a restarted server would
+         */
+        void restartEvents();
+
+        /**
+         * @brief Answer the next count GET /events requests with 503, as a failing proxy would
+         */
+        void failEvents(int count);
+
+        /**
+         * @brief Answer the next count GET requests for single accessories with 503
+         */
+        void failAccessoryReads(int count);
+
+        /**
+         * @brief Number of requests received, optionally only for one method and decoded path
+         */
+        size_t requestCount() const { return totalRequests_.load(); }
+        size_t requestCount(const std::string& method, const std::string& path) const;
+        size_t connectionCount() const { return connections_.load(); }
+        void resetCounters();
+
+        /**
+         * @brief traceparent header of the latest request that sent one (cleared by resetCounters)
+         */
+        std::string lastTraceparent() const;
+
+    private:
+        struct Response {
+            int status = 200;
+            std::string body;
+        };
+
+        struct HomeData {
+            std::string name;
+            std::vector<std::string> rooms;
+            std::map<std::string, std::vector<Accessory>> accessories;  // By room
+            std::vector<SceneDetail> scenes;
+            std::vector<AccessoryGroupDetail> groups;
+        };
+
+        void generate();
+        void acceptLoop();
+        void serve(int fd);
+        Response handle(const std::string& method, const std::vector<std::string>& segments, const std::string& body);
+        Response handleEvents(const std::string& query);
+        void recordChange(const Accessory& accessory, const Service& service, const Characteristic& characteristic);
+
+        const HomeData* findHome(const std::string& name) const;
+        Accessory* findAccessory(const std::string& home, const std::string& room, const std::string& accessory);
+
+        MockServerOptions options_;
+        int listenFd_ = -1;
+        int port_ = 0;
+        std::thread acceptThread_;
+        std::atomic<bool> stopping_{false};
+        std::atomic<size_t> totalRequests_{0};
+        std::atomic<size_t> connections_{0};
+
+        mutable std::mutex mutex_;
+        std::vector<HomeData> homes_;
+        uint64_t idGeneration_ = 0;
+        std::map<std::string, size_t> requestCounts_;  // "METHOD path"
+        std::string lastTraceparent_;
+        std::vector<int> clientFds_;
+
+        // Change feed (GET /events), guarded by mutex_
+        std::condition_variable changed_;
+        std::deque<CharacteristicChange> changes_;
+        uint64_t sequence_ = 0;
+        int epoch_;  // Unique across servers in the process
+        int failEvents_ = 0;
+        int failAccessoryReads_ = 0;
+        std::vector<std::thread> clientThreads_;
+    };
+
+} // namespace testing
+} // namespace prefab
@@ -0,0 +1,913 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <prefab/prefab.h>
+#include <mock_server.h>
+
+using prefab::testing::MockPrefabServer;
+
+static prefab::ClientConfig configFor(const MockPrefabServer& server) {
+    prefab::ClientConfig config(server.baseUrl());
+    config.enableMdnsDiscovery = false;
+    return config;
+}
+
+static std::string characteristicValue(const prefab::Accessory& accessory, const std::string& typeName) {
+    for (const auto& service : *accessory.services) {
+        for (const auto& characteristic : service.characteristics) {
+            if (characteristic.typeName == typeName) return characteristic.value;
+        }
+    }
+    return "";
+}
+
+static bool waitUntil(const std::function<bool()>& condition) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+int main() {
+    std::cout << "Testing PrefabClient against the mock server..." << std::endl;
+
+    prefab::testing::MockServerOptions options;
+    options.layout.roomsPerHome = 2;
+    options.layout.accessoriesPerRoom = 3;
+    MockPrefabServer server(options);
+
+    const std::string home = MockPrefabServer::homeName(0);
+    const std::string room = MockPrefabServer::roomName(0);
+    const std::string lamp = MockPrefabServer::accessoryName(0);
+    const std::string lampPath = "/accessories/" + home + "/" + room + "/" + lamp;
+
+    try {
+        // Discovery answers from the background browser's registry within the timeout, daemon or not
+        {
+            auto browser = prefab::ServiceBrowser::shared();
+            assert(browser == prefab::ServiceBrowser::shared());
+            const auto started = std::chrono::steady_clock::now();
+            prefab::PrefabClient client(configFor(server));
+            const bool found = client.discoverServices([](const std::string&, int) {}, 50);
+            assert(std::chrono::steady_clock::now() - started < std::chrono::seconds(2));
+            assert(found == !client.discoveredServers().empty());
+        }
+
+        // Lazy discovery: construction does not wait, and a saved server is used at once
+        {
+            const std::string cachePath = (std::filesystem::temp_directory_path() /
+                                           ("prefab-test-" + std::to_string(::getpid()) + ".discovery")).string();
+            std::ofstream(cachePath) << nlohmann::json{{"url", server.baseUrl()}}.dump();
+
+            prefab::ClientConfig config;
+            config.lazyDiscovery = true;
+            config.discoveryTimeoutMs = 60000;
+            config.discoveryCachePath = cachePath;
+            const auto started = std::chrono::steady_clock::now();
+            prefab::PrefabClient client(config);
+            assert(std::chrono::steady_clock::now() - started < std::chrono::seconds(1));
+            assert(client.getBaseUrl() == server.baseUrl() && client.getHomes().size() == 1);
+            std::remove(cachePath.c_str());
+        }
+
+        // Read API
+        {
+            prefab::PrefabClient client(configFor(server));
+            assert(client.testConnection());
+            assert(client.getHomes().size() == 1);
+            assert(client.getRooms(home).size() == 2);
+            assert(client.getAccessories(home, room).size() == 3);
+
+            prefab::Accessory accessory = client.getAccessory(home, room, lamp);
+            assert(accessory.name == lamp);
+            assert(accessory.services && accessory.services->size() == 3);
+
+            prefab::AccessoryArena arena;
+            client.getAccessories(home, room, arena);
+            const prefab::pmr::Accessory& pooled = client.getAccessory(home, room, lamp, arena);
+            assert(arena.accessories().size() == 3 + 1 && &pooled == &arena.accessories().back());
+            assert(nlohmann::json(prefab::toAccessory(pooled)) == nlohmann::json(accessory));
+
+            auto scenes = client.getScenes(home);
+            assert(!scenes.empty());
+            assert(client.getScene(home, scenes[0].uniqueIdentifier).actions.size() == 2 * 3);
+
+            bool notFound = false;
+            try {
+                client.getAccessory(home, room, "Missing");
+            } catch (const prefab::PrefabException& e) {
+                notFound = e.getHttpCode() == 404;
+            }
+            assert(notFound);
+            std::cout << "✓ Read API" << std::endl;
+        }
+
+        // Writes by type resolve IDs once, and again only after the server rejects them
+        {
+            prefab::PrefabClient client(configFor(server));
+            server.resetCounters();
+            client.updateCharacteristicByType(home, room, lamp, "Brightness", "10");
+            client.updateCharacteristicByType(home, room, lamp, "Brightness", "20");
+            client.updateCharacteristicByTypeAsync(home, room, lamp, "Brightness", "30").get();
+            assert(server.requestCount("GET", lampPath) == 1);
+            assert(server.requestCount("PUT", lampPath) == 3);
+            assert(characteristicValue(server.accessory(home, room, lamp), "Brightness") == "30");
+
+            server.regenerateIdentifiers();
+            client.updateCharacteristicByType(home, room, lamp, "Brightness", "40");
+            assert(server.requestCount("GET", lampPath) == 2);
+            assert(server.requestCount("PUT", lampPath) == 5);
+            assert(characteristicValue(server.accessory(home, room, lamp), "Brightness") == "40");
+
+            // Out-of-range typed writes are rejected locally
+            client.updateCharacteristicByType(home, room, lamp, "Brightness", prefab::CharacteristicValue::fromInt(45));
+            bool rejected = false;
+            try {
+                client.updateCharacteristicByType(home, room, lamp, "Brightness",
+                                                  prefab::CharacteristicValue::fromInt(150));
+            } catch (const prefab::PrefabException& e) {
+                rejected = e.getHttpCode() == 0;
+            }
+            assert(rejected);
+            rejected = false;
+            try {
+                client.updateCharacteristicByTypeAsync(home, room, lamp, "On", "maybe").get();
+            } catch (const prefab::PrefabException&) {
+                rejected = true;
+            }
+            assert(rejected);
+            assert(server.requestCount("PUT", lampPath) == 6);
+            assert(characteristicValue(server.accessory(home, room, lamp), "Brightness") == "45");
+            std::cout << "✓ Characteristic ID resolution is reused and refreshed" << std::endl;
+        }
+
+        // Response cache serves repeated reads and is invalidated by writes
+        {
+            prefab::ClientConfig config = configFor(server);
+            config.cache.enabled = true;
+            config.cache.accessoryTtlMs = 60000;
+            prefab::PrefabClient client(config);
+            server.resetCounters();
+
+            client.getAccessory(home, room, lamp);
+            client.getAccessory(home, room, lamp);
+            assert(server.requestCount("GET", lampPath) == 1);
+            assert(client.getCacheStats().hits == 1);
+
+            client.updateCharacteristicByType(home, room, lamp, "Brightness", "55");
+            prefab::Accessory fresh = client.getAccessory(home, room, lamp);
+            assert(characteristicValue(fresh, "Brightness") == "55");
+            assert(server.requestCount("GET", lampPath) == 2);
+
+            // Invalidating another home while a read is in flight keeps the read's entry;
+            // invalidating its own home drops it
+            prefab::testing::MockServerOptions slowOptions;
+            slowOptions.layout.homes = 2;
+            slowOptions.latency = std::chrono::milliseconds(50);
+            MockPrefabServer slow(slowOptions);
+            prefab::ClientConfig slowConfig = configFor(slow);
+            slowConfig.cache = config.cache;
+            prefab::PrefabClient slowClient(slowConfig);
+            std::future<prefab::Accessory> read = slowClient.getAccessoryAsync(home, room, lamp);
+            slowClient.invalidateCache(MockPrefabServer::homeName(1));
+            read.get();
+            slowClient.getAccessory(home, room, lamp);
+            assert(slow.requestCount("GET", lampPath) == 1);
+            slowClient.invalidateCache(home);
+            read = slowClient.getAccessoryAsync(home, room, lamp);
+            slowClient.invalidateCache(home);
+            read.get();
+            slowClient.getAccessory(home, room, lamp);
+            assert(slow.requestCount("GET", lampPath) == 3);
+            std::cout << "✓ Response cache" << std::endl;
+        }
+
+        // Batch writes report per-item results
+        {
+            prefab::PrefabClient client(configFor(server));
+            prefab::BatchUpdate batch(client);
+            for (int a = 0; a < 3; ++a) {
+                batch.addByType(home, room, MockPrefabServer::accessoryName(a), "Brightness", "70");
+            }
+            batch.addByType(home, room, "Missing", "Brightness", "70");
+            prefab::BatchResult result = batch.maxParallelRequests(2).send();
+            assert(result.items.size() == 4);
+            assert(result.succeeded() == 3);
+            assert(!result.items[3].success && result.items[3].httpCode == 404);
+            assert(result.peakInFlight >= 1 && result.peakInFlight <= 2);
+            for (int a = 0; a < 3; ++a) {
+                assert(characteristicValue(server.accessory(home, room, MockPrefabServer::accessoryName(a)),
+                                           "Brightness") == "70");
+            }
+
+            // Writes rejected before they are sent finish on the sender's stack, however many there are
+            prefab::BatchUpdate invalid(client);
+            for (int i = 0; i < 200000; ++i) invalid.addByType(home, room, lamp, "On", "maybe");
+            result = invalid.maxParallelRequests(1).send();
+            assert(result.failed() == 200000 && result.peakInFlight == 1);
+            std::cout << "✓ Batch updates" << std::endl;
+        }
+
+        // Coalescing sends far fewer writes than requested and lands on the last value
+        {
+            prefab::ClientConfig config = configFor(server);
+            config.coalescing.enabled = true;
+            config.coalescing.holdWindowMs = 20;
+            prefab::PrefabClient client(config);
+            prefab::Accessory accessory = client.getAccessory(home, room, lamp);
+            prefab::UpdateAccessoryInput update;
+            update.serviceId = accessory.services->at(0).uniqueIdentifier.toString();
+            update.characteristicId = accessory.services->at(0).characteristics.at(1).uniqueIdentifier.toString();
+
+            server.resetCounters();
+            std::vector<std::future<std::string>> writes;
+            for (int i = 0; i < 50; ++i) {
+                update.value = std::to_string(i);
+                writes.push_back(client.updateAccessoryAsync(home, room, lamp, update));
+            }
+            for (auto& write : writes) write.get();
+            assert(server.requestCount("PUT", lampPath) < 10);
+            assert(characteristicValue(server.accessory(home, room, lamp), "Brightness") == "49");
+            std::cout << "✓ Write coalescing" << std::endl;
+        }
+
+        // Snapshot crawl covers the whole generated home
+        {
+            prefab::PrefabClient client(configFor(server));
+            prefab::HomeSnapshot snapshot = client.getSnapshot();
+            assert(snapshot.homes.size() == 1);
+            assert(snapshot.roomCount() == 2);
+            assert(snapshot.accessoryCount() == 6);
+            assert(snapshot.stats.errors.empty());
+            const prefab::Accessory* found = snapshot.findAccessory(home, room, lamp);
+            assert(found && found->services && found->services->size() == 3);
+            std::cout << "✓ Snapshot" << std::endl;
+        }
+
+        // Binary snapshot file round trip and background refresh
+        {
+            const std::string path = (std::filesystem::temp_directory_path() /
+                                      ("prefab-test-" + std::to_string(::getpid()) + ".snapshot")).string();
+            prefab::PrefabClient client(configFor(server));
+            prefab::HomeSnapshot snapshot = client.getSnapshot();
+            prefab::saveSnapshotFile(snapshot, path);
+
+            auto mapped = prefab::MappedSnapshot::open(path);
+            assert(mapped->homeCount() == 1 && mapped->roomCount() == 2 && mapped->accessoryCount() == 6);
+            auto lampView = mapped->findAccessory(home, room, lamp);
+            assert(lampView && lampView->serviceCount() == 3 && !mapped->findAccessory(home, room, "Missing"));
+            const prefab::Accessory* original = snapshot.findAccessory(home, room, lamp);
+            assert(nlohmann::json(lampView->toAccessory()) == nlohmann::json(*original));
+            prefab::HomeSnapshot reloaded = mapped->toSnapshot();
+            assert(reloaded.accessoryCount() == 6);
+            assert(nlohmann::json(*reloaded.findAccessory(home, room, lamp)) == nlohmann::json(*original));
+
+            // Damaged files are rejected, and loadSnapshot falls back to a cold start
+            {
+                std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+                file.seekp(-1, std::ios::end);
+                file.put('\x7f');
+            }
+            bool corrupt = false;
+            try {
+                prefab::MappedSnapshot::open(path);
+            } catch (const prefab::PrefabException& e) {
+                corrupt = std::string(e.what()).find("checksum") != std::string::npos;
+            }
+            assert(corrupt);
+
+            prefab::PrefabClient coldClient(configFor(server));
+            auto refreshed = std::make_shared<std::promise<size_t>>();
+            assert(!coldClient.loadSnapshot(path, prefab::SnapshotOptions(), [&coldClient, refreshed](auto result) {
+                // Called after the save, off the network thread, so waiting on another request is fine
+                auto homes = coldClient.getHomesAsync();
+                assert(homes.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+                refreshed->set_value(result.value().accessoryCount());
+            }));
+            assert(refreshed->get_future().get() == 6);
+
+            // The refresh replaced the damaged file, so the next start is served from it
+            prefab::PrefabClient warmClient(configFor(server));
+            auto warmRefresh = std::make_shared<std::promise<void>>();
+            auto warm = warmClient.loadSnapshot(path, prefab::SnapshotOptions(), [warmRefresh](auto) {
+                warmRefresh->set_value();
+            });
+            assert(warm && warm->accessoryCount() == 6);
+            warmClient.updateCharacteristicByType(home, room, lamp, "Brightness", "35");
+            warmRefresh->get_future().wait();
+            std::remove(path.c_str());
+            std::cout << "✓ Snapshot file" << std::endl;
+        }
+
+        // Load balancing: a dead endpoint is skipped, the faster server gets more work, a restarted one rejoins
+        {
+            prefab::testing::MockServerOptions slowOptions = options;
+            slowOptions.latency = std::chrono::milliseconds(20);
+            MockPrefabServer slow(slowOptions);
+            auto flaky = std::make_unique<MockPrefabServer>(options);
+            const int flakyPort = flaky->port();
+            const std::string flakyUrl = flaky->baseUrl();
+
+            prefab::ClientConfig config = configFor(server);
+            config.loadBalancing.endpoints = {slow.baseUrl(), server.baseUrl(), flakyUrl};
+            config.loadBalancing.healthCheckIntervalMs = 20;
+            prefab::PrefabClient client(config);
+            flaky.reset();  // Offline from here on
+
+            for (int i = 0; i < 30; ++i) assert(client.getHomes().size() == 1);
+            assert(client.getHomesAsync().get().size() == 1);
+            client.updateCharacteristicByType(home, room, lamp, "Brightness", "44");
+            assert(characteristicValue(server.accessory(home, room, lamp), "Brightness") == "44" ||
+                   characteristicValue(slow.accessory(home, room, lamp), "Brightness") == "44");
+
+            auto statusOf = [&](const std::string& url) {
+                for (const auto& endpoint : client.getEndpointStatus()) {
+                    if (endpoint.url == url) return endpoint;
+                }
+                assert(false);
+                return prefab::EndpointStatus();
+            };
+            assert(!statusOf(flakyUrl).healthy && statusOf(flakyUrl).failures >= 1);
+            assert(statusOf(server.baseUrl()).requests > statusOf(slow.baseUrl()).requests);
+            assert(statusOf(slow.baseUrl()).latency > statusOf(server.baseUrl()).latency);
+
+            prefab::testing::MockServerOptions restartOptions = options;
+            restartOptions.port = flakyPort;
+            MockPrefabServer restarted(restartOptions);
+            assert(waitUntil([&] { return statusOf(flakyUrl).healthy; }));
+            std::cout << "✓ Load balancing and failover" << std::endl;
+        }
+
+        // Deadlines cut a slow request short; a hedged GET is answered by the fast server
+        {
+            prefab::testing::MockServerOptions slowOptions = options;
+            slowOptions.latency = std::chrono::milliseconds(1000);
+            MockPrefabServer slow(slowOptions);
+            auto elapsed = [](std::chrono::steady_clock::time_point since) {
+                return std::chrono::steady_clock::now() - since;
+            };
+            auto fails = [](auto&& call) {
+                try {
+                    call();
+                } catch (const prefab::PrefabException&) {
+                    return true;
+                }
+                return false;
+            };
+
+            prefab::PrefabClient slowClient(configFor(slow));
+            auto started = std::chrono::steady_clock::now();
+            assert(fails([&] {
+                prefab::RequestDeadline deadline(std::chrono::milliseconds(50));
+                prefab::RequestDeadline looser(std::chrono::seconds(10));  // Cannot extend the outer one
+                slowClient.getHomes();
+            }));
+            assert(elapsed(started) < std::chrono::milliseconds(500));
+            std::future<std::vector<prefab::Home>> homes;
+            {
+                prefab::RequestDeadline deadline(std::chrono::milliseconds(50));
+                homes = slowClient.getHomesAsync();
+            }
+            assert(fails([&] { homes.get(); }));
+            assert(fails([&] {
+                prefab::RequestDeadline deadline(std::chrono::milliseconds(0));
+                slowClient.getHomes();
+            }));
+            assert(!prefab::RequestDeadline::current());
+
+            // A timeout the deadline cut short neither fails the endpoint nor fails over
+            prefab::ClientConfig balancedConfig = configFor(server);
+            balancedConfig.loadBalancing.endpoints = {slow.baseUrl(), server.baseUrl()};
+            prefab::PrefabClient balanced(balancedConfig);
+            assert(fails([&] {
+                prefab::RequestDeadline deadline(std::chrono::milliseconds(50));
+                balanced.getHomes();
+            }));
+            for (const prefab::EndpointStatus& status : balanced.getEndpointStatus()) {
+                assert(status.healthy && status.failures == 0);
+                assert(status.requests == (status.url == slow.baseUrl() ? 1u : 0u));
+            }
+
+            prefab::ClientConfig shortConfig = configFor(slow);
+            shortConfig.timeoutMs = 50;
+            prefab::PrefabClient shortClient(shortConfig);
+            started = std::chrono::steady_clock::now();
+            assert(fails([&] { shortClient.getHomes(); }));
+            assert(elapsed(started) < std::chrono::milliseconds(500));
+
+            // A coalesced write is sent from the network thread, still under its caller's deadline
+            prefab::ClientConfig coalescedConfig = configFor(slow);
+            coalescedConfig.coalescing.enabled = true;
+            prefab::PrefabClient coalesced(coalescedConfig);
+            prefab::UpdateAccessoryInput update;
+            update.characteristicId = "unknown";
+            update.value = "1";
+            started = std::chrono::steady_clock::now();
+            try {
+                prefab::RequestDeadline deadline(std::chrono::milliseconds(50));
+                coalesced.updateAccessory(home, room, lamp, update);
+                assert(false);
+            } catch (const prefab::PrefabException& e) {
+                assert(e.getHttpCode() == 0);  // Timed out rather than answered
+            }
+            assert(elapsed(started) < std::chrono::milliseconds(500));
+
+            // Untried endpoints tie, so every first attempt goes to the slow server listed first
+            prefab::ClientConfig config = configFor(server);
+            config.loadBalancing.endpoints = {slow.baseUrl(), server.baseUrl()};
+            config.hedging.enabled = true;
+            config.hedging.initialDelayMs = 20;
+            prefab::PrefabClient client(config);
+            for (int i = 0; i < 3; ++i) assert(client.getHomes().size() == 1);
+            assert(client.getHomesAsync().get().size() == 1);
+            const prefab::HedgingStats stats = client.getHedgingStats();
+            assert(stats.hedged >= 1 && stats.hedgeWins >= 1 && stats.hedgeWins <= stats.hedged);
+            assert(prefab::PrefabClient(configFor(server)).getHedgingStats().hedged == 0);
+            std::cout << "✓ Deadlines and hedged reads" << std::endl;
+        }
+
+        // Metrics: per-route counts, error codes, bytes and latencies, and their Prometheus rendering
+        {
+            prefab::PrefabClient client(configFor(server));
+            for (int i = 0; i < 5; ++i) client.getHomes();
+            client.getAccessoryAsync(home, room, lamp).get();
+            try {
+                client.getAccessory(home, room, "Missing");
+            } catch (const prefab::PrefabException&) {
+            }
+            client.updateCharacteristicByType(home, room, lamp, "Brightness", "21");  // IDs known from the read
+
+            const prefab::MetricsSnapshot metrics = client.getMetrics();
+            auto routeOf = [&](const std::string& method, const std::string& route) {
+                for (const auto& entry : metrics.routes) {
+                    if (entry.method == method && entry.route == route) return entry;
+                }
+                assert(false);
+                return prefab::RouteMetrics();
+            };
+            const prefab::RouteMetrics homes = routeOf("GET", "/homes");
+            assert(homes.requests == 5 && homes.errors == 0 && homes.bytesReceived > 0 && homes.bytesSent == 0);
+            assert(homes.latency.count == 5 && homes.dns.count == 5 && homes.transfer.count == 5);
+            assert(homes.latency.max.count() > 0 && homes.latency.percentile(50) <= homes.latency.max);
+            assert(homes.latency.countAtOrBelow(homes.latency.max) <= 5);
+            const prefab::RouteMetrics accessory = routeOf("GET", "/accessories/:home/:room/:accessory");
+            assert(accessory.requests == 2 && accessory.errors == 1 && accessory.errorsByCode.at(404) == 1);
+            assert(routeOf("PUT", "/accessories/:home/:room/:accessory").bytesSent > 0);
+
+            const std::string text = prefab::formatPrometheus(metrics);
+            assert(text.find("prefab_client_requests_total{method=\"GET\",route=\"/homes\"} 5\n") != std::string::npos);
+            assert(text.find("route=\"/accessories/:home/:room/:accessory\",code=\"404\"} 1\n") != std::string::npos);
+            assert(text.find("prefab_client_request_duration_seconds_count{method=\"GET\",route=\"/homes\","
+                             "phase=\"total\"} 5\n") != std::string::npos);
+            assert(text.find("# TYPE prefab_client_request_duration_seconds histogram") != std::string::npos);
+
+            // Buckets are exact below 8 us and within an eighth above
+            for (long long us : {0LL, 1LL, 7LL, 8LL, 9LL, 100LL, 1000LL, 123456LL, 10000000LL}) {
+                const std::chrono::microseconds value(us);
+                const size_t bucket = prefab::HistogramSnapshot::bucketFor(value);
+                assert(prefab::HistogramSnapshot::bucketUpperBound(bucket) >= value);
+                assert(bucket == 0 || prefab::HistogramSnapshot::bucketUpperBound(bucket - 1) < value);
+                assert(prefab::HistogramSnapshot::bucketUpperBound(bucket).count() <= us + us / 8);
+            }
+
+            prefab::ClientConfig quiet = configFor(server);
+            quiet.enableMetrics = false;
+            prefab::PrefabClient unmeasured(quiet);
+            unmeasured.getHomes();
+            assert(unmeasured.getMetrics().routes.empty());
+            std::cout << "✓ Metrics" << std::endl;
+        }
+
+        // Logging: filtered by level before any work, delivered in order through the async ring
+        {
+            struct CaptureSink : prefab::LogSink {
+                std::mutex mutex;
+                std::vector<prefab::LogRecord> records;
+                void write(const prefab::LogRecord& record) override {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    records.push_back(record);
+                }
+            };
+            auto capture = std::make_shared<CaptureSink>();
+            const std::shared_ptr<prefab::LogSink> previousSink = prefab::Logger::sink();
+            const prefab::LogLevel previousLevel = prefab::Logger::level();
+            prefab::Logger::setSink(capture);
+
+            prefab::PrefabClient client(configFor(server));
+            client.getAccessory(home, room, lamp);
+            assert(capture->records.empty());  // Debug is below the default level
+            prefab::Logger::setLevel(prefab::LogLevel::Debug);
+            client.getAccessory(home, room, lamp);
+            assert(capture->records.size() == 1);
+            const prefab::LogRecord record = capture->records[0];
+            assert(record.level == prefab::LogLevel::Debug && std::string(record.component) == "client");
+            assert(record.message == "getAccessory");
+            assert(std::find(record.fields.begin(), record.fields.end(),
+                             std::make_pair(std::string("accessory"), lamp)) != record.fields.end());
+
+            std::ostringstream line;
+            prefab::StreamLogSink(line).write(record);
+            assert(line.str().find("Z DEBUG client: getAccessory home=\"" + home + "\"") != std::string::npos);
+
+            auto async = std::make_shared<prefab::AsyncLogSink>(capture, 64);
+            prefab::Logger::setSink(async);
+            std::vector<std::thread> writers;
+            for (int t = 0; t < 4; ++t) {
+                writers.emplace_back([t] {
+                    for (int i = 0; i < 500; ++i) {
+                        prefab::Logger::write(prefab::LogLevel::Info, "test", "burst",
+                                              {{"writer", std::to_string(t)}, {"i", std::to_string(i)}});
+                    }
+                });
+            }
+            for (auto& writer : writers) writer.join();
+            async->flush();
+            {
+                std::lock_guard<std::mutex> lock(capture->mutex);
+                assert(capture->records.size() - 1 + async->dropped() == 4 * 500);
+                int last[4] = {-1, -1, -1, -1};  // Each writer's records arrive in its order
+                for (size_t i = 1; i < capture->records.size(); ++i) {
+                    const auto& fields = capture->records[i].fields;
+                    const int writer = std::stoi(fields[0].second);
+                    const int index = std::stoi(fields[1].second);
+                    assert(index > last[writer]);
+                    last[writer] = index;
+                }
+            }
+
+            prefab::Logger::setLevel(previousLevel);
+            prefab::Logger::setSink(previousSink);
+            std::cout << "✓ Logging" << std::endl;
+        }
+
+        // Tracing: composite operation -> request -> attempt spans, with the attempt's ID sent to the server
+        {
+            struct CaptureExporter : prefab::SpanExporter {
+                std::mutex mutex;
+                std::vector<prefab::SpanRecord> spans;
+                void exportSpans(const std::vector<prefab::SpanRecord>& batch) override {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    spans.insert(spans.end(), batch.begin(), batch.end());
+                }
+            };
+            auto capture = std::make_shared<CaptureExporter>();
+            const std::string spanFile = (std::filesystem::temp_directory_path() /
+                                          ("prefab-test-" + std::to_string(::getpid()) + ".spans")).string();
+            auto file = std::make_shared<prefab::FileSpanExporter>(spanFile);
+            struct Both : prefab::SpanExporter {
+                std::vector<std::shared_ptr<prefab::SpanExporter>> exporters;
+                void exportSpans(const std::vector<prefab::SpanRecord>& batch) override {
+                    for (const auto& exporter : exporters) exporter->exportSpans(batch);
+                }
+                void flush() override {
+                    for (const auto& exporter : exporters) exporter->flush();
+                }
+            };
+            auto both = std::make_shared<Both>();
+            both->exporters = {capture, file};
+
+            prefab::ClientConfig config = configFor(server);
+            config.tracing.enabled = true;
+            config.tracing.exporter = both;
+            config.tracing.exportIntervalMs = 50;
+            prefab::PrefabClient client(config);
+
+            std::string sceneTrace;
+            {
+                prefab::TraceSpan scene(client, "scene");
+                sceneTrace = scene.context()->traceId;
+                assert(prefab::TraceSpan::current()->spanId == scene.context()->spanId);
+                client.updateCharacteristicByType(home, room, lamp, "Brightness", "21");  // Cold index: GET, then PUT
+                client.updateCharacteristicByTypeAsync(home, room, MockPrefabServer::accessoryName(1),
+                                                       "Brightness", "22").get();
+            }
+            assert(!prefab::TraceSpan::current());
+            client.flushTraces();
+
+            std::lock_guard<std::mutex> lock(capture->mutex);
+            auto find = [&](const std::function<bool(const prefab::SpanRecord&)>& match) {
+                std::vector<const prefab::SpanRecord*> found;
+                for (const auto& span : capture->spans) {
+                    if (match(span)) found.push_back(&span);
+                }
+                return found;
+            };
+            auto attribute = [](const prefab::SpanRecord& span, const std::string& key) {
+                for (const auto& [name, value] : span.attributes) {
+                    if (name == key) return value;
+                }
+                return std::string();
+            };
+            assert(capture->spans.size() == 1 + 2 * (1 + 2 * 2));  // Scene, 2 x (composite, 2 x (request, attempt))
+            for (const auto& span : capture->spans) assert(span.traceId == sceneTrace && !span.error);
+
+            const auto scene = find([](const prefab::SpanRecord& span) { return span.name == "scene"; });
+            assert(scene.size() == 1 && scene[0]->parentSpanId.empty());
+            const auto composites = find([](const prefab::SpanRecord& span) {
+                return span.name == "updateCharacteristicByType";
+            });
+            assert(composites.size() == 2);
+            for (const prefab::SpanRecord* composite : composites) {
+                assert(composite->parentSpanId == scene[0]->spanId);
+                const auto requests = find([&](const prefab::SpanRecord& span) {
+                    return span.parentSpanId == composite->spanId;
+                });
+                assert(requests.size() == 2);
+                assert(requests[0]->name == "GET /accessories/:home/:room/:accessory");
+                assert(requests[1]->name == "PUT /accessories/:home/:room/:accessory");
+                for (const prefab::SpanRecord* request : requests) {
+                    assert(attribute(*request, "prefab.attempts") == "1");
+                    assert(attribute(*request, "http.response.status_code") == "200");
+                    const auto attempts = find([&](const prefab::SpanRecord& span) {
+                        return span.parentSpanId == request->spanId;
+                    });
+                    assert(attempts.size() == 1 && attempts[0]->kind == prefab::SpanKind::Client);
+                    assert(!attribute(*attempts[0], "prefab.server_us").empty());
+                    assert(!attribute(*attempts[0], "prefab.transfer_us").empty());
+                    assert(attempts[0]->start >= request->start && attempts[0]->end <= request->end);
+                }
+            }
+            assert(attribute(*composites[0], "prefab.accessory") == lamp);
+
+            // The server saw the last attempt's own span as the parent of its work
+            const std::optional<prefab::SpanContext> sent = prefab::SpanContext::parse(server.lastTraceparent());
+            assert(sent && sent->traceId == sceneTrace && sent->sampled);
+            assert(find([&](const prefab::SpanRecord& span) {
+                return span.spanId == sent->spanId && span.name == "attempt";
+            }).size() == 1);
+
+            assert(prefab::SpanContext::parse(sent->traceparent())->spanId == sent->spanId);
+            assert(!prefab::SpanContext::parse("00-" + std::string(32, '0') + "-" + std::string(16, 'a') + "-01"));
+            assert(!prefab::SpanContext::parse("00-abc-def-01"));
+            assert(!prefab::SpanContext::parse(sent->traceparent() + "-extra"));
+
+            std::ifstream exported(spanFile);
+            std::string line;
+            assert(std::getline(exported, line));
+            const nlohmann::json otlp = nlohmann::json::parse(line);
+            assert(otlp["resourceSpans"][0]["scopeSpans"][0]["spans"][0]["traceId"] == sceneTrace);
+            std::filesystem::remove(spanFile);
+
+            // Disabled tracing sends no header and records nothing
+            server.resetCounters();
+            prefab::PrefabClient untraced(configFor(server));
+            prefab::TraceSpan ignored(untraced, "ignored");
+            assert(!ignored.context());
+            untraced.getHomes();
+            assert(server.lastTraceparent().empty());
+            std::cout << "✓ Tracing" << std::endl;
+        }
+
+        // Change feed: writes and outside changes reach the mirror, restarts and feed errors resync
+        {
+            prefab::PrefabClient client(configFor(server));
+            prefab::ChangeFeedOptions feedOptions;
+            feedOptions.waitSeconds = 1;
+            feedOptions.retryDelayMs = 20;
+            prefab::ChangeFeed feed(client, feedOptions);
+            feed.watch(home, room, lamp);
+            std::atomic<int> notified{0};
+            feed.subscribe([&](const prefab::CharacteristicChange& change) {
+                if (change.accessory == lamp) notified++;
+            });
+            feed.start();
+            assert(waitUntil([&] { return feed.synchronized() && feed.resyncCount() == 1; }));
+            const uint64_t startSequence = feed.sequence();
+
+            client.updateCharacteristicByType(home, room, lamp, "Brightness", "12");
+            assert(waitUntil([&] { return feed.value(home, room, lamp, "Brightness") == std::optional<std::string>("12"); }));
+            assert(feed.sequence() > startSequence && notified > 0);
+
+            server.setCharacteristicValue(home, room, lamp, "Brightness", "34");
+            assert(waitUntil([&] { return feed.value(home, room, lamp, "Brightness") == std::optional<std::string>("34"); }));
+
+            // A change the feed never reports is picked up by the reread after a restart
+            server.setCharacteristicValue(home, room, lamp, "Brightness", "56", false);
+            server.restartEvents();
+            assert(waitUntil([&] { return feed.value(home, room, lamp, "Brightness") == std::optional<std::string>("56"); }));
+            assert(feed.resyncCount() == 2);
+
+            server.setCharacteristicValue(home, room, lamp, "Brightness", "78", false);
+            server.failEvents(1);
+            assert(waitUntil([&] { return feed.value(home, room, lamp, "Brightness") == std::optional<std::string>("78"); }));
+            assert(feed.resyncCount() >= 3 && feed.synchronized());
+
+            // An accessory watched while running is read again until its first read succeeds
+            const std::string fan = MockPrefabServer::accessoryName(1);
+            const size_t resyncs = feed.resyncCount();
+            server.failAccessoryReads(2);
+            feed.watch(home, room, fan);
+            assert(waitUntil([&] { return feed.accessory(home, room, fan).has_value(); }));
+            assert(feed.resyncCount() == resyncs && feed.synchronized());
+            feed.stop();
+
+            // With load balancing the feed stays on one server, whose epoch it follows
+            MockPrefabServer other(options);
+            prefab::ClientConfig balancedConfig = configFor(server);
+            balancedConfig.loadBalancing.endpoints = {server.baseUrl(), other.baseUrl()};
+            prefab::PrefabClient balanced(balancedConfig);
+            feedOptions.waitSeconds = 0;
+            prefab::ChangeFeed balancedFeed(balanced, feedOptions);
+            balancedFeed.watch(home, room, lamp);
+            server.resetCounters();
+            auto polls = [&] { return server.requestCount("GET", "/events") + other.requestCount("GET", "/events"); };
+            balancedFeed.start();
+            assert(waitUntil([&] { return polls() >= 20; }));
+            balancedFeed.stop();
+            assert(balancedFeed.resyncCount() == 1);
+            assert(server.requestCount("GET", "/events") == 0 || other.requestCount("GET", "/events") == 0);
+            std::cout << "✓ Change feed" << std::endl;
+        }
+
+        // Poller: callbacks only on change, intervals adapt, and the global rate cap holds
+        {
+            prefab::PrefabClient client(configFor(server));
+            prefab::PollerOptions pollerOptions;
+            pollerOptions.tickMs = 5;
+            pollerOptions.minIntervalMs = 20;
+            pollerOptions.initialIntervalMs = 40;
+            pollerOptions.maxIntervalMs = 200;
+            pollerOptions.maxRequestsPerSecond = 1000;
+            prefab::Poller poller(client, pollerOptions);
+            std::mutex seenMutex;
+            std::vector<std::string> seen;
+            const size_t brightness = poller.add(home, room, lamp, "Brightness", [&](const std::string& value) {
+                std::lock_guard<std::mutex> lock(seenMutex);
+                seen.push_back(value);
+            });
+            poller.start();
+            assert(waitUntil([&] { return poller.value(brightness).has_value(); }));
+            assert(waitUntil([&] { return *poller.interval(brightness) > std::chrono::milliseconds(80); }));
+            {
+                std::lock_guard<std::mutex> lock(seenMutex);
+                assert(seen.empty());
+            }
+
+            server.setCharacteristicValue(home, room, lamp, "Brightness", "61", false);
+            assert(waitUntil([&] {
+                std::lock_guard<std::mutex> lock(seenMutex);
+                return seen == std::vector<std::string>{"61"};
+            }));
+            assert(poller.stats().changes == 1 && poller.stats().errors == 0);
+            poller.stop();
+
+            pollerOptions.minIntervalMs = pollerOptions.initialIntervalMs = pollerOptions.maxIntervalMs = 20;
+            pollerOptions.maxRequestsPerSecond = 50;
+            prefab::Poller capped(client, pollerOptions);
+            for (int r = 0; r < 2; ++r) {
+                for (int a = 0; a < 3; ++a) {
+                    capped.add(home, MockPrefabServer::roomName(r), MockPrefabServer::accessoryName(a), "Brightness", nullptr);
+                }
+            }
+            const auto cappedStarted = std::chrono::steady_clock::now();
+            capped.start();
+            assert(waitUntil([&] { return capped.stats().reads >= 10 && capped.stats().deferred > 0; }));
+            capped.stop();
+            const auto cappedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - cappedStarted).count();
+            // Ticks are at least 5 ms apart and each adds a quarter token to a bucket that starts with one
+            assert(capped.stats().reads <= 2 + static_cast<size_t>(cappedMs / 20));
+
+            pollerOptions.maxRequestsPerSecond = 0;
+            prefab::Poller unlimited(client, pollerOptions);
+            for (int a = 0; a < 3; ++a) {
+                unlimited.add(home, room, MockPrefabServer::accessoryName(a), "Brightness", nullptr);
+            }
+            unlimited.start();
+            assert(waitUntil([&] { return unlimited.stats().reads >= 12; }));
+            unlimited.stop();
+            assert(unlimited.stats().deferred == 0);
+            std::cout << "✓ Poller" << std::endl;
+        }
+
+        // Request scheduling: per-server and per-accessory token buckets, interactive requests first
+        {
+            prefab::ClientConfig config = configFor(server);
+            config.scheduling.enabled = true;
+            config.scheduling.serverRate = 20;
+            config.scheduling.serverBurst = 1;
+            config.scheduling.accessoryRate = 0;
+            config.scheduling.maxQueued = 4;
+            prefab::PrefabClient client(config);
+            client.getAccessory(home, room, lamp);  // Learns the characteristic IDs
+
+            // A write queued behind background reads is sent as soon as the server has a token
+            std::mutex orderMutex;
+            std::vector<std::string> order;
+            auto finished = [&](const std::string& what) {
+                std::lock_guard<std::mutex> lock(orderMutex);
+                order.push_back(what);
+            };
+            {
+                prefab::RequestPriorityScope background(prefab::RequestPriority::Background);
+                for (int i = 0; i < 4; ++i) {
+                    client.getHomesAsync([&](prefab::AsyncResult<std::vector<prefab::Home>> result) {
+                        assert(result.ok());
+                        finished("read");
+                    });
+                }
+            }
+            client.updateCharacteristicByTypeAsync(home, room, lamp, "Brightness", "12",
+                [&](prefab::AsyncResult<std::string> result) {
+                    assert(result.ok());
+                    finished("write");
+                });
+            assert(waitUntil([&] {
+                std::lock_guard<std::mutex> lock(orderMutex);
+                return order.size() == 5;
+            }));
+            assert(std::find(order.begin(), order.end(), "write") - order.begin() <= 2);
+
+            // Requests beyond a full queue fail at once
+            std::atomic<int> full{0};
+            std::atomic<int> answered{0};
+            {
+                prefab::RequestPriorityScope background(prefab::RequestPriority::Background);
+                for (int i = 0; i < 8; ++i) {
+                    client.getHomesAsync([&](prefab::AsyncResult<std::vector<prefab::Home>> result) {
+                        if (!result.ok()) {
+                            try {
+                                result.value();
+                            } catch (const prefab::PrefabException& e) {
+                                if (std::string(e.what()).find("Request queue full") != std::string::npos) full++;
+                            }
+                        }
+                        answered++;
+                    });
+                }
+            }
+            assert(waitUntil([&] { return answered == 8; }));
+            assert(full >= 3);
+
+            const prefab::MetricsSnapshot metrics = client.getMetrics();
+            assert(metrics.queues.size() == 3);
+            const prefab::QueueMetrics& interactive = metrics.queues[0];
+            const prefab::QueueMetrics& queued = metrics.queues[2];
+            assert(interactive.priority == "interactive" && interactive.admitted == 1);
+            assert(queued.priority == "background" && queued.depth == 0);
+            assert(queued.admitted + queued.rejected == 12 && queued.rejected == static_cast<uint64_t>(full.load()));
+            assert(queued.wait.count == queued.admitted && queued.wait.max >= std::chrono::milliseconds(40));
+            const std::string text = prefab::formatPrometheus(metrics);
+            assert(text.find("prefab_client_queue_rejected_total{priority=\"background\"} " +
+                             std::to_string(full.load()) + "\n") != std::string::npos);
+            assert(text.find("prefab_client_queue_wait_seconds_count{priority=\"background\"}") != std::string::npos);
+        }
+        {
+            // Each accessory has its own bucket, and a deadline bounds the wait for it
+            prefab::ClientConfig config = configFor(server);
+            config.scheduling.enabled = true;
+            config.scheduling.serverRate = 0;
+            config.scheduling.accessoryRate = 10;
+            config.scheduling.accessoryBurst = 1;
+            prefab::PrefabClient client(config);
+            std::vector<std::future<prefab::Accessory>> reads;
+            for (int i = 0; i < 3; ++i) reads.push_back(client.getAccessoryAsync(home, room, lamp));
+            for (auto& read : reads) read.get();
+            // One token to start with, then one every 100 ms: the last read waited for two refills
+            prefab::QueueMetrics normal = client.getMetrics().queues[1];
+            assert(normal.admitted == 3 && normal.wait.count == 3);
+            assert(normal.wait.max >= std::chrono::milliseconds(150));
+            try {
+                prefab::RequestDeadline deadline(std::chrono::milliseconds(20));
+                client.getAccessory(home, room, lamp);
+                assert(false);
+            } catch (const prefab::PrefabException& e) {
+                assert(std::string(e.what()) == "Deadline exceeded");
+            }
+
+            // A failover takes a token of its own, from the bucket of the endpoint it goes to
+            prefab::ClientConfig balancedConfig = configFor(server);
+            balancedConfig.loadBalancing.endpoints = {"http://127.0.0.1:1", server.baseUrl()};
+            balancedConfig.scheduling.enabled = true;
+            balancedConfig.scheduling.serverRate = 0.01;
+            balancedConfig.scheduling.serverBurst = 1;
+            balancedConfig.scheduling.accessoryRate = 0;
+            prefab::PrefabClient balanced(balancedConfig);
+            assert(balanced.getHomes().size() == 1);
+            normal = balanced.getMetrics().queues[1];
+            assert(normal.admitted == 2 && normal.depth == 0);
+            std::cout << "✓ Request scheduling" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << std::endl;
+    std::cout << "All client tests passed!" << std::endl;
+    return 0;
+}
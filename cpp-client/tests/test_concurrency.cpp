@@ -0,0 +1,137 @@
+#include <iostream>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <prefab/prefab.h>
+#include <mock_server.h>
+
+using prefab::testing::MockPrefabServer;
+
+// One client shared by a pool of workers while its server is swapped underneath them and
+// other clients come and go. Build with -DPREFAB_SANITIZER=thread to have ThreadSanitizer
+// check it; without it, it still checks that no request fails or hangs.
+
+static prefab::ClientConfig configFor(const MockPrefabServer& server) {
+    prefab::ClientConfig config(server.baseUrl());
+    config.enableMdnsDiscovery = false;
+    return config;
+}
+
+int main() {
+    std::cout << "Testing one PrefabClient shared by many threads..." << std::endl;
+
+    prefab::testing::MockServerOptions options;
+    options.layout.roomsPerHome = 2;
+    options.layout.accessoriesPerRoom = 3;
+    MockPrefabServer first(options);
+    MockPrefabServer second(options);  // Same data and IDs, so writes resolved on one work on the other
+
+    const std::string home = MockPrefabServer::homeName(0);
+    const std::string room = MockPrefabServer::roomName(0);
+
+    prefab::ClientConfig config = configFor(first);
+    config.cache.enabled = true;
+    config.cache.accessoryTtlMs = 20;
+    config.coalescing.enabled = true;
+    config.coalescing.holdWindowMs = 2;
+    config.hedging.enabled = true;
+    config.hedging.initialDelayMs = 5;
+    config.tracing.enabled = true;
+    config.scheduling.enabled = true;
+    config.scheduling.serverRate = 2000;
+    config.scheduling.serverBurst = 50;
+    config.scheduling.accessoryRate = 500;
+    prefab::PrefabClient client(config);
+
+    constexpr int kWorkers = 8;
+    constexpr int kIterations = 150;
+    std::atomic<int> running{kWorkers};
+    std::atomic<int> failures{0};
+    auto fail = [&failures](const std::string& where, const std::exception& e) {
+        std::cerr << where << ": " << e.what() << std::endl;
+        failures++;
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kWorkers; ++t) {
+        threads.emplace_back([&, t] {
+            const std::string accessory = MockPrefabServer::accessoryName(t % 3);
+            for (int i = 0; i < kIterations; ++i) {
+                try {
+                    switch (i % 5) {
+                    case 0:
+                        if (client.getHomes().size() != 1) failures++;
+                        break;
+                    case 1:
+                        if (client.getAccessory(home, room, accessory).name != accessory) failures++;
+                        break;
+                    case 2:
+                        client.updateCharacteristicByType(home, room, accessory, "Brightness", std::to_string(i % 100));
+                        break;
+                    case 3:
+                        if (client.getAccessoriesAsync(home, room).get().size() != 3) failures++;
+                        break;
+                    default: {
+                        prefab::RequestDeadline deadline(std::chrono::seconds(10));
+                        prefab::TraceSpan span(client, "worker");
+                        if (client.getRoom(home, room).name != room) failures++;
+                    }
+                    }
+                } catch (const std::exception& e) {
+                    fail("worker " + std::to_string(t), e);
+                }
+            }
+            running--;
+        });
+    }
+
+    // Swap the server while requests are in flight
+    threads.emplace_back([&] {
+        for (int i = 0; running > 0; ++i) {
+            client.setBaseUrl((i % 2 ? second : first).baseUrl());
+            const std::string url = client.getBaseUrl();
+            if (url != first.baseUrl() && url != second.baseUrl()) failures++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    // Read statistics and drop cached state alongside the workers
+    threads.emplace_back([&] {
+        while (running > 0) {
+            client.getCacheStats();
+            client.getHedgingStats();
+            prefab::formatPrometheus(client.getMetrics());
+            client.getEndpointStatus();
+            client.invalidateCache(home);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    });
+
+    // Other clients start and stop on their own threads, each touching curl's global state
+    for (int c = 0; c < 2; ++c) {
+        threads.emplace_back([&] {
+            while (running > 0) {
+                try {
+                    prefab::PrefabClient other(configFor(second));
+                    other.getHomes();
+                } catch (const std::exception& e) {
+                    fail("short-lived client", e);
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) thread.join();
+
+    assert(failures == 0);
+    assert(first.requestCount() > 0 && second.requestCount() > 0);
+    const std::string lamp = MockPrefabServer::accessoryName(0);
+    assert(client.getAccessory(home, room, lamp).name == lamp);
+    std::cout << "✓ Concurrent requests, server swaps and client churn" << std::endl;
+
+    std::cout << "All concurrency tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <prefab/prefab.h>
+#include <prefab/coro.h>
+
+using prefab::coro::Task;
+
+static Task<int> value(int v) {
+    co_return v;
+}
+
+static Task<int> sum(std::vector<int> values) {
+    std::vector<Task<int>> tasks;
+    for (int v : values) tasks.push_back(value(v));
+    auto results = co_await prefab::coro::when_all(std::move(tasks));
+    int total = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        assert(results[i] == values[i]);
+        total += results[i];
+    }
+    co_return total;
+}
+
+static Task<int> failing() {
+    throw std::runtime_error("boom");
+    co_return 0;
+}
+
+int main() {
+    std::cout << "Testing Prefab C++ coroutine front-end..." << std::endl;
+
+    try {
+        // Plain task composition
+        assert(prefab::coro::sync_wait(value(42)) == 42);
+        assert(prefab::coro::sync_wait(sum({1, 2, 3, 4})) == 10);
+        assert(prefab::coro::sync_wait(sum({})) == 0);
+        std::cout << "✓ Task and when_all test passed" << std::endl;
+
+        // Errors inside a fan-out reach the awaiter
+        bool threw = false;
+        try {
+            std::vector<Task<int>> tasks;
+            tasks.push_back(value(1));
+            tasks.push_back(failing());
+            prefab::coro::sync_wait(prefab::coro::when_all(std::move(tasks)));
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+        std::cout << "✓ when_all error propagation test passed" << std::endl;
+
+        // Network errors surface as PrefabException, resumed on the run loop thread
+        prefab::ClientConfig config("http://127.0.0.1:1");
+        config.enableMdnsDiscovery = false;
+        prefab::PrefabClient client(config);
+
+        prefab::coro::RunLoop loop;
+        prefab::coro::AsyncClient asyncClient(client, loop.executor());
+        std::thread::id loopThread = std::this_thread::get_id();
+
+        bool sawError = false;
+        bool connected = true;
+        auto rule = [&]() -> Task<void> {
+            connected = co_await asyncClient.testConnectionAsync();
+            assert(std::this_thread::get_id() == loopThread);
+            try {
+                co_await asyncClient.getRoomsAsync("Test Home");
+            } catch (const prefab::PrefabException&) {
+                sawError = true;
+            }
+            assert(std::this_thread::get_id() == loopThread);
+        };
+        prefab::coro::spawn(rule(), [&loop](std::exception_ptr) { loop.stop(); });
+        loop.run();
+
+        assert(!connected);
+        assert(sawError);
+        std::cout << "✓ AsyncClient error propagation test passed" << std::endl;
+
+        std::cout << std::endl;
+        std::cout << "All coroutine tests passed!" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
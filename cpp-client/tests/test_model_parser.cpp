@@ -0,0 +1,151 @@
+#include <iostream>
+#include <cassert>
+#include <prefab/models.h>
+#include <prefab/arena.h>
+#include "model_parser.h"
+
+using json = nlohmann::json;
+
+// The streaming parser must produce exactly what the from_json overloads produce
+static void assertSameAsDom(const std::string& body) {
+    prefab::Accessory streamed;
+    std::string error;
+    bool ok = prefab::parseAccessoryJson(body, streamed, error);
+    if (!ok) std::cerr << "unexpected error: " << error << std::endl;
+    assert(ok);
+
+    prefab::Accessory dom = json::parse(body).get<prefab::Accessory>();
+    assert(json(streamed) == json(dom));
+}
+
+static void assertRejected(const std::string& body, const std::string& expected) {
+    prefab::Accessory accessory;
+    std::string error;
+    assert(!prefab::parseAccessoryJson(body, accessory, error));
+    if (error.find(expected) == std::string::npos) std::cerr << "unexpected error: " << error << std::endl;
+    assert(error.find(expected) != std::string::npos);
+}
+
+static prefab::Uuid uuid(const char* text) {
+    return *prefab::Uuid::parse(text);
+}
+
+static prefab::Accessory sampleAccessory() {
+    prefab::Characteristic brightness;
+    brightness.uniqueIdentifier = uuid("6A2B0C11-73D4-4F6E-9C41-0D8E5B7A3C01");
+    brightness.description = "Brightness";
+    brightness.properties = {"read", "write", "notify"};
+    brightness.typeName = prefab::InternedString("Brightness");
+    brightness.type = uuid("00000008-0000-1000-8000-0026BB765291");
+    brightness.metadata.format = "int";
+    brightness.metadata.units = "percentage";
+    brightness.metadata.minimumValue = "0";
+    brightness.metadata.maximumValue = "100";
+    brightness.metadata.validValues = std::vector<std::string>{"0", "50", "100"};
+    brightness.value = "42";
+
+    prefab::Characteristic on = brightness;
+    on.uniqueIdentifier = uuid("6A2B0C11-73D4-4F6E-9C41-0D8E5B7A3C02");
+    on.description = "Power State \"On\"";
+    on.typeName = prefab::InternedString("On");
+    on.type = uuid("00000025-0000-1000-8000-0026BB765291");
+    on.metadata = prefab::CharacteristicMetadata();
+    on.value = "1";
+
+    prefab::Service light;
+    light.uniqueIdentifier = uuid("B7E3F0A2-1C5D-4E8B-A6F4-92D0C3E1B501");
+    light.name = "Light";
+    light.typeName = prefab::InternedString("Lightbulb");
+    light.type = uuid("00000043-0000-1000-8000-0026BB765291");
+    light.isPrimary = true;
+    light.isUserInteractive = true;
+    light.associatedType = "none";
+    light.characteristics = {brightness, on};
+
+    prefab::Service info = light;
+    info.uniqueIdentifier = uuid("B7E3F0A2-1C5D-4E8B-A6F4-92D0C3E1B502");
+    info.isPrimary = false;
+    info.associatedType.reset();
+    info.characteristics.clear();
+
+    prefab::Accessory accessory;
+    accessory.home = "Test Home";
+    accessory.room = "Living Room";
+    accessory.name = "Smart Light é";
+    accessory.category = "Lightbulb";
+    accessory.isReachable = true;
+    accessory.supportsIdentify = false;
+    accessory.manufacturer = "Test Manufacturer";
+    accessory.services = std::vector<prefab::Service>{light, info};
+    return accessory;
+}
+
+int main() {
+    std::cout << "Testing streaming accessory parser..." << std::endl;
+
+    std::string full = json(sampleAccessory()).dump();
+    assertSameAsDom(full);
+    assertSameAsDom(R"({"home":"H","room":"R","name":"Basic"})");
+    std::cout << "✓ Matches DOM parsing" << std::endl;
+
+    // Nulls for optional fields, null metadata and unknown keys of every shape
+    assertSameAsDom(R"({"home":"H","room":"R","name":"A","category":null,"isBridged":null,"services":[
+        {"uniqueIdentifier":"b7e3f0a2-1c5d-4e8b-a6f4-92d0c3e1b503","name":"N","typeName":"T","type":"0000003E-0000-1000-8000-0026BB765291","isPrimary":false,"isUserInteractive":true,
+         "associatedType":null,"extra":{"nested":[1,{"deep":[]}]},"characteristics":[
+            {"uniqueIdentifier":"6A2B0C11-73D4-4F6E-9C41-0D8E5B7A3C03","description":"D","properties":[],"typeName":"T",
+             "type":"00000023-0000-1000-8000-0026BB765291",
+             "metadata":null,"value":"v","future":[{"a":1},2.5,null,true]}]}],
+        "unknownNumber":7,"unknownString":"x"})");
+    std::cout << "✓ Skips unknown keys and accepts nulls" << std::endl;
+
+    std::vector<prefab::Accessory> list;
+    std::string error;
+    std::string listBody = json::array({json(sampleAccessory()), json::parse(R"({"home":"H","room":"R","name":"B"})")}).dump();
+    assert(prefab::parseAccessoryListJson(listBody, list, error));
+    assert(list.size() == 2);
+    assert(json(list) == json::parse(listBody).get<std::vector<prefab::Accessory>>());
+    assert(prefab::parseAccessoryListJson("[]", list, error) && list.empty());
+    std::cout << "✓ Parses accessory lists" << std::endl;
+
+    assertRejected(R"({"home":"H","room":"R"})", "missing required field 'name' in accessory");
+    assertRejected(R"({"home":"H","room":"R","name":"A","services":[{"name":"N","typeName":"T",
+        "uniqueIdentifier":"B7E3F0A2-1C5D-4E8B-A6F4-92D0C3E1B501","type":"00000043-0000-1000-8000-0026BB765291",
+        "isUserInteractive":true,"characteristics":[]}]})",
+                   "missing required field 'isPrimary' in service");
+    assertRejected(R"({"home":"H","room":"R","name":3})", "field 'name' has the wrong type");
+    assertRejected(R"({"home":"H","room":null,"name":"A"})", "field 'room' must not be null");
+    assertRejected(R"({"home":"H","room":"R","name":"A","services":{}})", "field 'services' has the wrong type");
+    assertRejected(R"({"home":"H","room":"R","name":"A","services":[{"uniqueIdentifier":"S1","name":"N",
+        "typeName":"T","type":"U","isPrimary":true,"isUserInteractive":true,"characteristics":[]}]})",
+                   "field 'uniqueIdentifier' is not a UUID");
+    assertRejected(R"({"home":"H","room":"R","name":"A")", "parse error");
+    assertRejected(R"([{"home":"H","room":"R","name":"A"}])", "expected an accessory object");
+    assertRejected("null", "expected an accessory object");
+    assert(!prefab::parseAccessoryListJson(R"({"home":"H"})", list, error));
+    std::cout << "✓ Rejects malformed accessories" << std::endl;
+
+    // Arena parsing matches heap parsing, and a cleared arena is refilled without touching the heap
+    prefab::AccessoryArena arena(256);
+    assert(prefab::parseAccessoryListJson(listBody, arena.accessories(), error));
+    assert(arena.accessories().size() == 2);
+    assert(json(prefab::toAccessory(arena.accessories()[0])) == json::parse(full).get<prefab::Accessory>());
+    assert(arena.overflowBytes() > 0);
+    for (int round = 0; round < 3; ++round) {
+        arena.clear();
+        assert(arena.bytesUsed() == 0 && arena.accessories().empty());
+        assert(prefab::parseAccessoryListJson(listBody, arena.accessories(), error));
+        assert(arena.accessories().size() == 2 && arena.overflowBytes() == 0);
+    }
+    prefab::pmr::Accessory& single = arena.accessories().emplace_back();
+    assert(prefab::parseAccessoryJson(full, single, error));
+    assert(json(prefab::toAccessory(single)) == json::parse(full).get<prefab::Accessory>());
+    const auto& brightness = single.services->front().characteristics.front();
+    assert(brightness.metadata.constraints.format == prefab::ValueFormat::Int && brightness.typedValue.asInt() == 42);
+    assert(!prefab::parseAccessoryListJson(R"([{"home":"H","room":"R","name":"A"},{"home":"H"}])", arena.accessories(), error));
+    assert(arena.accessories().size() == 3);
+    std::cout << "✓ Parses into an arena" << std::endl;
+
+    std::cout << std::endl;
+    std::cout << "All streaming parser tests passed!" << std::endl;
+    return 0;
+}
@@ -55,7 +55,62 @@ int main() {
         assert(update.characteristicId == update2.characteristicId);
         assert(update.value == update2.value);
         std::cout << "✓ UpdateAccessoryInput serialization test passed" << std::endl;
-        
+
+        // Test typed values decoded from metadata.format
+        nlohmann::json j5 = {
+            {"uniqueIdentifier", "6a2b0c11-73d4-4f6e-9c41-0d8e5b7a3c01"}, {"description", "Brightness"},
+            {"properties", nlohmann::json::array()},
+            {"typeName", "Brightness"}, {"type", "00000008-0000-1000-8000-0026BB765291"},
+            {"metadata", {{"format", "int"}, {"minimumValue", "0"}, {"maximumValue", "100"}, {"stepValue", "5"}}},
+            {"value", "40"}
+        };
+        auto brightness = j5.get<prefab::Characteristic>();
+        assert(brightness.typedValue.isInt() && brightness.typedValue.asInt() == 40);
+        const prefab::ValueConstraints& constraints = brightness.metadata.constraints;
+        assert(constraints.format == prefab::ValueFormat::Int);
+        std::string error;
+        assert(constraints.check("45", error));
+        assert(!constraints.check("150", error));
+        assert(!constraints.check("42", error));
+        assert(!constraints.check("4.5", error));
+        assert(!constraints.check(prefab::CharacteristicValue::fromString("on"), error));
+        brightness.setValue(prefab::CharacteristicValue::fromFloat(60.0));
+        assert(brightness.value == "60" && constraints.check(brightness.typedValue, error));
+
+        auto on = prefab::CharacteristicValue::parse("true", prefab::ValueFormat::Bool);
+        assert(on && on->isBool() && on->asBool() && on->toString() == "1");
+        assert(!prefab::CharacteristicValue::parse("maybe", prefab::ValueFormat::Bool));
+        auto hue = prefab::CharacteristicValue::parse("22.5", prefab::ValueFormat::Float);
+        assert(hue && hue->asFloat() == 22.5 && hue->toString() == "22.5");
+        assert(prefab::CharacteristicValue::parse("", prefab::ValueFormat::UInt8)->isEmpty());
+        prefab::ValueConstraints uint8;
+        uint8.format = prefab::ValueFormat::UInt8;
+        assert(!uint8.check("256", error) && !uint8.check("-1", error) && uint8.check("255", error));
+        std::cout << "✓ Typed characteristic value test passed" << std::endl;
+
+        // Test binary UUIDs and interned type names
+        assert(brightness.uniqueIdentifier.toString() == "6A2B0C11-73D4-4F6E-9C41-0D8E5B7A3C01");
+        assert(brightness.uniqueIdentifier == "6a2b0c11-73d4-4f6e-9c41-0d8e5b7a3c01");
+        assert(brightness.type == "00000008-0000-1000-8000-0026BB765291");
+        assert(brightness.type != "not-a-uuid");
+        assert(!prefab::Uuid::parse("00000008-0000-1000-8000-0026BB76529G"));
+        bool rejected = false;
+        try {
+            nlohmann::json("not-a-uuid").get<prefab::Uuid>();
+        } catch (const nlohmann::json::exception&) {
+            rejected = true;
+        }
+        assert(rejected);
+        assert(prefab::Uuid::parse(brightness.type.toString()) == brightness.type);
+        assert(brightness.typeName == prefab::InternedString("Brightness"));
+        assert(&brightness.typeName.str() == &prefab::InternedString(std::string("Bright") + "ness").str());
+        assert(brightness.typeName == "Brightness" && brightness.typeName != "Hue");
+        assert(!prefab::InternedString::find("Never interned anywhere"));
+        auto brightness2 = nlohmann::json(brightness).get<prefab::Characteristic>();
+        assert(brightness2.uniqueIdentifier == brightness.uniqueIdentifier && brightness2.type == brightness.type);
+        assert(brightness2.typeName == brightness.typeName);
+        std::cout << "✓ UUID and interned type name test passed" << std::endl;
+
         std::cout << std::endl;
         std::cout << "All model tests passed!" << std::endl;
         